@@ -0,0 +1,1054 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * lxqt_wallet-agent keeps wallets unlocked in locked memory and serves requests of processes of the same
+ * user over a unix domain socket.See lxqtwallet_agent.h for the protocol.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include "lxqtwallet.h"
+#include "lxqtwallet_agent.h"
+
+#define MAX_CLIENTS 64
+
+/*
+ * modified wallets are saved after this many seconds without further modifications
+ */
+#define SAVE_DELAY 1
+
+/*
+ * a client that stalls in the middle of a message for this many seconds is disconnected
+ */
+#define CLIENT_TIMEOUT 5
+
+/*
+ * bytes read from a client socket at a time
+ */
+#define READ_SIZE 65536
+
+#define StringsAreEqual( x,y ) strcmp( x,y ) == 0
+
+struct agent_wallet
+{
+    lxqt_wallet_t wallet;
+    char *wallet_name;
+    char *application_name;
+    time_t last_used;
+    time_t modified;
+    /*
+     * memory file created by lxqt_wallet_share(),-1 until a client asks for it and after the wallet is modified
+     */
+    int shared_fd;
+    struct agent_wallet *next;
+};
+
+/*
+ * Client sockets are non blocking and each client has its own buffers,a request is processed once all of it
+ * has arrived and its reply is sent as the socket takes it so that a slow client never holds up the others.
+ */
+struct agent_client
+{
+    int fd;
+    char *input;
+    u_int64_t input_size;
+    u_int64_t input_capacity;
+    char *output;
+    u_int64_t output_size;
+    u_int64_t output_sent;
+    /*
+     * descriptor that goes out with the first byte of the pending reply,-1 if there is none
+     */
+    int passed_fd;
+    time_t last_progress;
+    int failed;
+};
+
+static struct agent_wallet *_wallets;
+
+static volatile sig_atomic_t _stop;
+
+static void _signal_handler(int sig)
+{
+    (void)sig;
+    _stop = 1;
+}
+
+static void _help(void)
+{
+    puts("\
+usage: lxqt_wallet-agent [-f] [-t seconds]\n\
+       lxqt_wallet-agent -k\n\n\
+-f          : stay in the foreground\n\
+-t seconds  : lock wallets that were not used for \"seconds\" seconds\n\
+-k          : stop a running agent\n\n\
+The agent socket path is printed on start up as a shell command that exports\n\
+LXQT_WALLET_AGENT_SOCKET environment variable.");
+}
+
+static struct agent_wallet *_find_wallet(const char *wallet_name, const char *application_name)
+{
+    struct agent_wallet *e;
+
+    for (e = _wallets; e != NULL; e = e->next)
+    {
+        if (StringsAreEqual(e->wallet_name, wallet_name) && StringsAreEqual(e->application_name, application_name))
+        {
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+static lxqt_wallet_error _close_wallet(struct agent_wallet *w)
+{
+    struct agent_wallet **e;
+    lxqt_wallet_error r;
+
+    for (e = &_wallets; *e != NULL; e = &(*e)->next)
+    {
+        if (*e == w)
+        {
+            *e = w->next;
+            break;
+        }
+    }
+
+    if (w->shared_fd != -1)
+    {
+        close(w->shared_fd);
+    }
+
+    r = lxqt_wallet_close(&w->wallet);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        fprintf(stderr, "lxqt_wallet-agent: failed to save wallet \"%s\" of \"%s\"\n", w->wallet_name, w->application_name);
+    }
+
+    free(w->wallet_name);
+    free(w->application_name);
+    free(w);
+
+    return r;
+}
+
+static void _close_all_wallets(void)
+{
+    while (_wallets != NULL)
+    {
+        _close_wallet(_wallets);
+    }
+}
+
+static lxqt_wallet_error _unlock_wallet(const lxqt_wallet_agent_message_t *m)
+{
+    struct agent_wallet *e;
+    lxqt_wallet_t wallet;
+    lxqt_wallet_error r;
+
+    if (m->count != 3)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    if (_find_wallet(m->argument[ 0 ], m->argument[ 1 ]) != NULL)
+    {
+        return lxqt_wallet_no_error;
+    }
+
+    r = lxqt_wallet_open(&wallet, m->argument[ 2 ], m->size[ 2 ], m->argument[ 0 ], m->argument[ 1 ]);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    e = calloc(1, sizeof(struct agent_wallet));
+
+    if (e == NULL)
+    {
+        lxqt_wallet_close(&wallet);
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    e->wallet           = wallet;
+    e->wallet_name      = strdup(m->argument[ 0 ]);
+    e->application_name = strdup(m->argument[ 1 ]);
+    e->last_used        = time(NULL);
+    e->shared_fd        = -1;
+
+    if (e->wallet_name == NULL || e->application_name == NULL)
+    {
+        free(e->wallet_name);
+        free(e->application_name);
+        free(e);
+        lxqt_wallet_close(&wallet);
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    e->next  = _wallets;
+    _wallets = e;
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * pack all keys of a wallet into [ u_int32_t key size ][ key ] nodes
+ */
+static lxqt_wallet_error _list_keys(lxqt_wallet_t wallet, char **buffer, u_int32_t *buffer_size)
+{
+    lxqt_wallet_iterator_t iter;
+    u_int64_t size = 0;
+    char *e;
+
+    memset(&iter, '\0', sizeof(iter));
+
+    while (lxqt_wallet_iter_read_key(wallet, &iter))
+    {
+        size += sizeof(u_int32_t) + iter.entry.key_size;
+    }
+
+    if (size > LXQT_WALLET_AGENT_MAX_MESSAGE_SIZE)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    e = malloc(size + 1);
+
+    if (e == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    *buffer      = e;
+    *buffer_size = size;
+
+    memset(&iter, '\0', sizeof(iter));
+
+    while (lxqt_wallet_iter_read_key(wallet, &iter))
+    {
+        memcpy(e, &iter.entry.key_size, sizeof(u_int32_t));
+        memcpy(e + sizeof(u_int32_t), iter.entry.key, iter.entry.key_size);
+        e += sizeof(u_int32_t) + iter.entry.key_size;
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+static void _drop_shared_copy(struct agent_wallet *w)
+{
+    if (w->shared_fd != -1)
+    {
+        close(w->shared_fd);
+        w->shared_fd = -1;
+    }
+}
+
+static void _reply(struct agent_client *c, lxqt_wallet_error r, u_int32_t count, const char **argument,
+                   const u_int32_t *size)
+{
+    if (_lxqt_wallet_agent_pack((u_int32_t)r, count, argument, size, &c->output, &c->output_size))
+    {
+        c->failed = 1;
+    }
+
+    c->output_sent = 0;
+}
+
+/*
+ * returns 1 if the agent should stop
+ */
+static int _process_request(struct agent_client *c, const lxqt_wallet_agent_message_t *m)
+{
+    lxqt_wallet_key_values_t kv;
+    struct agent_wallet *w;
+    lxqt_wallet_error r;
+    char *buffer;
+    u_int32_t size;
+    const char *e;
+
+    if (m->type == LXQT_WALLET_AGENT_STOP)
+    {
+        _reply(c, lxqt_wallet_no_error, 0, NULL, NULL);
+        return 1;
+    }
+
+    if (m->type == LXQT_WALLET_AGENT_UNLOCK)
+    {
+        _reply(c, _unlock_wallet(m), 0, NULL, NULL);
+        return 0;
+    }
+
+    if (m->count < 2)
+    {
+        _reply(c, lxqt_wallet_invalid_argument, 0, NULL, NULL);
+        return 0;
+    }
+
+    w = _find_wallet(m->argument[ 0 ], m->argument[ 1 ]);
+
+    if (w == NULL)
+    {
+        _reply(c, lxqt_wallet_wallet_not_unlocked, 0, NULL, NULL);
+        return 0;
+    }
+
+    w->last_used = time(NULL);
+
+    switch (m->type)
+    {
+    case LXQT_WALLET_AGENT_LOCK:
+
+        _reply(c, _close_wallet(w), 0, NULL, NULL);
+        break;
+
+    case LXQT_WALLET_AGENT_SAVE:
+
+        r = lxqt_wallet_no_error;
+
+        if (w->modified != 0)
+        {
+            r = lxqt_wallet_save(w->wallet);
+
+            if (r == lxqt_wallet_no_error)
+            {
+                w->modified = 0;
+            }
+        }
+
+        _reply(c, r, 0, NULL, NULL);
+        break;
+
+    case LXQT_WALLET_AGENT_HAS_WALLET:
+
+        _reply(c, lxqt_wallet_no_error, 0, NULL, NULL);
+        break;
+
+    case LXQT_WALLET_AGENT_HAS_KEY:
+
+        if (m->count != 3)
+        {
+            r = lxqt_wallet_invalid_argument;
+        }
+        else if (lxqt_wallet_wallet_has_key(w->wallet, m->argument[ 2 ], m->size[ 2 ]))
+        {
+            r = lxqt_wallet_no_error;
+        }
+        else
+        {
+            r = lxqt_wallet_key_not_found;
+        }
+
+        _reply(c, r, 0, NULL, NULL);
+        break;
+
+    case LXQT_WALLET_AGENT_GET:
+
+        if (m->count != 3)
+        {
+            _reply(c, lxqt_wallet_invalid_argument, 0, NULL, NULL);
+        }
+        else if (lxqt_wallet_read_key_value(w->wallet, m->argument[ 2 ], m->size[ 2 ], &kv))
+        {
+            e = kv.key_value == NULL ? "" : kv.key_value;
+            _reply(c, lxqt_wallet_no_error, 1, &e, &kv.key_value_size);
+        }
+        else
+        {
+            _reply(c, lxqt_wallet_key_not_found, 0, NULL, NULL);
+        }
+        break;
+
+    case LXQT_WALLET_AGENT_SET:
+
+        if (m->count != 4)
+        {
+            r = lxqt_wallet_invalid_argument;
+        }
+        else
+        {
+            /*
+             * replace an existing entry
+             */
+            while (lxqt_wallet_wallet_has_key(w->wallet, m->argument[ 2 ], m->size[ 2 ]))
+            {
+                lxqt_wallet_delete_key(w->wallet, m->argument[ 2 ], m->size[ 2 ]);
+            }
+
+            r = lxqt_wallet_add_key(w->wallet, m->argument[ 2 ], m->size[ 2 ], m->argument[ 3 ], m->size[ 3 ]);
+
+            w->modified = w->last_used;
+
+            _drop_shared_copy(w);
+        }
+
+        _reply(c, r, 0, NULL, NULL);
+        break;
+
+    case LXQT_WALLET_AGENT_DELETE:
+
+        if (m->count != 3)
+        {
+            r = lxqt_wallet_invalid_argument;
+        }
+        else
+        {
+            r = lxqt_wallet_delete_key(w->wallet, m->argument[ 2 ], m->size[ 2 ]);
+
+            w->modified = w->last_used;
+
+            _drop_shared_copy(w);
+        }
+
+        _reply(c, r, 0, NULL, NULL);
+        break;
+
+    case LXQT_WALLET_AGENT_LIST:
+
+        r = _list_keys(w->wallet, &buffer, &size);
+
+        if (r == lxqt_wallet_no_error)
+        {
+            e = buffer;
+            _reply(c, r, 1, &e, &size);
+            free(buffer);
+        }
+        else
+        {
+            _reply(c, r, 0, NULL, NULL);
+        }
+        break;
+
+    case LXQT_WALLET_AGENT_SHARE:
+
+        /*
+         * all clients attached to a wallet share one memory file until the wallet changes
+         */
+        if (w->shared_fd == -1)
+        {
+            r = lxqt_wallet_share(w->wallet, &w->shared_fd);
+        }
+        else
+        {
+            r = lxqt_wallet_no_error;
+        }
+
+        if (r == lxqt_wallet_no_error)
+        {
+            c->passed_fd = fcntl(w->shared_fd, F_DUPFD_CLOEXEC, 0);
+
+            _reply(c, c->passed_fd == -1 ? lxqt_wallet_failed_to_open_file : r, 0, NULL, NULL);
+        }
+        else
+        {
+            w->shared_fd = -1;
+            _reply(c, r, 0, NULL, NULL);
+        }
+        break;
+
+    default:
+
+        _reply(c, lxqt_wallet_invalid_argument, 0, NULL, NULL);
+    }
+
+    return 0;
+}
+
+/*
+ * save wallets that were modified a while ago and lock wallets that were not used for "timeout" seconds
+ */
+static void _housekeeping(int timeout)
+{
+    struct agent_wallet *e = _wallets;
+    struct agent_wallet *next;
+    time_t now = time(NULL);
+
+    while (e != NULL)
+    {
+        next = e->next;
+
+        if (timeout > 0 && now - e->last_used >= timeout)
+        {
+            _close_wallet(e);
+        }
+        else if (e->modified != 0 && now - e->modified >= SAVE_DELAY)
+        {
+            if (lxqt_wallet_save(e->wallet) != lxqt_wallet_no_error)
+            {
+                fprintf(stderr, "lxqt_wallet-agent: failed to save wallet \"%s\" of \"%s\"\n",
+                        e->wallet_name, e->application_name);
+            }
+
+            e->modified = 0;
+        }
+
+        e = next;
+    }
+}
+
+/*
+ * create the directory that holds the socket when it is not in XDG_RUNTIME_DIR,the directory
+ * must be private to this user.
+ */
+static int _create_socket_directory(const char *path)
+{
+    char dir[ PATH_MAX ];
+    struct stat st;
+    char *e;
+
+    snprintf(dir, sizeof(dir), "%s", path);
+
+    e = strrchr(dir, '/');
+
+    if (e == NULL || e == dir)
+    {
+        return 0;
+    }
+
+    *e = '\0';
+
+    if (getenv(LXQT_WALLET_AGENT_SOCKET_ENV) != NULL || getenv("XDG_RUNTIME_DIR") != NULL)
+    {
+        return 0;
+    }
+
+    mkdir(dir, 0700);
+
+    if (lstat(dir, &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != geteuid() || (st.st_mode & 077) != 0)
+    {
+        fprintf(stderr, "lxqt_wallet-agent: \"%s\" is not a private directory\n", dir);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int _listen(const char *path)
+{
+    struct sockaddr_un addr;
+    lxqt_wallet_agent_t agent;
+    mode_t mask;
+    int fd;
+    int r;
+
+    if (lxqt_wallet_agent_connect(&agent) == lxqt_wallet_no_error)
+    {
+        lxqt_wallet_agent_disconnect(&agent);
+        fprintf(stderr, "lxqt_wallet-agent: an agent is already listening on \"%s\"\n", path);
+        return -1;
+    }
+
+    if (_create_socket_directory(path))
+    {
+        return -1;
+    }
+
+    memset(&addr, '\0', sizeof(addr));
+
+    addr.sun_family = AF_UNIX;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "lxqt_wallet-agent: socket path \"%s\" is too long\n", path);
+        return -1;
+    }
+
+    strcpy(addr.sun_path, path);
+
+    /*
+     * a socket left behind by an agent that did not exit cleanly
+     */
+    unlink(path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    /*
+     * the socket is created private to this user,the mask is put back right after so that files created
+     * later by the agent get the permissions the user asked for
+     */
+    mask = umask(077);
+
+    r = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+
+    umask(mask);
+
+    if (r != 0 || listen(fd, 16) != 0)
+    {
+        fprintf(stderr, "lxqt_wallet-agent: failed to listen on \"%s\": %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void _accept(int listen_fd, struct agent_client *clients, int *count)
+{
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+    if (fd == -1)
+    {
+        return;
+    }
+
+    if (*count >= MAX_CLIENTS || !_lxqt_wallet_agent_peer_is_trusted(fd))
+    {
+        close(fd);
+        return;
+    }
+
+    memset(&clients[ *count ], '\0', sizeof(struct agent_client));
+
+    clients[ *count ].fd            = fd;
+    clients[ *count ].passed_fd     = -1;
+    clients[ *count ].last_progress = time(NULL);
+
+    *count += 1;
+}
+
+static void _close_client(struct agent_client *c)
+{
+    close(c->fd);
+
+    if (c->passed_fd != -1)
+    {
+        close(c->passed_fd);
+    }
+
+    _lxqt_wallet_agent_buffer_free(c->input, c->input_capacity);
+    _lxqt_wallet_agent_buffer_free(c->output, c->output_size);
+}
+
+/*
+ * read what the socket has to offer,returns 1 if the client went away
+ */
+static int _client_read(struct agent_client *c)
+{
+    u_int64_t capacity;
+    ssize_t n;
+    char *e;
+
+    if (c->input_capacity - c->input_size < READ_SIZE)
+    {
+        /*
+         * the buffer doubles so that a large request is not copied over and over as it arrives
+         */
+        capacity = c->input_capacity * 2;
+
+        if (capacity < c->input_size + READ_SIZE)
+        {
+            capacity = c->input_size + READ_SIZE;
+        }
+
+        if (c->input_size > LXQT_WALLET_AGENT_MAX_MESSAGE_SIZE)
+        {
+            return 1;
+        }
+
+        e = calloc(1, capacity);
+
+        if (e == NULL)
+        {
+            return 1;
+        }
+
+        mlock(e, capacity);
+
+        if (c->input != NULL)
+        {
+            memcpy(e, c->input, c->input_size);
+        }
+
+        _lxqt_wallet_agent_buffer_free(c->input, c->input_capacity);
+
+        c->input          = e;
+        c->input_capacity = capacity;
+    }
+
+    n = read(c->fd, c->input + c->input_size, c->input_capacity - c->input_size);
+
+    if (n == -1)
+    {
+        return errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+    }
+    else if (n == 0)
+    {
+        return 1;
+    }
+
+    c->input_size   += n;
+    c->last_progress = time(NULL);
+
+    return 0;
+}
+
+/*
+ * process requests that have fully arrived,one at a time since a request is not read before the reply to the
+ * one before it went out.Returns 1 if the agent should stop.
+ */
+static int _client_process(struct agent_client *c)
+{
+    lxqt_wallet_agent_message_t m;
+    u_int64_t size;
+    int stop = 0;
+    int r;
+
+    while (!stop && !c->failed && c->output == NULL)
+    {
+        r = _lxqt_wallet_agent_parse(c->input, c->input_size, &m, &size);
+
+        if (r == 1)
+        {
+            break;
+        }
+        else if (r == -1)
+        {
+            c->failed = 1;
+            break;
+        }
+
+        stop = _process_request(c, &m);
+
+        _lxqt_wallet_agent_message_free(&m);
+
+        memmove(c->input, c->input + size, c->input_size - size);
+        memset(c->input + c->input_size - size, '\0', size);
+
+        c->input_size -= size;
+    }
+
+    return stop;
+}
+
+/*
+ * send what the socket takes of the pending reply,returns 1 if the client went away
+ */
+static int _client_write(struct agent_client *c)
+{
+    int64_t n = _lxqt_wallet_agent_send_some(c->fd, c->output + c->output_sent, c->output_size - c->output_sent,
+                                             c->passed_fd);
+
+    if (n == -1)
+    {
+        return 1;
+    }
+    else if (n == 0)
+    {
+        return 0;
+    }
+
+    if (c->passed_fd != -1)
+    {
+        close(c->passed_fd);
+        c->passed_fd = -1;
+    }
+
+    c->output_sent  += n;
+    c->last_progress = time(NULL);
+
+    if (c->output_sent == c->output_size)
+    {
+        _lxqt_wallet_agent_buffer_free(c->output, c->output_size);
+
+        c->output      = NULL;
+        c->output_size = 0;
+        c->output_sent = 0;
+    }
+
+    return 0;
+}
+
+static int _client_stalled(const struct agent_client *c, time_t now)
+{
+    return (c->input_size > 0 || c->output != NULL) && now - c->last_progress >= CLIENT_TIMEOUT;
+}
+
+static int _run(int listen_fd, int timeout)
+{
+    struct pollfd fds[ 1 + MAX_CLIENTS ];
+    struct agent_client clients[ MAX_CLIENTS ];
+    struct agent_client *c;
+    time_t now;
+    int count = 0;
+    int stop = 0;
+    int done;
+    int i;
+
+    while (!stop && !_stop)
+    {
+        fds[ 0 ].fd      = listen_fd;
+        fds[ 0 ].events  = POLLIN;
+        fds[ 0 ].revents = 0;
+
+        for (i = 0; i < count; i++)
+        {
+            fds[ i + 1 ].fd      = clients[ i ].fd;
+            fds[ i + 1 ].events  = clients[ i ].output == NULL ? POLLIN : POLLOUT;
+            fds[ i + 1 ].revents = 0;
+        }
+
+        if (poll(fds, 1 + count, 1000) > 0)
+        {
+            for (i = count - 1; i >= 0 && !stop; i--)
+            {
+                c = &clients[ i ];
+
+                if (fds[ i + 1 ].revents == 0)
+                {
+                    continue;
+                }
+
+                if (fds[ i + 1 ].revents & POLLOUT)
+                {
+                    done = _client_write(c);
+                }
+                else if (fds[ i + 1 ].revents & POLLIN)
+                {
+                    done = _client_read(c);
+                }
+                else
+                {
+                    done = 1;
+                }
+
+                if (!done)
+                {
+                    stop = _client_process(c);
+
+                    /*
+                     * most replies fit in the socket buffer and go out right away
+                     */
+                    if (c->output != NULL && !c->failed)
+                    {
+                        done = _client_write(c);
+                    }
+                }
+
+                if (done || c->failed)
+                {
+                    _close_client(c);
+                    clients[ i ] = clients[ count - 1 ];
+                    count--;
+                }
+            }
+
+            if (fds[ 0 ].revents & POLLIN)
+            {
+                _accept(listen_fd, clients, &count);
+            }
+        }
+
+        now = time(NULL);
+
+        for (i = count - 1; i >= 0; i--)
+        {
+            if (_client_stalled(&clients[ i ], now))
+            {
+                _close_client(&clients[ i ]);
+                clients[ i ] = clients[ count - 1 ];
+                count--;
+            }
+        }
+
+        _housekeeping(timeout);
+    }
+
+    /*
+     * the reply to a stop request is given a chance to go out
+     */
+    for (i = 0; i < count; i++)
+    {
+        if (clients[ i ].output != NULL)
+        {
+            _client_write(&clients[ i ]);
+        }
+
+        _close_client(&clients[ i ]);
+    }
+
+    return 0;
+}
+
+static int _stop_agent(void)
+{
+    lxqt_wallet_agent_t agent;
+
+    if (lxqt_wallet_agent_connect(&agent) != lxqt_wallet_no_error)
+    {
+        fputs("lxqt_wallet-agent: agent is not running\n", stderr);
+        return 1;
+    }
+    else
+    {
+        lxqt_wallet_agent_stop(agent);
+        lxqt_wallet_agent_disconnect(&agent);
+        return 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    char path[ PATH_MAX ];
+    struct sigaction sa;
+    int foreground = 0;
+    int timeout = 0;
+    int fd;
+    int i;
+    pid_t pid;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (StringsAreEqual(argv[ i ], "-f"))
+        {
+            foreground = 1;
+        }
+        else if (StringsAreEqual(argv[ i ], "-k"))
+        {
+            return _stop_agent();
+        }
+        else if (StringsAreEqual(argv[ i ], "-t") && i + 1 < argc)
+        {
+            timeout = atoi(argv[ ++i ]);
+        }
+        else
+        {
+            _help();
+            return StringsAreEqual(argv[ i ], "-h") || StringsAreEqual(argv[ i ], "--help") ? 0 : 1;
+        }
+    }
+
+    /*
+     * keep unlocked wallets out of swap and core dumps
+     */
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        fprintf(stderr, "lxqt_wallet-agent: warning: failed to lock memory: %s\n", strerror(errno));
+    }
+#ifdef __linux__
+    prctl(PR_SET_DUMPABLE, 0);
+#endif
+
+    lxqt_wallet_agent_socket_path(path, sizeof(path));
+
+    fd = _listen(path);
+
+    if (fd == -1)
+    {
+        return 1;
+    }
+
+    printf("%s=%s; export %s;\n", LXQT_WALLET_AGENT_SOCKET_ENV, path, LXQT_WALLET_AGENT_SOCKET_ENV);
+    fflush(stdout);
+
+    if (!foreground)
+    {
+        pid = fork();
+
+        if (pid == -1)
+        {
+            fprintf(stderr, "lxqt_wallet-agent: fork failed: %s\n", strerror(errno));
+            unlink(path);
+            return 1;
+        }
+        else if (pid != 0)
+        {
+            return 0;
+        }
+
+        setsid();
+
+        /*
+         * memory locks are not inherited across fork()
+         */
+        mlockall(MCL_CURRENT | MCL_FUTURE);
+
+        i = open("/dev/null", O_RDWR);
+
+        if (i != -1)
+        {
+            dup2(i, 0);
+            dup2(i, 1);
+            dup2(i, 2);
+
+            if (i > 2)
+            {
+                close(i);
+            }
+        }
+    }
+
+    memset(&sa, '\0', sizeof(sa));
+
+    sa.sa_handler = _signal_handler;
+
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+
+    signal(SIGPIPE, SIG_IGN);
+
+    _run(fd, timeout);
+
+    close(fd);
+    unlink(path);
+
+    _close_all_wallets();
+
+    return 0;
+}
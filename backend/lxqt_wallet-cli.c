@@ -28,6 +28,10 @@
  * SUCH DAMAGE.
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -41,8 +45,19 @@
 #include <locale.h>
 #include <libintl.h>
 #include <locale.h>
+#include <pthread.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <stddef.h>
+#include <sys/uio.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+
+#include <gcrypt.h>
 
 #include "lxqtwallet.h"
+#include "lxqtwallet_internal.h"
 
 #define PASSWORD_SIZE         512
 #define WALLET_NAME_SIZE      512
@@ -100,11 +115,30 @@ To add a file to a wallet,run            : lxqt_wallet-cli --add    <path to fil
 To delete a file in a wallet,run         : lxqt_wallet-cli --delete <file name>\n\
 To get a file from the wallet,run        : lxqt_wallet-cli --get    <file name>\n\
 To add all files in a folder,run         : lxqt_wallet-cli --add-all <folder path>\n\
+To add all files in a folder and in its sub folders keyed by their relative paths,run: lxqt_wallet-cli --add-tree <folder path>\n\
+To make the wallet hold the files in a folder and in its sub folders,run: lxqt_wallet-cli --sync <folder path>\n\
+Only new and changed files are added again and files removed from the folder are deleted from the wallet.\n\
 To get a list of files in the wallet,run : lxqt_wallet-cli --list\n\
-To get all files from the wallet,run     : lxqt_wallet-cli --get-all");
+To get all files from the wallet,run     : lxqt_wallet-cli --get-all [<folder path>]\n\
+To store files with the same content once,run: lxqt_wallet-cli --dedup\n\
+Files added to the wallet after deduplication is turned on are stored once per distinct content.\n\
+Files larger than 1 MiB are encrypted to their own files in the \"YYY.blobs\" folder next to the wallet file.");
 
     help3 =  lxqt_wallet_gettext("\
-To get a list of wallets,run             : lxqt_wallet-cli --wallets\n");
+To get a list of wallets,run             : lxqt_wallet-cli --wallets\n\n\
+Prefixing a command with \"--agent\" makes it use a wallet held unlocked by a running lxqt_wallet-agent,\n\
+the wallet password is asked for only when the agent does not have the wallet unlocked.\n\
+To unlock a wallet in the agent,run      : lxqt_wallet-cli --agent --unlock\n\
+To save and lock a wallet in the agent,run: lxqt_wallet-cli --agent --lock\n\n\
+To run many commands with one unlock,run : lxqt_wallet-cli --batch [--wallet <name>] [--password-fd <fd>] [<command file>]\n\
+Commands are read one per line from the command file or from standard input,they are \"add <path>\",\"add-all <path>\",\"add-tree <path>\",\n\
+\"get <file name>\",\"delete <file name>\",\"get-all [<folder path>]\",\"sync <path>\",\"dedup\" and \"list\".The wallet is saved once after the last command.\n\
+A wallet that does not exist is created when its password is read from a file descriptor.\n\n\
+To write all files in the wallet to a tar archive,run: lxqt_wallet-cli --export-tar [--wallet <name>] [--password-fd <fd>] [<archive path>]\n\
+To add all files in a tar archive to the wallet,run  : lxqt_wallet-cli --import-tar [--wallet <name>] [--password-fd <fd>] [<archive path>]\n\
+The archive is written to standard output or read from standard input when its path is not given,the wallet name and\n\
+password are then asked for through the terminal.Large archives are added in batches and files of batches added before\n\
+a damaged part of an archive stay in the wallet.\n");
 
     printf("\n%s%s\n%s\n%s", VERSION_STRING, help1, help2, help3);
 }
@@ -187,9 +221,26 @@ static int _getPassWordFromUser(char *password, size_t size, size_t *len)
     }
 }
 
+/*
+ * folder encrypted contents of large files of the open wallet are kept in,see _storeExternalFile()
+ */
+static char _externalFolder[ PATH_MAX ];
+
+static void _setExternalFolder(const char *wallet_name)
+{
+    char path[ PATH_MAX ];
+
+    lxqt_wallet_application_wallet_path(path, sizeof(path), APPLICATION_NAME);
+
+    snprintf(_externalFolder, sizeof(_externalFolder), "%s%.*s.blobs/", path, WALLET_NAME_SIZE, wallet_name);
+}
+
 static int _open_wallet(lxqt_wallet_t *wallet, const char *password, size_t password_length, const char *wallet_name)
 {
     lxqt_wallet_error r = lxqt_wallet_open(wallet, password, password_length, wallet_name, APPLICATION_NAME);
+
+    _setExternalFolder(wallet_name);
+
     if (r != lxqt_wallet_no_error)
     {
         puts(lxqt_wallet_gettext("wrong password,failed to open wallet"));
@@ -201,21 +252,23 @@ static int _open_wallet(lxqt_wallet_t *wallet, const char *password, size_t pass
     }
 }
 
-static int _openWallet(lxqt_wallet_t *wallet)
+static void _getWalletName(char wallet_name[ WALLET_NAME_SIZE + 1 ])
+{
+    printf("%s",lxqt_wallet_gettext("enter wallet name: "));
+    _getInputFromUser(wallet_name, WALLET_NAME_SIZE, NULL);
+}
+
+/*
+ * get the password of a wallet from the user,the wallet is created if it does not exist and the user wants it to.
+ */
+static int _getWalletPassword(const char *wallet_name, char password[ PASSWORD_SIZE + 1 ], size_t *password_length)
 {
-    size_t password_length = 0;
     lxqt_wallet_error r;
 
     int c;
 
-    char password[ PASSWORD_SIZE + 1 ];
     char password_1[ PASSWORD_SIZE + 1 ];
 
-    char wallet_name[ WALLET_NAME_SIZE + 1 ];
-
-    printf("%s",lxqt_wallet_gettext("enter wallet name: "));
-    _getInputFromUser(wallet_name, WALLET_NAME_SIZE, NULL);
-
     if (lxqt_wallet_exists(wallet_name, APPLICATION_NAME) != 0)
     {
         printf("%s",lxqt_wallet_gettext_1("wallet \"%s\" does not exist,do you want to create it?(y/n): ",wallet_name));
@@ -224,7 +277,7 @@ static int _openWallet(lxqt_wallet_t *wallet)
         if (c == 'y')
         {
             printf("%s",lxqt_wallet_gettext("enter wallet password: "));
-            _getPassWordFromUser(password, PASSWORD_SIZE, &password_length);
+            _getPassWordFromUser(password, PASSWORD_SIZE, password_length);
             puts("");
             printf("%s",lxqt_wallet_gettext("re enter wallet password: "));
             _getPassWordFromUser(password_1, PASSWORD_SIZE, NULL);
@@ -236,7 +289,7 @@ static int _openWallet(lxqt_wallet_t *wallet)
             }
             else
             {
-                r = lxqt_wallet_create(password, password_length, wallet_name, APPLICATION_NAME);
+                r = lxqt_wallet_create(password, *password_length, wallet_name, APPLICATION_NAME);
                 if (r != lxqt_wallet_no_error)
                 {
                     puts(lxqt_wallet_gettext("failed to create wallet"));
@@ -253,275 +306,4412 @@ static int _openWallet(lxqt_wallet_t *wallet)
     else
     {
         printf("%s",lxqt_wallet_gettext("enter wallet password: "));
-        _getPassWordFromUser(password, PASSWORD_SIZE, &password_length);
+        _getPassWordFromUser(password, PASSWORD_SIZE, password_length);
         puts("");
     }
 
-    return _open_wallet(wallet, password, password_length, wallet_name);
+    return 0;
 }
 
-static int _printListOfManagedFiles(lxqt_wallet_t wallet)
+static int _openWallet(lxqt_wallet_t *wallet)
 {
-    lxqt_wallet_iterator_t iter;
+    size_t password_length = 0;
 
-    memset(&iter, '\0', sizeof(iter));
+    char password[ PASSWORD_SIZE + 1 ];
+
+    char wallet_name[ WALLET_NAME_SIZE + 1 ];
 
-    while (lxqt_wallet_iter_read_value(wallet, &iter))
+    _getWalletName(wallet_name);
+
+    if (_getWalletPassword(wallet_name, password, &password_length))
     {
-        puts(iter.entry.key);
+        return 1;
     }
 
-    return 0;
+    return _open_wallet(wallet, password, password_length, wallet_name);
 }
 
-static const char *_fileName(const char *filePath)
+/*
+ * Functions below implement out of line storage of large files.
+ *
+ * Content of a file larger than LARGE_FILE_SIZE is not stored in the wallet,it is encrypted with a random content key
+ * to its own file in the seekable stream format of lxqt_wallet_encrypt_stream() and the entry of the file holds an
+ * external reference made up of EXTERNAL_MAGIC,the u_int64_t size of the file,a random 16 bytes id and the content
+ * key.The id names the encrypted file in the "YYY.blobs" folder next to the "YYY.lwt" wallet file.
+ *
+ * The wallet hence stays small no matter how large stored files are and opening it decrypts only small entries,
+ * encrypted files are decrypted straight to where they are written when they are read.Large files are not
+ * deduplicated and encrypted files of deleted entries are removed only after the wallet is saved.
+ *
+ * Content of a small file that looks like an external reference or like a reference to a blob is stored out of line
+ * too,see _storedOutOfLine(),a value of a file entry that looks like a reference is hence always one.
+ */
+#define LARGE_FILE_SIZE      ( 1024 * 1024 )
+#define EXTERNAL_MAGIC       "\0lxqt_wallet_ext"
+#define EXTERNAL_MAGIC_SIZE  16
+#define EXTERNAL_ID_SIZE     16
+#define EXTERNAL_KEY_SIZE    32
+#define EXTERNAL_SIZE        ( EXTERNAL_MAGIC_SIZE + sizeof(u_int64_t) + EXTERNAL_ID_SIZE + EXTERNAL_KEY_SIZE )
+
+static char **_deletedExternalFiles;
+static size_t _deletedExternalFileCount;
+
+static int _isExternal(const char *value, u_int32_t value_size)
 {
-    const char *e = strrchr(filePath, '/');
-    if (e == NULL)
-    {
-        return filePath;
-    }
-    else
-    {
-        return e + 1;
-    }
+    return value_size == EXTERNAL_SIZE && memcmp(value, EXTERNAL_MAGIC, EXTERNAL_MAGIC_SIZE) == 0;
 }
 
-static int _addFileToWallet_1(lxqt_wallet_t wallet, int fd, const char *filePath, const struct stat *st)
+static u_int64_t _externalSize(const char *reference)
 {
-    lxqt_wallet_error r;
-    char *e;
-    const char *fileName = _fileName(filePath);
-    e = malloc(st->st_size);
-    if (e == NULL)
+    u_int64_t size;
+
+    memcpy(&size, reference + EXTERNAL_MAGIC_SIZE, sizeof(u_int64_t));
+
+    return size;
+}
+
+static const char *_externalKey(const char *reference)
+{
+    return reference + EXTERNAL_MAGIC_SIZE + sizeof(u_int64_t) + EXTERNAL_ID_SIZE;
+}
+
+/*
+ * size of the content of a file whose entry has "value"
+ */
+static u_int64_t _valueSize(const char *value, u_int32_t value_size)
+{
+    if (_isExternal(value, value_size))
     {
-        puts(lxqt_wallet_gettext("failed to allocate memory"));
-        return 1;
+        return _externalSize(value);
     }
     else
     {
-        read(fd, e, st->st_size);
-        r = lxqt_wallet_add_key(wallet, _file(fileName), e, st->st_size);
-        free(e);
-        if (r != lxqt_wallet_no_error)
-        {
-            puts(lxqt_wallet_gettext("failed to add file to the wallet"));
-            return 1;
-        }
-        else
-        {
-            return 0;
-        }
+        return value_size;
     }
 }
 
-static int _addFileToWallet(lxqt_wallet_t wallet, const char *filePath)
+static void _externalPath(char path[ PATH_MAX ], const char *reference)
 {
-    lxqt_wallet_error r;
-    struct stat st;
-    int fd;
-    void *map;
-    int k = 1;
-    const char *fileName = _fileName(filePath);
+    const unsigned char *id = (const unsigned char *)reference + EXTERNAL_MAGIC_SIZE + sizeof(u_int64_t);
+    size_t len;
+    int i;
+
+    snprintf(path, PATH_MAX, "%s", _externalFolder);
 
-    if (lxqt_wallet_wallet_has_key(wallet, _file(fileName)))
+    len = strlen(path);
+
+    for (i = 0; i < EXTERNAL_ID_SIZE && len + 2 < PATH_MAX; i++)
     {
-        printf("%s",lxqt_wallet_gettext_1("wallet already has \"%s\" entry\n", fileName));
-        return 1;
+        len += snprintf(path + len, PATH_MAX - len, "%02x", id[ i ]);
     }
-    else
+}
+
+static int _writeAll(int fd, const char *value, size_t value_size)
+{
+    ssize_t r;
+
+    while (value_size > 0)
     {
-        fd = open(filePath, O_RDONLY);
-        if (fd == -1)
-        {
-            puts(lxqt_wallet_gettext("failed to open file for reading"));
-            return 1;
-        }
-        else
+        r = write(fd, value, value_size);
+
+        if (r <= 0)
         {
-            fstat(fd, &st);
-            map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-            if (map == MAP_FAILED)
+            if (r == 0)
             {
-                k = _addFileToWallet_1(wallet, fd, fileName, &st);
-            }
-            else
-            {
-                r = lxqt_wallet_add_key(wallet, _file(fileName), map, st.st_size);
-                munmap(map, st.st_size);
-                if (r != lxqt_wallet_no_error)
-                {
-                    puts(lxqt_wallet_gettext("failed to add file to the wallet"));
-                    k = 1;
-                }
-                else
-                {
-                    k = 0;
-                }
+                errno = EIO;
             }
 
-            close(fd);
-            return k;
+            return 1;
         }
+
+        value += r;
+        value_size -= r;
     }
+
+    return 0;
 }
 
-static int _deleteFileFromWallet(lxqt_wallet_t wallet, const char *filePath)
+/*
+ * remove the encrypted file of a reference that did not make it into the wallet
+ */
+static void _discardExternalFile(const char *reference)
 {
-    const char *fileName = _fileName(filePath);
-    lxqt_wallet_delete_key(wallet, _file(fileName));
+    char path[ PATH_MAX ];
+
+    _externalPath(path, reference);
+
+    unlink(path);
+}
+
+static int _externalProgress(u_int64_t size, void *arg)
+{
+    *(u_int64_t *)arg = size;
     return 0;
 }
 
-static int _getFileFromWallet(lxqt_wallet_t wallet, const char *filePath)
+/*
+ * create a new file in the blobs folder for a reference with a new id and key,returns its file descriptor or -1
+ */
+static int _createExternalFile(char reference[ EXTERNAL_SIZE ], char path[ PATH_MAX ])
 {
-    int fd;
-    int r;
-    struct stat st;
-    lxqt_wallet_key_values_t k;
-    const char *fileName = _fileName(filePath);
+    char *id  = reference + EXTERNAL_MAGIC_SIZE + sizeof(u_int64_t);
+    char *key = id + EXTERNAL_ID_SIZE;
 
-    r = lxqt_wallet_read_key_value(wallet, _file(fileName), &k);
-    if (r != 1)
-    {
-        puts(lxqt_wallet_gettext("file not found in the wallet"));
-        return 1;
-    }
-    else
+    memcpy(reference, EXTERNAL_MAGIC, EXTERNAL_MAGIC_SIZE);
+    memset(reference + EXTERNAL_MAGIC_SIZE, '\0', sizeof(u_int64_t));
+
+    gcry_create_nonce(id, EXTERNAL_ID_SIZE);
+    gcry_randomize(key, EXTERNAL_KEY_SIZE, GCRY_STRONG_RANDOM);
+
+    mkdir(_externalFolder, 0700);
+
+    _externalPath(path, reference);
+
+    return open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+}
+
+/*
+ * flush and close a file created by _createExternalFile() and record the size of its content in the reference,
+ * the file is removed if "r" says its content could not be written
+ */
+static int _finishExternalFile(int dest, const char *path, lxqt_wallet_error r, u_int64_t size,
+                               char reference[ EXTERNAL_SIZE ])
+{
+    if (r != lxqt_wallet_no_error || fsync(dest) != 0 || close(dest) != 0)
     {
-        if (stat(filePath, &st) == 0)
-        {
-            printf("%s",lxqt_wallet_gettext_1("path ./\"%s\" already occupied\n", fileName));
-            return 1;
-        }
-        else
+        if (r != lxqt_wallet_no_error)
         {
-            fd = open(filePath, O_WRONLY | O_CREAT, 0644);
-            if (fd == -1)
-            {
-                puts(lxqt_wallet_gettext("failed to open file for writing"));
-                return 1;
-            }
-            else
-            {
-                write(fd, k.key_value, k.key_value_size);
-                close(fd);
-                return 0;
-            }
+            close(dest);
         }
+
+        unlink(path);
+        return 1;
     }
+
+    memcpy(reference + EXTERNAL_MAGIC_SIZE, &size, sizeof(u_int64_t));
+
+    return 0;
 }
 
-static int _getAllFilesFromWallet(lxqt_wallet_t wallet)
+/*
+ * encrypt everything read from "fd" to a new file in the blobs folder and make a reference to it
+ */
+static int _storeExternalFileFromFd(int fd, char reference[ EXTERNAL_SIZE ])
 {
-    lxqt_wallet_iterator_t iter;
-
-    memset(&iter, '\0', sizeof(iter));
+    char path[ PATH_MAX ];
+    u_int64_t size = 0;
+    lxqt_wallet_error r;
+    int dest = _createExternalFile(reference, path);
 
-    while (lxqt_wallet_iter_read_value(wallet, &iter))
+    if (dest == -1)
     {
-        _getFileFromWallet(wallet, iter.entry.key);
+        return 1;
     }
 
-    return 0;
+    r = lxqt_wallet_encrypt_stream(_externalKey(reference), EXTERNAL_KEY_SIZE, fd, dest, _externalProgress, &size);
+
+    return _finishExternalFile(dest, path, r, size, reference);
 }
 
-static int _addAllFilesToTheWallet(lxqt_wallet_t wallet, const char *path)
+/*
+ * encrypt "value" to a new file in the blobs folder and make a reference to it
+ */
+static int _storeExternalFile(const char *value, size_t value_size, char reference[ EXTERNAL_SIZE ])
 {
-    struct stat st;
-    DIR *dir = opendir(path);
-    struct dirent *entry;
-    char path_1[ PATH_MAX ];
+    char path[ PATH_MAX ];
+    lxqt_wallet_error r;
+    int dest = _createExternalFile(reference, path);
 
-    if (dir == NULL)
+    if (dest == -1)
     {
-        puts(lxqt_wallet_gettext("failed to open directory for reading"));
         return 1;
     }
-    else
-    {
-        while ((entry = readdir(dir)) != NULL)
-        {
-            snprintf(path_1, PATH_MAX, "%s/%s", path, entry->d_name);
-            if (stat(path_1, &st) == 0 && S_ISREG(st.st_mode))
-            {
-                _addFileToWallet(wallet, path_1);
-            }
-        }
-        return 0;
-    }
+
+    r = lxqt_wallet_encrypt_buffer(_externalKey(reference), EXTERNAL_KEY_SIZE, value, value_size, dest);
+
+    return _finishExternalFile(dest, path, r, value_size, reference);
 }
 
-static int _printWalletList(void)
+/*
+ * remember the encrypted file of a deleted entry,it is removed once the wallet is saved
+ */
+static void _deleteExternalFile(const char *reference)
 {
-    int len = 0;
-    int k;
-    char *c;
-    char **e = lxqt_wallet_wallet_list(APPLICATION_NAME, &len);
+    char path[ PATH_MAX ];
+    char **e = realloc(_deletedExternalFiles, (_deletedExternalFileCount + 1) * sizeof(char *));
 
-    for (k = 0; k < len; k++)
+    if (e == NULL)
     {
-        c = *(e + k);
-        puts(c);
-        free(c);
+        return;
     }
 
-    free(e);
-    return 0;
-}
+    _deletedExternalFiles = e;
 
-int main(int argc, char *argv[])
-{
-    lxqt_wallet_t wallet = 0;
+    _externalPath(path, reference);
 
-    const char *path;
-    const char *action;
-    int r = 1;
+    e[ _deletedExternalFileCount ] = strdup(path);
 
-    if (argc == 1)
+    if (e[ _deletedExternalFileCount ] != NULL)
     {
-        _help();
-        return 0;
+        _deletedExternalFileCount++;
     }
+}
 
-    action = argv[ 1 ];
+/*
+ * write the content of a file whose entry has "value" to "fd",encrypted files are decrypted straight to "fd".
+ * Returns 1 with errno set on failure.
+ */
+static int _writeValue(int fd, const char *value, u_int32_t value_size)
+{
+    char path[ PATH_MAX ];
+    lxqt_wallet_error r;
+    int src;
 
-    if (argc == 2)
+    if (!_isExternal(value, value_size))
     {
-        if (StringsAreEqual(action, "-h") || StringsAreEqual(action, "--help") || StringsAreEqual(action, "-help")
-                || StringsAreEqual(action, "-v") || StringsAreEqual(action, "--version"))
-        {
-            _help();
-            return 0;
-        }
-        else if (StringsAreEqual(action, "--wallets"))
-        {
-            return _printWalletList();
-        }
-        else if (StringsAreEqual(action, "--list") || StringsAreEqual(action, "--get-all"))
-        {
-            ;
-        }
-        else
-        {
-            _help();
-            return 1;
-        }
+        return _writeAll(fd, value, value_size);
     }
 
-    if (_openWallet(&wallet))
+    _externalPath(path, value);
+
+    src = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (src == -1)
     {
         return 1;
     }
-    else
-    {
-        if (StringsAreEqual(action, "--list"))
+
+    r = lxqt_wallet_decrypt_stream(_externalKey(value), EXTERNAL_KEY_SIZE, src, fd, NULL, NULL);
+
+    close(src);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        errno = EIO;
+        return 1;
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+/*
+ * forget encrypted files of deleted entries,they are removed if "saved" says the wallet without them was saved
+ */
+static void _removeDeletedExternalFiles(int saved)
+{
+    size_t i;
+
+    for (i = 0; i < _deletedExternalFileCount; i++)
+    {
+        if (saved)
+        {
+            unlink(_deletedExternalFiles[ i ]);
+        }
+
+        free(_deletedExternalFiles[ i ]);
+    }
+
+    free(_deletedExternalFiles);
+
+    _deletedExternalFiles     = NULL;
+    _deletedExternalFileCount = 0;
+}
+
+/*
+ * Files are kept either in a wallet opened by this process or in a wallet held unlocked by lxqt_wallet-agent
+ * with "--agent",functions below add,read,delete and list entries of both and functions that work on files
+ * go through them.
+ */
+typedef struct
+{
+    /*
+     * NULL when the wallet is held by the agent
+     */
+    lxqt_wallet_t wallet;
+    lxqt_wallet_agent_t agent;
+    const char *wallet_name;
+    /*
+     * the last error the agent replied with that was not lxqt_wallet_key_not_found
+     */
+    lxqt_wallet_error error;
+} cli_wallet_t;
+
+static cli_wallet_t _localWallet(lxqt_wallet_t wallet)
+{
+    cli_wallet_t w;
+
+    memset(&w, '\0', sizeof(w));
+
+    w.wallet = wallet;
+
+    return w;
+}
+
+static lxqt_wallet_error _agentError(cli_wallet_t *w, lxqt_wallet_error r)
+{
+    if (r != lxqt_wallet_no_error && r != lxqt_wallet_key_not_found)
+    {
+        w->error = r;
+    }
+
+    return r;
+}
+
+/*
+ * returns 1 and fills "k" if the wallet has "key",a value read from the agent is a copy that must be released
+ * with _releaseValue()
+ */
+static int _readKey(cli_wallet_t *w, const char *key, u_int32_t key_size, lxqt_wallet_key_values_t *k)
+{
+    char *value;
+    u_int32_t value_size;
+
+    if (w->agent == NULL)
+    {
+        return lxqt_wallet_read_key_value(w->wallet, key, key_size, k);
+    }
+
+    if (_agentError(w, lxqt_wallet_agent_get(w->agent, w->wallet_name, APPLICATION_NAME, key, key_size,
+                    &value, &value_size)) != lxqt_wallet_no_error)
+    {
+        return 0;
+    }
+
+    k->key            = key;
+    k->key_size       = key_size;
+    k->key_value      = value;
+    k->key_value_size = value_size;
+
+    return 1;
+}
+
+static void _releaseValue(cli_wallet_t *w, lxqt_wallet_key_values_t *k)
+{
+    if (w->agent != NULL)
+    {
+        lxqt_wallet_agent_free_value((char *)k->key_value, k->key_value_size);
+    }
+
+    k->key_value      = NULL;
+    k->key_value_size = 0;
+}
+
+static int _hasKey(cli_wallet_t *w, const char *key, u_int32_t key_size)
+{
+    if (w->agent == NULL)
+    {
+        return lxqt_wallet_wallet_has_key(w->wallet, key, key_size);
+    }
+    else
+    {
+        return _agentError(w, lxqt_wallet_agent_has_key(w->agent, w->wallet_name, APPLICATION_NAME, key,
+                                                        key_size)) == lxqt_wallet_no_error;
+    }
+}
+
+/*
+ * the agent replaces an existing entry with the same key
+ */
+static lxqt_wallet_error _addKey(cli_wallet_t *w, const char *key, u_int32_t key_size, const char *value,
+                                 u_int32_t value_size)
+{
+    if (w->agent == NULL)
+    {
+        return lxqt_wallet_add_key(w->wallet, key, key_size, value, value_size);
+    }
+    else
+    {
+        return _agentError(w, lxqt_wallet_agent_add_key(w->agent, w->wallet_name, APPLICATION_NAME, key, key_size,
+                                                        value, value_size));
+    }
+}
+
+static lxqt_wallet_error _removeKey(cli_wallet_t *w, const char *key, u_int32_t key_size)
+{
+    if (w->agent == NULL)
+    {
+        return lxqt_wallet_delete_key(w->wallet, key, key_size);
+    }
+    else
+    {
+        return _agentError(w, lxqt_wallet_agent_delete_key(w->agent, w->wallet_name, APPLICATION_NAME, key,
+                                                           key_size));
+    }
+}
+
+/*
+ * call "function" with every key in the wallet,listing stops if "function" returns non zero
+ */
+static lxqt_wallet_error _listKeys(cli_wallet_t *w, int(*function)(const char *, u_int32_t, void *), void *arg)
+{
+    lxqt_wallet_iterator_t iter;
+
+    if (w->agent != NULL)
+    {
+        return _agentError(w, lxqt_wallet_agent_list(w->agent, w->wallet_name, APPLICATION_NAME, function, arg));
+    }
+
+    memset(&iter, '\0', sizeof(iter));
+
+    while (lxqt_wallet_iter_read_key(w->wallet, &iter))
+    {
+        if (function(iter.entry.key, iter.entry.key_size, arg))
+        {
+            break;
+        }
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+static int _agentReportError(lxqt_wallet_error r)
+{
+    if (r == lxqt_wallet_no_error)
+    {
+        return 0;
+    }
+    else if (r == lxqt_wallet_failed_to_connect_to_agent)
+    {
+        puts(lxqt_wallet_gettext("lost connection to lxqt_wallet-agent"));
+    }
+    else if (r == lxqt_wallet_wallet_not_unlocked)
+    {
+        puts(lxqt_wallet_gettext("wallet is not unlocked in lxqt_wallet-agent"));
+    }
+    else if (r == lxqt_wallet_key_not_found)
+    {
+        puts(lxqt_wallet_gettext("file not found in the wallet"));
+    }
+    else
+    {
+        puts(lxqt_wallet_gettext("lxqt_wallet-agent failed to complete the request"));
+    }
+
+    return 1;
+}
+
+/*
+ * print "message",or why the agent failed if it did
+ */
+static int _reportError(cli_wallet_t *w, const char *message)
+{
+    if (w->error != lxqt_wallet_no_error)
+    {
+        return _agentReportError(w->error);
+    }
+    else
+    {
+        puts(lxqt_wallet_gettext(message));
+        return 1;
+    }
+}
+
+/*
+ * Functions below implement deduplicated storage of files,it is turned on for a wallet with "--dedup".
+ *
+ * Content of a file in a wallet with deduplication turned on is stored once in a blob entry keyed by its SHA-256 hash
+ * and the entry of the file holds a reference to the blob,a reference is made up of REFERENCE_MAGIC followed by the
+ * hash.The number of references to each blob is kept in a count entry and a blob and its count are deleted when the
+ * last file that refers to the blob is deleted.Counts are changed in memory and written back when the wallet is closed,
+ * before files are added in one go and before an "--agent" command finishes.
+ *
+ * Keys of entries that are not files start with a '\0' character:
+ * "\0dedup"            : present in wallets with deduplication turned on.
+ * "\0b" + 32 bytes hash : blob,the value is the content of the file.
+ * "\0c" + 32 bytes hash : count,the value is a u_int32_t number of references to the blob.
+ *
+ * Files that are not larger than a reference are stored as they are.
+ */
+#define DEDUP_KEY            "\0dedup"
+#define DEDUP_KEY_SIZE       7
+#define HASH_SIZE            32
+#define BLOB_KEY_SIZE        ( 2 + HASH_SIZE )
+#define REFERENCE_MAGIC      "\0lxqt_wallet_ref"
+#define REFERENCE_MAGIC_SIZE 16
+#define REFERENCE_SIZE       ( REFERENCE_MAGIC_SIZE + HASH_SIZE )
+
+static int _isInternalKey(const char *key, u_int32_t key_size)
+{
+    return key_size > 0 && key[ 0 ] == '\0';
+}
+
+static int _isReference(const char *value, u_int32_t value_size)
+{
+    return value_size == REFERENCE_SIZE && memcmp(value, REFERENCE_MAGIC, REFERENCE_MAGIC_SIZE) == 0;
+}
+
+/*
+ * returns 1 if the content of a file is not to be stored in the wallet as it is
+ */
+static int _storedOutOfLine(const char *value, u_int64_t value_size)
+{
+    if (value_size > LARGE_FILE_SIZE)
+    {
+        return 1;
+    }
+    else
+    {
+        return _isExternal(value, value_size) || _isReference(value, value_size);
+    }
+}
+
+static int _dedupEnabled(cli_wallet_t *w)
+{
+    return _hasKey(w, DEDUP_KEY, DEDUP_KEY_SIZE);
+}
+
+static int _enableDedup(cli_wallet_t *w)
+{
+    if (_dedupEnabled(w))
+    {
+        return 0;
+    }
+    else if (_addKey(w, DEDUP_KEY, DEDUP_KEY_SIZE, NULL, 0) != lxqt_wallet_no_error)
+    {
+        return _reportError(w, "failed to add file to the wallet");
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+static void _hash(char hash[ HASH_SIZE ], const char *value, size_t value_size)
+{
+    gcry_md_hash_buffer(GCRY_MD_SHA256, hash, value, value_size);
+}
+
+static void _blobKey(char key[ BLOB_KEY_SIZE ], char type, const char *hash)
+{
+    key[ 0 ] = '\0';
+    key[ 1 ] = type;
+    memcpy(key + 2, hash, HASH_SIZE);
+}
+
+static void _reference(char reference[ REFERENCE_SIZE ], const char *hash)
+{
+    memcpy(reference, REFERENCE_MAGIC, REFERENCE_MAGIC_SIZE);
+    memcpy(reference + REFERENCE_MAGIC_SIZE, hash, HASH_SIZE);
+}
+
+/*
+ * Counts of blobs are read from the wallet the first time they are needed and are then kept in memory while files
+ * are added and deleted,changed counts are written back in one go by _flushBlobCounts().
+ * "stored" is the count the wallet holds,0 if it has no count entry,and "blob" is set if the wallet has the blob.
+ */
+typedef struct
+{
+    char hash[ HASH_SIZE ];
+    u_int32_t count;
+    u_int32_t stored;
+    int blob;
+    int used;
+} blob_count_t;
+
+static blob_count_t *_blobCounts;
+static size_t _blobCountCapacity;
+static size_t _blobCountSize;
+
+static size_t _blobCountSlot(const blob_count_t *table, size_t capacity, const char *hash)
+{
+    u_int64_t h;
+    size_t i;
+
+    memcpy(&h, hash, sizeof(h));
+
+    for (i = (size_t)h & (capacity - 1); table[ i ].used; i = (i + 1) & (capacity - 1))
+    {
+        if (memcmp(table[ i ].hash, hash, HASH_SIZE) == 0)
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+static int _growBlobCounts(void)
+{
+    size_t capacity = _blobCountCapacity > 0 ? 2 * _blobCountCapacity : 64;
+    blob_count_t *table = calloc(capacity, sizeof(blob_count_t));
+    size_t i;
+
+    if (table == NULL)
+    {
+        return 1;
+    }
+
+    for (i = 0; i < _blobCountCapacity; i++)
+    {
+        if (_blobCounts[ i ].used)
+        {
+            table[ _blobCountSlot(table, capacity, _blobCounts[ i ].hash) ] = _blobCounts[ i ];
+        }
+    }
+
+    free(_blobCounts);
+
+    _blobCounts        = table;
+    _blobCountCapacity = capacity;
+
+    return 0;
+}
+
+/*
+ * returns the in memory count of a blob or NULL on error
+ */
+static blob_count_t *_blobCount(cli_wallet_t *w, const char *hash)
+{
+    char key[ BLOB_KEY_SIZE ];
+    lxqt_wallet_key_values_t k;
+    blob_count_t *e;
+    u_int32_t stored = 0;
+
+    if (2 * (_blobCountSize + 1) > _blobCountCapacity && _growBlobCounts() != 0)
+    {
+        return NULL;
+    }
+
+    e = _blobCounts + _blobCountSlot(_blobCounts, _blobCountCapacity, hash);
+
+    if (e->used)
+    {
+        return e;
+    }
+
+    _blobKey(key, 'c', hash);
+
+    if (_readKey(w, key, BLOB_KEY_SIZE, &k))
+    {
+        if (k.key_value_size == sizeof(u_int32_t))
+        {
+            memcpy(&stored, k.key_value, sizeof(u_int32_t));
+        }
+
+        _releaseValue(w, &k);
+    }
+    else if (w->error != lxqt_wallet_no_error)
+    {
+        return NULL;
+    }
+
+    memcpy(e->hash, hash, HASH_SIZE);
+
+    e->count  = stored;
+    e->stored = stored;
+    e->blob   = stored > 0;
+    e->used   = 1;
+
+    _blobCountSize++;
+
+    return e;
+}
+
+/*
+ * write changed counts to the wallet and forget all counts,blobs whose counts dropped to 0 are deleted.
+ * A local wallet gets all new count entries with one lxqt_wallet_add_keys() call after room for them is made,
+ * the agent replaces count entries one by one.
+ */
+static int _flushBlobCounts(cli_wallet_t *w)
+{
+    lxqt_wallet_key_values_t *entries = NULL;
+    char (*keys)[ BLOB_KEY_SIZE ] = NULL;
+    char key[ BLOB_KEY_SIZE ];
+    blob_count_t *e;
+    size_t count = 0;
+    size_t i;
+    int k = 0;
+
+    if (_blobCountSize == 0)
+    {
+        return 0;
+    }
+
+    if (w->agent == NULL)
+    {
+        entries = malloc(_blobCountSize * sizeof(lxqt_wallet_key_values_t));
+        keys    = malloc(_blobCountSize * BLOB_KEY_SIZE);
+
+        if (entries == NULL || keys == NULL || lxqt_wallet_reserve(w->wallet, _blobCountSize,
+                              _blobCountSize * (BLOB_KEY_SIZE + sizeof(u_int32_t))) != lxqt_wallet_no_error)
+        {
+            k = 1;
+        }
+    }
+
+    for (i = 0; k == 0 && i < _blobCountCapacity; i++)
+    {
+        e = _blobCounts + i;
+
+        if (!e->used || (e->count == e->stored && (e->count > 0 || !e->blob)))
+        {
+            continue;
+        }
+
+        _blobKey(key, 'c', e->hash);
+
+        if (e->stored > 0 && (e->count == 0 || w->agent == NULL))
+        {
+            _removeKey(w, key, BLOB_KEY_SIZE);
+        }
+
+        if (e->count == 0)
+        {
+            if (e->blob)
+            {
+                _blobKey(key, 'b', e->hash);
+                _removeKey(w, key, BLOB_KEY_SIZE);
+            }
+        }
+        else if (w->agent == NULL)
+        {
+            memcpy(keys[ count ], key, BLOB_KEY_SIZE);
+
+            entries[ count ].key            = keys[ count ];
+            entries[ count ].key_size       = BLOB_KEY_SIZE;
+            entries[ count ].key_value      = (const char *)&e->count;
+            entries[ count ].key_value_size = sizeof(u_int32_t);
+            count++;
+        }
+        else
+        {
+            _addKey(w, key, BLOB_KEY_SIZE, (const char *)&e->count, sizeof(u_int32_t));
+        }
+    }
+
+    if (k == 0 && count > 0 && lxqt_wallet_add_keys(w->wallet, entries, count) != lxqt_wallet_no_error)
+    {
+        k = 1;
+    }
+
+    if (w->error != lxqt_wallet_no_error)
+    {
+        k = 1;
+    }
+
+    free(entries);
+    free(keys);
+    free(_blobCounts);
+
+    _blobCounts        = NULL;
+    _blobCountCapacity = 0;
+    _blobCountSize     = 0;
+
+    return k;
+}
+
+/*
+ * save and close the wallet and remove encrypted files of entries deleted from it
+ */
+static lxqt_wallet_error _closeWallet(lxqt_wallet_t *wallet)
+{
+    cli_wallet_t w = _localWallet(*wallet);
+    int k = _flushBlobCounts(&w);
+    lxqt_wallet_error r = lxqt_wallet_close(wallet);
+
+    _removeDeletedExternalFiles(r == lxqt_wallet_no_error);
+
+    if (k != 0)
+    {
+        puts(lxqt_wallet_gettext("failed to update counts of deduplicated files"));
+
+        if (r == lxqt_wallet_no_error)
+        {
+            r = lxqt_wallet_failed_to_allocate_memory;
+        }
+    }
+
+    return r;
+}
+
+/*
+ * "--agent" commands run by different processes take turns to change counts of blobs,counts are read and written
+ * back while holding an exclusive lock on a file next to the wallet.Returns the locked file descriptor or -1.
+ */
+static int _lockBlobCounts(const char *wallet_name)
+{
+    char path[ PATH_MAX ];
+    char lock[ PATH_MAX ];
+    int fd;
+
+    lxqt_wallet_application_wallet_path(path, sizeof(path), APPLICATION_NAME);
+
+    snprintf(lock, sizeof(lock), "%s%.*s.lock", path, WALLET_NAME_SIZE, wallet_name);
+
+    fd = open(lock, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+
+    if (fd != -1 && flock(fd, LOCK_EX) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+/*
+ * add a file to the wallet,its content is stored out of line if it is large and in a blob if the wallet has
+ * deduplication turned on
+ */
+static lxqt_wallet_error _storeFile(cli_wallet_t *w, const char *key, u_int32_t key_size,
+                                    const char *value, u_int32_t value_size)
+{
+    char hash[ HASH_SIZE ];
+    char blob_key[ BLOB_KEY_SIZE ];
+    char reference[ REFERENCE_SIZE ];
+    char external[ EXTERNAL_SIZE ];
+    lxqt_wallet_error r;
+    blob_count_t *count;
+
+    if (_storedOutOfLine(value, value_size))
+    {
+        if (_storeExternalFile(value, value_size, external) != 0)
+        {
+            return lxqt_wallet_failed_to_open_file;
+        }
+
+        r = _addKey(w, key, key_size, external, EXTERNAL_SIZE);
+
+        if (r != lxqt_wallet_no_error)
+        {
+            _discardExternalFile(external);
+        }
+
+        return r;
+    }
+
+    if (value_size <= REFERENCE_SIZE || !_dedupEnabled(w))
+    {
+        return _addKey(w, key, key_size, value, value_size);
+    }
+
+    _hash(hash, value, value_size);
+
+    count = _blobCount(w, hash);
+
+    if (count == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    if (!count->blob)
+    {
+        _blobKey(blob_key, 'b', hash);
+
+        if (_addKey(w, blob_key, BLOB_KEY_SIZE, value, value_size) != lxqt_wallet_no_error)
+        {
+            return lxqt_wallet_failed_to_allocate_memory;
+        }
+
+        count->blob = 1;
+    }
+
+    _reference(reference, hash);
+
+    r = _addKey(w, key, key_size, reference, REFERENCE_SIZE);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        count->count++;
+    }
+
+    return r;
+}
+
+/*
+ * drop a reference to a blob held by a deleted file,the blob is deleted with its last reference
+ */
+static void _releaseReference(cli_wallet_t *w, const char *hash)
+{
+    blob_count_t *count = _blobCount(w, hash);
+
+    if (count != NULL && count->count > 0)
+    {
+        count->count--;
+    }
+}
+
+/*
+ * replace a reference with the content of the blob it refers to,returns 1 if the blob is missing
+ */
+static int _resolveReference(cli_wallet_t *w, lxqt_wallet_key_values_t *k)
+{
+    char key[ BLOB_KEY_SIZE ];
+
+    if (!_isReference(k->key_value, k->key_value_size))
+    {
+        return 0;
+    }
+
+    _blobKey(key, 'b', k->key_value + REFERENCE_MAGIC_SIZE);
+
+    _releaseValue(w, k);
+
+    if (_readKey(w, key, BLOB_KEY_SIZE, k))
+    {
+        return 0;
+    }
+    else
+    {
+        return _reportError(w, "content of the file is missing from the wallet");
+    }
+}
+
+static int _printKey(const char *key, u_int32_t key_size, void *arg)
+{
+    (void)arg;
+
+    if (!_isInternalKey(key, key_size))
+    {
+        puts(key);
+    }
+
+    return 0;
+}
+
+static int _printListOfManagedFiles(cli_wallet_t *w)
+{
+    return _agentReportError(_listKeys(w, _printKey, NULL));
+}
+
+static const char *_fileName(const char *filePath)
+{
+    const char *e = strrchr(filePath, '/');
+    if (e == NULL)
+    {
+        return filePath;
+    }
+    else
+    {
+        return e + 1;
+    }
+}
+
+static int _addFileToWallet_1(cli_wallet_t *w, int fd, const char *fileName, const struct stat *st)
+{
+    lxqt_wallet_error r;
+    char *e;
+    e = malloc(st->st_size);
+    if (e == NULL)
+    {
+        puts(lxqt_wallet_gettext("failed to allocate memory"));
+        return 1;
+    }
+    else
+    {
+        read(fd, e, st->st_size);
+        r = _storeFile(w, _file(fileName), e, st->st_size);
+        free(e);
+        if (r != lxqt_wallet_no_error)
+        {
+            return _reportError(w, "failed to add file to the wallet");
+        }
+        else
+        {
+            return 0;
+        }
+    }
+}
+
+/*
+ * encrypt a large file straight from "fd" to the blobs folder and add a reference to it
+ */
+static int _addLargeFileToWallet(cli_wallet_t *w, int fd, const char *fileName)
+{
+    char external[ EXTERNAL_SIZE ];
+
+    if (_storeExternalFileFromFd(fd, external) != 0)
+    {
+        puts(lxqt_wallet_gettext("failed to store file out of line"));
+        return 1;
+    }
+
+    if (_addKey(w, _file(fileName), external, EXTERNAL_SIZE) != lxqt_wallet_no_error)
+    {
+        _discardExternalFile(external);
+        return _reportError(w, "failed to add file to the wallet");
+    }
+
+    return 0;
+}
+
+static int _addFileToWallet(cli_wallet_t *w, const char *filePath)
+{
+    lxqt_wallet_error r;
+    struct stat st;
+    int fd;
+    void *map;
+    int k = 1;
+    const char *fileName = _fileName(filePath);
+
+    if (_hasKey(w, _file(fileName)))
+    {
+        printf("%s",lxqt_wallet_gettext_1("wallet already has \"%s\" entry\n", fileName));
+        return 1;
+    }
+    else if (w->error != lxqt_wallet_no_error)
+    {
+        return _agentReportError(w->error);
+    }
+    else
+    {
+        fd = open(filePath, O_RDONLY);
+        if (fd == -1)
+        {
+            puts(lxqt_wallet_gettext("failed to open file for reading"));
+            return 1;
+        }
+
+        fstat(fd, &st);
+
+        if (st.st_size > LARGE_FILE_SIZE)
+        {
+            k = _addLargeFileToWallet(w, fd, fileName);
+            close(fd);
+            return k;
+        }
+
+        map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            k = _addFileToWallet_1(w, fd, fileName, &st);
+        }
+        else
+        {
+            r = _storeFile(w, _file(fileName), map, st.st_size);
+            munmap(map, st.st_size);
+            if (r != lxqt_wallet_no_error)
+            {
+                k = _reportError(w, "failed to add file to the wallet");
+            }
+            else
+            {
+                k = 0;
+            }
+        }
+
+        close(fd);
+        return k;
+    }
+}
+
+/*
+ * delete a file and drop its reference to a blob or to an encrypted file if it has one
+ */
+static lxqt_wallet_error _deleteKey(cli_wallet_t *w, const char *key, u_int32_t key_size)
+{
+    lxqt_wallet_key_values_t k;
+    lxqt_wallet_error r;
+    char hash[ HASH_SIZE ];
+    int reference = 0;
+
+    if (_readKey(w, key, key_size, &k))
+    {
+        if (_isReference(k.key_value, k.key_value_size))
+        {
+            memcpy(hash, k.key_value + REFERENCE_MAGIC_SIZE, HASH_SIZE);
+            reference = 1;
+        }
+        else if (_isExternal(k.key_value, k.key_value_size))
+        {
+            _deleteExternalFile(k.key_value);
+        }
+
+        _releaseValue(w, &k);
+    }
+
+    r = _removeKey(w, key, key_size);
+
+    if (reference && r == lxqt_wallet_no_error)
+    {
+        _releaseReference(w, hash);
+    }
+
+    return r;
+}
+
+static int _deleteFileFromWallet(cli_wallet_t *w, const char *filePath)
+{
+    const char *fileName = _fileName(filePath);
+
+    _deleteKey(w, _file(fileName));
+
+    return _agentReportError(w->error);
+}
+
+static int _writeFile(const char *filePath, const char *value, size_t value_size)
+{
+    int fd;
+    struct stat st;
+    const char *fileName = _fileName(filePath);
+
+    if (stat(filePath, &st) == 0)
+    {
+        printf("%s",lxqt_wallet_gettext_1("path ./\"%s\" already occupied\n", fileName));
+        return 1;
+    }
+    else
+    {
+        fd = open(filePath, O_WRONLY | O_CREAT, 0644);
+        if (fd == -1)
+        {
+            puts(lxqt_wallet_gettext("failed to open file for writing"));
+            return 1;
+        }
+        else if (_writeValue(fd, value, value_size) != 0)
+        {
+            close(fd);
+            unlink(filePath);
+            puts(lxqt_wallet_gettext("failed to write the file"));
+            return 1;
+        }
+        else
+        {
+            close(fd);
+            return 0;
+        }
+    }
+}
+
+static int _getFileFromWallet(cli_wallet_t *w, const char *filePath)
+{
+    int r;
+    lxqt_wallet_key_values_t k;
+    const char *fileName = _fileName(filePath);
+
+    r = _readKey(w, _file(fileName), &k);
+    if (r != 1)
+    {
+        return _reportError(w, "file not found in the wallet");
+    }
+    else if (_resolveReference(w, &k) != 0)
+    {
+        return 1;
+    }
+    else
+    {
+        r = _writeFile(filePath, k.key_value, k.key_value_size);
+        _releaseValue(w, &k);
+        return r;
+    }
+}
+
+static int _forEachFileInFolder(const char *path, int(*function)(const char *, void *), void *arg)
+{
+    struct stat st;
+    DIR *dir = opendir(path);
+    struct dirent *entry;
+    char path_1[ PATH_MAX ];
+
+    if (dir == NULL)
+    {
+        puts(lxqt_wallet_gettext("failed to open directory for reading"));
+        return 1;
+    }
+    else
+    {
+        while ((entry = readdir(dir)) != NULL)
+        {
+            snprintf(path_1, PATH_MAX, "%s/%s", path, entry->d_name);
+            if (stat(path_1, &st) == 0 && S_ISREG(st.st_mode))
+            {
+                function(path_1, arg);
+            }
+        }
+        closedir(dir);
+        return 0;
+    }
+}
+
+static int _addFileToWallet_2(const char *filePath, void *w)
+{
+    return _addFileToWallet(w, filePath);
+}
+
+static int _addAllFilesToTheWallet(cli_wallet_t *w, const char *path)
+{
+    return _forEachFileInFolder(path, _addFileToWallet_2, w);
+}
+
+/*
+ * Functions below implement "--add-tree" that adds all files in a folder and in its sub folders to the wallet
+ * keyed by their paths relative to the folder.Files are read by a pool of threads and are added in one go.
+ */
+
+#define NOT_ADDED ( ( size_t )-1 )
+
+/*
+ * a file recorded in the manifest of "--sync",see _readManifest()
+ */
+typedef struct
+{
+    const char *path;
+    u_int32_t path_size;
+    u_int64_t size;
+    int64_t mtime;
+    int64_t mtime_nsec;
+    char hash[ HASH_SIZE ];
+    int seen;
+} sync_record_t;
+
+typedef struct
+{
+    char *path;
+    char *data;
+    u_int32_t size;
+    int failed;
+    /*
+     * size and modification time of the file,"skip" is set by "--sync" for files that are not to be read and added
+     * and "record" points to the manifest entry of the file.
+     */
+    u_int64_t file_size;
+    int64_t mtime;
+    int64_t mtime_nsec;
+    int skip;
+    int exists;
+    sync_record_t *record;
+    /*
+     * set by "--sync" for files whose keys are in the wallet but were not added by a sync
+     */
+    int unmanaged;
+    /*
+     * set when the file is to be stored in a blob,"entry" is the position of the file in the list of added entries
+     * or NOT_ADDED
+     */
+    int hashed;
+    char hash[ HASH_SIZE ];
+    char reference[ REFERENCE_SIZE ];
+    size_t entry;
+    /*
+     * set for files larger than LARGE_FILE_SIZE,they are not read into memory and are encrypted straight from
+     * the file when they are added
+     */
+    int large;
+    /*
+     * set when the content was already encrypted to the blobs folder and "data" holds its external reference
+     */
+    int external;
+} tree_file_t;
+
+typedef struct
+{
+    tree_file_t *files;
+    size_t count;
+    size_t capacity;
+    int dirfd;
+    int dedup;
+    /*
+     * set to hash the content of all files and not only of the ones that are stored in blobs
+     */
+    int hash_all;
+    /*
+     * files stored in blobs sorted by their hashes,files with the same content follow each other.
+     * "blob_keys" and "blob_counts" hold keys and values of blob and count entries added with the files and
+     * "blob_updates" marks blobs that are already in the wallet and whose counts are to be updated.
+     */
+    tree_file_t **blobs;
+    size_t blob_count;
+    char (*blob_keys)[ BLOB_KEY_SIZE ];
+    u_int32_t *blob_counts;
+    char *blob_updates;
+} tree_t;
+
+static int _treeAddPath(tree_t *t, const char *path)
+{
+    tree_file_t *e;
+
+    if (t->count == t->capacity)
+    {
+        t->capacity = t->capacity == 0 ? 1024 : t->capacity * 2;
+
+        e = realloc(t->files, t->capacity * sizeof(tree_file_t));
+
+        if (e == NULL)
+        {
+            return 1;
+        }
+
+        t->files = e;
+    }
+
+    e = t->files + t->count;
+
+    e->path = strdup(path);
+    e->data = NULL;
+    e->size = 0;
+    e->failed = 0;
+    e->hashed = 0;
+    e->entry = NOT_ADDED;
+    e->skip = 0;
+    e->exists = 0;
+    e->record = NULL;
+    e->unmanaged = 0;
+    e->large = 0;
+    e->external = 0;
+
+    if (e->path == NULL)
+    {
+        return 1;
+    }
+    else
+    {
+        t->count++;
+        return 0;
+    }
+}
+
+/*
+ * collect paths of regular files under "path",a path relative to the top folder.
+ * Symbolic links to files are followed,symbolic links to folders are not to keep away from loops.
+ */
+static int _treeWalk(tree_t *t, int dirfd, const char *path)
+{
+    DIR *dir;
+    struct dirent *entry;
+    struct stat st;
+    int fd;
+    int r = 0;
+    int is_dir;
+    int is_file;
+    char path_1[ PATH_MAX ];
+
+    fd = openat(dirfd, *path == '\0' ? "." : path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+    if (fd == -1)
+    {
+        printf("%s: %s\n", lxqt_wallet_gettext("failed to open directory for reading"), *path == '\0' ? "." : path);
+        return 1;
+    }
+
+    dir = fdopendir(fd);
+
+    if (dir == NULL)
+    {
+        close(fd);
+        return 1;
+    }
+
+    while (r == 0 && (entry = readdir(dir)) != NULL)
+    {
+        if (StringsAreEqual(entry->d_name, ".") || StringsAreEqual(entry->d_name, ".."))
+        {
+            continue;
+        }
+
+        if (*path == '\0')
+        {
+            snprintf(path_1, PATH_MAX, "%s", entry->d_name);
+        }
+        else
+        {
+            snprintf(path_1, PATH_MAX, "%s/%s", path, entry->d_name);
+        }
+
+        if (entry->d_type == DT_DIR)
+        {
+            is_dir  = 1;
+            is_file = 0;
+        }
+        else if (entry->d_type == DT_REG)
+        {
+            is_dir  = 0;
+            is_file = 1;
+        }
+        else if (entry->d_type == DT_UNKNOWN && fstatat(dirfd, path_1, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode))
+        {
+            is_dir  = 1;
+            is_file = 0;
+        }
+        else
+        {
+            is_dir  = 0;
+            is_file = fstatat(dirfd, path_1, &st, 0) == 0 && S_ISREG(st.st_mode);
+        }
+
+        if (is_dir)
+        {
+            r = _treeWalk(t, dirfd, path_1);
+        }
+        else if (is_file)
+        {
+            r = _treeAddPath(t, path_1);
+        }
+    }
+
+    closedir(dir);
+
+    return r;
+}
+
+/*
+ * hash a file read from "fd" a piece at a time
+ */
+static int _hashFile(int fd, char hash[ HASH_SIZE ])
+{
+    char buffer[ 64 * 1024 ];
+    gcry_md_hd_t handle;
+    ssize_t r;
+
+    if (gcry_md_open(&handle, GCRY_MD_SHA256, 0) != 0)
+    {
+        return 1;
+    }
+
+    while ((r = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        gcry_md_write(handle, buffer, r);
+    }
+
+    if (r == 0)
+    {
+        memcpy(hash, gcry_md_read(handle, GCRY_MD_SHA256), HASH_SIZE);
+    }
+
+    gcry_md_close(handle);
+
+    memset(buffer, '\0', sizeof(buffer));
+
+    return r != 0;
+}
+
+static void _treeReadFile(void *arg, u_int64_t i)
+{
+    tree_t *t = arg;
+    tree_file_t *e = t->files + i;
+    struct stat st;
+    ssize_t r;
+    size_t n = 0;
+    int fd;
+
+    if (e->skip)
+    {
+        return;
+    }
+
+    e->failed = 1;
+
+    fd = openat(t->dirfd, e->path, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1)
+    {
+        return;
+    }
+
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return;
+    }
+
+    e->file_size  = st.st_size;
+    e->mtime      = st.st_mtim.tv_sec;
+    e->mtime_nsec = st.st_mtim.tv_nsec;
+
+    if ((u_int64_t)st.st_size > LARGE_FILE_SIZE)
+    {
+        /*
+         * it is read here only if "--sync" needs its hash
+         */
+        e->large  = 1;
+        e->failed = t->hash_all && _hashFile(fd, e->hash) != 0;
+        close(fd);
+        return;
+    }
+
+    e->data = malloc(st.st_size > 0 ? st.st_size : 1);
+
+    if (e->data == NULL)
+    {
+        close(fd);
+        return;
+    }
+
+    while (n < (size_t)st.st_size)
+    {
+        r = read(fd, e->data + n, st.st_size - n);
+
+        if (r <= 0)
+        {
+            break;
+        }
+
+        n += r;
+    }
+
+    close(fd);
+
+    e->size   = n;
+    e->failed = 0;
+    e->hashed = t->dedup && n > REFERENCE_SIZE && !_storedOutOfLine(e->data, n);
+
+    if (e->hashed || t->hash_all)
+    {
+        _hash(e->hash, e->data, n);
+    }
+}
+
+static int _compareHashes(const void *x, const void *y)
+{
+    const tree_file_t *a = *(const tree_file_t * const *)x;
+    const tree_file_t *b = *(const tree_file_t * const *)y;
+
+    return memcmp(a->hash, b->hash, HASH_SIZE);
+}
+
+static int _compareKeys(const void *x, const void *y)
+{
+    const lxqt_wallet_key_values_t *a = x;
+    const lxqt_wallet_key_values_t *b = y;
+
+    if (a->key_size != b->key_size)
+    {
+        return a->key_size < b->key_size ? -1 : 1;
+    }
+    else
+    {
+        return memcmp(a->key, b->key, a->key_size);
+    }
+}
+
+/*
+ * get keys already in the wallet sorted so that each file can be looked up in them with bsearch()
+ */
+static lxqt_wallet_key_values_t *_sortedKeys(lxqt_wallet_t wallet, size_t *count)
+{
+    lxqt_wallet_iterator_t iter;
+    lxqt_wallet_key_values_t *e;
+    size_t i = 0;
+    size_t n = lxqt_wallet_wallet_entry_count(wallet);
+
+    e = malloc((n > 0 ? n : 1) * sizeof(lxqt_wallet_key_values_t));
+
+    if (e == NULL)
+    {
+        return NULL;
+    }
+
+    memset(&iter, '\0', sizeof(iter));
+
+    while (i < n && lxqt_wallet_iter_read_key(wallet, &iter))
+    {
+        e[ i++ ] = iter.entry;
+    }
+
+    qsort(e, i, sizeof(lxqt_wallet_key_values_t), _compareKeys);
+
+    *count = i;
+
+    return e;
+}
+
+/*
+ * turn added files that are to be stored in blobs into references and add blob and count entries for contents that
+ * are not in the wallet yet,returns the new number of entries.Counts of blobs that are already in the wallet are
+ * changed in memory by _updateTreeBlobCounts() after the entries are added and are written back with other changed
+ * counts.
+ */
+static size_t _addTreeBlobs(tree_t *t, lxqt_wallet_key_values_t *entries, size_t count,
+                            const lxqt_wallet_key_values_t *keys, size_t key_count)
+{
+    lxqt_wallet_key_values_t key;
+    const lxqt_wallet_key_values_t *e;
+    size_t blob_entries = count;
+    size_t i;
+    size_t j;
+    u_int32_t n;
+
+    t->blobs       = malloc((t->count > 0 ? t->count : 1) * sizeof(tree_file_t *));
+    t->blob_keys   = malloc((t->count > 0 ? 2 * t->count : 1) * BLOB_KEY_SIZE);
+    t->blob_counts = malloc((t->count > 0 ? t->count : 1) * sizeof(u_int32_t));
+    t->blob_updates = calloc(t->count > 0 ? t->count : 1, 1);
+
+    if (t->blobs == NULL || t->blob_keys == NULL || t->blob_counts == NULL || t->blob_updates == NULL)
+    {
+        /*
+         * files are stored as they are
+         */
+        t->blob_count = 0;
+        return count;
+    }
+
+    t->blob_count = 0;
+
+    for (i = 0; i < t->count; i++)
+    {
+        if (t->files[ i ].hashed && t->files[ i ].entry != NOT_ADDED)
+        {
+            t->blobs[ t->blob_count++ ] = t->files + i;
+        }
+    }
+
+    qsort(t->blobs, t->blob_count, sizeof(tree_file_t *), _compareHashes);
+
+    for (i = 0; i < t->blob_count; i = j)
+    {
+        for (j = i; j < t->blob_count && memcmp(t->blobs[ i ]->hash, t->blobs[ j ]->hash, HASH_SIZE) == 0; j++)
+        {
+            _reference(t->blobs[ j ]->reference, t->blobs[ j ]->hash);
+
+            entries[ t->blobs[ j ]->entry ].key_value      = t->blobs[ j ]->reference;
+            entries[ t->blobs[ j ]->entry ].key_value_size = REFERENCE_SIZE;
+        }
+
+        _blobKey(t->blob_keys[ 2 * i ], 'c', t->blobs[ i ]->hash);
+
+        key.key      = t->blob_keys[ 2 * i ];
+        key.key_size = BLOB_KEY_SIZE;
+
+        e = bsearch(&key, keys, key_count, sizeof(lxqt_wallet_key_values_t), _compareKeys);
+
+        n = 0;
+
+        if (e != NULL && e->key_value_size == sizeof(u_int32_t))
+        {
+            memcpy(&n, e->key_value, sizeof(u_int32_t));
+        }
+
+        t->blob_counts[ i ] = n + (u_int32_t)(j - i);
+
+        if (n != 0)
+        {
+            t->blob_updates[ i ] = 1;
+        }
+        else
+        {
+            /*
+             * a new blob,its count is added with it
+             */
+            _blobKey(t->blob_keys[ 2 * i + 1 ], 'b', t->blobs[ i ]->hash);
+
+            entries[ blob_entries ].key            = t->blob_keys[ 2 * i + 1 ];
+            entries[ blob_entries ].key_size       = BLOB_KEY_SIZE;
+            entries[ blob_entries ].key_value      = t->blobs[ i ]->data;
+            entries[ blob_entries ].key_value_size = t->blobs[ i ]->size;
+            blob_entries++;
+
+            entries[ blob_entries ].key            = t->blob_keys[ 2 * i ];
+            entries[ blob_entries ].key_size       = BLOB_KEY_SIZE;
+            entries[ blob_entries ].key_value      = (const char *)(t->blob_counts + i);
+            entries[ blob_entries ].key_value_size = sizeof(u_int32_t);
+            blob_entries++;
+        }
+    }
+
+    return blob_entries;
+}
+
+static int _updateTreeBlobCounts(lxqt_wallet_t wallet, tree_t *t)
+{
+    cli_wallet_t w = _localWallet(wallet);
+    blob_count_t *count;
+    size_t i;
+    int k = 0;
+
+    for (i = 0; i < t->blob_count; i++)
+    {
+        if (t->blob_updates[ i ])
+        {
+            count = _blobCount(&w, t->blobs[ i ]->hash);
+
+            if (count == NULL)
+            {
+                puts(lxqt_wallet_gettext("failed to add file to the wallet"));
+                k = 1;
+            }
+            else
+            {
+                count->count = t->blob_counts[ i ];
+            }
+        }
+    }
+
+    return k;
+}
+
+/*
+ * open folder "path" and collect paths of files in it,returns 1 if not all of them could be collected
+ * and t->dirfd is -1 if the folder could not be opened.
+ */
+static int _treeOpen(tree_t *t, lxqt_wallet_t wallet, const char *path)
+{
+    cli_wallet_t w = _localWallet(wallet);
+
+    memset(t, '\0', sizeof(tree_t));
+
+    t->dirfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (t->dirfd == -1)
+    {
+        puts(lxqt_wallet_gettext("failed to open directory for reading"));
+        return 1;
+    }
+
+    t->dedup = _dedupEnabled(&w);
+
+    return _treeWalk(t, t->dirfd, "");
+}
+
+static void _treeClose(tree_t *t)
+{
+    size_t i;
+
+    for (i = 0; i < t->count; i++)
+    {
+        if (t->files[ i ].data != NULL)
+        {
+            memset(t->files[ i ].data, '\0', t->files[ i ].size);
+            free(t->files[ i ].data);
+        }
+
+        free(t->files[ i ].path);
+    }
+
+    free(t->files);
+    free(t->blobs);
+    free(t->blob_keys);
+    free(t->blob_counts);
+    free(t->blob_updates);
+
+    if (t->dirfd != -1)
+    {
+        close(t->dirfd);
+    }
+}
+
+/*
+ * store the content of a file that is to be added out of line and replace it with an external reference,
+ * large files are encrypted straight from the file
+ */
+static void _treeStoreExternalFile(void *arg, u_int64_t i)
+{
+    tree_t *t = arg;
+    tree_file_t *e = t->files + i;
+    char *reference;
+    int fd;
+    int k;
+
+    if (e->entry == NOT_ADDED || e->external || (!e->large && !_storedOutOfLine(e->data, e->size)))
+    {
+        return;
+    }
+
+    reference = malloc(EXTERNAL_SIZE);
+
+    if (reference == NULL)
+    {
+        k = 1;
+    }
+    else if (e->large)
+    {
+        fd = openat(t->dirfd, e->path, O_RDONLY | O_CLOEXEC);
+        k  = fd == -1 || _storeExternalFileFromFd(fd, reference) != 0;
+
+        if (fd != -1)
+        {
+            close(fd);
+        }
+    }
+    else
+    {
+        k = _storeExternalFile(e->data, e->size, reference);
+    }
+
+    if (k != 0)
+    {
+        free(reference);
+        e->failed = 1;
+        return;
+    }
+
+    if (e->data != NULL)
+    {
+        memset(e->data, '\0', e->size);
+        free(e->data);
+    }
+
+    e->data = reference;
+    e->size = EXTERNAL_SIZE;
+}
+
+/*
+ * add files that were read and are not skipped to the wallet in one go,files the wallet already has are refused
+ */
+static int _treeInsert(lxqt_wallet_t wallet, tree_t *t)
+{
+    cli_wallet_t w = _localWallet(wallet);
+    lxqt_wallet_key_values_t *keys;
+    lxqt_wallet_key_values_t *entries;
+    lxqt_wallet_key_values_t key;
+    lxqt_wallet_error r;
+    size_t key_count = 0;
+    size_t count = 0;
+    size_t i;
+    int k = 0;
+
+    /*
+     * counts of blobs are looked up in the wallet below and must be written back first
+     */
+    if (_flushBlobCounts(&w) != 0)
+    {
+        puts(lxqt_wallet_gettext("failed to update counts of deduplicated files"));
+        return 1;
+    }
+
+    keys    = _sortedKeys(wallet, &key_count);
+    entries = malloc((t->count > 0 ? 3 * t->count : 1) * sizeof(lxqt_wallet_key_values_t));
+
+    if (keys == NULL || entries == NULL)
+    {
+        puts(lxqt_wallet_gettext("failed to allocate memory"));
+        k = 1;
+    }
+    else
+    {
+        for (i = 0; i < t->count; i++)
+        {
+            key.key      = t->files[ i ].path;
+            key.key_size = strlen(t->files[ i ].path) + 1;
+
+            if (t->files[ i ].skip)
+            {
+                continue;
+            }
+            else if (t->files[ i ].failed)
+            {
+                printf("%s: %s\n", lxqt_wallet_gettext("failed to open file for reading"), t->files[ i ].path);
+                k = 1;
+            }
+            else if (bsearch(&key, keys, key_count, sizeof(lxqt_wallet_key_values_t), _compareKeys) != NULL)
+            {
+                printf("%s",lxqt_wallet_gettext_1("wallet already has \"%s\" entry\n", t->files[ i ].path));
+                k = 1;
+            }
+            else
+            {
+                t->files[ i ].entry = count++;
+            }
+        }
+
+        _lxqt_wallet_parallel_for(t->count, _treeStoreExternalFile, t);
+
+        for (i = 0; i < t->count; i++)
+        {
+            if (t->files[ i ].entry == NOT_ADDED)
+            {
+                continue;
+            }
+            else if (t->files[ i ].failed)
+            {
+                printf("%s: %s\n", lxqt_wallet_gettext("failed to store file out of line"), t->files[ i ].path);
+                k = 1;
+            }
+
+            entries[ t->files[ i ].entry ].key            = t->files[ i ].path;
+            entries[ t->files[ i ].entry ].key_size       = strlen(t->files[ i ].path) + 1;
+            entries[ t->files[ i ].entry ].key_value      = t->files[ i ].data;
+            entries[ t->files[ i ].entry ].key_value_size = t->files[ i ].size;
+        }
+
+        if (t->dedup)
+        {
+            count = _addTreeBlobs(t, entries, count, keys, key_count);
+        }
+
+        r = k == 0 ? lxqt_wallet_add_keys(wallet, entries, count) : lxqt_wallet_failed_to_open_file;
+
+        if (r != lxqt_wallet_no_error)
+        {
+            /*
+             * nothing was added,encrypted files written for the added files are of no use
+             */
+            for (i = 0; i < t->count; i++)
+            {
+                if (t->files[ i ].entry != NOT_ADDED && !t->files[ i ].failed &&
+                    _isExternal(t->files[ i ].data, t->files[ i ].size))
+                {
+                    _discardExternalFile(t->files[ i ].data);
+                }
+            }
+
+            if (k == 0)
+            {
+                puts(lxqt_wallet_gettext("failed to add file to the wallet"));
+            }
+
+            k = 1;
+        }
+        else if (t->dedup)
+        {
+            k |= _updateTreeBlobCounts(wallet, t);
+        }
+    }
+
+    free(keys);
+    free(entries);
+
+    return k;
+}
+
+static int _addTreeToWallet(lxqt_wallet_t wallet, const char *path)
+{
+    tree_t t;
+    int k = _treeOpen(&t, wallet, path);
+
+    if (t.dirfd == -1)
+    {
+        return 1;
+    }
+
+    _lxqt_wallet_parallel_for(t.count, _treeReadFile, &t);
+
+    k |= _treeInsert(wallet, &t);
+
+    _treeClose(&t);
+
+    return k;
+}
+
+/*
+ * Functions below implement "--sync" that makes the wallet hold the files in a folder and in its sub folders keyed
+ * by their relative paths.
+ *
+ * The size,modification time and SHA-256 hash of every synced file is kept in a manifest entry whose key is
+ * SYNC_MANIFEST_KEY and whose value is a list of [ u_int32_t path size ][ path ][ u_int64_t size ]
+ * [ int64_t modification time in seconds ][ int64_t nano seconds ][ hash ] records sorted by path.
+ *
+ * Only files whose size or modification time changed since the last sync are read,files whose content did not
+ * change are not written to the wallet again and files removed from the folder are deleted from the wallet.
+ * Entries that were not added by a sync are left alone,files in the folder with the same keys are neither read nor
+ * recorded in the manifest.Files missing from a damaged manifest are synced again.
+ */
+#define SYNC_MANIFEST_KEY      "\0sync"
+#define SYNC_MANIFEST_KEY_SIZE 6
+#define SYNC_RECORD_SIZE       ( 3 * sizeof( u_int64_t ) + HASH_SIZE )
+
+static int _compareRecords(const void *x, const void *y)
+{
+    const sync_record_t *a = x;
+    const sync_record_t *b = y;
+
+    if (a->path_size != b->path_size)
+    {
+        return a->path_size < b->path_size ? -1 : 1;
+    }
+    else
+    {
+        return memcmp(a->path, b->path, a->path_size);
+    }
+}
+
+/*
+ * read the manifest into "records" sorted by path,records point into "buffer" that holds a copy of the manifest.
+ * "damaged" is set if only the start of the manifest could be read.
+ */
+static int _readManifest(lxqt_wallet_t wallet, char **buffer, u_int32_t *buffer_size,
+                         sync_record_t **records, size_t *count, int *damaged)
+{
+    lxqt_wallet_key_values_t k;
+    sync_record_t *e;
+    u_int32_t i = 0;
+    size_t n = 0;
+    const char *z;
+
+    *buffer      = NULL;
+    *buffer_size = 0;
+    *records     = NULL;
+    *count       = 0;
+    *damaged     = 0;
+
+    if (!lxqt_wallet_read_key_value(wallet, SYNC_MANIFEST_KEY, SYNC_MANIFEST_KEY_SIZE, &k) || k.key_value_size == 0)
+    {
+        return 0;
+    }
+
+    *buffer = malloc(k.key_value_size);
+    e       = malloc((k.key_value_size / (sizeof(u_int32_t) + SYNC_RECORD_SIZE) + 1) * sizeof(sync_record_t));
+
+    if (*buffer == NULL || e == NULL)
+    {
+        free(*buffer);
+        free(e);
+        *buffer = NULL;
+        puts(lxqt_wallet_gettext("failed to allocate memory"));
+        return 1;
+    }
+
+    memcpy(*buffer, k.key_value, k.key_value_size);
+    *buffer_size = k.key_value_size;
+
+    while (i < k.key_value_size)
+    {
+        z = *buffer + i;
+
+        /*
+         * a damaged manifest,the rest of it is ignored and the files it lists are synced again
+         */
+        if (k.key_value_size - i < sizeof(u_int32_t) + SYNC_RECORD_SIZE)
+        {
+            *damaged = 1;
+            break;
+        }
+
+        memcpy(&e[ n ].path_size, z, sizeof(u_int32_t));
+
+        if (e[ n ].path_size == 0 || e[ n ].path_size > k.key_value_size - i - sizeof(u_int32_t) - SYNC_RECORD_SIZE)
+        {
+            *damaged = 1;
+            break;
+        }
+        else if (z[ sizeof(u_int32_t) + e[ n ].path_size - 1 ] != '\0')
+        {
+            *damaged = 1;
+            break;
+        }
+
+        e[ n ].path = z + sizeof(u_int32_t);
+        z = e[ n ].path + e[ n ].path_size;
+
+        memcpy(&e[ n ].size, z, sizeof(u_int64_t));
+        memcpy(&e[ n ].mtime, z + sizeof(u_int64_t), sizeof(int64_t));
+        memcpy(&e[ n ].mtime_nsec, z + 2 * sizeof(u_int64_t), sizeof(int64_t));
+        memcpy(e[ n ].hash, z + 3 * sizeof(u_int64_t), HASH_SIZE);
+
+        e[ n ].seen = 0;
+
+        i += sizeof(u_int32_t) + e[ n ].path_size + SYNC_RECORD_SIZE;
+        n++;
+    }
+
+    qsort(e, n, sizeof(sync_record_t), _compareRecords);
+
+    *records = e;
+    *count   = n;
+
+    return 0;
+}
+
+static char *_writeRecord(char *e, const char *path, u_int32_t path_size, u_int64_t size, int64_t mtime,
+                          int64_t mtime_nsec, const char *hash)
+{
+    memcpy(e, &path_size, sizeof(u_int32_t));
+    e += sizeof(u_int32_t);
+    memcpy(e, path, path_size);
+    e += path_size;
+    memcpy(e, &size, sizeof(u_int64_t));
+    e += sizeof(u_int64_t);
+    memcpy(e, &mtime, sizeof(int64_t));
+    e += sizeof(int64_t);
+    memcpy(e, &mtime_nsec, sizeof(int64_t));
+    e += sizeof(int64_t);
+    memcpy(e, hash, HASH_SIZE);
+
+    return e + HASH_SIZE;
+}
+
+static int _compareFilePaths(const void *x, const void *y)
+{
+    const tree_file_t *a = *(const tree_file_t * const *)x;
+    const tree_file_t *b = *(const tree_file_t * const *)y;
+    size_t l = strlen(a->path);
+    size_t m = strlen(b->path);
+
+    if (l != m)
+    {
+        return l < m ? -1 : 1;
+    }
+    else
+    {
+        return memcmp(a->path, b->path, l);
+    }
+}
+
+/*
+ * write a new manifest if it differs from the old one
+ */
+static int _writeManifest(lxqt_wallet_t wallet, tree_t *t, const char *old, u_int32_t old_size)
+{
+    tree_file_t **files = malloc((t->count > 0 ? t->count : 1) * sizeof(tree_file_t *));
+    tree_file_t *f;
+    u_int64_t size = 0;
+    size_t count = 0;
+    size_t i;
+    char *buffer;
+    char *e;
+    int k = 0;
+
+    if (files == NULL)
+    {
+        puts(lxqt_wallet_gettext("failed to allocate memory"));
+        return 1;
+    }
+
+    for (i = 0; i < t->count; i++)
+    {
+        f = t->files + i;
+
+        if ((!f->failed || f->record != NULL) && !f->unmanaged)
+        {
+            files[ count++ ] = f;
+            size += sizeof(u_int32_t) + strlen(f->path) + 1 + SYNC_RECORD_SIZE;
+        }
+    }
+
+    qsort(files, count, sizeof(tree_file_t *), _compareFilePaths);
+
+    buffer = malloc(size > 0 ? size : 1);
+
+    if (buffer == NULL || size >= (u_int64_t)UINT_MAX)
+    {
+        free(files);
+        free(buffer);
+        puts(lxqt_wallet_gettext("failed to allocate memory"));
+        return 1;
+    }
+
+    e = buffer;
+
+    for (i = 0; i < count; i++)
+    {
+        f = files[ i ];
+
+        if (f->failed || f->skip)
+        {
+            /*
+             * not read,what was recorded the last time is kept
+             */
+            e = _writeRecord(e, f->path, strlen(f->path) + 1, f->record->size, f->record->mtime,
+                             f->record->mtime_nsec, f->record->hash);
+        }
+        else
+        {
+            e = _writeRecord(e, f->path, strlen(f->path) + 1, f->file_size, f->mtime, f->mtime_nsec, f->hash);
+        }
+    }
+
+    if (size != old_size || (size > 0 && memcmp(buffer, old, size) != 0))
+    {
+        lxqt_wallet_delete_key(wallet, SYNC_MANIFEST_KEY, SYNC_MANIFEST_KEY_SIZE);
+
+        if (lxqt_wallet_add_key(wallet, SYNC_MANIFEST_KEY, SYNC_MANIFEST_KEY_SIZE, buffer, size) != lxqt_wallet_no_error)
+        {
+            puts(lxqt_wallet_gettext("failed to add file to the wallet"));
+            k = 1;
+        }
+    }
+
+    free(buffer);
+    free(files);
+
+    return k;
+}
+
+static void _treeStatFile(void *arg, u_int64_t i)
+{
+    tree_t *t = arg;
+    tree_file_t *e = t->files + i;
+    struct stat st;
+
+    if (fstatat(t->dirfd, e->path, &st, 0) == 0)
+    {
+        e->file_size  = st.st_size;
+        e->mtime      = st.st_mtim.tv_sec;
+        e->mtime_nsec = st.st_mtim.tv_nsec;
+    }
+    else
+    {
+        e->failed = 1;
+    }
+}
+
+static int _syncFolder(lxqt_wallet_t wallet, const char *path)
+{
+    cli_wallet_t w = _localWallet(wallet);
+    tree_t t;
+    tree_file_t *f;
+    sync_record_t *records;
+    sync_record_t record;
+    lxqt_wallet_key_values_t *keys;
+    lxqt_wallet_key_values_t key;
+    char *manifest;
+    u_int32_t manifest_size;
+    size_t record_count;
+    size_t key_count = 0;
+    size_t added = 0;
+    size_t updated = 0;
+    size_t deleted = 0;
+    size_t failed = 0;
+    size_t unmanaged = 0;
+    size_t i;
+    int damaged;
+    int k = _treeOpen(&t, wallet, path);
+
+    if (t.dirfd == -1)
+    {
+        return 1;
+    }
+
+    t.hash_all = 1;
+
+    if (_readManifest(wallet, &manifest, &manifest_size, &records, &record_count, &damaged) != 0)
+    {
+        _treeClose(&t);
+        return 1;
+    }
+
+    _lxqt_wallet_parallel_for(t.count, _treeStatFile, &t);
+
+    keys = _sortedKeys(wallet, &key_count);
+
+    if (keys == NULL)
+    {
+        puts(lxqt_wallet_gettext("failed to allocate memory"));
+        free(manifest);
+        free(records);
+        _treeClose(&t);
+        return 1;
+    }
+
+    /*
+     * files whose size and modification time are the same as the last time are not read
+     */
+    for (i = 0; i < t.count; i++)
+    {
+        f = t.files + i;
+
+        record.path      = f->path;
+        record.path_size = strlen(f->path) + 1;
+
+        key.key      = record.path;
+        key.key_size = record.path_size;
+
+        if (record_count > 0)
+        {
+            f->record = bsearch(&record, records, record_count, sizeof(sync_record_t), _compareRecords);
+        }
+        f->exists = bsearch(&key, keys, key_count, sizeof(lxqt_wallet_key_values_t), _compareKeys) != NULL;
+
+        if (f->record != NULL)
+        {
+            f->record->seen = 1;
+        }
+
+        if (f->failed)
+        {
+            f->skip = 1;
+        }
+        else if (f->record == NULL && f->exists && !damaged)
+        {
+            f->skip      = 1;
+            f->unmanaged = 1;
+        }
+        else if (f->record != NULL && f->exists && f->record->size == f->file_size &&
+                 f->record->mtime == f->mtime && f->record->mtime_nsec == f->mtime_nsec)
+        {
+            f->skip = 1;
+        }
+    }
+
+    free(keys);
+
+    _lxqt_wallet_parallel_for(t.count, _treeReadFile, &t);
+
+    for (i = 0; i < t.count; i++)
+    {
+        f = t.files + i;
+
+        if (f->failed)
+        {
+            printf("%s: %s\n", lxqt_wallet_gettext("failed to open file for reading"), f->path);
+            f->skip = 1;
+            failed++;
+            k = 1;
+        }
+        else if (f->unmanaged)
+        {
+            printf("%s: %s\n", lxqt_wallet_gettext("not added by a sync,left alone"), f->path);
+            unmanaged++;
+        }
+        else if (f->skip)
+        {
+            continue;
+        }
+        else if (f->record != NULL && f->exists && memcmp(f->record->hash, f->hash, HASH_SIZE) == 0)
+        {
+            /*
+             * only the modification time changed
+             */
+            f->skip = 1;
+            f->record = NULL;
+        }
+        else if (f->exists)
+        {
+            _deleteKey(&w, f->path, strlen(f->path) + 1);
+            printf("%s: %s\n", lxqt_wallet_gettext("updated"), f->path);
+            updated++;
+        }
+        else
+        {
+            printf("%s: %s\n", lxqt_wallet_gettext("added"), f->path);
+            added++;
+        }
+    }
+
+    for (i = 0; i < record_count; i++)
+    {
+        if (!records[ i ].seen)
+        {
+            _deleteKey(&w, records[ i ].path, records[ i ].path_size);
+            printf("%s: %s\n", lxqt_wallet_gettext("deleted"), records[ i ].path);
+            deleted++;
+        }
+    }
+
+    k |= _treeInsert(wallet, &t);
+
+    /*
+     * files whose content did not change get their new modification time recorded
+     */
+    for (i = 0; i < t.count; i++)
+    {
+        if (t.files[ i ].skip && t.files[ i ].record == NULL && !t.files[ i ].failed && !t.files[ i ].unmanaged)
+        {
+            t.files[ i ].skip = 0;
+        }
+    }
+
+    k |= _writeManifest(wallet, &t, manifest, manifest_size);
+
+    printf("%lu %s,%lu %s,%lu %s,%lu %s,%lu %s,%lu %s\n", (unsigned long)added, lxqt_wallet_gettext("added"),
+           (unsigned long)updated, lxqt_wallet_gettext("updated"), (unsigned long)deleted, lxqt_wallet_gettext("deleted"),
+           (unsigned long)(t.count - added - updated - failed - unmanaged), lxqt_wallet_gettext("unchanged"),
+           (unsigned long)failed, lxqt_wallet_gettext("failed"), (unsigned long)unmanaged, lxqt_wallet_gettext("left alone"));
+
+    free(manifest);
+    free(records);
+    _treeClose(&t);
+
+    return k;
+}
+
+/*
+ * Functions below implement "--get-all" that writes all files in the wallet to a folder.
+ *
+ * The wallet is walked once and files are written by a pool of threads straight from the memory of the wallet.
+ * Keys with '/' characters are written to sub folders that are created as needed.A file is created unnamed with
+ * O_TMPFILE and is linked into its folder only after all of its content is written,a file is hence either missing
+ * or complete and files that already exist are not replaced.
+ */
+
+typedef struct
+{
+    lxqt_wallet_key_values_t *entries;
+    /*
+     * all entries of the wallet sorted by their keys,blobs files refer to are looked up in them
+     */
+    lxqt_wallet_key_values_t *keys;
+    size_t key_count;
+    int dirfd;
+    int failed;
+} extract_t;
+
+/*
+ * keys that would be written outside of the target folder are refused
+ */
+static int _safePath(const char *path)
+{
+    const char *e = path;
+    size_t len;
+
+    if (*path == '\0' || *path == '/')
+    {
+        return 0;
+    }
+
+    while (*e != '\0')
+    {
+        len = strcspn(e, "/");
+
+        if (len == 0 || (len == 1 && e[ 0 ] == '.') || (len == 2 && e[ 0 ] == '.' && e[ 1 ] == '.'))
+        {
+            return 0;
+        }
+
+        e += len;
+
+        if (*e == '/')
+        {
+            e++;
+
+            if (*e == '\0')
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * open the folder file "path" is to be created in,creating missing folders on the way.
+ * "path" is cut at its last '/' and the name of the file is returned through "name".
+ */
+static int _openParentFolder(int dirfd, char *path, const char **name)
+{
+    char *e = strrchr(path, '/');
+    char *f;
+    int fd;
+
+    if (e == NULL)
+    {
+        *name = path;
+        return dup(dirfd);
+    }
+
+    *e = '\0';
+    *name = e + 1;
+
+    fd = openat(dirfd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd != -1)
+    {
+        return fd;
+    }
+
+    for (f = strchr(path, '/'); f != NULL; f = strchr(f + 1, '/'))
+    {
+        *f = '\0';
+        mkdirat(dirfd, path, 0755);
+        *f = '/';
+    }
+
+    mkdirat(dirfd, path, 0755);
+
+    return openat(dirfd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+/*
+ * create file "name" in folder "dirfd" with "value" as its content,returns EEXIST if the file already exists
+ */
+static int _createFileAtomically(int dirfd, const char *name, const char *value, u_int32_t value_size)
+{
+    char path[ PATH_MAX ];
+    int fd = -1;
+    int r = 0;
+
+#ifdef O_TMPFILE
+    fd = openat(dirfd, ".", O_TMPFILE | O_WRONLY | O_CLOEXEC, 0644);
+
+    if (fd != -1)
+    {
+        if (_writeValue(fd, value, value_size) != 0)
+        {
+            r = errno;
+        }
+        else
+        {
+            snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+
+            if (linkat(AT_FDCWD, path, dirfd, name, AT_SYMLINK_FOLLOW) != 0)
+            {
+                r = errno;
+            }
+        }
+
+        close(fd);
+
+        return r;
+    }
+#endif
+    /*
+     * the file system does not support unnamed files,write to a temporary name and link it to the real name
+     */
+    snprintf(path, sizeof(path), ".%s.%ld.tmp", name, (long)pthread_self());
+
+    fd = openat(dirfd, path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+
+    if (fd == -1)
+    {
+        return errno;
+    }
+
+    if (_writeValue(fd, value, value_size) != 0)
+    {
+        r = errno;
+    }
+    else if (linkat(dirfd, path, dirfd, name, 0) != 0)
+    {
+        r = errno;
+    }
+
+    close(fd);
+    unlinkat(dirfd, path, 0);
+
+    return r;
+}
+
+static void _extractFile(void *arg, u_int64_t i)
+{
+    extract_t *x = arg;
+    const lxqt_wallet_key_values_t *e = x->entries + i;
+    lxqt_wallet_key_values_t key;
+    char blob_key[ BLOB_KEY_SIZE ];
+    char path[ PATH_MAX ];
+    char folder[ PATH_MAX ];
+    const char *name;
+    size_t len = strnlen(e->key, e->key_size);
+    int fd;
+    int r;
+
+    if (len >= sizeof(path))
+    {
+        len = sizeof(path) - 1;
+    }
+
+    memcpy(path, e->key, len);
+    path[ len ] = '\0';
+
+    if (!_safePath(path))
+    {
+        printf("%s: %s\n", lxqt_wallet_gettext("refusing to write a file outside of the folder"), path);
+        x->failed = 1;
+        return;
+    }
+
+    if (_isReference(e->key_value, e->key_value_size))
+    {
+        _blobKey(blob_key, 'b', e->key_value + REFERENCE_MAGIC_SIZE);
+
+        key.key      = blob_key;
+        key.key_size = BLOB_KEY_SIZE;
+
+        e = bsearch(&key, x->keys, x->key_count, sizeof(lxqt_wallet_key_values_t), _compareKeys);
+
+        if (e == NULL)
+        {
+            printf("%s: %s\n", lxqt_wallet_gettext("content of the file is missing from the wallet"), path);
+            x->failed = 1;
+            return;
+        }
+    }
+
+    memcpy(folder, path, len + 1);
+
+    fd = _openParentFolder(x->dirfd, folder, &name);
+
+    if (fd == -1)
+    {
+        printf("%s: %s\n", lxqt_wallet_gettext("failed to create a folder"), path);
+        x->failed = 1;
+        return;
+    }
+
+    r = _createFileAtomically(fd, name, e->key_value, e->key_value_size);
+
+    close(fd);
+
+    if (r == EEXIST)
+    {
+        printf("%s",lxqt_wallet_gettext_1("path ./\"%s\" already occupied\n", path));
+        x->failed = 1;
+    }
+    else if (r != 0)
+    {
+        printf("%s: %s\n", lxqt_wallet_gettext("failed to open file for writing"), path);
+        x->failed = 1;
+    }
+}
+
+static int _getAllFilesFromWallet(lxqt_wallet_t wallet, const char *path)
+{
+    lxqt_wallet_iterator_t iter;
+    extract_t x;
+    size_t count = 0;
+    size_t n;
+
+    if (path == NULL)
+    {
+        path = ".";
+    }
+    else
+    {
+        mkdir(path, 0755);
+    }
+
+    x.failed = 0;
+    x.dirfd  = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (x.dirfd == -1)
+    {
+        puts(lxqt_wallet_gettext("failed to open directory for reading"));
+        return 1;
+    }
+
+    n = lxqt_wallet_wallet_entry_count(wallet);
+
+    x.entries   = malloc((n > 0 ? n : 1) * sizeof(lxqt_wallet_key_values_t));
+    x.keys      = malloc((n > 0 ? n : 1) * sizeof(lxqt_wallet_key_values_t));
+    x.key_count = 0;
+
+    if (x.entries == NULL || x.keys == NULL)
+    {
+        free(x.entries);
+        free(x.keys);
+        close(x.dirfd);
+        puts(lxqt_wallet_gettext("failed to allocate memory"));
+        return 1;
+    }
+
+    memset(&iter, '\0', sizeof(iter));
+
+    while (x.key_count < n && lxqt_wallet_iter_read_value(wallet, &iter))
+    {
+        x.keys[ x.key_count++ ] = iter.entry;
+
+        if (!_isInternalKey(iter.entry.key, iter.entry.key_size))
+        {
+            x.entries[ count++ ] = iter.entry;
+        }
+    }
+
+    if (count < x.key_count)
+    {
+        qsort(x.keys, x.key_count, sizeof(lxqt_wallet_key_values_t), _compareKeys);
+    }
+
+    _lxqt_wallet_parallel_for(count, _extractFile, &x);
+
+    free(x.entries);
+    free(x.keys);
+    close(x.dirfd);
+
+    return x.failed;
+}
+
+/*
+ * Functions below implement "--agent" mode where files are kept in a wallet held unlocked by lxqt_wallet-agent,
+ * commands run the same functions as they do on a wallet opened by this process.
+ */
+
+static int _agentGetFile(const char *key, u_int32_t key_size, void *arg)
+{
+    if (!_isInternalKey(key, key_size))
+    {
+        _getFileFromWallet(arg, key);
+    }
+
+    return 0;
+}
+
+static int _agentGetAllFilesFromWallet(cli_wallet_t *w)
+{
+    return _agentReportError(_listKeys(w, _agentGetFile, w));
+}
+
+static int _agentMain(int argc, char *argv[])
+{
+    cli_wallet_t w;
+    lxqt_wallet_error r;
+    size_t password_length = 0;
+    const char *action;
+    int k = 1;
+    int lock;
+
+    char password[ PASSWORD_SIZE + 1 ];
+    char wallet_name[ WALLET_NAME_SIZE + 1 ];
+
+    if (argc < 3 || argc > 4)
+    {
+        _help();
+        return 1;
+    }
+
+    action = argv[ 2 ];
+
+    memset(&w, '\0', sizeof(w));
+
+    if (lxqt_wallet_agent_connect(&w.agent) != lxqt_wallet_no_error)
+    {
+        puts(lxqt_wallet_gettext("failed to connect to lxqt_wallet-agent"));
+        return 1;
+    }
+
+    _getWalletName(wallet_name);
+    _setExternalFolder(wallet_name);
+
+    w.wallet_name = wallet_name;
+
+    if (StringsAreEqual(action, "--lock"))
+    {
+        k = _agentReportError(lxqt_wallet_agent_lock(w.agent, wallet_name, APPLICATION_NAME));
+        lxqt_wallet_agent_disconnect(&w.agent);
+        return k;
+    }
+
+    if (!lxqt_wallet_agent_has_wallet(w.agent, wallet_name, APPLICATION_NAME))
+    {
+        if (_getWalletPassword(wallet_name, password, &password_length))
+        {
+            lxqt_wallet_agent_disconnect(&w.agent);
+            return 1;
+        }
+
+        r = lxqt_wallet_agent_unlock(w.agent, password, password_length, wallet_name, APPLICATION_NAME);
+
+        memset(password, '\0', sizeof(password));
+
+        if (r != lxqt_wallet_no_error)
+        {
+            puts(lxqt_wallet_gettext("wrong password,failed to open wallet"));
+            lxqt_wallet_agent_disconnect(&w.agent);
+            return 1;
+        }
+    }
+
+    lock = _lockBlobCounts(wallet_name);
+
+    if (lock == -1)
+    {
+        puts(lxqt_wallet_gettext("failed to lock the wallet"));
+        lxqt_wallet_agent_disconnect(&w.agent);
+        return 1;
+    }
+
+    if (argc == 3 && StringsAreEqual(action, "--list"))
+    {
+        k = _printListOfManagedFiles(&w);
+    }
+    else if (argc == 3 && StringsAreEqual(action, "--get-all"))
+    {
+        k = _agentGetAllFilesFromWallet(&w);
+    }
+    else if (argc == 3 && StringsAreEqual(action, "--unlock"))
+    {
+        k = 0;
+    }
+    else if (argc == 4 && StringsAreEqual(action, "--add"))
+    {
+        k = _addFileToWallet(&w, argv[ 3 ]);
+    }
+    else if (argc == 4 && StringsAreEqual(action, "--delete"))
+    {
+        k = _deleteFileFromWallet(&w, argv[ 3 ]);
+    }
+    else if (argc == 4 && StringsAreEqual(action, "--get"))
+    {
+        k = _getFileFromWallet(&w, argv[ 3 ]);
+    }
+    else if (argc == 4 && StringsAreEqual(action, "--add-all"))
+    {
+        k = _addAllFilesToTheWallet(&w, argv[ 3 ]);
+    }
+    else
+    {
+        _help();
+    }
+
+    if (_flushBlobCounts(&w) != 0)
+    {
+        k = _reportError(&w, "failed to update counts of deduplicated files");
+    }
+
+    close(lock);
+
+    /*
+     * encrypted files of deleted entries are removed only after the agent saved the wallet without them
+     */
+    if (_deletedExternalFileCount > 0)
+    {
+        r = lxqt_wallet_agent_save(w.agent, wallet_name, APPLICATION_NAME);
+
+        _removeDeletedExternalFiles(r == lxqt_wallet_no_error);
+    }
+
+    lxqt_wallet_agent_disconnect(&w.agent);
+
+    return k;
+}
+
+/*
+ * Functions below implement "--batch" mode where commands read from a file or from standard input are run against
+ * one open wallet handle and the wallet is saved once when all of them are done.
+ */
+
+/*
+ * options shared by "--batch","--export-tar" and "--import-tar",the wallet name and password are asked for when they
+ * are not given and "use_tty" makes the questions go through the terminal instead of standard input and output.
+ */
+typedef struct
+{
+    const char *wallet_name;
+    const char *file;
+    int password_fd;
+    int use_tty;
+} wallet_options_t;
+
+static int _parseWalletOptions(int argc, char *argv[], wallet_options_t *opts)
+{
+    char *end;
+    int i;
+
+    opts->wallet_name = NULL;
+    opts->file        = NULL;
+    opts->password_fd = -1;
+    opts->use_tty     = 0;
+
+    for (i = 2; i < argc; i++)
+    {
+        if (StringsAreEqual(argv[ i ], "--password-fd") && i + 1 < argc)
+        {
+            opts->password_fd = (int)strtol(argv[ ++i ], &end, 10);
+
+            if (*end != '\0' || opts->password_fd < 0)
+            {
+                return 1;
+            }
+        }
+        else if (StringsAreEqual(argv[ i ], "--wallet") && i + 1 < argc)
+        {
+            opts->wallet_name = argv[ ++i ];
+        }
+        else if (opts->file == NULL && argv[ i ][ 0 ] != '-')
+        {
+            opts->file = argv[ i ];
+        }
+        else
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * ask a question through the terminal,"echo" is 0 when asking for a password
+ */
+static int _getInputFromTerminal(const char *question, char *buffer, size_t size, size_t *len, int echo)
+{
+    struct termios old;
+    struct termios new;
+    size_t e = 0;
+    int c;
+    FILE *f = fopen("/dev/tty", "r+");
+
+    if (f == NULL)
+    {
+        fprintf(stderr, "%s\n", lxqt_wallet_gettext("failed to open the terminal"));
+        return 1;
+    }
+
+    fputs(question, f);
+    fflush(f);
+
+    if (!echo)
+    {
+        if (tcgetattr(fileno(f), &old) != 0)
+        {
+            fclose(f);
+            fprintf(stderr, "%s\n", lxqt_wallet_gettext("failed to read password"));
+            return 1;
+        }
+
+        new = old;
+        new.c_lflag &= ~ECHO;
+        tcsetattr(fileno(f), TCSAFLUSH, &new);
+    }
+
+    while (e < size && (c = fgetc(f)) != EOF && c != '\n')
+    {
+        buffer[ e++ ] = c;
+    }
+
+    buffer[ e ] = '\0';
+
+    if (len != NULL)
+    {
+        *len = e;
+    }
+
+    if (!echo)
+    {
+        tcsetattr(fileno(f), TCSAFLUSH, &old);
+        fputs("\n", f);
+    }
+
+    fclose(f);
+
+    return 0;
+}
+
+/*
+ * read a password from a file descriptor,reading stops at the first new line character or at the end of the file
+ */
+static int _getPassWordFromFd(int fd, char *password, size_t size, size_t *len)
+{
+    char c;
+    size_t e = 0;
+    ssize_t r;
+
+    while (e < size)
+    {
+        r = read(fd, &c, 1);
+        if (r == 1)
+        {
+            if (c == '\n')
+            {
+                break;
+            }
+            else
+            {
+                password[ e++ ] = c;
+            }
+        }
+        else if (r == 0)
+        {
+            break;
+        }
+        else
+        {
+            puts(lxqt_wallet_gettext("failed to read password"));
+            return 1;
+        }
+    }
+
+    password[ e ] = '\0';
+    *len = e;
+
+    return 0;
+}
+
+static int _batchRunCommand(lxqt_wallet_t wallet, const char *command, const char *argument)
+{
+    cli_wallet_t w = _localWallet(wallet);
+
+    if (StringsAreEqual(command, "list"))
+    {
+        return _printListOfManagedFiles(&w);
+    }
+    else if (StringsAreEqual(command, "dedup"))
+    {
+        return _enableDedup(&w);
+    }
+    else if (StringsAreEqual(command, "get-all"))
+    {
+        return _getAllFilesFromWallet(wallet, *argument == '\0' ? NULL : argument);
+    }
+    else if (StringsAreNotEqual(command, "add") && StringsAreNotEqual(command, "add-all")
+             && StringsAreNotEqual(command, "add-tree") && StringsAreNotEqual(command, "delete")
+             && StringsAreNotEqual(command, "get") && StringsAreNotEqual(command, "sync"))
+    {
+        puts("unknown command");
+        return 1;
+    }
+    else if (*argument == '\0')
+    {
+        puts(lxqt_wallet_gettext("command is missing its argument"));
+        return 1;
+    }
+    else if (StringsAreEqual(command, "add"))
+    {
+        return _addFileToWallet(&w, argument);
+    }
+    else if (StringsAreEqual(command, "add-all"))
+    {
+        return _addAllFilesToTheWallet(&w, argument);
+    }
+    else if (StringsAreEqual(command, "add-tree"))
+    {
+        return _addTreeToWallet(wallet, argument);
+    }
+    else if (StringsAreEqual(command, "sync"))
+    {
+        return _syncFolder(wallet, argument);
+    }
+    else if (StringsAreEqual(command, "delete"))
+    {
+        return _deleteFileFromWallet(&w, argument);
+    }
+    else
+    {
+        return _getFileFromWallet(&w, argument);
+    }
+}
+
+/*
+ * Each line holds one command followed by its argument,"add <path>","add-all <path>","add-tree <path>","get <file name>",
+ * "delete <file name>","get-all [<folder path>]","sync <path>","dedup" or "list".Commands may be written with a leading "--".
+ * Empty lines and lines starting with '#' are skipped.
+ * The argument is the rest of the line and may contain spaces.
+ */
+static int _batchRunCommands(lxqt_wallet_t wallet, FILE *f)
+{
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    char *command;
+    char *argument;
+    int line_number = 0;
+    int failed = 0;
+
+    while ((len = getline(&line, &size, f)) != -1)
+    {
+        line_number++;
+
+        while (len > 0 && (line[ len - 1 ] == '\n' || line[ len - 1 ] == '\r'))
+        {
+            line[ --len ] = '\0';
+        }
+
+        command = line;
+
+        while (*command == ' ' || *command == '\t')
+        {
+            command++;
+        }
+
+        if (*command == '\0' || *command == '#')
+        {
+            continue;
+        }
+
+        if (command[ 0 ] == '-' && command[ 1 ] == '-')
+        {
+            command += 2;
+        }
+
+        argument = command + strcspn(command, " \t");
+
+        if (*argument != '\0')
+        {
+            *argument++ = '\0';
+
+            while (*argument == ' ' || *argument == '\t')
+            {
+                argument++;
+            }
+        }
+
+        if (_batchRunCommand(wallet, command, argument) != 0)
+        {
+            printf("%s %d\n", lxqt_wallet_gettext("failed to complete command on line"), line_number);
+            failed = 1;
+        }
+    }
+
+    free(line);
+
+    return failed;
+}
+
+static int _openWalletWithOptions(lxqt_wallet_t *wallet, const wallet_options_t *opts)
+{
+    size_t password_length = 0;
+    lxqt_wallet_error r;
+    int k;
+
+    char password[ PASSWORD_SIZE + 1 ];
+    char wallet_name[ WALLET_NAME_SIZE + 1 ];
+
+    if (opts->wallet_name != NULL)
+    {
+        snprintf(wallet_name, sizeof(wallet_name), "%s", opts->wallet_name);
+    }
+    else if (opts->use_tty)
+    {
+        if (_getInputFromTerminal(lxqt_wallet_gettext("enter wallet name: "), wallet_name, WALLET_NAME_SIZE, NULL, 1))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        _getWalletName(wallet_name);
+    }
+
+    if (opts->password_fd == -1 && opts->use_tty)
+    {
+        if (lxqt_wallet_exists(wallet_name, APPLICATION_NAME) != 0)
+        {
+            fprintf(stderr, "%s\n", lxqt_wallet_gettext("wallet does not exist"));
+            return 1;
+        }
+
+        if (_getInputFromTerminal(lxqt_wallet_gettext("enter wallet password: "), password, PASSWORD_SIZE,
+                                  &password_length, 0))
+        {
+            return 1;
+        }
+    }
+    else if (opts->password_fd == -1)
+    {
+        if (_getWalletPassword(wallet_name, password, &password_length))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        k = _getPassWordFromFd(opts->password_fd, password, PASSWORD_SIZE, &password_length);
+
+        close(opts->password_fd);
+
+        if (k)
+        {
+            return 1;
+        }
+
+        /*
+         * there is nobody to ask for a confirmation,a wallet that does not exist is created with the given password
+         */
+        if (lxqt_wallet_exists(wallet_name, APPLICATION_NAME) != 0)
+        {
+            r = lxqt_wallet_create(password, password_length, wallet_name, APPLICATION_NAME);
+            if (r != lxqt_wallet_no_error)
+            {
+                memset(password, '\0', sizeof(password));
+                puts(lxqt_wallet_gettext("failed to create wallet"));
+                return 1;
+            }
+        }
+    }
+
+    k = _open_wallet(wallet, password, password_length, wallet_name);
+
+    memset(password, '\0', sizeof(password));
+
+    return k;
+}
+
+static int _batchMain(int argc, char *argv[])
+{
+    lxqt_wallet_t wallet = 0;
+    wallet_options_t opts;
+    FILE *f;
+    int k;
+
+    if (_parseWalletOptions(argc, argv, &opts))
+    {
+        _help();
+        return 1;
+    }
+
+    if (opts.file == NULL)
+    {
+        f = stdin;
+    }
+    else
+    {
+        f = fopen(opts.file, "r");
+        if (f == NULL)
+        {
+            puts(lxqt_wallet_gettext("failed to open file for reading"));
+            return 1;
+        }
+    }
+
+    if (_openWalletWithOptions(&wallet, &opts))
+    {
+        k = 1;
+    }
+    else
+    {
+        k = _batchRunCommands(wallet, f);
+
+        if (_closeWallet(&wallet) != lxqt_wallet_no_error)
+        {
+            puts(lxqt_wallet_gettext("failed to save the wallet"));
+            k = 1;
+        }
+    }
+
+    if (f != stdin)
+    {
+        fclose(f);
+    }
+
+    return k;
+}
+
+/*
+ * Functions below implement "--export-tar" and "--import-tar" that stream files in the wallet to and from a tar
+ * archive in the POSIX ustar format.
+ *
+ * The archive is written to standard output or read from standard input unless a file is given,the wallet name and
+ * password are hence asked for through the terminal or the password is read from "--password-fd".An archive is
+ * written straight from the memory of the wallet and files read from an archive are added to the wallet in batches,
+ * files are never written to disk in plain text.
+ */
+#define TAR_BLOCK_SIZE 512
+#define TAR_NAME_SIZE  100
+#define TAR_PREFIX_SIZE 155
+#define TAR_LONG_NAME  "././@LongLink"
+
+typedef struct
+{
+    char name[ 100 ];
+    char mode[ 8 ];
+    char uid[ 8 ];
+    char gid[ 8 ];
+    char size[ 12 ];
+    char mtime[ 12 ];
+    char checksum[ 8 ];
+    char typeflag;
+    char linkname[ 100 ];
+    char magic[ 6 ];
+    char version[ 2 ];
+    char uname[ 32 ];
+    char gname[ 32 ];
+    char devmajor[ 8 ];
+    char devminor[ 8 ];
+    char prefix[ 155 ];
+    char padding[ 12 ];
+} tar_header_t;
+
+static const char _tarZeros[ TAR_BLOCK_SIZE ];
+
+static size_t _tarPadding(u_int64_t size)
+{
+    return (TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+}
+
+static void _tarChecksum(tar_header_t *h)
+{
+    const unsigned char *e = (const unsigned char *)h;
+    unsigned int sum = 0;
+    size_t i;
+
+    memset(h->checksum, ' ', sizeof(h->checksum));
+
+    for (i = 0; i < TAR_BLOCK_SIZE; i++)
+    {
+        sum += e[ i ];
+    }
+
+    snprintf(h->checksum, sizeof(h->checksum), "%06o", sum);
+    h->checksum[ 7 ] = ' ';
+}
+
+static void _tarHeader(tar_header_t *h, const char *name, size_t name_size, u_int64_t size, char type, time_t mtime)
+{
+    size_t i;
+
+    memset(h, '\0', sizeof(tar_header_t));
+
+    memcpy(h->name, name, name_size < TAR_NAME_SIZE ? name_size : TAR_NAME_SIZE);
+
+    snprintf(h->mode, sizeof(h->mode), "%07o", 0600);
+    snprintf(h->uid, sizeof(h->uid), "%07o", 0);
+    snprintf(h->gid, sizeof(h->gid), "%07o", 0);
+    /*
+     * sizes that do not fit in 11 octal digits are stored as big endian base-256 numbers
+     */
+    if (size > 077777777777ULL)
+    {
+        for (i = sizeof(h->size) - 1; i > 0; i--)
+        {
+            h->size[ i ] = (char)(size & 0xff);
+            size >>= 8;
+        }
+
+        h->size[ 0 ] = (char)0x80;
+    }
+    else
+    {
+        snprintf(h->size, sizeof(h->size), "%011llo", (unsigned long long)size);
+    }
+
+    snprintf(h->mtime, sizeof(h->mtime), "%011llo", (unsigned long long)mtime);
+
+    h->typeflag = type;
+
+    memcpy(h->magic, "ustar", 6);
+    memcpy(h->version, "00", 2);
+}
+
+/*
+ * write all buffers in "iov",partial writes to pipes are resumed where they stopped
+ */
+static int _writeAllv(int fd, struct iovec *iov, int count)
+{
+    ssize_t r;
+
+    while (count > 0)
+    {
+        r = writev(fd, iov, count);
+
+        if (r <= 0)
+        {
+            if (r == 0)
+            {
+                errno = EIO;
+            }
+            else if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return 1;
+        }
+
+        while (count > 0 && (size_t)r >= iov->iov_len)
+        {
+            r -= iov->iov_len;
+            iov++;
+            count--;
+        }
+
+        if (count > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + r;
+            iov->iov_len -= r;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * write a file to the archive,names that do not fit in the name field are split between the prefix and the name
+ * fields at a '/' character and names that can not be split are preceded by a GNU long name entry.
+ * Files stored out of line are decrypted straight to the archive.
+ */
+static int _tarWriteFile(int fd, const char *name, size_t name_size, const char *value, u_int32_t value_size,
+                         time_t mtime)
+{
+    tar_header_t header;
+    tar_header_t long_name;
+    struct iovec iov[ 6 ];
+    u_int64_t size = _valueSize(value, value_size);
+    size_t i;
+    int n = 0;
+
+    if (name_size <= TAR_NAME_SIZE)
+    {
+        _tarHeader(&header, name, name_size, size, '0', mtime);
+    }
+    else
+    {
+        for (i = name_size - TAR_NAME_SIZE - 1; i < name_size; i++)
+        {
+            if (name[ i ] == '/' && i > 0 && i <= TAR_PREFIX_SIZE && i + 1 < name_size)
+            {
+                break;
+            }
+        }
+
+        if (i < name_size)
+        {
+            _tarHeader(&header, name + i + 1, name_size - i - 1, size, '0', mtime);
+            memcpy(header.prefix, name, i);
+        }
+        else
+        {
+            _tarHeader(&long_name, TAR_LONG_NAME, strlen(TAR_LONG_NAME), name_size + 1, 'L', mtime);
+            _tarChecksum(&long_name);
+
+            iov[ n ].iov_base = &long_name;
+            iov[ n++ ].iov_len = TAR_BLOCK_SIZE;
+            iov[ n ].iov_base = (void *)name;
+            iov[ n++ ].iov_len = name_size;
+            iov[ n ].iov_base = (void *)_tarZeros;
+            iov[ n++ ].iov_len = 1 + _tarPadding(name_size + 1);
+
+            _tarHeader(&header, name, TAR_NAME_SIZE, size, '0', mtime);
+        }
+    }
+
+    _tarChecksum(&header);
+
+    iov[ n ].iov_base = &header;
+    iov[ n++ ].iov_len = TAR_BLOCK_SIZE;
+
+    if (_isExternal(value, value_size))
+    {
+        return _writeAllv(fd, iov, n) || _writeValue(fd, value, value_size) ||
+               _writeAll(fd, _tarZeros, _tarPadding(size));
+    }
+
+    iov[ n ].iov_base = (void *)value;
+    iov[ n++ ].iov_len = value_size;
+    iov[ n ].iov_base = (void *)_tarZeros;
+    iov[ n++ ].iov_len = _tarPadding(value_size);
+
+    return _writeAllv(fd, iov, n);
+}
+
+static int _exportTar(lxqt_wallet_t wallet, int fd)
+{
+    lxqt_wallet_key_values_t *keys;
+    lxqt_wallet_key_values_t *e;
+    lxqt_wallet_key_values_t key;
+    char blob_key[ BLOB_KEY_SIZE ];
+    size_t key_count = 0;
+    size_t i;
+    time_t mtime = time(NULL);
+    int k = 0;
+
+    keys = _sortedKeys(wallet, &key_count);
+
+    if (keys == NULL)
+    {
+        fprintf(stderr, "%s\n", lxqt_wallet_gettext("failed to allocate memory"));
+        return 1;
+    }
+
+    key.key      = blob_key;
+    key.key_size = BLOB_KEY_SIZE;
+
+    for (i = 0; i < key_count && k == 0; i++)
+    {
+        e = keys + i;
+
+        if (_isInternalKey(e->key, e->key_size))
+        {
+            continue;
+        }
+
+        if (_isReference(e->key_value, e->key_value_size))
+        {
+            _blobKey(blob_key, 'b', e->key_value + REFERENCE_MAGIC_SIZE);
+
+            e = bsearch(&key, keys, key_count, sizeof(lxqt_wallet_key_values_t), _compareKeys);
+
+            if (e == NULL)
+            {
+                fprintf(stderr, "%s: %.*s\n", lxqt_wallet_gettext("content of the file is missing from the wallet"),
+                        (int)strnlen(keys[ i ].key, keys[ i ].key_size), keys[ i ].key);
+                k = 1;
+                break;
+            }
+        }
+
+        if (_tarWriteFile(fd, keys[ i ].key, strnlen(keys[ i ].key, keys[ i ].key_size), e->key_value,
+                          e->key_value_size, mtime))
+        {
+            fprintf(stderr, "%s: %s\n", lxqt_wallet_gettext("failed to write the archive"), strerror(errno));
+            k = 1;
+        }
+    }
+
+    /*
+     * an archive ends with two blocks of zeros
+     */
+    if (k == 0 && (_writeAll(fd, _tarZeros, TAR_BLOCK_SIZE) || _writeAll(fd, _tarZeros, TAR_BLOCK_SIZE)))
+    {
+        fprintf(stderr, "%s: %s\n", lxqt_wallet_gettext("failed to write the archive"), strerror(errno));
+        k = 1;
+    }
+
+    free(keys);
+
+    return k;
+}
+
+/*
+ * read "size" bytes unless the end of the file is reached first,returns the number of bytes read or -1 on error
+ */
+static ssize_t _readAll(int fd, char *buffer, size_t size)
+{
+    size_t n = 0;
+    ssize_t r;
+
+    while (n < size)
+    {
+        r = read(fd, buffer + n, size - n);
+
+        if (r == 0)
+        {
+            break;
+        }
+        else if (r < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return -1;
+        }
+
+        n += r;
+    }
+
+    return n;
+}
+
+static int _tarSkip(int fd, u_int64_t size)
+{
+    char buffer[ 64 * TAR_BLOCK_SIZE ];
+    size_t n;
+
+    while (size > 0)
+    {
+        n = size < sizeof(buffer) ? size : sizeof(buffer);
+
+        if (_readAll(fd, buffer, n) != (ssize_t)n)
+        {
+            return 1;
+        }
+
+        size -= n;
+    }
+
+    return 0;
+}
+
+/*
+ * numeric fields are octal numbers or big endian base-256 numbers when their first byte has its high bit set
+ */
+static u_int64_t _tarNumber(const char *field, size_t size)
+{
+    const unsigned char *e = (const unsigned char *)field;
+    u_int64_t n = 0;
+    size_t i = 0;
+
+    if (size > 0 && (e[ 0 ] & 0x80))
+    {
+        n = e[ 0 ] & 0x7f;
+
+        for (i = 1; i < size; i++)
+        {
+            n = (n << 8) | e[ i ];
+        }
+
+        return n;
+    }
+
+    while (i < size && e[ i ] == ' ')
+    {
+        i++;
+    }
+
+    while (i < size && e[ i ] >= '0' && e[ i ] <= '7')
+    {
+        n = n * 8 + (e[ i++ ] - '0');
+    }
+
+    return n;
+}
+
+static int _tarChecksumIsValid(const tar_header_t *h)
+{
+    const unsigned char *e = (const unsigned char *)h;
+    unsigned int sum = 0;
+    size_t i;
+
+    for (i = 0; i < TAR_BLOCK_SIZE; i++)
+    {
+        if (i >= offsetof(tar_header_t, checksum) && i < offsetof(tar_header_t, typeflag))
+        {
+            sum += ' ';
+        }
+        else
+        {
+            sum += e[ i ];
+        }
+    }
+
+    return sum == _tarNumber(h->checksum, sizeof(h->checksum));
+}
+
+/*
+ * read the data of an entry and the padding that follows it,a nul character is appended to the data
+ */
+static char *_tarReadData(int fd, u_int64_t size)
+{
+    char *e;
+
+    if (size >= (u_int64_t)UINT_MAX)
+    {
+        return NULL;
+    }
+
+    e = malloc(size + 1);
+
+    if (e == NULL)
+    {
+        return NULL;
+    }
+
+    if (_readAll(fd, e, size) != (ssize_t)size || _tarSkip(fd, _tarPadding(size)))
+    {
+        free(e);
+        return NULL;
+    }
+
+    e[ size ] = '\0';
+
+    return e;
+}
+
+/*
+ * take "path" and "size" out of the records of a pax extended header,records look like "<length> <key>=<value>\n"
+ */
+static void _tarReadPaxHeader(const char *data, u_int64_t size, char **path, u_int64_t *file_size, int *has_size)
+{
+    const char *e = data;
+    const char *end = data + size;
+    const char *key;
+    const char *value;
+    const char *record_end;
+    char *p;
+    unsigned long len;
+
+    while (e < end)
+    {
+        len = strtoul(e, &p, 10);
+
+        if (p == e || *p != ' ' || len == 0 || len > (unsigned long)(end - e))
+        {
+            break;
+        }
+
+        key        = p + 1;
+        record_end = e + len - 1;
+        value      = memchr(key, '=', record_end - key);
+
+        if (value != NULL && *record_end == '\n')
+        {
+            if (value - key == 4 && memcmp(key, "path", 4) == 0)
+            {
+                free(*path);
+                *path = strndup(value + 1, record_end - value - 1);
+            }
+            else if (value - key == 4 && memcmp(key, "size", 4) == 0)
+            {
+                *file_size = strtoull(value + 1, NULL, 10);
+                *has_size  = 1;
+            }
+        }
+
+        e += len;
+    }
+}
+
+/*
+ * get the path of an entry from its header,"long_name" is the path given by a preceding GNU long name or pax entry
+ */
+static char *_tarPath(const tar_header_t *h, const char *long_name)
+{
+    char path[ TAR_PREFIX_SIZE + 1 + TAR_NAME_SIZE + 1 ];
+    const char *e;
+    size_t len;
+
+    if (long_name != NULL)
+    {
+        e = long_name;
+    }
+    else
+    {
+        len = strnlen(h->prefix, TAR_PREFIX_SIZE);
+
+        if (len > 0 && memcmp(h->magic, "ustar", 5) == 0)
+        {
+            snprintf(path, sizeof(path), "%.*s/%.*s", (int)len, h->prefix,
+                     (int)strnlen(h->name, TAR_NAME_SIZE), h->name);
+        }
+        else
+        {
+            snprintf(path, sizeof(path), "%.*s", (int)strnlen(h->name, TAR_NAME_SIZE), h->name);
+        }
+
+        e = path;
+    }
+
+    for (;;)
+    {
+        if (*e == '/')
+        {
+            e++;
+        }
+        else if (e[ 0 ] == '.' && e[ 1 ] == '/')
+        {
+            e += 2;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return strdup(e);
+}
+
+static int _compareTreeFiles(const void *x, const void *y)
+{
+    const tree_file_t *a = *(const tree_file_t * const *)x;
+    const tree_file_t *b = *(const tree_file_t * const *)y;
+    int r = strcmp(a->path, b->path);
+
+    if (r != 0)
+    {
+        return r;
+    }
+    else
+    {
+        return a < b ? -1 : 1;
+    }
+}
+
+/*
+ * an archive may hold a file more than once,the last one wins like it does when the archive is extracted
+ */
+static int _skipReplacedFiles(tree_t *t)
+{
+    tree_file_t **e;
+    size_t i;
+
+    if (t->count < 2)
+    {
+        return 0;
+    }
+
+    e = malloc(t->count * sizeof(tree_file_t *));
+
+    if (e == NULL)
+    {
+        return 1;
+    }
+
+    for (i = 0; i < t->count; i++)
+    {
+        e[ i ] = t->files + i;
+    }
+
+    qsort(e, t->count, sizeof(tree_file_t *), _compareTreeFiles);
+
+    for (i = 0; i + 1 < t->count; i++)
+    {
+        if (StringsAreEqual(e[ i ]->path, e[ i + 1 ]->path))
+        {
+            e[ i ]->skip = 1;
+        }
+    }
+
+    free(e);
+
+    return 0;
+}
+
+/*
+ * Archives are imported in batches,a batch is added to the wallet once it has TAR_BATCH_COUNT files or holds
+ * TAR_BATCH_SIZE bytes of content.Files larger than LARGE_FILE_SIZE are encrypted to the blobs folder straight from
+ * the archive as they are read and only their references are held,memory use hence does not grow with the archive.
+ *
+ * Paths of files added by earlier batches are remembered so that a file the archive holds more than once still ends
+ * up with its last copy.A failure stops the import,files of batches added before it stay in the wallet like files
+ * extracted before a damaged part of an archive do and an archive that fits in one batch is added in one go.
+ */
+#define TAR_BATCH_COUNT ( 64 * 1024 )
+#define TAR_BATCH_SIZE  ( 64 * 1024 * 1024 )
+
+typedef struct
+{
+    char **paths;
+    size_t capacity;
+    size_t count;
+} path_set_t;
+
+static size_t _pathSetSlot(char **paths, size_t capacity, const char *path)
+{
+    const unsigned char *e = (const unsigned char *)path;
+    size_t i = 2166136261u;
+
+    while (*e != '\0')
+    {
+        i = (i ^ *e++) * 16777619u;
+    }
+
+    i &= capacity - 1;
+
+    while (paths[ i ] != NULL && !StringsAreEqual(paths[ i ], path))
+    {
+        i = (i + 1) & (capacity - 1);
+    }
+
+    return i;
+}
+
+static int _pathSetHas(const path_set_t *s, const char *path)
+{
+    return s->count > 0 && s->paths[ _pathSetSlot(s->paths, s->capacity, path) ] != NULL;
+}
+
+static int _pathSetAdd(path_set_t *s, const char *path)
+{
+    size_t capacity;
+    size_t i;
+    char **e;
+
+    if (2 * (s->count + 1) > s->capacity)
+    {
+        capacity = s->capacity > 0 ? 2 * s->capacity : 1024;
+        e        = calloc(capacity, sizeof(char *));
+
+        if (e == NULL)
+        {
+            return 1;
+        }
+
+        for (i = 0; i < s->capacity; i++)
+        {
+            if (s->paths[ i ] != NULL)
+            {
+                e[ _pathSetSlot(e, capacity, s->paths[ i ]) ] = s->paths[ i ];
+            }
+        }
+
+        free(s->paths);
+
+        s->paths    = e;
+        s->capacity = capacity;
+    }
+
+    i = _pathSetSlot(s->paths, s->capacity, path);
+
+    if (s->paths[ i ] == NULL)
+    {
+        s->paths[ i ] = strdup(path);
+
+        if (s->paths[ i ] == NULL)
+        {
+            return 1;
+        }
+
+        s->count++;
+    }
+
+    return 0;
+}
+
+static void _pathSetFree(path_set_t *s)
+{
+    size_t i;
+
+    for (i = 0; i < s->capacity; i++)
+    {
+        free(s->paths[ i ]);
+    }
+
+    free(s->paths);
+}
+
+typedef struct
+{
+    int fd;
+    char *reference;
+    int k;
+} tar_stream_t;
+
+static void *_tarStreamThread(void *arg)
+{
+    tar_stream_t *e = arg;
+
+    e->k = _storeExternalFileFromFd(e->fd, e->reference);
+
+    close(e->fd);
+
+    return NULL;
+}
+
+/*
+ * encrypt the next "size" bytes of the archive to a new file in the blobs folder and make a reference to it.
+ * lxqt_wallet_encrypt_stream() reads until the end of its input,the bytes are handed to it through a socket that
+ * is shut down after the last one.
+ */
+static int _tarStoreExternalFile(int fd, u_int64_t size, char reference[ EXTERNAL_SIZE ])
+{
+    char buffer[ 64 * TAR_BLOCK_SIZE ];
+    tar_stream_t stream;
+    pthread_t thread;
+    ssize_t r;
+    size_t n;
+    size_t i;
+    int sockets[ 2 ];
+    int k = 0;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0)
+    {
+        return 1;
+    }
+
+    stream.fd        = sockets[ 1 ];
+    stream.reference = reference;
+    stream.k         = 1;
+
+    if (pthread_create(&thread, NULL, _tarStreamThread, &stream) != 0)
+    {
+        close(sockets[ 0 ]);
+        close(sockets[ 1 ]);
+        return 1;
+    }
+
+    while (k == 0 && size > 0)
+    {
+        n = size < sizeof(buffer) ? size : sizeof(buffer);
+
+        if (_readAll(fd, buffer, n) != (ssize_t)n)
+        {
+            k = 1;
+        }
+
+        for (i = 0; k == 0 && i < n; i += r)
+        {
+            r = send(sockets[ 0 ], buffer + i, n - i, MSG_NOSIGNAL);
+
+            if (r < 0 && errno == EINTR)
+            {
+                r = 0;
+            }
+            else if (r <= 0)
+            {
+                k = 1;
+            }
+        }
+
+        size -= n;
+    }
+
+    memset(buffer, '\0', sizeof(buffer));
+
+    close(sockets[ 0 ]);
+
+    pthread_join(thread, NULL);
+
+    if (k != 0 && stream.k == 0)
+    {
+        /*
+         * the archive was cut short,the file has only a part of the content
+         */
+        _discardExternalFile(reference);
+    }
+
+    return k != 0 || stream.k != 0;
+}
+
+/*
+ * add files of a batch to the wallet,earlier copies of files added by earlier batches are deleted first.
+ * Encrypted files of files that were not added are removed.
+ */
+static int _tarInsertBatch(lxqt_wallet_t wallet, tree_t *t, path_set_t *added)
+{
+    cli_wallet_t w = _localWallet(wallet);
+    size_t i;
+    int dedup = t->dedup;
+    int k = _skipReplacedFiles(t);
+
+    if (k != 0)
+    {
+        puts(lxqt_wallet_gettext("failed to allocate memory"));
+    }
+
+    for (i = 0; k == 0 && i < t->count; i++)
+    {
+        if (!t->files[ i ].skip && _pathSetHas(added, t->files[ i ].path))
+        {
+            _deleteKey(&w, t->files[ i ].path, strlen(t->files[ i ].path) + 1);
+        }
+    }
+
+    if (k == 0)
+    {
+        k = _treeInsert(wallet, t);
+    }
+
+    for (i = 0; i < t->count; i++)
+    {
+        if (t->files[ i ].entry == NOT_ADDED)
+        {
+            if (t->files[ i ].external)
+            {
+                _discardExternalFile(t->files[ i ].data);
+            }
+        }
+        else if (k == 0 && _pathSetAdd(added, t->files[ i ].path))
+        {
+            puts(lxqt_wallet_gettext("failed to allocate memory"));
+            k = 1;
+        }
+    }
+
+    _treeClose(t);
+
+    memset(t, '\0', sizeof(tree_t));
+
+    t->dirfd = -1;
+    t->dedup = dedup;
+
+    return k;
+}
+
+static int _importTar(lxqt_wallet_t wallet, int fd)
+{
+    cli_wallet_t w = _localWallet(wallet);
+    tar_header_t header;
+    path_set_t added;
+    tree_t t;
+    tree_file_t *e;
+    char *long_name = NULL;
+    char *data;
+    char *path;
+    u_int64_t size;
+    u_int64_t pax_size = 0;
+    u_int64_t batch_size = 0;
+    int has_size = 0;
+    ssize_t r;
+    size_t i;
+    int k = 0;
+
+    memset(&t, '\0', sizeof(tree_t));
+    memset(&added, '\0', sizeof(path_set_t));
+
+    t.dirfd = -1;
+    t.dedup = _dedupEnabled(&w);
+
+    for (;;)
+    {
+        r = _readAll(fd, (char *)&header, TAR_BLOCK_SIZE);
+
+        if (r == 0 || (r == TAR_BLOCK_SIZE && memcmp(&header, _tarZeros, TAR_BLOCK_SIZE) == 0))
+        {
+            break;
+        }
+        else if (r != TAR_BLOCK_SIZE || !_tarChecksumIsValid(&header))
+        {
+            puts(lxqt_wallet_gettext("failed to read the archive"));
+            k = 1;
+            break;
+        }
+
+        size = has_size ? pax_size : _tarNumber(header.size, sizeof(header.size));
+
+        if (header.typeflag == 'L' || header.typeflag == 'x')
+        {
+            data = _tarReadData(fd, size);
+
+            if (data == NULL)
+            {
+                puts(lxqt_wallet_gettext("failed to read the archive"));
+                k = 1;
+                break;
+            }
+
+            if (header.typeflag == 'L')
+            {
+                free(long_name);
+                long_name = data;
+            }
+            else
+            {
+                _tarReadPaxHeader(data, size, &long_name, &pax_size, &has_size);
+                free(data);
+            }
+
+            continue;
+        }
+
+        path = NULL;
+
+        if (header.typeflag == '0' || header.typeflag == '\0' || header.typeflag == '7')
+        {
+            path = _tarPath(&header, long_name);
+
+            if (path == NULL)
+            {
+                puts(lxqt_wallet_gettext("failed to allocate memory"));
+                k = 1;
+                break;
+            }
+        }
+
+        if (path == NULL || *path == '\0' || path[ strlen(path) - 1 ] == '/')
+        {
+            /*
+             * folders,links and other entries that are not regular files have nothing to add to the wallet
+             */
+            free(path);
+
+            if (_tarSkip(fd, size + _tarPadding(size)))
+            {
+                puts(lxqt_wallet_gettext("failed to read the archive"));
+                k = 1;
+                break;
+            }
+        }
+        else if (size > LARGE_FILE_SIZE)
+        {
+            data = malloc(EXTERNAL_SIZE);
+
+            if (data == NULL || _treeAddPath(&t, path))
+            {
+                free(data);
+                free(path);
+                puts(lxqt_wallet_gettext("failed to allocate memory"));
+                k = 1;
+                break;
+            }
+
+            free(path);
+
+            e = t.files + t.count - 1;
+
+            e->data     = data;
+            e->size     = EXTERNAL_SIZE;
+            e->external = 1;
+
+            /*
+             * an encrypted file that was written is removed with the rest of the batch below
+             */
+            if (_tarStoreExternalFile(fd, size, data) != 0)
+            {
+                e->external = 0;
+                k = 1;
+            }
+            else if (_tarSkip(fd, _tarPadding(size)))
+            {
+                k = 1;
+            }
+
+            if (k != 0)
+            {
+                puts(lxqt_wallet_gettext("failed to read the archive"));
+                break;
+            }
+        }
+        else
+        {
+            data = _tarReadData(fd, size);
+
+            if (data == NULL || _treeAddPath(&t, path))
+            {
+                free(path);
+                free(data);
+                puts(lxqt_wallet_gettext("failed to read the archive"));
+                k = 1;
+                break;
+            }
+
+            e = t.files + t.count - 1;
+
+            e->data   = data;
+            e->size   = size;
+            e->hashed = t.dedup && size > REFERENCE_SIZE && !_storedOutOfLine(data, size);
+
+            if (e->hashed)
+            {
+                _hash(e->hash, data, size);
+            }
+
+            free(path);
+
+            batch_size += size;
+        }
+
+        free(long_name);
+
+        long_name = NULL;
+        has_size  = 0;
+
+        if (t.count >= TAR_BATCH_COUNT || batch_size >= TAR_BATCH_SIZE)
+        {
+            k = _tarInsertBatch(wallet, &t, &added);
+
+            batch_size = 0;
+
+            if (k != 0)
+            {
+                break;
+            }
+        }
+    }
+
+    free(long_name);
+
+    if (k == 0)
+    {
+        k = _tarInsertBatch(wallet, &t, &added);
+    }
+    else
+    {
+        for (i = 0; i < t.count; i++)
+        {
+            if (t.files[ i ].external)
+            {
+                _discardExternalFile(t.files[ i ].data);
+            }
+        }
+
+        _treeClose(&t);
+    }
+
+    _pathSetFree(&added);
+
+    return k;
+}
+
+static int _tarMain(int argc, char *argv[], int export)
+{
+    lxqt_wallet_t wallet = 0;
+    wallet_options_t opts;
+    int fd;
+    int k;
+
+    if (_parseWalletOptions(argc, argv, &opts))
+    {
+        _help();
+        return 1;
+    }
+
+    opts.use_tty = 1;
+
+    if (opts.file == NULL)
+    {
+        fd = export ? 1 : 0;
+    }
+    else if (export)
+    {
+        fd = open(opts.file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    }
+    else
+    {
+        fd = open(opts.file, O_RDONLY | O_CLOEXEC);
+    }
+
+    if (fd == -1)
+    {
+        fprintf(stderr, "%s\n", lxqt_wallet_gettext(export ? "failed to open file for writing" :
+                                                             "failed to open file for reading"));
+        return 1;
+    }
+
+    if (isatty(fd))
+    {
+        fprintf(stderr, "%s\n", lxqt_wallet_gettext("refusing to use the terminal for the archive"));
+        k = 1;
+    }
+    else if (_openWalletWithOptions(&wallet, &opts))
+    {
+        k = 1;
+    }
+    else
+    {
+        k = export ? _exportTar(wallet, fd) : _importTar(wallet, fd);
+
+        if (_closeWallet(&wallet) != lxqt_wallet_no_error)
+        {
+            fprintf(stderr, "%s\n", lxqt_wallet_gettext("failed to save the wallet"));
+            k = 1;
+        }
+    }
+
+    if (opts.file != NULL)
+    {
+        if (close(fd) != 0 && export)
+        {
+            fprintf(stderr, "%s\n", lxqt_wallet_gettext("failed to write the archive"));
+            k = 1;
+        }
+    }
+
+    return k;
+}
+
+static int _printWalletList(void)
+{
+    int len = 0;
+    int k;
+    char *c;
+    char **e = lxqt_wallet_wallet_list(APPLICATION_NAME, &len);
+
+    for (k = 0; k < len; k++)
+    {
+        c = *(e + k);
+        puts(c);
+        free(c);
+    }
+
+    free(e);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    lxqt_wallet_t wallet = 0;
+    cli_wallet_t w;
+
+    const char *path;
+    const char *action;
+    int r = 1;
+
+    if (argc == 1)
+    {
+        _help();
+        return 0;
+    }
+
+    action = argv[ 1 ];
+
+    if (StringsAreEqual(action, "--agent"))
+    {
+        return _agentMain(argc, argv);
+    }
+
+    if (StringsAreEqual(action, "--batch"))
+    {
+        return _batchMain(argc, argv);
+    }
+
+    if (StringsAreEqual(action, "--export-tar") || StringsAreEqual(action, "--import-tar"))
+    {
+        return _tarMain(argc, argv, StringsAreEqual(action, "--export-tar"));
+    }
+
+    if (argc == 2)
+    {
+        if (StringsAreEqual(action, "-h") || StringsAreEqual(action, "--help") || StringsAreEqual(action, "-help")
+                || StringsAreEqual(action, "-v") || StringsAreEqual(action, "--version"))
         {
-            r = _printListOfManagedFiles(wallet);
+            _help();
+            return 0;
+        }
+        else if (StringsAreEqual(action, "--wallets"))
+        {
+            return _printWalletList();
+        }
+        else if (StringsAreEqual(action, "--list") || StringsAreEqual(action, "--get-all")
+                 || StringsAreEqual(action, "--dedup"))
+        {
+            ;
+        }
+        else
+        {
+            _help();
+            return 1;
+        }
+    }
+
+    if (_openWallet(&wallet))
+    {
+        return 1;
+    }
+    else
+    {
+        w = _localWallet(wallet);
+
+        if (StringsAreEqual(action, "--list"))
+        {
+            r = _printListOfManagedFiles(&w);
+        }
+        else if (StringsAreEqual(action, "--dedup"))
+        {
+            r = _enableDedup(&w);
         }
         else if (StringsAreEqual(action, "--get-all"))
         {
-            r = _getAllFilesFromWallet(wallet);
+            r = _getAllFilesFromWallet(wallet, argc == 3 ? argv[ 2 ] : NULL);
         }
         else
         {
@@ -534,19 +4724,27 @@ int main(int argc, char *argv[])
                 path = argv[ 2 ];
                 if (StringsAreEqual(action, "--add"))
                 {
-                    r = _addFileToWallet(wallet, path);
+                    r = _addFileToWallet(&w, path);
                 }
                 else if (StringsAreEqual(action, "--delete"))
                 {
-                    r = _deleteFileFromWallet(wallet, path);
+                    r = _deleteFileFromWallet(&w, path);
                 }
                 else if (StringsAreEqual(action, "--get"))
                 {
-                    r = _getFileFromWallet(wallet, path);
+                    r = _getFileFromWallet(&w, path);
                 }
                 else if (StringsAreEqual(action, "--add-all"))
                 {
-                    r = _addAllFilesToTheWallet(wallet, path);
+                    r = _addAllFilesToTheWallet(&w, path);
+                }
+                else if (StringsAreEqual(action, "--add-tree"))
+                {
+                    r = _addTreeToWallet(wallet, path);
+                }
+                else if (StringsAreEqual(action, "--sync"))
+                {
+                    r = _syncFolder(wallet, path);
                 }
                 else
                 {
@@ -556,7 +4754,7 @@ int main(int argc, char *argv[])
             }
         }
 
-        lxqt_wallet_close(&wallet);
+        _closeWallet(&wallet);
         return r;
     }
 }
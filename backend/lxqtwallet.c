@@ -28,7 +28,12 @@
  * SUCH DAMAGE.
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "lxqtwallet.h"
+#include "lxqtwallet_internal.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -38,17 +43,50 @@
 #include <stdio.h>
 #include <limits.h>
 #include <sys/mman.h>
+#include <sys/file.h>
 #include <dirent.h>
 #include <sys/stat.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <zlib.h>
+
+#if defined( __linux__ ) && defined( __has_include )
+#if __has_include( <linux/io_uring.h> )
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <stdint.h>
+/*
+ * linux/fs.h comes with linux/io_uring.h and it defines its own BLOCK_SIZE
+ */
+#undef BLOCK_SIZE
+#endif
+#endif
+
+/*
+ * files are streamed through io_uring when it is available at build time and at run time,see _file_pipeline_uring()
+ */
+#if defined( IORING_OFF_SQ_RING ) && defined( IORING_FEAT_SINGLE_MMAP ) && defined( __NR_io_uring_setup )
+#define HAS_IO_URING 1
+#else
+#define HAS_IO_URING 0
+#endif
 
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
 #include <gcrypt.h>
 #pragma GCC diagnostic warning "-Wdeprecated-declarations"
 
 #define VERSION 200
+/*
+ * version of wallets and encrypted files that use flags in the last byte of the magic string header,
+ * older versions of the library refuse to open them
+ */
+#define FLAGS_VERSION 300
 #define VERSION_SIZE sizeof( short )
 /*
  * below string MUST BE 11 bytes long
@@ -56,30 +94,213 @@
 #define MAGIC_STRING "lxqt_wallet"
 #define MAGIC_STRING_SIZE 11
 #define MAGIC_STRING_BUFFER_SIZE 16
+#define GENERATION_OFFSET ( MAGIC_STRING_SIZE + VERSION_SIZE )
+#define FLAGS_OFFSET ( GENERATION_OFFSET + sizeof( u_int16_t ) )
+#define LOAD_FLAG_COMPRESSED 1
 #define PASSWORD_SIZE 32
 #define BLOCK_SIZE 16
 #define IV_SIZE 16
 #define SALT_SIZE 16
 #define FILE_BLOCK_SIZE 1024
 
+/*
+ * size of buffers compressed encrypted files are compressed and decompressed through
+ */
+#define COMPRESSION_BUFFER_SIZE ( 256 * 1024 )
+
+/*
+ * number and default size of buffers files are streamed through by lxqt_wallet_create_encrypted_file()
+ * and lxqt_wallet_create_decrypted_file(),see _file_pipeline()
+ */
+#define FILE_PIPELINE_BUFFER_COUNT 4
+#define FILE_PIPELINE_MIN_BUFFER_SIZE ( 1024 * 1024 )
+#define FILE_PIPELINE_MAX_BUFFER_SIZE ( 8 * 1024 * 1024 )
+
+/*
+ * "read_size" of a pipeline that reads until the end of its source
+ */
+#define FILE_SIZE_UNKNOWN ( ( u_int64_t ) -1 )
+
+/*
+ * seekable encrypted file format,see "Seekable encrypted file documentation" below
+ */
+#define CHUNKED_MAGIC_STRING "lxqt_wallet_cfs"
+#define CHUNKED_VERSION 1
+#define CHUNKED_HEADER_SIZE 64
+#define CHUNKED_TAG_SIZE 16
+#define CHUNKED_NONCE_SIZE 12
+#define CHUNKED_NONCE_PREFIX_SIZE 4
+#define CHUNKED_CHECK_BLOCK_SIZE ( MAGIC_STRING_BUFFER_SIZE + CHUNKED_TAG_SIZE )
+#define CHUNKED_DATA_OFFSET ( CHUNKED_HEADER_SIZE + CHUNKED_CHECK_BLOCK_SIZE )
+#define CHUNKED_CHUNK_SIZE ( 64 * 1024 )
+#define CHUNKED_MAX_CHUNK_SIZE ( 16 * 1024 * 1024 )
+#define CHUNKED_UNKNOWN_SIZE ( ( u_int64_t ) -1 )
+#define CHUNKED_HEADER_INDEX ( ( u_int64_t ) -1 )
+
+/*
+ * lxqt_wallet_decrypt_range() reads and decrypts a range through a locked buffer of about this many bytes
+ */
+#define RANGE_BATCH_SIZE ( 8 * 1024 * 1024 )
+
 #define PBKDF2_ITERATIONS 10000
 
+#define KEY_CACHE_SIZE 32
+
 #define NODE_HEADER_SIZE ( 2 * sizeof( u_int32_t ) )
 
 #define WALLET_EXTENSION ".lwt"
 
+/*
+ * file in an application wallet directory that lists its wallets,see _update_manifest()
+ */
+#define MANIFEST_FILE_NAME "wallets.manifest"
+#define MANIFEST_MAGIC_STRING "lxqt_wallet_mft"
+#define MANIFEST_ENTRY_HEADER_SIZE ( 2 * sizeof( u_int32_t ) + 2 * sizeof( u_int64_t ) )
+
+/*
+ * environment variable that overrides the directory wallets are stored in
+ */
+#define STORAGE_ROOT_ENV "LXQT_WALLET_STORAGE_ROOT"
+
+#ifdef O_PATH
+#define DIRECTORY_HANDLE_FLAGS ( O_PATH | O_DIRECTORY | O_CLOEXEC )
+#else
+#define DIRECTORY_HANDLE_FLAGS ( O_RDONLY | O_DIRECTORY | O_CLOEXEC )
+#endif
+
+/*
+ * first 16 bytes of a memory file created by lxqt_wallet_share()
+ */
+#define SHARED_MAGIC_STRING "lxqt_wallet_sh2"
+#define SHARED_HEADER_SIZE ( MAGIC_STRING_BUFFER_SIZE + 4 * sizeof( u_int64_t ) )
+
+/*
+ * an entry of an open wallet,"key" is the offset of its key in the key arena,"value" is the offset of its value in
+ * the value arena and "hash" is _key_hash() of its key
+ */
+struct _entry_header
+{
+    u_int64_t key;
+    u_int64_t value;
+    u_int64_t hash;
+    u_int32_t key_size;
+    u_int32_t value_size;
+};
+
 struct lxqt_wallet_struct
 {
     char *application_name;
     char *wallet_name;
     char key[ PASSWORD_SIZE ];
     char salt[ SALT_SIZE ];
-    char *wallet_data;
+    /*
+     * entries are kept apart from the load of the wallet file,"entries" holds a header for every entry in the order
+     * of the nodes of the load,"key_data" holds their keys one after the other and "value_data" holds their values.
+     * Both arenas are locked memory."key_slots" is an open addressing hash table of keys that is at most half full,
+     * a slot holds the position of a header plus one and 0 marks a free slot.
+     * The load is split up when the wallet is read and is put back together when it is saved,"wallet_data_size"
+     * is the size of the load and "wallet_data_entry_count" is the number of entries.
+     */
+    struct _entry_header *entries;
+    u_int64_t entries_capacity;
+    char *key_data;
+    u_int64_t key_data_size;
+    u_int64_t key_data_capacity;
+    char *value_data;
+    u_int64_t value_data_size;
+    u_int64_t value_data_capacity;
+    u_int64_t *key_slots;
+    u_int64_t key_slots_capacity;
     u_int64_t wallet_data_size;
     u_int64_t wallet_data_entry_count;
     int wallet_modified;
+    /*
+     * state of the wallet file as it was when this handle last read or wrote it,
+     * used to detect saves made by other handles or processes.
+     */
+    char file_key[ PASSWORD_SIZE ];
+    char file_iv[ IV_SIZE ];
+    dev_t file_dev;
+    ino_t file_ino;
+    off_t file_size;
+    time_t file_mtime;
+    u_int16_t file_generation;
+    u_int16_t file_version;
+    /*
+     * set by lxqt_wallet_set_compression() or when the wallet file has a compressed load
+     */
+    int compressed;
+    /*
+     * keys added or deleted through this handle since it was last saved,stored in locked memory as a list of
+     * [ u_int32_t key size ][ key ] nodes."changed_key_slots" is an open addressing hash table of the list that
+     * is at most half full,a slot holds the offset of a node plus one and 0 marks a free slot.
+     */
+    char *changed_keys;
+    u_int64_t changed_keys_size;
+    u_int64_t changed_keys_capacity;
+    u_int64_t changed_keys_count;
+    u_int64_t *changed_key_slots;
+    u_int64_t changed_key_slots_capacity;
+    /*
+     * set by lxqt_wallet_set_thread_safe(),readers share "lock" and writers hold it exclusively.
+     */
+    int thread_safe;
+    pthread_rwlock_t lock;
+    /*
+     * number of lxqt_wallet_open() calls sharing this handle through the handle cache,
+     * 0 if the handle is not in the cache."cache_path" is the full path of the wallet file the handle was
+     * opened from,cached handles are looked up by it so that a changed storage root does not match them.
+     */
+    int cache_references;
+    char *cache_path;
+    struct lxqt_wallet_struct *cache_next;
+    /*
+     * set by lxqt_wallet_attach(),the entry headers,the hash table and the arenas are in a read only shared mapping
+     * of "mapping_size" bytes.
+     */
+    int read_only;
+    char *mapping;
+    u_int64_t mapping_size;
+};
+
+/*
+ * process wide cache of opened wallets,enabled with lxqt_wallet_set_handle_cache()
+ */
+static struct
+{
+    pthread_mutex_t mutex;
+    int enabled;
+    struct lxqt_wallet_struct *wallets;
+} _handle_cache = { PTHREAD_MUTEX_INITIALIZER, 0, NULL };
+
+/*
+ * directory wallets are stored in and descriptors of application wallet directories in it,
+ * see _application_directory()
+ */
+struct _application_directory
+{
+    char *application_name;
+    int fd;
+    /*
+     * number of _application_directory() calls on the descriptor not yet matched by _release_application_directory()
+     */
+    int users;
+    /*
+     * set when the directory was replaced or the storage root changed,the descriptor is closed once it has no users
+     */
+    int stale;
+    struct _application_directory *next;
 };
 
+static struct
+{
+    pthread_mutex_t mutex;
+    int resolved;
+    char root[ PATH_MAX ];
+    char root_override[ PATH_MAX ];
+    struct _application_directory *directories;
+} _storage = { PTHREAD_MUTEX_INITIALIZER, 0, "", "", NULL };
+
 /*
  * Encrypted file documentation.
  *
@@ -96,7 +317,10 @@ struct lxqt_wallet_struct
  *
  * The third 16 bytes are "magic string" bytes.
  * The first 11 bytes are used to store a known data aka "magic string" to be used to check if decryption key is correct or not.
- * The remaining 5 bytes are used to store file version number.
+ * The next 2 bytes are used to store file version number.
+ * The next 2 bytes are a u_int16_t data type and are used to store a generation counter that is incremented on every save.
+ * The last byte is used to store flags.Bit 0 is set if the load is compressed,files that have flags set have
+ * version number FLAGS_VERSION.
  *
  * The fourth 16 bytes are used to store information about the contents of the load.
  * The first 8 bytes are a u_int64_t data type and are used to store the load size
@@ -104,6 +328,9 @@ struct lxqt_wallet_struct
  *
  * The load starts at 64th byte.
  *
+ * A compressed load is a zlib stream that inflates to "load size" bytes,the encrypted data that follows the end
+ * of the stream is padding.
+ *
  * The file is encrypted using CBC mode of 256 bit AES and hence may be padded to a file size larger than file contents to
  * accomodate CBC mode demanding data sizes that are divisible by 16.
  *
@@ -132,8 +359,29 @@ static char *_wallet_full_path(char *path_buffer, u_int32_t path_buffer_size, co
 
 static void _create_application_wallet_path(const char *application_name);
 
+static int _application_directory(const char *application_name, int create);
+
+static void _release_application_directory(int fd);
+
+static const char *_wallet_file_name(char *buffer, u_int32_t buffer_size, const char *wallet_name);
+
+static int _lock_application_directory(const char *application_name);
+
+static void _unlock_application_directory(int fd);
+
+static void _update_manifest(const char *wallet_name, const char *application_name, const struct stat *st,
+                             u_int64_t entry_count, int version);
+
 static gcry_error_t _create_key(const char salt[ SALT_SIZE ], char output_key[ PASSWORD_SIZE ], const char *input_key, u_int32_t input_key_length);
 
+static gcry_error_t _create_key_cached(const char *path, const char salt[ SALT_SIZE ], char output_key[ PASSWORD_SIZE ],
+                                       const char *input_key, u_int32_t input_key_length);
+
+static void _cache_key(const char *path, const char salt[ SALT_SIZE ], const char key[ PASSWORD_SIZE ],
+                       const char *input_key, u_int32_t input_key_length);
+
+static void _purge_cached_keys(const char *path);
+
 static gcry_error_t _create_temp_key(char *output_key, u_int32_t output_key_size, const char *input_key, u_int32_t input_key_length);
 
 static void _get_iv_from_wallet_header(char iv[ IV_SIZE ], int fd);
@@ -148,6 +396,10 @@ static void _create_magic_string_header(char magic_string[ MAGIC_STRING_BUFFER_S
 
 static int _wallet_is_compatible(const char *);
 
+static void _set_load_flags(char magic_string[ MAGIC_STRING_BUFFER_SIZE ], int flags);
+
+static int _load_flags(const char *buffer);
+
 static int _password_match(const char *buffer);
 
 static int _volume_version(const char *buffer);
@@ -158,6 +410,9 @@ static lxqt_wallet_error _lxqt_wallet_open(const char *password, u_int32_t passw
         const char *wallet_name, const char *application_name, char *buffer,
         int *ffd, struct lxqt_wallet_struct **ww, gcry_cipher_hd_t *h);
 
+static lxqt_wallet_error _lxqt_wallet_open_0(gcry_cipher_hd_t *h, struct lxqt_wallet_struct *w,
+        const char *password, u_int32_t password_length, int fd, char *buffer, const char *path);
+
 int lxqt_wallet_library_version(void)
 {
     return VERSION;
@@ -171,7 +426,7 @@ char *_lxqt_wallet_get_wallet_data(lxqt_wallet_t wallet)
     }
     else
     {
-        return wallet->wallet_data;
+        return wallet->key_data;
     }
 }
 
@@ -191,6 +446,61 @@ inline static void  _get_header_components(u_int32_t *first, u_int32_t *second,
     memcpy(second, str + sizeof(u_int32_t), sizeof(u_int32_t));
 }
 
+static void _read_lock(lxqt_wallet_t wallet)
+{
+    if (wallet != NULL && wallet->thread_safe)
+    {
+        pthread_rwlock_rdlock(&wallet->lock);
+    }
+}
+
+static void _write_lock(lxqt_wallet_t wallet)
+{
+    if (wallet != NULL && wallet->thread_safe)
+    {
+        pthread_rwlock_wrlock(&wallet->lock);
+    }
+}
+
+static void _unlock(lxqt_wallet_t wallet)
+{
+    if (wallet != NULL && wallet->thread_safe)
+    {
+        pthread_rwlock_unlock(&wallet->lock);
+    }
+}
+
+lxqt_wallet_error lxqt_wallet_set_thread_safe(lxqt_wallet_t wallet)
+{
+    if (wallet == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+    else if (wallet->thread_safe)
+    {
+        return lxqt_wallet_no_error;
+    }
+    else if (pthread_rwlock_init(&wallet->lock, NULL) != 0)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+    else
+    {
+        wallet->thread_safe = 1;
+        return lxqt_wallet_no_error;
+    }
+}
+
+void lxqt_wallet_read_lock(lxqt_wallet_t wallet)
+{
+    _read_lock(wallet);
+}
+
+void lxqt_wallet_read_unlock(lxqt_wallet_t wallet)
+{
+    _unlock(wallet);
+}
+
 u_int64_t lxqt_wallet_wallet_size(lxqt_wallet_t wallet)
 {
     if (wallet == NULL)
@@ -199,7 +509,11 @@ u_int64_t lxqt_wallet_wallet_size(lxqt_wallet_t wallet)
     }
     else
     {
-        return wallet->wallet_data_size;
+        u_int64_t size;
+        _read_lock(wallet);
+        size = wallet->wallet_data_size;
+        _unlock(wallet);
+        return size;
     }
 }
 
@@ -211,7 +525,11 @@ u_int64_t lxqt_wallet_wallet_entry_count(lxqt_wallet_t wallet)
     }
     else
     {
-        return wallet->wallet_data_entry_count;
+        u_int64_t count;
+        _read_lock(wallet);
+        count = wallet->wallet_data_entry_count;
+        _unlock(wallet);
+        return count;
     }
 }
 
@@ -290,11 +608,17 @@ lxqt_wallet_error lxqt_wallet_create(const char *password, u_int32_t password_le
     gcry_cipher_hd_t handle = 0;
     gcry_error_t r;
 
+    struct stat st;
+    int lock;
+    int dirfd;
+
     if (password == NULL || wallet_name == NULL || application_name == NULL)
     {
         return _exit_create(lxqt_wallet_invalid_argument, handle);
     }
-    if (lxqt_wallet_exists(wallet_name, application_name) == 0)
+    if (lxqt_wallet_exists(wallet_name, application_name) == 0 ||
+        lxqt_wallet_sharded_exists(wallet_name, application_name) == 0 ||
+        lxqt_wallet_paged_exists(wallet_name, application_name) == 0)
     {
         return _exit_create(lxqt_wallet_wallet_exists, handle);
     }
@@ -311,11 +635,11 @@ lxqt_wallet_error lxqt_wallet_create(const char *password, u_int32_t password_le
 
         r = gcry_cipher_encrypt(handle, buffer, MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE, NULL, 0);
 
-        _create_application_wallet_path(application_name);
+        dirfd = _application_directory(application_name, 1);
 
-        _wallet_full_path(path, PATH_MAX, wallet_name, application_name);
+        fd = openat(dirfd, _wallet_file_name(path, PATH_MAX, wallet_name), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
 
-        fd = open(path, O_WRONLY | O_CREAT, 0600);
+        _release_application_directory(dirfd);
 
         if (fd == -1)
         {
@@ -340,1132 +664,6578 @@ lxqt_wallet_error lxqt_wallet_create(const char *password, u_int32_t password_le
              */
             write(fd, buffer + MAGIC_STRING_BUFFER_SIZE, BLOCK_SIZE);
 
+            fstat(fd, &st);
             close(fd);
+
+            lock = _lock_application_directory(application_name);
+            _update_manifest(wallet_name, application_name, &st, 0, VERSION);
+            _unlock_application_directory(lock);
+
             return _exit_create(lxqt_wallet_no_error, handle);
         }
     }
 }
 
-lxqt_wallet_error lxqt_wallet_create_encrypted_file(const char *password, u_int32_t password_length,
-        const char *source, const char *destination, int(*function)(int, void *), void *v)
+/*
+ * Files are encrypted and decrypted through a ring of large buffers.A reader thread fills buffers from the
+ * source file,the calling thread encrypts or decrypts them in order and a writer thread writes them out to
+ * the destination file.The three stages run concurrently and each buffer moves through them in turn.
+ *
+ * The calling thread runs the transform function of the pipeline on each buffer and is the only one that calls
+ * the progress function.A transform may change the amount of data in a buffer,every buffer but the last one
+ * has "read_stride" bytes read into it and "write_stride" bytes written out of it.
+ *
+ * The source is read until its end if its size is FILE_SIZE_UNKNOWN.The reader then reads a byte ahead of every
+ * buffer to find out if the buffer is the last one before passing it on.
+ */
+enum
 {
-    gcry_error_t r;
-    int fd_dest;
-    int fd_src;
-    char iv[ IV_SIZE ];
-    char key[ PASSWORD_SIZE ];
-    char salt[ SALT_SIZE ];
-    char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ] = { '\0' };
-    char file_buffer[ FILE_BLOCK_SIZE ];
+    FILE_BUFFER_EMPTY = 0,
+    FILE_BUFFER_READ,
+    FILE_BUFFER_PROCESSED
+};
+
+struct _file_buffer
+{
+    char *data;
     u_int64_t size;
-    u_int64_t i;
-    u_int64_t j;
-    u_int64_t l;
-    int k;
-    gcry_cipher_hd_t handle = 0;
+    int state;
+    int last;
+};
 
-    struct stat st;
+#if HAS_IO_URING
 
-    if (password == NULL || source == NULL || destination == NULL)
-    {
-        return lxqt_wallet_invalid_argument;
-    }
+struct _uring
+{
+    int fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+};
 
-    if (stat(destination, &st) == 0)
-    {
-        return lxqt_wallet_failed_to_open_file;
-    }
+#endif
 
-    r = lxqt_wallet_create_1(&handle, password, password_length, key, iv, salt);
+struct _file_pipeline;
 
-    if (_failed(r))
+struct _chunked_file;
+
+typedef lxqt_wallet_error (*_file_transform)(struct _file_pipeline *, struct _file_buffer *, u_int64_t chunk);
+
+struct _file_pipeline
+{
+#if HAS_IO_URING
+    struct _uring uring;
+    off_t src_offset;
+    off_t dest_offset;
+#endif
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    struct _file_buffer buffers[ FILE_PIPELINE_BUFFER_COUNT ];
+    int buffer_count;
+    u_int64_t buffer_size;
+    u_int64_t read_stride;
+    u_int64_t write_stride;
+    u_int64_t chunk_count;
+    u_int64_t read_size;
+    u_int64_t write_size;
+    _file_transform transform;
+    gcry_cipher_hd_t handle;
+    const struct _chunked_file *file;
+    int fd_src;
+    int fd_dest;
+    int stop;
+    lxqt_wallet_error error;
+};
+
+static u_int64_t _file_pipeline_buffer_size = FILE_PIPELINE_MIN_BUFFER_SIZE;
+
+void lxqt_wallet_set_file_buffer_size(u_int32_t size)
+{
+    if (size < FILE_PIPELINE_MIN_BUFFER_SIZE)
     {
-        return _exit_create(lxqt_wallet_gcry_cipher_encrypt_failed, handle);
+        size = FILE_PIPELINE_MIN_BUFFER_SIZE;
     }
-    else
+    else if (size > FILE_PIPELINE_MAX_BUFFER_SIZE)
     {
-        fd_dest = open(destination, O_WRONLY | O_CREAT, 0600);
-        if (fd_dest == -1)
-        {
-            return _exit_create(lxqt_wallet_failed_to_open_file, handle);
-        }
-        fd_src = open(source, O_RDONLY);
-        if (fd_src == -1)
-        {
-            close(fd_dest);
-            return _exit_create(lxqt_wallet_failed_to_open_file, handle);
-        }
-        /*
-         * first 16 bytes are for PBKDF2 salt
-         */
-        write(fd_dest, salt, SALT_SIZE);
-        /*
-         * second 16 bytes are for AES IV
-         */
-        write(fd_dest, iv, IV_SIZE);
+        size = FILE_PIPELINE_MAX_BUFFER_SIZE;
+    }
 
-        fstat(fd_src, &st);
-	size = (u_int64_t)st.st_size;
+    _file_pipeline_buffer_size = size - size % FILE_BLOCK_SIZE;
+}
 
-        _create_magic_string_header(buffer);
+static u_int64_t _round_up_to_file_block(u_int64_t size)
+{
+    return (size + FILE_BLOCK_SIZE - 1) / FILE_BLOCK_SIZE * FILE_BLOCK_SIZE;
+}
 
-        memcpy(buffer + MAGIC_STRING_BUFFER_SIZE, &size, sizeof(u_int64_t));
+/*
+ * wait for the buffer of chunk "chunk" to reach state "state",returns NULL if the pipeline was stopped
+ */
+static struct _file_buffer *_file_pipeline_wait(struct _file_pipeline *p, u_int64_t chunk, int state)
+{
+    struct _file_buffer *e = p->buffers + chunk % p->buffer_count;
 
-        gcry_cipher_encrypt(handle, buffer, MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE, NULL, 0);
+    pthread_mutex_lock(&p->mutex);
 
-        /*
-         * write third 16 byte and fourth 16 to the header
-         */
-        write(fd_dest, buffer, MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE);
+    while (e->state != state && !p->stop)
+    {
+        pthread_cond_wait(&p->cond, &p->mutex);
+    }
 
-        i = 0;
-        j = 0;
-        l = 0;
+    if (p->stop)
+    {
+        e = NULL;
+    }
 
-        while (1)
-        {
-            k = (int)read(fd_src, file_buffer, FILE_BLOCK_SIZE);
-            if (k == 0)
-            {
-                break;
-            }
-            r = gcry_cipher_encrypt(handle, file_buffer, FILE_BLOCK_SIZE, NULL, 0);
-            write(fd_dest, file_buffer, FILE_BLOCK_SIZE);
-            if (k < FILE_BLOCK_SIZE)
-            {
-                break;
-            }
-            i += FILE_BLOCK_SIZE;
-            j = (i * 100 / size);
-            if (j > l)
-            {
-                if (function((int)j, v))
-                {
-                    break;
-                }
-                l = j;
-            }
-        }
+    pthread_mutex_unlock(&p->mutex);
 
-        function(100, v);
+    return e;
+}
 
-        close(fd_dest);
-        close(fd_src);
-        return  _exit_create(lxqt_wallet_no_error, handle);
+static void _file_pipeline_post(struct _file_pipeline *p, struct _file_buffer *e, int state)
+{
+    pthread_mutex_lock(&p->mutex);
+    e->state = state;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
+}
+
+static void _file_pipeline_stop(struct _file_pipeline *p, lxqt_wallet_error error)
+{
+    pthread_mutex_lock(&p->mutex);
+
+    if (p->error == lxqt_wallet_no_error)
+    {
+        p->error = error;
     }
+
+    p->stop = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
 }
 
-lxqt_wallet_error lxqt_wallet_change_wallet_password(lxqt_wallet_t wallet, const char *new_key, u_int32_t new_key_size)
+/*
+ * size of part "chunk" of "total" bytes split in parts of "stride" bytes
+ */
+static u_int64_t _file_pipeline_chunk_size(u_int64_t total, u_int64_t stride, u_int64_t chunk)
 {
-    char key[ PASSWORD_SIZE ];
-    gcry_error_t r;
+    u_int64_t offset = chunk * stride;
 
-    if (wallet == NULL || new_key == NULL)
+    if (total - offset < stride)
     {
-        return lxqt_wallet_invalid_argument;
+        return total - offset;
     }
     else
     {
-        r = _create_key(wallet->salt, key, new_key, new_key_size);
-        if (_failed(r))
-        {
-            return lxqt_wallet_failed_to_create_key_hash;
-        }
-        else
-        {
-            memcpy(wallet->key, key, PASSWORD_SIZE);
-            wallet->wallet_modified = 1;
-            return lxqt_wallet_no_error;
-        }
+        return stride;
     }
 }
 
-static lxqt_wallet_error _exit_open(lxqt_wallet_error st,
-                                    struct lxqt_wallet_struct *w, gcry_cipher_hd_t handle, int fd)
-{
-    if (handle != 0)
-    {
-        gcry_cipher_close(handle);
-    }
-    if (fd != -1)
-    {
-        close(fd);
-    }
-    if (w != NULL)
+/*
+ * read up to "size" bytes,returns the number of bytes read or -1 on error
+ */
+static ssize_t _file_pipeline_read(int fd, char *buffer, u_int64_t size)
+{
+    u_int64_t i;
+    ssize_t n;
+
+    for (i = 0; i < size; i += n)
     {
-        free(w->wallet_name);
-        free(w->application_name);
-        free(w);
+        n = read(fd, buffer + i, size - i);
+
+        if (n == -1 && errno == EINTR)
+        {
+            n = 0;
+        }
+        else if (n == -1)
+        {
+            return -1;
+        }
+        else if (n == 0)
+        {
+            break;
+        }
     }
-    return st;
+
+    return (ssize_t)i;
 }
 
-static lxqt_wallet_error _lxqt_wallet_open_0(gcry_cipher_hd_t *h, struct lxqt_wallet_struct *w,
-        const char *password, u_int32_t password_length, int fd, char *buffer)
+static void *_file_pipeline_reader(void *arg)
 {
-    gcry_error_t r;
-    gcry_cipher_hd_t handle;
-    char iv[ IV_SIZE ];
+    struct _file_pipeline *p = arg;
+    struct _file_buffer *e;
+    u_int64_t chunk;
+    u_int64_t size;
+    ssize_t n;
+    char next;
+    int has_next = 0;
 
-    if (gcry_control(GCRYCTL_INITIALIZATION_FINISHED_P) == 0)
+    for (chunk = 0; chunk < p->chunk_count; chunk++)
     {
-        gcry_check_version(NULL);
-        gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
-    }
+        e = _file_pipeline_wait(p, chunk, FILE_BUFFER_EMPTY);
 
-    r = gcry_cipher_open(h, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_CBC, 0);
+        if (e == NULL)
+        {
+            break;
+        }
 
-    handle = *h;
+        if (p->read_size == FILE_SIZE_UNKNOWN)
+        {
+            if (has_next)
+            {
+                e->data[ 0 ] = next;
+            }
 
-    if (_failed(r))
-    {
-        return lxqt_wallet_gcry_cipher_open_failed;
-    }
+            n = _file_pipeline_read(p->fd_src, e->data + has_next, p->read_stride - has_next);
 
-    _get_salt_from_wallet_header(w->salt, fd);
+            if (n != -1 && (u_int64_t)n + has_next == p->read_stride)
+            {
+                has_next = (int)_file_pipeline_read(p->fd_src, &next, 1);
+                size     = p->read_stride;
+            }
+            else
+            {
+                size     = (u_int64_t)n + has_next;
+                has_next = 0;
+            }
 
-    r = _create_key(w->salt, w->key, password, password_length);
+            e->last = has_next == 0;
+        }
+        else
+        {
+            size = _file_pipeline_chunk_size(p->read_size, p->read_stride, chunk);
 
-    if (_failed(r))
-    {
-        return lxqt_wallet_failed_to_create_key_hash;
-    }
+            /*
+             * a short read means the file is shorter than it was when we started
+             */
+            n = _file_pipeline_read(p->fd_src, e->data, size) == (ssize_t)size ? 0 : -1;
 
-    r = gcry_cipher_setkey(handle, w->key, PASSWORD_SIZE);
+            e->last = chunk == p->chunk_count - 1;
+        }
 
-    if (_failed(r))
-    {
-        return lxqt_wallet_gcry_cipher_setkey_failed;
-    }
+        if (n == -1 || has_next == -1)
+        {
+            _file_pipeline_stop(p, lxqt_wallet_failed_to_open_file);
+            return NULL;
+        }
 
-    _get_iv_from_wallet_header(iv, fd);
+        e->size = size;
 
-    r = gcry_cipher_setiv(handle, iv, IV_SIZE);
+        if (e->last)
+        {
+            _file_pipeline_post(p, e, FILE_BUFFER_READ);
+            break;
+        }
 
-    if (_failed(r))
-    {
-        return lxqt_wallet_gcry_cipher_setiv_failed;
-    }
-    else
-    {
-        _get_volume_info(buffer, fd);
-        return gcry_cipher_decrypt(handle, buffer, MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE, NULL, 0);
+        _file_pipeline_post(p, e, FILE_BUFFER_READ);
     }
+
+    return NULL;
 }
 
-lxqt_wallet_error lxqt_wallet_create_decrypted_file(const char *password, u_int32_t password_length,
-        const char *source, const char *destination, int(*function)(int, void *), void *v)
+static void *_file_pipeline_writer(void *arg)
 {
-    gcry_error_t r;
-
-    int fd_dest;
-    int fd_src;
-
-    struct stat st;
-
-    char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ] = { '\0' };
-    char file_buffer[ FILE_BLOCK_SIZE ];
-
+    struct _file_pipeline *p = arg;
+    struct _file_buffer *e;
+    u_int64_t chunk;
     u_int64_t size;
     u_int64_t i;
-    u_int64_t j;
-    u_int64_t l;
-    u_int64_t n;
-    u_int64_t t;
-
-    gcry_cipher_hd_t handle = 0;
-
-    struct lxqt_wallet_struct *w;
-
-    if (password == NULL || source == NULL || destination == NULL)
-    {
-        return lxqt_wallet_invalid_argument;
-    }
-
-    if (stat(destination, &st) == 0)
-    {
-        return lxqt_wallet_failed_to_open_file;
-    }
-
-    w = malloc(sizeof(struct lxqt_wallet_struct));
-
-    if (w == NULL)
-    {
-        return _exit_open(lxqt_wallet_failed_to_allocate_memory, NULL, handle, -1);
-    }
-
-    memset(w, '\0', sizeof(struct lxqt_wallet_struct));
-
-    fd_src = open(source, O_RDONLY);
-    if (fd_src == -1)
-    {
-        return _exit_open(lxqt_wallet_failed_to_open_file, w, handle, -1);
-    }
+    ssize_t n;
 
-    r = _lxqt_wallet_open_0(&handle, w, password, password_length, fd_src, buffer);
-
-    if (_failed(r))
+    for (chunk = 0; chunk < p->chunk_count; chunk++)
     {
-        close(fd_src);
-        return _exit_open(lxqt_wallet_failed_to_open_file, w, handle, -1);
-    }
+        e = _file_pipeline_wait(p, chunk, FILE_BUFFER_PROCESSED);
 
-    if (_password_match(buffer) && _wallet_is_compatible(buffer))
-    {
-        fd_dest = open(destination, O_WRONLY | O_CREAT, 0600);
-        if (fd_dest == -1)
+        if (e == NULL)
         {
-            close(fd_src);
-            return _exit_open(lxqt_wallet_failed_to_open_file, w, handle, -1);
+            break;
         }
 
-        _get_load_information(w, buffer);
-
-        size = w->wallet_data_size;
-
-        i = 0;
-        j = 0;
-        l = 0;
+        size = e->size;
 
-        n = size / FILE_BLOCK_SIZE;
-
-        for (t = 0; t < n; t++)
+        for (i = 0; i < size; i += n)
         {
-            read(fd_src, file_buffer, FILE_BLOCK_SIZE);
-            gcry_cipher_decrypt(handle, file_buffer, FILE_BLOCK_SIZE, NULL, 0);
-            write(fd_dest, file_buffer, FILE_BLOCK_SIZE);
-            i += FILE_BLOCK_SIZE;
-            j = (i * 100 / size);
-            if (j > l)
+            n = write(p->fd_dest, e->data + i, size - i);
+
+            if (n == -1 && errno == EINTR)
             {
-                if (function((int)j, v))
-                {
-                    break;
-                }
-                l = j;
+                n = 0;
+            }
+            else if (n <= 0)
+            {
+                _file_pipeline_stop(p, lxqt_wallet_failed_to_open_file);
+                return NULL;
             }
         }
 
-        size = size - i;
-
-        if (size > 0)
+        if (e->last)
         {
-            read(fd_src, file_buffer, FILE_BLOCK_SIZE);
-            gcry_cipher_decrypt(handle, file_buffer, FILE_BLOCK_SIZE, NULL, 0);
-            write(fd_dest, file_buffer, size);
+            _file_pipeline_post(p, e, FILE_BUFFER_EMPTY);
+            break;
         }
 
-        close(fd_src);
-        close(fd_dest);
+        _file_pipeline_post(p, e, FILE_BUFFER_EMPTY);
+    }
 
-        function(100, v);
+    return NULL;
+}
+
+#if HAS_IO_URING
 
-        return _exit_open(lxqt_wallet_no_error, w, handle, -1);
+static void _uring_close(struct _uring *u)
+{
+    if (u->sqes != NULL)
+    {
+        munmap(u->sqes, u->sqes_size);
     }
-    else
+    if (u->cq_ring != NULL && u->cq_ring != u->sq_ring)
     {
-        close(fd_src);
-        return _exit_open(lxqt_wallet_wrong_password, w, handle, -1);
+        munmap(u->cq_ring, u->cq_ring_size);
+    }
+    if (u->sq_ring != NULL)
+    {
+        munmap(u->sq_ring, u->sq_ring_size);
     }
+
+    close(u->fd);
 }
 
-static lxqt_wallet_error _lxqt_wallet_open(const char *password, u_int32_t password_length,
-        const char *wallet_name, const char *application_name, char *buffer,
-        int *ffd, struct lxqt_wallet_struct **ww, gcry_cipher_hd_t *h)
+/*
+ * set up a ring with one submission slot per pipeline buffer and register the buffers with it,
+ * returns 0 on success
+ */
+static int _uring_setup(struct _uring *u, struct _file_buffer *buffers, int buffer_count, u_int64_t buffer_size)
 {
-    gcry_error_t r;
-    gcry_cipher_hd_t handle = 0;
-
-    char path[ PATH_MAX ];
-
-    int fd;
-
-    size_t len;
-
-    struct lxqt_wallet_struct *w;
+    struct io_uring_params params;
+    struct iovec iov[ FILE_PIPELINE_BUFFER_COUNT ];
+    char *sq;
+    char *cq;
+    int i;
 
-    _wallet_full_path(path, PATH_MAX, wallet_name, application_name);
+    memset(u, '\0', sizeof(struct _uring));
+    memset(&params, '\0', sizeof(params));
 
-    fd = open(path, O_RDONLY);
+    u->fd = (int)syscall(__NR_io_uring_setup, FILE_PIPELINE_BUFFER_COUNT, &params);
 
-    if (fd == -1)
+    if (u->fd == -1)
     {
-        return _exit_open(lxqt_wallet_failed_to_open_file, NULL, handle, fd);
+        return 1;
     }
 
-    w = malloc(sizeof(struct lxqt_wallet_struct));
+    u->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    u->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    u->sqes_size    = params.sq_entries * sizeof(struct io_uring_sqe);
 
-    if (w == NULL)
+    /*
+     * only kernels that share the two rings in one mapping are supported,they are the ones that also have
+     * the IORING_OP_READ_FIXED and IORING_OP_WRITE_FIXED operations we need
+     */
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP))
     {
-        return _exit_open(lxqt_wallet_failed_to_allocate_memory, NULL, handle, fd);
+        _uring_close(u);
+        return 1;
     }
 
-    memset(w, '\0', sizeof(struct lxqt_wallet_struct));
-
-    len = strlen(wallet_name);
-
-    w->wallet_name = malloc(sizeof(char) * (len + 1));
-
-    if (w->wallet_name == NULL)
+    if (u->cq_ring_size > u->sq_ring_size)
     {
-        return _exit_open(lxqt_wallet_failed_to_allocate_memory, w, handle, fd);
+        u->sq_ring_size = u->cq_ring_size;
     }
-    else
+
+    u->sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+
+    if (u->sq_ring == MAP_FAILED)
     {
-        memcpy(w->wallet_name, wallet_name, len + 1);
+        u->sq_ring = NULL;
+        _uring_close(u);
+        return 1;
     }
 
-    len = strlen(application_name);
+    u->cq_ring = u->sq_ring;
 
-    w->application_name = malloc(sizeof(char) * (len + 1));
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
 
-    if (w->application_name == NULL)
-    {
-        return _exit_open(lxqt_wallet_failed_to_allocate_memory, w, handle, fd);
-    }
-    else
+    if (u->sqes == MAP_FAILED)
     {
-        memcpy(w->application_name, application_name, len + 1);
+        u->sqes = NULL;
+        _uring_close(u);
+        return 1;
     }
 
-    r = _lxqt_wallet_open_0(&handle, w, password, password_length, fd, buffer);
+    sq = u->sq_ring;
+    cq = u->cq_ring;
 
-    if (_failed(r))
+    u->sq_head  = (unsigned *)(sq + params.sq_off.head);
+    u->sq_tail  = (unsigned *)(sq + params.sq_off.tail);
+    u->sq_mask  = (unsigned *)(sq + params.sq_off.ring_mask);
+    u->sq_array = (unsigned *)(sq + params.sq_off.array);
+    u->cq_head  = (unsigned *)(cq + params.cq_off.head);
+    u->cq_tail  = (unsigned *)(cq + params.cq_off.tail);
+    u->cq_mask  = (unsigned *)(cq + params.cq_off.ring_mask);
+    u->cqes     = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    for (i = 0; i < buffer_count; i++)
     {
-        return _exit_open(lxqt_wallet_gcry_cipher_decrypt_failed, w, handle, fd);
+        iov[ i ].iov_base = buffers[ i ].data;
+        iov[ i ].iov_len  = buffer_size;
     }
-    else
+
+    if (syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_BUFFERS, iov, buffer_count) != 0)
     {
-        *ww = w;
-        *ffd = fd;
-        *h = handle;
-        return lxqt_wallet_no_error;
+        _uring_close(u);
+        return 1;
     }
+
+    return 0;
 }
 
-lxqt_wallet_error lxqt_wallet_open(lxqt_wallet_t *wallet, const char *password, u_int32_t password_length,
-                                   const char *wallet_name, const char *application_name)
+static void _uring_queue(struct _uring *u, int opcode, int fd, int buffer, char *data, u_int32_t size, off_t offset)
 {
-    struct stat st;
-    u_int64_t len;
-    char *e;
+    unsigned tail = *u->sq_tail;
+    unsigned index = tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = u->sqes + index;
 
-    int fd;
-    struct lxqt_wallet_struct *w = 0;
+    memset(sqe, '\0', sizeof(struct io_uring_sqe));
 
-    gcry_cipher_hd_t handle = 0;
+    sqe->opcode    = (u_int8_t)opcode;
+    sqe->fd        = fd;
+    sqe->off       = (u_int64_t)offset;
+    sqe->addr      = (u_int64_t)(uintptr_t)data;
+    sqe->len       = size;
+    sqe->buf_index = (u_int16_t)buffer;
+    sqe->user_data = (u_int64_t)buffer;
 
-    char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ];
+    u->sq_array[ index ] = index;
 
-    gcry_error_t r;
+    __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
 
-    if (wallet_name == NULL || application_name == NULL || wallet == NULL)
+static int _uring_enter(struct _uring *u, unsigned submit, unsigned wait)
+{
+    int r;
+
+    do
     {
-        return lxqt_wallet_invalid_argument;
-    }
+        r = (int)syscall(__NR_io_uring_enter, u->fd, submit, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
 
-    r = _lxqt_wallet_open(password, password_length, wallet_name, application_name, buffer, &fd, &w, &handle);
+    } while (r == -1 && errno == EINTR);
 
-    if (r != lxqt_wallet_no_error)
-    {
-        return r;
-    }
+    return r;
+}
 
-    if (_password_match(buffer))
+/*
+ * An alternative to the reader and the writer threads that does all I/O of the pipeline from one thread through
+ * io_uring.
+ *
+ * Every buffer has at most one read or write in flight and reads of buffers ahead of the cipher stage are in
+ * flight at the same time as writes of buffers behind it.Reads and writes use explicit file offsets and
+ * registered buffers to skip per request page pinning.
+ *
+ * A read can not be linked to the write of the same buffer because the buffer has to go through the cipher
+ * stage between the two.
+ */
+static void *_file_pipeline_uring(void *arg)
+{
+    struct _file_pipeline *p = arg;
+    struct _uring *u = &p->uring;
+    struct _file_buffer *e;
+    struct io_uring_cqe *cqe;
+    u_int64_t chunk[ FILE_PIPELINE_BUFFER_COUNT ];
+    u_int64_t done[ FILE_PIPELINE_BUFFER_COUNT ];
+    u_int64_t size[ FILE_PIPELINE_BUFFER_COUNT ];
+    int busy[ FILE_PIPELINE_BUFFER_COUNT ] = { 0 };
+    u_int64_t read_chunk = 0;
+    u_int64_t write_chunk = 0;
+    u_int64_t written = 0;
+    unsigned submit = 0;
+    unsigned in_flight = 0;
+    unsigned head;
+    int i;
+
+    while (written < p->chunk_count)
     {
-        if (_wallet_is_compatible(buffer))
+        pthread_mutex_lock(&p->mutex);
+
+        while (!p->stop && in_flight == 0 && submit == 0 &&
+                !(read_chunk < p->chunk_count && p->buffers[ read_chunk % p->buffer_count ].state == FILE_BUFFER_EMPTY) &&
+                !(write_chunk < p->chunk_count && p->buffers[ write_chunk % p->buffer_count ].state == FILE_BUFFER_PROCESSED))
         {
-            fstat(fd, &st);
+            pthread_cond_wait(&p->cond, &p->mutex);
+        }
 
-            len = (u_int64_t)(st.st_size - (SALT_SIZE + IV_SIZE + MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE));
+        if (p->stop)
+        {
+            pthread_mutex_unlock(&p->mutex);
+            break;
+        }
+
+        while (read_chunk < p->chunk_count)
+        {
+            i = (int)(read_chunk % p->buffer_count);
 
-            if ((int64_t)len <= 0)
+            if (busy[ i ] || p->buffers[ i ].state != FILE_BUFFER_EMPTY)
+            {
+                break;
+            }
+
+            busy[ i ]  = 1;
+            chunk[ i ] = read_chunk++;
+            done[ i ]  = 0;
+            size[ i ]  = _file_pipeline_chunk_size(p->read_size, p->read_stride, chunk[ i ]);
+
+            _uring_queue(u, IORING_OP_READ_FIXED, p->fd_src, i, p->buffers[ i ].data, (u_int32_t)size[ i ],
+                         p->src_offset + (off_t)(chunk[ i ] * p->read_stride));
+            submit++;
+        }
+
+        while (write_chunk < p->chunk_count)
+        {
+            i = (int)(write_chunk % p->buffer_count);
+
+            if (busy[ i ] || p->buffers[ i ].state != FILE_BUFFER_PROCESSED)
+            {
+                break;
+            }
+
+            busy[ i ]  = 1;
+            chunk[ i ] = write_chunk++;
+            done[ i ]  = 0;
+            size[ i ]  = p->buffers[ i ].size;
+
+            _uring_queue(u, IORING_OP_WRITE_FIXED, p->fd_dest, i, p->buffers[ i ].data, (u_int32_t)size[ i ],
+                         p->dest_offset + (off_t)(chunk[ i ] * p->write_stride));
+            submit++;
+        }
+
+        pthread_mutex_unlock(&p->mutex);
+
+        in_flight += submit;
+
+        if (_uring_enter(u, submit, 1) < 0)
+        {
+            _file_pipeline_stop(p, lxqt_wallet_failed_to_open_file);
+            submit = 0;
+            break;
+        }
+
+        submit = 0;
+
+        head = *u->cq_head;
+
+        while (head != __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE))
+        {
+            cqe = u->cqes + (head & *u->cq_mask);
+            i   = (int)cqe->user_data;
+            e   = p->buffers + i;
+
+            head++;
+            in_flight--;
+
+            if (cqe->res <= 0)
             {
                 /*
-                 * empty wallet
+                 * a failed request or a source file that is shorter than it was when we started
                  */
-                *wallet = w;
-                return _exit_open(lxqt_wallet_no_error, NULL, handle, fd);
+                busy[ i ] = 0;
+                _file_pipeline_stop(p, lxqt_wallet_failed_to_open_file);
+                continue;
+            }
+
+            done[ i ] += (u_int64_t)cqe->res;
+
+            if (done[ i ] < size[ i ])
+            {
+                /*
+                 * short read or write,queue the rest of the buffer
+                 */
+                _uring_queue(u, e->state == FILE_BUFFER_EMPTY ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED,
+                             e->state == FILE_BUFFER_EMPTY ? p->fd_src : p->fd_dest, i, e->data + done[ i ],
+                             (u_int32_t)(size[ i ] - done[ i ]),
+                             (e->state == FILE_BUFFER_EMPTY ? p->src_offset + (off_t)(chunk[ i ] * p->read_stride) :
+                                                              p->dest_offset + (off_t)(chunk[ i ] * p->write_stride)) +
+                             (off_t)done[ i ]);
+                submit++;
+                continue;
+            }
+
+            busy[ i ] = 0;
+
+            if (e->state == FILE_BUFFER_EMPTY)
+            {
+                e->size = size[ i ];
+                e->last = chunk[ i ] == p->chunk_count - 1;
+                _file_pipeline_post(p, e, FILE_BUFFER_READ);
             }
             else
             {
-                _get_load_information(w, buffer);
-                if( w->wallet_data_size > len ){
-                    /*
-                     * Wallet is corrupt somehow,lets clear it.
-                    */
-                    w->wallet_data_size = 0;
-                    w->wallet_data_entry_count = 0;
-                    w->wallet_modified = 1;
+                written++;
+                _file_pipeline_post(p, e, FILE_BUFFER_EMPTY);
+            }
+        }
+
+        __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    /*
+     * buffers must not be freed while the kernel is still using them
+     */
+    while (in_flight > 0 && _uring_enter(u, submit, 1) >= 0)
+    {
+        submit = 0;
+        head   = *u->cq_head;
+
+        while (head != __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE))
+        {
+            head++;
+            in_flight--;
+        }
+
+        __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+#endif
+
+/*
+ * start threads that do the I/O of the pipeline,the number of started threads is returned
+ */
+static int _file_pipeline_start(struct _file_pipeline *p, pthread_t *threads)
+{
+#if HAS_IO_URING
+    p->src_offset  = lseek(p->fd_src, 0, SEEK_CUR);
+    p->dest_offset = lseek(p->fd_dest, 0, SEEK_CUR);
+
+    if (p->read_size != FILE_SIZE_UNKNOWN && p->src_offset != -1 && p->dest_offset != -1 &&
+            _uring_setup(&p->uring, p->buffers, p->buffer_count, p->buffer_size) == 0)
+    {
+        if (pthread_create(threads, NULL, _file_pipeline_uring, p) == 0)
+        {
+            return 1;
+        }
+
+        _uring_close(&p->uring);
+        p->uring.fd = -1;
+    }
+    else
+    {
+        p->uring.fd = -1;
+    }
+#endif
+    if (pthread_create(threads, NULL, _file_pipeline_reader, p) != 0)
+    {
+        return 0;
+    }
+
+    if (pthread_create(threads + 1, NULL, _file_pipeline_writer, p) != 0)
+    {
+        _file_pipeline_stop(p, lxqt_wallet_failed_to_allocate_memory);
+        pthread_join(threads[ 0 ], NULL);
+        return 0;
+    }
+
+    return 2;
+}
+
+/*
+ * run a pipeline whose file descriptors,sizes,strides and transform are set by the caller.
+ *
+ * "read_stride" bytes are read into each buffer and the size of buffers defaults to it if it is not set.
+ *
+ * Progress is reported in percent through "function" or in bytes read from the source through "bytes_function",
+ * lxqt_wallet_no_error is returned if either of them cancels the operation.
+ */
+static lxqt_wallet_error _file_pipeline_run(struct _file_pipeline *p, int(*function)(int, void *),
+        int(*bytes_function)(u_int64_t, void *), void *v)
+{
+    struct _file_buffer *e;
+    pthread_t threads[ 2 ];
+    int thread_count = 0;
+    u_int64_t chunk;
+    u_int64_t done = 0;
+    u_int64_t j;
+    u_int64_t l = 0;
+    lxqt_wallet_error r;
+    int last;
+    int i;
+
+    if (p->read_size == 0)
+    {
+        return lxqt_wallet_no_error;
+    }
+
+    if (p->buffer_size == 0)
+    {
+        p->buffer_size = p->read_stride;
+    }
+
+    if (p->read_size == FILE_SIZE_UNKNOWN)
+    {
+        p->chunk_count = FILE_SIZE_UNKNOWN;
+    }
+    else
+    {
+        p->chunk_count = (p->read_size + p->read_stride - 1) / p->read_stride;
+    }
+
+    p->buffer_count = p->chunk_count < FILE_PIPELINE_BUFFER_COUNT ? (int)p->chunk_count : FILE_PIPELINE_BUFFER_COUNT;
+
+    for (i = 0; i < p->buffer_count; i++)
+    {
+        p->buffers[ i ].data = malloc(p->buffer_size);
+
+        if (p->buffers[ i ].data == NULL)
+        {
+            p->error = lxqt_wallet_failed_to_allocate_memory;
+            break;
+        }
+
+        mlock(p->buffers[ i ].data, p->buffer_size);
+    }
+
+    posix_fadvise(p->fd_src, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->cond, NULL);
+
+    if (p->error == lxqt_wallet_no_error)
+    {
+        thread_count = _file_pipeline_start(p, threads);
+
+        if (thread_count == 0)
+        {
+            p->error = lxqt_wallet_failed_to_allocate_memory;
+        }
+    }
+
+    if (p->error == lxqt_wallet_no_error)
+    {
+        for (chunk = 0; chunk < p->chunk_count; chunk++)
+        {
+            e = _file_pipeline_wait(p, chunk, FILE_BUFFER_READ);
+
+            if (e == NULL)
+            {
+                break;
+            }
+
+            done += e->size;
+            last  = e->last;
+
+            r = p->transform(p, e, chunk);
+
+            if (r != lxqt_wallet_no_error)
+            {
+                _file_pipeline_stop(p, r);
+                break;
+            }
+
+            _file_pipeline_post(p, e, FILE_BUFFER_PROCESSED);
+
+            if (bytes_function != NULL)
+            {
+                if (bytes_function(done, v))
+                {
+                    _file_pipeline_stop(p, lxqt_wallet_no_error);
+                    break;
                 }
-                e = malloc(len);
+            }
+            else if (function != NULL)
+            {
+                j = done * 100 / p->read_size;
 
-                if (e != NULL)
+                if (j > l && j < 100)
                 {
-                    mlock(e, len);
-                    read(fd, e, len);
-                    r = gcry_cipher_decrypt(handle, e, len, NULL, 0);
-                    if (_passed(r))
+                    if (function((int)j, v))
                     {
-                        w->wallet_data = e;
-                        *wallet = w;
-                        return _exit_open(lxqt_wallet_no_error, NULL, handle, fd);
+                        _file_pipeline_stop(p, lxqt_wallet_no_error);
+                        break;
                     }
-                    else
-                    {
-                        free(e);
-                        return _exit_open(lxqt_wallet_gcry_cipher_decrypt_failed, w, handle, fd);
-                    }
-                }
-                else
-                {
-                    return _exit_open(lxqt_wallet_failed_to_allocate_memory, w, handle, fd);
+
+                    l = j;
                 }
             }
+
+            if (last)
+            {
+                break;
+            }
         }
-        else
+
+        for (i = 0; i < thread_count; i++)
         {
-            return _exit_open(lxqt_wallet_incompatible_wallet, w, handle, fd);
+            pthread_join(threads[ i ], NULL);
+        }
+    }
+
+#if HAS_IO_URING
+    if (thread_count == 1)
+    {
+        _uring_close(&p->uring);
+    }
+#endif
+
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->mutex);
+
+    for (i = 0; i < p->buffer_count; i++)
+    {
+        if (p->buffers[ i ].data != NULL)
+        {
+            memset(p->buffers[ i ].data, '\0', p->buffer_size);
+            munlock(p->buffers[ i ].data, p->buffer_size);
+            free(p->buffers[ i ].data);
         }
     }
+
+    return p->error;
+}
+
+static lxqt_wallet_error _cbc_encrypt_buffer(struct _file_pipeline *p, struct _file_buffer *e, u_int64_t chunk)
+{
+    u_int64_t size = _round_up_to_file_block(e->size);
+
+    (void)chunk;
+
+    memset(e->data + e->size, '\0', size - e->size);
+
+    e->size = size;
+
+    if (_failed(gcry_cipher_encrypt(p->handle, e->data, size, NULL, 0)))
+    {
+        return lxqt_wallet_gcry_cipher_encrypt_failed;
+    }
     else
     {
-        return _exit_open(lxqt_wallet_wrong_password, w, handle, fd);
+        return lxqt_wallet_no_error;
+    }
+}
+
+static lxqt_wallet_error _cbc_decrypt_buffer(struct _file_pipeline *p, struct _file_buffer *e, u_int64_t chunk)
+{
+    if (_failed(gcry_cipher_decrypt(p->handle, e->data, e->size, NULL, 0)))
+    {
+        return lxqt_wallet_gcry_cipher_decrypt_failed;
+    }
+    else
+    {
+        e->size = _file_pipeline_chunk_size(p->write_size, p->write_stride, chunk);
+        return lxqt_wallet_no_error;
+    }
+}
+
+/*
+ * stream "size" bytes of data from "fd_src" to "fd_dest" through the CBC cipher in "handle".
+ *
+ * When encrypting,the data is zero padded to a multiple of FILE_BLOCK_SIZE and the padded data is written out.
+ * When decrypting,"size" is the size of the plain text,the padded cipher text is read and the padding is dropped.
+ *
+ * lxqt_wallet_no_error is returned if "function" cancels the operation.
+ */
+static lxqt_wallet_error _file_pipeline(gcry_cipher_hd_t handle, int fd_src, int fd_dest, u_int64_t size, int encrypt,
+                                        int(*function)(int, void *), void *v)
+{
+    struct _file_pipeline p;
+    u_int64_t padded_size = _round_up_to_file_block(size);
+
+    memset(&p, '\0', sizeof(p));
+
+    p.fd_src      = fd_src;
+    p.fd_dest     = fd_dest;
+    p.handle      = handle;
+    p.transform   = encrypt ? _cbc_encrypt_buffer : _cbc_decrypt_buffer;
+    p.read_size   = encrypt ? size : padded_size;
+    p.write_size  = encrypt ? padded_size : size;
+    p.read_stride = _file_pipeline_buffer_size;
+
+    if (p.read_stride > padded_size)
+    {
+        p.read_stride = padded_size;
+    }
+
+    p.write_stride = p.read_stride;
+
+    return _file_pipeline_run(&p, function, NULL, v);
+}
+
+/*
+ * Seekable encrypted file documentation.
+ *
+ * Files created by lxqt_wallet_create_seekable_encrypted_file() start with a 64 bytes header that is stored unencrypted.
+ *
+ * The first 16 bytes are the magic string "lxqt_wallet_cfs".
+ * The second 16 bytes are used for PBKDF2 salt.
+ * The next 4 bytes are a random nonce prefix.
+ * The next 4 bytes are a u_int32_t data type and are used to store the chunk size.
+ * The next 8 bytes are a u_int64_t data type and are used to store the size of the plain text.The size is
+ * CHUNKED_UNKNOWN_SIZE if it was not known when the file was created and it is then computed from the file size.
+ * The next 2 bytes are a u_int16_t data type and are used to store the format version.
+ * The remaining 14 bytes are reserved and are zero.
+ *
+ * The header is followed by a 32 bytes check block made up of AES-GCM encryption of the magic string header of
+ * wallets followed by its 16 bytes tag.The header is the additional authenticated data of the check block and
+ * the check block hence tells if the password is correct and if the header was tampered with.
+ *
+ * The check block is followed by chunks.A chunk is AES-GCM encryption of "chunk size" bytes of the plain text
+ * followed by a 16 bytes tag.The last chunk may be shorter and it is the only chunk of an empty file and is empty.
+ * The nonce of a chunk is the nonce prefix followed by the u_int64_t index of the chunk and the additional
+ * authenticated data of a chunk is its u_int64_t index followed by a byte that is 1 for the last chunk and 0
+ * for the others.Chunks can therefore not be reordered,dropped or appended without failing verification.
+ *
+ * Chunks are encrypted and decrypted independently of each other and in parallel.
+ */
+struct _chunked_file
+{
+    char key[ PASSWORD_SIZE ];
+    char nonce_prefix[ CHUNKED_NONCE_PREFIX_SIZE ];
+    u_int32_t chunk_size;
+    u_int64_t size;
+    u_int64_t chunk_count;
+};
+
+static u_int64_t _chunked_chunk_count(u_int64_t size, u_int32_t chunk_size)
+{
+    if (size == 0)
+    {
+        return 1;
+    }
+    else
+    {
+        return (size + chunk_size - 1) / chunk_size;
+    }
+}
+
+/*
+ * size of the plain text in chunk "index"
+ */
+static u_int64_t _chunked_chunk_size(const struct _chunked_file *f, u_int64_t index)
+{
+    return _file_pipeline_chunk_size(f->size, f->chunk_size, index);
+}
+
+/*
+ * encrypt or decrypt "size" bytes in "data" in place,the tag follows the data and "final" is set for the last chunk.
+ * The data is the check block if "index" is CHUNKED_HEADER_INDEX and "header" is its additional authenticated data.
+ */
+static lxqt_wallet_error _chunked_crypt(const struct _chunked_file *f, char *data, u_int64_t size, u_int64_t index,
+                                        int final, const char *header, int encrypt)
+{
+    gcry_cipher_hd_t handle;
+    char nonce[ CHUNKED_NONCE_SIZE ];
+    char aad[ sizeof(u_int64_t) + 1 ];
+    lxqt_wallet_error r = lxqt_wallet_no_error;
+
+    if (_failed(gcry_cipher_open(&handle, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_GCM, 0)))
+    {
+        return lxqt_wallet_gcry_cipher_open_failed;
+    }
+
+    memcpy(nonce, f->nonce_prefix, CHUNKED_NONCE_PREFIX_SIZE);
+    memcpy(nonce + CHUNKED_NONCE_PREFIX_SIZE, &index, sizeof(u_int64_t));
+
+    memcpy(aad, &index, sizeof(u_int64_t));
+    aad[ sizeof(u_int64_t) ] = final != 0;
+
+    if (_failed(gcry_cipher_setkey(handle, f->key, PASSWORD_SIZE)))
+    {
+        r = lxqt_wallet_gcry_cipher_setkey_failed;
+    }
+    else if (_failed(gcry_cipher_setiv(handle, nonce, CHUNKED_NONCE_SIZE)))
+    {
+        r = lxqt_wallet_gcry_cipher_setiv_failed;
+    }
+    else if (index == CHUNKED_HEADER_INDEX ? _failed(gcry_cipher_authenticate(handle, header, CHUNKED_HEADER_SIZE)) :
+             _failed(gcry_cipher_authenticate(handle, aad, sizeof(aad))))
+    {
+        r = encrypt ? lxqt_wallet_gcry_cipher_encrypt_failed : lxqt_wallet_gcry_cipher_decrypt_failed;
+    }
+    else if (encrypt)
+    {
+        if (_failed(gcry_cipher_encrypt(handle, data, size, NULL, 0)) ||
+                _failed(gcry_cipher_gettag(handle, data + size, CHUNKED_TAG_SIZE)))
+        {
+            r = lxqt_wallet_gcry_cipher_encrypt_failed;
+        }
+    }
+    else
+    {
+        if (_failed(gcry_cipher_decrypt(handle, data, size, NULL, 0)))
+        {
+            r = lxqt_wallet_gcry_cipher_decrypt_failed;
+        }
+        else if (_failed(gcry_cipher_checktag(handle, data + size, CHUNKED_TAG_SIZE)))
+        {
+            memset(data, '\0', size);
+            r = lxqt_wallet_authentication_failed;
+        }
+    }
+
+    gcry_cipher_close(handle);
+
+    return r;
+}
+
+/*
+ * see lxqtwallet_internal.h,every pool of threads in the library and in its programs goes through this function
+ */
+#define PARALLEL_FOR_MAX_THREADS 16
+
+struct _parallel_for
+{
+    void (*function)(void *, u_int64_t);
+    void *arg;
+    u_int64_t next;
+    u_int64_t count;
+};
+
+static void *_parallel_for_worker(void *arg)
+{
+    struct _parallel_for *e = arg;
+    u_int64_t i;
+
+    while ((i = __atomic_fetch_add(&e->next, 1, __ATOMIC_RELAXED)) < e->count)
+    {
+        e->function(e->arg, i);
+    }
+
+    return NULL;
+}
+
+void _lxqt_wallet_parallel_for(u_int64_t count, void (*function)(void *, u_int64_t), void *arg)
+{
+    struct _parallel_for e;
+    pthread_t threads[ PARALLEL_FOR_MAX_THREADS ];
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int thread_count = 0;
+    int i;
+
+    e.function = function;
+    e.arg      = arg;
+    e.next     = 0;
+    e.count    = count;
+
+    while (thread_count < cpus - 1 && thread_count < PARALLEL_FOR_MAX_THREADS - 1 && (u_int64_t)thread_count + 1 < count)
+    {
+        if (pthread_create(threads + thread_count, NULL, _parallel_for_worker, &e) != 0)
+        {
+            break;
+        }
+
+        thread_count++;
+    }
+
+    _parallel_for_worker(&e);
+
+    for (i = 0; i < thread_count; i++)
+    {
+        pthread_join(threads[ i ], NULL);
+    }
+}
+
+/*
+ * "count" chunks in "data",each chunk is followed by its tag.
+ * All chunks but the last one are full,"last_size" is the size of the last one and "final" tells if it is the
+ * last chunk of the file.
+ */
+struct _chunked_work
+{
+    const struct _chunked_file *file;
+    char *data;
+    u_int64_t first;
+    u_int64_t count;
+    u_int64_t last_size;
+    int final;
+    int encrypt;
+    lxqt_wallet_error error;
+};
+
+static void _chunked_work(void *arg, u_int64_t i)
+{
+    struct _chunked_work *w = arg;
+    const struct _chunked_file *f = w->file;
+    int last = i == w->count - 1;
+    lxqt_wallet_error r;
+
+    r = _chunked_crypt(f, w->data + i * (f->chunk_size + CHUNKED_TAG_SIZE), last ? w->last_size : f->chunk_size,
+                       w->first + i, last && w->final, NULL, w->encrypt);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        __atomic_store_n(&w->error, r, __ATOMIC_RELAXED);
+    }
+}
+
+static lxqt_wallet_error _chunked_run(const struct _chunked_file *f, char *data, u_int64_t first, u_int64_t count,
+                                      u_int64_t last_size, int final, int encrypt)
+{
+    struct _chunked_work w;
+
+    w.file      = f;
+    w.data      = data;
+    w.first     = first;
+    w.count     = count;
+    w.last_size = last_size;
+    w.final     = final;
+    w.encrypt   = encrypt;
+    w.error   = lxqt_wallet_no_error;
+
+    _lxqt_wallet_parallel_for(count, _chunked_work, &w);
+
+    return w.error;
+}
+
+/*
+ * pipeline transforms,a buffer holds "read_stride / chunk_size" chunks of plain text or the same number of chunks
+ * of cipher text followed by their tags.
+ *
+ * The last chunk of the file is in the last buffer and the last buffer of a stream holds one empty chunk if the
+ * stream is empty.
+ */
+static lxqt_wallet_error _chunked_encrypt_buffer(struct _file_pipeline *p, struct _file_buffer *e, u_int64_t chunk)
+{
+    const struct _chunked_file *f = p->file;
+    u_int64_t first = chunk * (p->read_stride / f->chunk_size);
+    u_int64_t count = _chunked_chunk_count(e->size, f->chunk_size);
+    u_int64_t last_size = e->size - (count - 1) * f->chunk_size;
+    u_int64_t i;
+
+    /*
+     * make room for tags
+     */
+    for (i = count - 1; i > 0; i--)
+    {
+        memmove(e->data + i * (f->chunk_size + CHUNKED_TAG_SIZE), e->data + i * f->chunk_size,
+                i == count - 1 ? last_size : f->chunk_size);
+    }
+
+    e->size += count * CHUNKED_TAG_SIZE;
+
+    return _chunked_run(f, e->data, first, count, last_size, e->last, 1);
+}
+
+static lxqt_wallet_error _chunked_decrypt_buffer(struct _file_pipeline *p, struct _file_buffer *e, u_int64_t chunk)
+{
+    const struct _chunked_file *f = p->file;
+    u_int64_t first = chunk * (p->read_stride / (f->chunk_size + CHUNKED_TAG_SIZE));
+    u_int64_t count = (e->size + f->chunk_size + CHUNKED_TAG_SIZE - 1) / (f->chunk_size + CHUNKED_TAG_SIZE);
+    u_int64_t last_size;
+    u_int64_t i;
+    lxqt_wallet_error r;
+
+    /*
+     * a stream that ends in the middle of a tag was cut short
+     */
+    if (count == 0 || e->size - (count - 1) * (f->chunk_size + CHUNKED_TAG_SIZE) < CHUNKED_TAG_SIZE)
+    {
+        return lxqt_wallet_authentication_failed;
+    }
+
+    last_size = e->size - (count - 1) * (f->chunk_size + CHUNKED_TAG_SIZE) - CHUNKED_TAG_SIZE;
+
+    r = _chunked_run(f, e->data, first, count, last_size, e->last, 0);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        /*
+         * drop tags
+         */
+        for (i = 1; i < count; i++)
+        {
+            memmove(e->data + i * f->chunk_size, e->data + i * (f->chunk_size + CHUNKED_TAG_SIZE),
+                    i == count - 1 ? last_size : f->chunk_size);
+        }
+
+        e->size -= count * CHUNKED_TAG_SIZE;
+    }
+
+    return r;
+}
+
+/*
+ * set up a seekable file of "size" bytes of plain text and create its header and check block in "header"
+ */
+static lxqt_wallet_error _chunked_create(struct _chunked_file *f, char header[ CHUNKED_DATA_OFFSET ],
+        const char *password, u_int32_t password_length, u_int64_t size)
+{
+    u_int16_t version = CHUNKED_VERSION;
+    char *salt = header + MAGIC_STRING_BUFFER_SIZE;
+
+    if (gcry_control(GCRYCTL_INITIALIZATION_FINISHED_P) == 0)
+    {
+        gcry_check_version(NULL);
+        gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+    }
+
+    memset(f, '\0', sizeof(struct _chunked_file));
+    memset(header, '\0', CHUNKED_DATA_OFFSET);
+
+    f->chunk_size = CHUNKED_CHUNK_SIZE;
+    f->size       = size;
+
+    _get_random_data(salt, SALT_SIZE);
+    _get_random_data(f->nonce_prefix, CHUNKED_NONCE_PREFIX_SIZE);
+
+    if (_failed(_create_key(salt, f->key, password, password_length)))
+    {
+        return lxqt_wallet_failed_to_create_key_hash;
+    }
+
+    f->chunk_count = size == CHUNKED_UNKNOWN_SIZE ? CHUNKED_UNKNOWN_SIZE : _chunked_chunk_count(size, f->chunk_size);
+
+    memcpy(header, CHUNKED_MAGIC_STRING, sizeof(CHUNKED_MAGIC_STRING));
+    memcpy(header + 32, f->nonce_prefix, CHUNKED_NONCE_PREFIX_SIZE);
+    memcpy(header + 36, &f->chunk_size, sizeof(u_int32_t));
+    memcpy(header + 40, &size, sizeof(u_int64_t));
+    memcpy(header + 48, &version, sizeof(u_int16_t));
+
+    _create_magic_string_header(header + CHUNKED_HEADER_SIZE);
+
+    return _chunked_crypt(f, header + CHUNKED_HEADER_SIZE, MAGIC_STRING_BUFFER_SIZE, CHUNKED_HEADER_INDEX, 0, header, 1);
+}
+
+static int _write_all(int fd, const char *buffer, u_int64_t size)
+{
+    ssize_t n;
+
+    while (size > 0)
+    {
+        n = write(fd, buffer, size);
+
+        if (n == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (n <= 0)
+        {
+            return 1;
+        }
+        else
+        {
+            buffer += n;
+            size -= n;
+        }
+    }
+
+    return 0;
+}
+
+static int _read_all(int fd, char *buffer, u_int64_t size, off_t offset)
+{
+    ssize_t n;
+
+    while (size > 0)
+    {
+        n = pread(fd, buffer, size, offset);
+
+        if (n == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (n <= 0)
+        {
+            return 1;
+        }
+
+        buffer += n;
+        offset += n;
+        size   -= (u_int64_t)n;
+    }
+
+    return 0;
+}
+
+static int _write_all_at(int fd, const char *buffer, u_int64_t size, off_t offset)
+{
+    ssize_t n;
+
+    while (size > 0)
+    {
+        n = pwrite(fd, buffer, size, offset);
+
+        if (n == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (n <= 0)
+        {
+            return 1;
+        }
+
+        buffer += n;
+        offset += n;
+        size   -= (u_int64_t)n;
+    }
+
+    return 0;
+}
+
+static int _is_chunked_file(int fd)
+{
+    char magic[ MAGIC_STRING_BUFFER_SIZE ];
+
+    return _read_all(fd, magic, MAGIC_STRING_BUFFER_SIZE, 0) == 0 &&
+           memcmp(magic, CHUNKED_MAGIC_STRING, sizeof(CHUNKED_MAGIC_STRING)) == 0;
+}
+
+/*
+ * parse the header and the check block of a seekable file and derive its key,"path" is used to look up the key
+ * in the key cache.
+ * The size of the file is left as CHUNKED_UNKNOWN_SIZE if the header does not have it.
+ */
+static lxqt_wallet_error _chunked_open_header(struct _chunked_file *f, char header[ CHUNKED_DATA_OFFSET ],
+        const char *path, const char *password, u_int32_t password_length)
+{
+    u_int16_t version;
+    gcry_error_t r;
+
+    if (gcry_control(GCRYCTL_INITIALIZATION_FINISHED_P) == 0)
+    {
+        gcry_check_version(NULL);
+        gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+    }
+
+    memset(f, '\0', sizeof(struct _chunked_file));
+
+    if (memcmp(header, CHUNKED_MAGIC_STRING, sizeof(CHUNKED_MAGIC_STRING)) != 0)
+    {
+        return lxqt_wallet_incompatible_wallet;
+    }
+
+    memcpy(f->nonce_prefix, header + 32, CHUNKED_NONCE_PREFIX_SIZE);
+    memcpy(&f->chunk_size, header + 36, sizeof(u_int32_t));
+    memcpy(&f->size, header + 40, sizeof(u_int64_t));
+    memcpy(&version, header + 48, sizeof(u_int16_t));
+
+    if (version != CHUNKED_VERSION || f->chunk_size == 0 || f->chunk_size > CHUNKED_MAX_CHUNK_SIZE)
+    {
+        return lxqt_wallet_incompatible_wallet;
+    }
+
+    if (path == NULL)
+    {
+        r = _create_key(header + MAGIC_STRING_BUFFER_SIZE, f->key, password, password_length);
+    }
+    else
+    {
+        r = _create_key_cached(path, header + MAGIC_STRING_BUFFER_SIZE, f->key, password, password_length);
+    }
+
+    if (_failed(r))
+    {
+        return lxqt_wallet_failed_to_create_key_hash;
+    }
+
+    if (_chunked_crypt(f, header + CHUNKED_HEADER_SIZE, MAGIC_STRING_BUFFER_SIZE, CHUNKED_HEADER_INDEX, 0, header, 0) !=
+            lxqt_wallet_no_error || !_password_match(header + CHUNKED_HEADER_SIZE))
+    {
+        memset(f->key, '\0', PASSWORD_SIZE);
+        return lxqt_wallet_wrong_password;
+    }
+
+    if (f->size == CHUNKED_UNKNOWN_SIZE)
+    {
+        f->chunk_count = CHUNKED_UNKNOWN_SIZE;
+    }
+    else
+    {
+        f->chunk_count = _chunked_chunk_count(f->size, f->chunk_size);
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * read the header of a seekable file and derive its key,"path" is used to look up the key in the key cache
+ */
+static lxqt_wallet_error _chunked_open(struct _chunked_file *f, int fd, const char *path,
+                                       const char *password, u_int32_t password_length)
+{
+    char header[ CHUNKED_DATA_OFFSET ];
+    u_int64_t data_size;
+    u_int64_t n;
+    struct stat st;
+    lxqt_wallet_error r;
+
+    if (_read_all(fd, header, CHUNKED_DATA_OFFSET, 0) != 0)
+    {
+        memset(f, '\0', sizeof(struct _chunked_file));
+        return lxqt_wallet_incompatible_wallet;
+    }
+
+    r = _chunked_open_header(f, header, path, password, password_length);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    if (f->size == CHUNKED_UNKNOWN_SIZE)
+    {
+        /*
+         * every chunk but the last one is full
+         */
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)(CHUNKED_DATA_OFFSET + CHUNKED_TAG_SIZE))
+        {
+            memset(f->key, '\0', PASSWORD_SIZE);
+            return lxqt_wallet_authentication_failed;
+        }
+
+        data_size = (u_int64_t)st.st_size - CHUNKED_DATA_OFFSET;
+        n = data_size % (f->chunk_size + CHUNKED_TAG_SIZE);
+
+        if (n > 0 && n < CHUNKED_TAG_SIZE)
+        {
+            memset(f->key, '\0', PASSWORD_SIZE);
+            return lxqt_wallet_authentication_failed;
+        }
+
+        f->size = data_size / (f->chunk_size + CHUNKED_TAG_SIZE) * f->chunk_size;
+
+        if (n > 0)
+        {
+            f->size += n - CHUNKED_TAG_SIZE;
+        }
+    }
+
+    f->chunk_count = _chunked_chunk_count(f->size, f->chunk_size);
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * set up a pipeline that streams a seekable file,chunks per buffer follow the size of pipeline buffers
+ */
+static void _chunked_pipeline(struct _file_pipeline *p, const struct _chunked_file *f, int fd_src, int fd_dest,
+                              int encrypt)
+{
+    u_int64_t chunks = _file_pipeline_buffer_size / f->chunk_size;
+    u_int64_t cipher_size = f->size + f->chunk_count * CHUNKED_TAG_SIZE;
+
+    if (chunks == 0)
+    {
+        chunks = 1;
+    }
+    if (chunks > f->chunk_count)
+    {
+        chunks = f->chunk_count;
+    }
+
+    memset(p, '\0', sizeof(struct _file_pipeline));
+
+    p->fd_src      = fd_src;
+    p->fd_dest     = fd_dest;
+    p->file        = f;
+    p->buffer_size = chunks * (f->chunk_size + CHUNKED_TAG_SIZE);
+
+    if (encrypt)
+    {
+        p->transform    = _chunked_encrypt_buffer;
+        p->read_size    = f->size;
+        p->write_size   = cipher_size;
+        p->read_stride  = chunks * f->chunk_size;
+        p->write_stride = p->buffer_size;
+    }
+    else
+    {
+        p->transform    = _chunked_decrypt_buffer;
+        p->read_size    = cipher_size;
+        p->write_size   = f->size;
+        p->read_stride  = p->buffer_size;
+        p->write_stride = chunks * f->chunk_size;
+    }
+}
+
+lxqt_wallet_error lxqt_wallet_create_seekable_encrypted_file(const char *password, u_int32_t password_length,
+        const char *source, const char *destination, int(*function)(int, void *), void *v)
+{
+    struct _chunked_file f;
+    struct _file_pipeline p;
+    char header[ CHUNKED_DATA_OFFSET ];
+    char tag[ CHUNKED_TAG_SIZE ];
+    lxqt_wallet_error r;
+    struct stat st;
+    int fd_src;
+    int fd_dest;
+
+    if (password == NULL || source == NULL || destination == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    if (stat(destination, &st) == 0)
+    {
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    fd_src = open(source, O_RDONLY | O_CLOEXEC);
+
+    if (fd_src == -1)
+    {
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    fstat(fd_src, &st);
+
+    r = _chunked_create(&f, header, password, password_length, (u_int64_t)st.st_size);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        memset(&f, '\0', sizeof(f));
+        close(fd_src);
+        return r;
+    }
+
+    fd_dest = open(destination, O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+
+    if (fd_dest == -1)
+    {
+        memset(&f, '\0', sizeof(f));
+        close(fd_src);
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    if (_write_all(fd_dest, header, CHUNKED_DATA_OFFSET) != 0)
+    {
+        r = lxqt_wallet_failed_to_open_file;
+    }
+    else if (f.size == 0)
+    {
+        r = _chunked_crypt(&f, tag, 0, 0, 1, NULL, 1);
+
+        if (r == lxqt_wallet_no_error && _write_all(fd_dest, tag, CHUNKED_TAG_SIZE) != 0)
+        {
+            r = lxqt_wallet_failed_to_open_file;
+        }
+    }
+    else
+    {
+        _chunked_pipeline(&p, &f, fd_src, fd_dest, 1);
+
+        r = _file_pipeline_run(&p, function, NULL, v);
+    }
+
+    function(100, v);
+
+    memset(&f, '\0', sizeof(f));
+
+    close(fd_src);
+    close(fd_dest);
+
+    return r;
+}
+
+/*
+ * decrypted files are written to a temporary file next to "destination" that gets its name only once all of it was
+ * decrypted and authenticated,a failure removes the temporary file and leaves no partial plaintext behind.
+ */
+static int _open_decrypted_file(char *path, size_t path_size, const char *destination)
+{
+    if ((size_t)snprintf(path, path_size, "%s.XXXXXX", destination) >= path_size)
+    {
+        return -1;
+    }
+    else
+    {
+        return mkostemp(path, O_CLOEXEC);
+    }
+}
+
+static lxqt_wallet_error _close_decrypted_file(lxqt_wallet_error r, int fd, const char *path, const char *destination)
+{
+    if (r == lxqt_wallet_no_error && (fsync(fd) != 0 || close(fd) != 0))
+    {
+        r = lxqt_wallet_failed_to_open_file;
+    }
+    else if (r != lxqt_wallet_no_error)
+    {
+        close(fd);
+    }
+
+    if (r == lxqt_wallet_no_error && rename(path, destination) != 0)
+    {
+        r = lxqt_wallet_failed_to_open_file;
+    }
+
+    if (r != lxqt_wallet_no_error)
+    {
+        unlink(path);
+    }
+
+    return r;
+}
+
+static lxqt_wallet_error _create_decrypted_file_chunked(const char *password, u_int32_t password_length,
+        int fd_src, const char *source, const char *destination, int(*function)(int, void *), void *v)
+{
+    struct _chunked_file f;
+    struct _file_pipeline p;
+    char tag[ CHUNKED_TAG_SIZE ];
+    char path[ PATH_MAX ];
+    lxqt_wallet_error r;
+    int fd_dest;
+
+    r = _chunked_open(&f, fd_src, source, password, password_length);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    fd_dest = _open_decrypted_file(path, sizeof(path), destination);
+
+    if (fd_dest == -1)
+    {
+        memset(&f, '\0', sizeof(f));
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    if (f.size == 0)
+    {
+        if (_read_all(fd_src, tag, CHUNKED_TAG_SIZE, CHUNKED_DATA_OFFSET) != 0)
+        {
+            r = lxqt_wallet_authentication_failed;
+        }
+        else
+        {
+            r = _chunked_crypt(&f, tag, 0, 0, 1, NULL, 0);
+        }
+    }
+    else
+    {
+        lseek(fd_src, CHUNKED_DATA_OFFSET, SEEK_SET);
+
+        _chunked_pipeline(&p, &f, fd_src, fd_dest, 0);
+
+        r = _file_pipeline_run(&p, function, NULL, v);
+    }
+
+    function(100, v);
+
+    memset(&f, '\0', sizeof(f));
+
+    return _close_decrypted_file(r, fd_dest, path, destination);
+}
+
+/*
+ * Chunks that hold the range are read and decrypted in batches of at most RANGE_BATCH_SIZE bytes through one locked
+ * buffer,chunks in a batch are decrypted in parallel.
+ */
+static lxqt_wallet_error _chunked_decrypt_range(const struct _chunked_file *f, int fd, u_int64_t offset,
+        u_int64_t length, char *buffer)
+{
+    u_int64_t stride = f->chunk_size + CHUNKED_TAG_SIZE;
+    u_int64_t first = offset / f->chunk_size;
+    u_int64_t last = (offset + length - 1) / f->chunk_size;
+    u_int64_t batch = RANGE_BATCH_SIZE / stride;
+    u_int64_t batch_first;
+    u_int64_t batch_last;
+    u_int64_t size;
+    u_int64_t i;
+    u_int64_t start;
+    u_int64_t end;
+    lxqt_wallet_error r = lxqt_wallet_no_error;
+    char *data;
+    char *e = buffer;
+
+    if (batch == 0)
+    {
+        batch = 1;
+    }
+
+    if (batch > last - first + 1)
+    {
+        batch = last - first + 1;
+    }
+
+    data = calloc(batch, stride);
+
+    if (data == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    mlock(data, batch * stride);
+
+    for (batch_first = first; batch_first <= last && r == lxqt_wallet_no_error; batch_first += batch)
+    {
+        batch_last = batch_first + batch - 1 < last ? batch_first + batch - 1 : last;
+
+        size = (batch_last - batch_first) * stride + _chunked_chunk_size(f, batch_last) + CHUNKED_TAG_SIZE;
+
+        if (_read_all(fd, data, size, (off_t)(CHUNKED_DATA_OFFSET + batch_first * stride)) != 0)
+        {
+            r = lxqt_wallet_authentication_failed;
+            break;
+        }
+
+        r = _chunked_run(f, data, batch_first, batch_last - batch_first + 1, _chunked_chunk_size(f, batch_last),
+                         batch_last == f->chunk_count - 1, 0);
+
+        for (i = batch_first; i <= batch_last && r == lxqt_wallet_no_error; i++)
+        {
+            start = i == first ? offset - first * f->chunk_size : 0;
+            end   = i == last ? offset + length - last * f->chunk_size : f->chunk_size;
+
+            memcpy(e, data + (i - batch_first) * stride + start, end - start);
+
+            e += end - start;
+        }
+    }
+
+    /*
+     * the caller gets nothing back from a range that failed to authenticate
+     */
+    if (r != lxqt_wallet_no_error)
+    {
+        memset(buffer, '\0', e - buffer);
+    }
+
+    memset(data, '\0', batch * stride);
+    munlock(data, batch * stride);
+    free(data);
+
+    return r;
+}
+
+/*
+ * files created by lxqt_wallet_create_encrypted_file() are in CBC mode and any block can be decrypted
+ * with the help of the block before it.Blocks are read and decrypted in batches of RANGE_BATCH_SIZE bytes.
+ *
+ * The format has no authentication tags and the plain text returned by this function is hence not
+ * authenticated,a modified file decrypts to garbage instead of failing.
+ */
+static lxqt_wallet_error _cbc_decrypt_range(const char *password, u_int32_t password_length, int fd,
+        const char *source, u_int64_t offset, u_int64_t *length, char *buffer)
+{
+    char header[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ];
+    struct lxqt_wallet_struct w;
+    gcry_cipher_hd_t handle = 0;
+    lxqt_wallet_error r;
+    u_int64_t first;
+    u_int64_t last;
+    u_int64_t block;
+    u_int64_t count;
+    u_int64_t batch = RANGE_BATCH_SIZE / BLOCK_SIZE;
+    u_int64_t start;
+    u_int64_t end;
+    char *data;
+
+    memset(&w, '\0', sizeof(w));
+
+    r = _lxqt_wallet_open_0(&handle, &w, password, password_length, fd, header, source);
+
+    if (_failed(r) || !_password_match(header) || !_wallet_is_compatible(header))
+    {
+        r = _failed(r) ? lxqt_wallet_failed_to_open_file : lxqt_wallet_wrong_password;
+    }
+    else if (_load_flags(header) & LOAD_FLAG_COMPRESSED)
+    {
+        /*
+         * a compressed file has to be decompressed from its beginning
+         */
+        r = lxqt_wallet_incompatible_wallet;
+    }
+    else
+    {
+        _get_load_information(&w, header);
+
+        if (offset >= w.wallet_data_size)
+        {
+            *length = 0;
+        }
+        else if (*length > w.wallet_data_size - offset)
+        {
+            *length = w.wallet_data_size - offset;
+        }
+    }
+
+    if (r == lxqt_wallet_no_error && *length > 0)
+    {
+        first = offset / BLOCK_SIZE;
+        last  = (offset + *length - 1) / BLOCK_SIZE;
+
+        if (batch > last - first + 1)
+        {
+            batch = last - first + 1;
+        }
+
+        /*
+         * each batch is read with the block before it,it is the IV of the first block of the batch
+         */
+        data = malloc((batch + 1) * BLOCK_SIZE);
+
+        if (data == NULL)
+        {
+            r = lxqt_wallet_failed_to_allocate_memory;
+        }
+        else
+        {
+            mlock(data, (batch + 1) * BLOCK_SIZE);
+
+            for (block = first; block <= last && r == lxqt_wallet_no_error; block += count)
+            {
+                count = last - block + 1 < batch ? last - block + 1 : batch;
+
+                /*
+                 * the block before block 0 is the last block of the header
+                 */
+                if (_read_all(fd, data, (count + 1) * BLOCK_SIZE,
+                              (off_t)(SALT_SIZE + IV_SIZE + MAGIC_STRING_BUFFER_SIZE + block * BLOCK_SIZE)) != 0)
+                {
+                    r = lxqt_wallet_failed_to_open_file;
+                }
+                else if (_failed(gcry_cipher_setiv(handle, data, BLOCK_SIZE)) ||
+                         _failed(gcry_cipher_decrypt(handle, data + BLOCK_SIZE, count * BLOCK_SIZE, NULL, 0)))
+                {
+                    r = lxqt_wallet_gcry_cipher_decrypt_failed;
+                }
+                else
+                {
+                    start = block == first ? offset - first * BLOCK_SIZE : 0;
+                    end   = block + count - 1 == last ? offset + *length - last * BLOCK_SIZE : BLOCK_SIZE;
+                    end  += (count - 1) * BLOCK_SIZE;
+
+                    memcpy(buffer, data + BLOCK_SIZE + start, end - start);
+
+                    buffer += end - start;
+                }
+            }
+
+            memset(data, '\0', (batch + 1) * BLOCK_SIZE);
+            munlock(data, (batch + 1) * BLOCK_SIZE);
+            free(data);
+        }
+    }
+
+    if (handle != 0)
+    {
+        gcry_cipher_close(handle);
+    }
+
+    memset(&w, '\0', sizeof(w));
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_decrypt_range(const char *password, u_int32_t password_length, const char *source,
+        u_int64_t offset, u_int64_t length, char *buffer, u_int64_t *buffer_size)
+{
+    struct _chunked_file f;
+    lxqt_wallet_error r;
+    int fd;
+
+    if (password == NULL || source == NULL || buffer_size == NULL || (buffer == NULL && length > 0))
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    *buffer_size = 0;
+
+    fd = open(source, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1)
+    {
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    if (!_is_chunked_file(fd))
+    {
+        r = _cbc_decrypt_range(password, password_length, fd, source, offset, &length, buffer);
+
+        if (r == lxqt_wallet_no_error)
+        {
+            *buffer_size = length;
+        }
+
+        close(fd);
+
+        return r;
+    }
+
+    r = _chunked_open(&f, fd, source, password, password_length);
+
+    if (r == lxqt_wallet_no_error && offset < f.size && length > 0)
+    {
+        if (length > f.size - offset)
+        {
+            length = f.size - offset;
+        }
+
+        r = _chunked_decrypt_range(&f, fd, offset, length, buffer);
+
+        if (r == lxqt_wallet_no_error)
+        {
+            *buffer_size = length;
+        }
+    }
+
+    memset(&f, '\0', sizeof(f));
+
+    close(fd);
+
+    return r;
+}
+
+/*
+ * set up a pipeline that streams a seekable file of unknown size between two file descriptors
+ */
+static void _chunked_stream_pipeline(struct _file_pipeline *p, const struct _chunked_file *f, int fd_src,
+                                     int fd_dest, int encrypt)
+{
+    u_int64_t chunks = _file_pipeline_buffer_size / f->chunk_size;
+
+    if (chunks == 0)
+    {
+        chunks = 1;
+    }
+
+    memset(p, '\0', sizeof(struct _file_pipeline));
+
+    p->fd_src      = fd_src;
+    p->fd_dest     = fd_dest;
+    p->file        = f;
+    p->read_size   = FILE_SIZE_UNKNOWN;
+    p->write_size  = FILE_SIZE_UNKNOWN;
+    p->buffer_size = chunks * (f->chunk_size + CHUNKED_TAG_SIZE);
+
+    if (encrypt)
+    {
+        p->transform    = _chunked_encrypt_buffer;
+        p->read_stride  = chunks * f->chunk_size;
+        p->write_stride = p->buffer_size;
+    }
+    else
+    {
+        p->transform    = _chunked_decrypt_buffer;
+        p->read_stride  = p->buffer_size;
+        p->write_stride = chunks * f->chunk_size;
+    }
+}
+
+lxqt_wallet_error lxqt_wallet_encrypt_stream(const char *password, u_int32_t password_length, int fd_src,
+        int fd_dest, int(*function)(u_int64_t, void *), void *v)
+{
+    struct _chunked_file f;
+    struct _file_pipeline p;
+    char header[ CHUNKED_DATA_OFFSET ];
+    lxqt_wallet_error r;
+
+    if (password == NULL || fd_src < 0 || fd_dest < 0)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    r = _chunked_create(&f, header, password, password_length, CHUNKED_UNKNOWN_SIZE);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        if (_write_all(fd_dest, header, CHUNKED_DATA_OFFSET) != 0)
+        {
+            r = lxqt_wallet_failed_to_open_file;
+        }
+        else
+        {
+            _chunked_stream_pipeline(&p, &f, fd_src, fd_dest, 1);
+
+            r = _file_pipeline_run(&p, NULL, function, v);
+        }
+    }
+
+    memset(&f, '\0', sizeof(f));
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_encrypt_buffer(const char *password, u_int32_t password_length, const char *buffer,
+        u_int64_t size, int fd_dest)
+{
+    struct _chunked_file f;
+    char header[ CHUNKED_DATA_OFFSET ];
+    u_int64_t batch = _file_pipeline_buffer_size / CHUNKED_CHUNK_SIZE;
+    u_int64_t stride = CHUNKED_CHUNK_SIZE + CHUNKED_TAG_SIZE;
+    u_int64_t chunk;
+    u_int64_t count;
+    u_int64_t last_size = 0;
+    u_int64_t i;
+    lxqt_wallet_error r;
+    char *data = NULL;
+
+    if (password == NULL || fd_dest < 0 || (buffer == NULL && size > 0))
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    r = _chunked_create(&f, header, password, password_length, size);
+
+    if (batch == 0)
+    {
+        batch = 1;
+    }
+
+    if (batch > f.chunk_count)
+    {
+        batch = f.chunk_count;
+    }
+
+    if (r == lxqt_wallet_no_error)
+    {
+        /*
+         * a few chunks at a time are copied out of the buffer with room for their tags and encrypted in parallel
+         */
+        data = calloc(batch, stride);
+
+        if (data == NULL)
+        {
+            r = lxqt_wallet_failed_to_allocate_memory;
+        }
+        else if (_write_all(fd_dest, header, CHUNKED_DATA_OFFSET) != 0)
+        {
+            r = lxqt_wallet_failed_to_open_file;
+        }
+        else
+        {
+            mlock(data, batch * stride);
+        }
+    }
+
+    for (chunk = 0; r == lxqt_wallet_no_error && chunk < f.chunk_count; chunk += count)
+    {
+        count = f.chunk_count - chunk < batch ? f.chunk_count - chunk : batch;
+
+        for (i = 0; i < count; i++)
+        {
+            last_size = _chunked_chunk_size(&f, chunk + i);
+
+            if (last_size > 0)
+            {
+                memcpy(data + i * stride, buffer + (chunk + i) * f.chunk_size, last_size);
+            }
+        }
+
+        r = _chunked_run(&f, data, chunk, count, last_size, chunk + count == f.chunk_count, 1);
+
+        if (r == lxqt_wallet_no_error &&
+            _write_all(fd_dest, data, (count - 1) * stride + last_size + CHUNKED_TAG_SIZE) != 0)
+        {
+            r = lxqt_wallet_failed_to_open_file;
+        }
+    }
+
+    if (data != NULL)
+    {
+        memset(data, '\0', batch * stride);
+        munlock(data, batch * stride);
+        free(data);
+    }
+
+    memset(&f, '\0', sizeof(f));
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_decrypt_stream(const char *password, u_int32_t password_length, int fd_src,
+        int fd_dest, int(*function)(u_int64_t, void *), void *v)
+{
+    struct _chunked_file f;
+    struct _file_pipeline p;
+    char header[ CHUNKED_DATA_OFFSET ];
+    lxqt_wallet_error r;
+
+    if (password == NULL || fd_src < 0 || fd_dest < 0)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    if (_file_pipeline_read(fd_src, header, CHUNKED_DATA_OFFSET) != CHUNKED_DATA_OFFSET)
+    {
+        return lxqt_wallet_incompatible_wallet;
+    }
+
+    r = _chunked_open_header(&f, header, NULL, password, password_length);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        _chunked_stream_pipeline(&p, &f, fd_src, fd_dest, 0);
+
+        r = _file_pipeline_run(&p, NULL, function, v);
+    }
+
+    memset(&f, '\0', sizeof(f));
+
+    return r;
+}
+
+/*
+ * zlib keeps copies of the data it works on in its own allocations,they are locked and wiped like our buffers
+ */
+#define ZLIB_ALLOCATION_HEADER_SIZE 16
+
+static voidpf _zlib_alloc(voidpf opaque, uInt items, uInt size)
+{
+    u_int64_t n = (u_int64_t)items * size + ZLIB_ALLOCATION_HEADER_SIZE;
+    char *e = malloc(n);
+
+    (void)opaque;
+
+    if (e == NULL)
+    {
+        return Z_NULL;
+    }
+
+    mlock(e, n);
+    memcpy(e, &n, sizeof(u_int64_t));
+
+    return e + ZLIB_ALLOCATION_HEADER_SIZE;
+}
+
+static void _zlib_free(voidpf opaque, voidpf address)
+{
+    char *e = (char *)address - ZLIB_ALLOCATION_HEADER_SIZE;
+    u_int64_t n;
+
+    (void)opaque;
+
+    memcpy(&n, e, sizeof(u_int64_t));
+    memset(e, '\0', n);
+    munlock(e, n);
+    free(e);
+}
+
+static void _zlib_init(z_stream *z)
+{
+    memset(z, '\0', sizeof(z_stream));
+
+    z->zalloc = _zlib_alloc;
+    z->zfree  = _zlib_free;
+}
+
+/*
+ * zlib counts sizes of a single step in uInt
+ */
+static uInt _zlib_step(u_int64_t size)
+{
+    return size > ( 1u << 30 ) ? ( 1u << 30 ) : (uInt)size;
+}
+
+static char *_locked_buffer(u_int64_t size)
+{
+    char *e = malloc(size);
+
+    if (e != NULL)
+    {
+        memset(e, '\0', size);
+        mlock(e, size);
+    }
+
+    return e;
+}
+
+static void _free_locked_buffer(char *e, u_int64_t size)
+{
+    if (e != NULL)
+    {
+        memset(e, '\0', size);
+        munlock(e, size);
+        free(e);
+    }
+}
+
+/*
+ * FNV-1a hash of a key for tables of keys kept in memory
+ */
+static u_int64_t _key_hash(const char *key, u_int32_t key_size)
+{
+    u_int64_t h = 14695981039346656037ULL;
+    u_int32_t i;
+
+    for (i = 0; i < key_size; i++)
+    {
+        h ^= (unsigned char)key[ i ];
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+/*
+ * make locked buffer "buffer" of "*capacity" bytes that holds "size" bytes large enough for "needed" bytes,it at
+ * least doubles when it grows and the memory it is moved out of is wiped.A NULL buffer is always allocated so that
+ * arenas of a wallet with entries exist even if they are empty.Returns 0 on success
+ */
+static int _grow_locked_buffer(char **buffer, u_int64_t *capacity, u_int64_t size, u_int64_t needed)
+{
+    u_int64_t n;
+    char *e;
+
+    if (needed <= *capacity && *buffer != NULL)
+    {
+        return 0;
+    }
+
+    n = *capacity < 64 ? 64 : *capacity * 2;
+
+    if (n < needed)
+    {
+        n = needed;
+    }
+
+    e = _locked_buffer(n);
+
+    if (e == NULL)
+    {
+        return 1;
+    }
+
+    if (size > 0)
+    {
+        memcpy(e, *buffer, size);
+    }
+
+    _free_locked_buffer(*buffer, *capacity);
+
+    *buffer   = e;
+    *capacity = n;
+
+    return 0;
+}
+
+static void _entries_free(struct lxqt_wallet_struct *w)
+{
+    if (w->entries != NULL)
+    {
+        memset(w->entries, '\0', w->entries_capacity * sizeof(struct _entry_header));
+        free(w->entries);
+    }
+
+    free(w->key_slots);
+
+    _free_locked_buffer(w->key_data, w->key_data_capacity);
+    _free_locked_buffer(w->value_data, w->value_data_capacity);
+
+    w->entries                 = NULL;
+    w->entries_capacity        = 0;
+    w->key_data                = NULL;
+    w->key_data_size           = 0;
+    w->key_data_capacity       = 0;
+    w->value_data              = NULL;
+    w->value_data_size         = 0;
+    w->value_data_capacity     = 0;
+    w->key_slots               = NULL;
+    w->key_slots_capacity      = 0;
+    w->wallet_data_size        = 0;
+    w->wallet_data_entry_count = 0;
+}
+
+/*
+ * hand the entries of "from" over to "to",entries "to" had are freed
+ */
+static void _entries_move(struct lxqt_wallet_struct *to, struct lxqt_wallet_struct *from)
+{
+    _entries_free(to);
+
+    to->entries                 = from->entries;
+    to->entries_capacity        = from->entries_capacity;
+    to->key_data                = from->key_data;
+    to->key_data_size           = from->key_data_size;
+    to->key_data_capacity       = from->key_data_capacity;
+    to->value_data              = from->value_data;
+    to->value_data_size         = from->value_data_size;
+    to->value_data_capacity     = from->value_data_capacity;
+    to->key_slots               = from->key_slots;
+    to->key_slots_capacity      = from->key_slots_capacity;
+    to->wallet_data_size        = from->wallet_data_size;
+    to->wallet_data_entry_count = from->wallet_data_entry_count;
+
+    from->entries    = NULL;
+    from->key_data   = NULL;
+    from->value_data = NULL;
+    from->key_slots  = NULL;
+
+    _entries_free(from);
+}
+
+static u_int64_t _key_index_home(const struct lxqt_wallet_struct *w, u_int64_t index)
+{
+    return w->entries[ index ].hash & (w->key_slots_capacity - 1);
+}
+
+/*
+ * put header "index" in the hash table,the table has a free slot
+ */
+static void _key_index_insert(struct lxqt_wallet_struct *w, u_int64_t index)
+{
+    u_int64_t mask = w->key_slots_capacity - 1;
+    u_int64_t s = _key_index_home(w, index);
+
+    while (w->key_slots[ s ] != 0)
+    {
+        s = (s + 1) & mask;
+    }
+
+    w->key_slots[ s ] = index + 1;
+}
+
+/*
+ * make the hash table large enough for "count" keys and put headers of counted entries in it,returns 0 on success.
+ * Slots are found through hashes kept in the headers and keys are not read.
+ */
+static int _key_index_rehash(struct lxqt_wallet_struct *w, u_int64_t count)
+{
+    u_int64_t capacity = 16;
+    u_int64_t *e;
+    u_int64_t i;
+
+    while (capacity < 2 * count)
+    {
+        capacity *= 2;
+    }
+
+    if (w->key_slots != NULL && capacity <= w->key_slots_capacity)
+    {
+        return 0;
+    }
+
+    e = calloc(capacity, sizeof(u_int64_t));
+
+    if (e == NULL)
+    {
+        return 1;
+    }
+
+    free(w->key_slots);
+
+    w->key_slots          = e;
+    w->key_slots_capacity = capacity;
+
+    for (i = 0; i < w->wallet_data_entry_count; i++)
+    {
+        _key_index_insert(w, i);
+    }
+
+    return 0;
+}
+
+/*
+ * make room for "count" more entries whose keys add up to "key_size" bytes and whose values add up to "value_size"
+ * bytes,nothing changes if memory runs out
+ */
+static lxqt_wallet_error _entries_reserve(struct lxqt_wallet_struct *w, u_int64_t count, u_int64_t key_size,
+                                          u_int64_t value_size)
+{
+    struct _entry_header *e;
+    u_int64_t capacity;
+
+    if (w->wallet_data_entry_count + count > w->entries_capacity)
+    {
+        capacity = w->entries_capacity < 16 ? 16 : w->entries_capacity * 2;
+
+        if (capacity < w->wallet_data_entry_count + count)
+        {
+            capacity = w->wallet_data_entry_count + count;
+        }
+
+        e = realloc(w->entries, capacity * sizeof(struct _entry_header));
+
+        if (e == NULL)
+        {
+            return lxqt_wallet_failed_to_allocate_memory;
+        }
+
+        w->entries          = e;
+        w->entries_capacity = capacity;
+    }
+
+    if (_grow_locked_buffer(&w->key_data, &w->key_data_capacity, w->key_data_size,
+                            w->key_data_size + key_size) != 0 ||
+            _grow_locked_buffer(&w->value_data, &w->value_data_capacity, w->value_data_size,
+                                w->value_data_size + value_size) != 0 ||
+            _key_index_rehash(w, w->wallet_data_entry_count + count) != 0)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * add an entry to the end of the wallet,room for it was made with _entries_reserve() and "hash" is _key_hash() of
+ * "key"
+ */
+static void _entries_append(struct lxqt_wallet_struct *w, const char *key, u_int32_t key_size, const char *value,
+                            u_int32_t value_size, u_int64_t hash)
+{
+    struct _entry_header *h = w->entries + w->wallet_data_entry_count;
+
+    h->key        = w->key_data_size;
+    h->value      = w->value_data_size;
+    h->hash       = hash;
+    h->key_size   = key_size;
+    h->value_size = value_size;
+
+    memcpy(w->key_data + w->key_data_size, key, key_size);
+
+    if (value_size > 0)
+    {
+        memcpy(w->value_data + w->value_data_size, value, value_size);
+    }
+
+    _key_index_insert(w, w->wallet_data_entry_count);
+
+    w->key_data_size   += key_size;
+    w->value_data_size += value_size;
+    w->wallet_data_size += NODE_HEADER_SIZE + (u_int64_t)key_size + value_size;
+    w->wallet_data_entry_count++;
+}
+
+static int64_t _entries_find(const struct lxqt_wallet_struct *w, const char *key, u_int32_t key_size)
+{
+    const struct _entry_header *h;
+    u_int64_t mask = w->key_slots_capacity - 1;
+    u_int64_t hash;
+    u_int64_t s;
+    u_int64_t e;
+
+    if (w->key_slots == NULL)
+    {
+        return -1;
+    }
+
+    hash = _key_hash(key, key_size);
+
+    for (s = hash & mask; (e = w->key_slots[ s ]) != 0; s = (s + 1) & mask)
+    {
+        h = w->entries + e - 1;
+
+        if (h->hash == hash && h->key_size == key_size && memcmp(w->key_data + h->key, key, key_size) == 0)
+        {
+            return (int64_t)(e - 1);
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * take entry "index" out of the wallet,keys and values after it move down in their arenas and headers after it
+ * move down by one and are renumbered in the hash table
+ */
+static void _entries_remove(struct lxqt_wallet_struct *w, u_int64_t index)
+{
+    struct _entry_header *h = w->entries + index;
+    u_int64_t key = h->key;
+    u_int64_t value = h->value;
+    u_int32_t key_size = h->key_size;
+    u_int32_t value_size = h->value_size;
+    u_int64_t mask = w->key_slots_capacity - 1;
+    u_int64_t s = _key_index_home(w, index);
+    u_int64_t j;
+    u_int64_t k;
+    u_int64_t i;
+
+    while (w->key_slots[ s ] != index + 1)
+    {
+        s = (s + 1) & mask;
+    }
+
+    /*
+     * close the gap by moving back keys further along the run that may live in it,a key stays where it is if its
+     * home slot is after the gap and not after the key
+     */
+    for (j = (s + 1) & mask; w->key_slots[ j ] != 0; j = (j + 1) & mask)
+    {
+        k = _key_index_home(w, w->key_slots[ j ] - 1);
+
+        if (s <= j ? (s < k && k <= j) : (s < k || k <= j))
+        {
+            continue;
+        }
+
+        w->key_slots[ s ] = w->key_slots[ j ];
+        s = j;
+    }
+
+    w->key_slots[ s ] = 0;
+
+    for (i = index + 1; i < w->wallet_data_entry_count; i++)
+    {
+        for (s = _key_index_home(w, i); w->key_slots[ s ] != i + 1; s = (s + 1) & mask)
+        {
+            ;
+        }
+
+        w->key_slots[ s ] = i;
+
+        w->entries[ i ].key   -= key_size;
+        w->entries[ i ].value -= value_size;
+    }
+
+    memmove(h, h + 1, (w->wallet_data_entry_count - index - 1) * sizeof(struct _entry_header));
+    memset(w->entries + w->wallet_data_entry_count - 1, '\0', sizeof(struct _entry_header));
+
+    memmove(w->key_data + key, w->key_data + key + key_size, w->key_data_size - key - key_size);
+    memset(w->key_data + w->key_data_size - key_size, '\0', key_size);
+
+    memmove(w->value_data + value, w->value_data + value + value_size, w->value_data_size - value - value_size);
+    memset(w->value_data + w->value_data_size - value_size, '\0', value_size);
+
+    w->key_data_size   -= key_size;
+    w->value_data_size -= value_size;
+    w->wallet_data_size -= NODE_HEADER_SIZE + (u_int64_t)key_size + value_size;
+    w->wallet_data_entry_count--;
+}
+
+static void _entries_entry(const struct lxqt_wallet_struct *w, u_int64_t index, lxqt_wallet_key_values_t *key_value)
+{
+    const struct _entry_header *h = w->entries + index;
+
+    key_value->key            = w->key_data + h->key;
+    key_value->key_size       = h->key_size;
+    key_value->key_value      = w->value_data + h->value;
+    key_value->key_value_size = h->value_size;
+}
+
+/*
+ * split a load of "size" bytes into entries of "w",which has none,nodes that do not fit in the load are dropped
+ */
+static lxqt_wallet_error _entries_load(struct lxqt_wallet_struct *w, const char *load, u_int64_t size)
+{
+    u_int64_t key_size = 0;
+    u_int64_t value_size = 0;
+    u_int64_t count = 0;
+    u_int64_t end;
+    u_int64_t i;
+    u_int32_t key_len;
+    u_int32_t key_value_len;
+
+    for (i = 0; size - i >= NODE_HEADER_SIZE; i += NODE_HEADER_SIZE + (u_int64_t)key_len + key_value_len)
+    {
+        _get_header_components(&key_len, &key_value_len, load + i);
+
+        if ((u_int64_t)key_len + key_value_len > size - i - NODE_HEADER_SIZE)
+        {
+            break;
+        }
+
+        key_size   += key_len;
+        value_size += key_value_len;
+        count++;
+    }
+
+    end = i;
+
+    if (_entries_reserve(w, count, key_size, value_size) != lxqt_wallet_no_error)
+    {
+        _entries_free(w);
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    for (i = 0; i < end; i += NODE_HEADER_SIZE + (u_int64_t)key_len + key_value_len)
+    {
+        _get_header_components(&key_len, &key_value_len, load + i);
+
+        _entries_append(w, load + i + NODE_HEADER_SIZE, key_len, load + i + NODE_HEADER_SIZE + key_len,
+                        key_value_len, _key_hash(load + i + NODE_HEADER_SIZE, key_len));
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * put the load of the wallet file together from the entries,"buffer" holds "wallet_data_size" bytes
+ */
+static void _entries_store(const struct lxqt_wallet_struct *w, char *buffer)
+{
+    const struct _entry_header *h;
+    u_int64_t i;
+
+    for (i = 0; i < w->wallet_data_entry_count; i++)
+    {
+        h = w->entries + i;
+
+        memcpy(buffer, &h->key_size, sizeof(u_int32_t));
+        memcpy(buffer + sizeof(u_int32_t), &h->value_size, sizeof(u_int32_t));
+        memcpy(buffer + NODE_HEADER_SIZE, w->key_data + h->key, h->key_size);
+        memcpy(buffer + NODE_HEADER_SIZE + h->key_size, w->value_data + h->value, h->value_size);
+
+        buffer += NODE_HEADER_SIZE + (u_int64_t)h->key_size + h->value_size;
+    }
+}
+
+/*
+ * compress a wallet load into a locked buffer whose size is a multiple of 32,"out_size" is the size of the buffer
+ * and "compressed_size" is the size of the compressed data in it.
+ * Returns 1 if compression failed or did not make the load smaller.
+ */
+static int _compress_load(const char *data, u_int64_t size, char **out, u_int64_t *out_size,
+                          u_int64_t *compressed_size)
+{
+    z_stream z;
+    u_int64_t n;
+    char *e;
+    int r;
+
+    _zlib_init(&z);
+
+    if (deflateInit(&z, Z_DEFAULT_COMPRESSION) != Z_OK)
+    {
+        return 1;
+    }
+
+    n = deflateBound(&z, size);
+    n = (n + 31) / 32 * 32;
+
+    e = _locked_buffer(n);
+
+    if (e == NULL)
+    {
+        deflateEnd(&z);
+        return 1;
+    }
+
+    do
+    {
+        z.next_in   = (Bytef *)data + z.total_in;
+        z.avail_in  = _zlib_step(size - z.total_in);
+        z.next_out  = (Bytef *)e + z.total_out;
+        z.avail_out = _zlib_step(n - z.total_out);
+
+        r = deflate(&z, z.avail_in == size - z.total_in ? Z_FINISH : Z_NO_FLUSH);
+
+    } while (r == Z_OK);
+
+    deflateEnd(&z);
+
+    if (r != Z_STREAM_END || z.total_out >= size)
+    {
+        _free_locked_buffer(e, n);
+        return 1;
+    }
+
+    memset(e + z.total_out, '\0', n - z.total_out);
+
+    *out             = e;
+    *out_size        = n;
+    *compressed_size = z.total_out;
+
+    return 0;
+}
+
+/*
+ * inflate a compressed load of at most "size" bytes into "out" that must be filled exactly,returns 0 on success
+ */
+static int _decompress_load(const char *data, u_int64_t size, char *out, u_int64_t out_size)
+{
+    z_stream z;
+    int r;
+
+    _zlib_init(&z);
+
+    if (inflateInit(&z) != Z_OK)
+    {
+        return 1;
+    }
+
+    do
+    {
+        z.next_in   = (Bytef *)data + z.total_in;
+        z.avail_in  = _zlib_step(size - z.total_in);
+        z.next_out  = (Bytef *)out + z.total_out;
+        z.avail_out = _zlib_step(out_size - z.total_out);
+
+        r = inflate(&z, Z_NO_FLUSH);
+
+    } while (r == Z_OK);
+
+    inflateEnd(&z);
+
+    return r != Z_STREAM_END || z.total_out != out_size;
+}
+
+static int _send_all(int fd, const char *buffer, u_int64_t size)
+{
+    ssize_t n;
+
+    while (size > 0)
+    {
+        n = send(fd, buffer, size, MSG_NOSIGNAL);
+
+        if (n == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (n <= 0)
+        {
+            return 1;
+        }
+
+        buffer += n;
+        size   -= (u_int64_t)n;
+    }
+
+    return 0;
+}
+
+/*
+ * Compressed encrypted files are compressed or decompressed by a thread that sits in front of or behind the file
+ * pipeline and is connected to it through a unix socket.The pipeline encrypts or decrypts the zlib stream
+ * concurrently with the compression and reads the compressed stream until its end since its size is not known
+ * ahead of time.
+ *
+ * A decompressor that fails keeps reading until the end of the socket to not leave the writer of the pipeline
+ * blocked.
+ */
+struct _file_compressor
+{
+    int fd_file;
+    int fd_socket;
+    u_int64_t size;
+    u_int64_t done;
+    lxqt_wallet_error error;
+    int(*function)(int, void *);
+    void *arg;
+    int last_percent;
+    int cancelled;
+};
+
+static void *_file_compressor(void *arg)
+{
+    struct _file_compressor *c = arg;
+    char *in = _locked_buffer(COMPRESSION_BUFFER_SIZE);
+    char *out = _locked_buffer(COMPRESSION_BUFFER_SIZE);
+    u_int64_t size;
+    ssize_t n;
+    z_stream z;
+    int flush = Z_NO_FLUSH;
+    int r = Z_OK;
+
+    _zlib_init(&z);
+
+    if (in == NULL || out == NULL || deflateInit(&z, Z_DEFAULT_COMPRESSION) != Z_OK)
+    {
+        c->error = lxqt_wallet_failed_to_allocate_memory;
+        _free_locked_buffer(in, COMPRESSION_BUFFER_SIZE);
+        _free_locked_buffer(out, COMPRESSION_BUFFER_SIZE);
+        close(c->fd_socket);
+        return NULL;
+    }
+
+    while (r != Z_STREAM_END)
+    {
+        if (z.avail_in == 0 && flush == Z_NO_FLUSH)
+        {
+            size = c->size - c->done;
+
+            if (size > COMPRESSION_BUFFER_SIZE)
+            {
+                size = COMPRESSION_BUFFER_SIZE;
+            }
+
+            /*
+             * a short read means the file is shorter than it was when we started
+             */
+            n = _file_pipeline_read(c->fd_file, in, size);
+
+            if (n != (ssize_t)size)
+            {
+                c->error = lxqt_wallet_failed_to_open_file;
+                break;
+            }
+
+            __atomic_store_n(&c->done, c->done + size, __ATOMIC_RELAXED);
+
+            z.next_in  = (Bytef *)in;
+            z.avail_in = (uInt)size;
+
+            if (c->done == c->size)
+            {
+                flush = Z_FINISH;
+            }
+        }
+
+        z.next_out  = (Bytef *)out;
+        z.avail_out = COMPRESSION_BUFFER_SIZE;
+
+        r = deflate(&z, flush);
+
+        if (r != Z_OK && r != Z_STREAM_END && r != Z_BUF_ERROR)
+        {
+            c->error = lxqt_wallet_failed_to_allocate_memory;
+            break;
+        }
+
+        if (_send_all(c->fd_socket, out, COMPRESSION_BUFFER_SIZE - z.avail_out) != 0)
+        {
+            c->error = lxqt_wallet_failed_to_open_file;
+            break;
+        }
+    }
+
+    deflateEnd(&z);
+
+    _free_locked_buffer(in, COMPRESSION_BUFFER_SIZE);
+    _free_locked_buffer(out, COMPRESSION_BUFFER_SIZE);
+
+    close(c->fd_socket);
+
+    return NULL;
+}
+
+static void *_file_decompressor(void *arg)
+{
+    struct _file_compressor *c = arg;
+    char *in = _locked_buffer(COMPRESSION_BUFFER_SIZE);
+    char *out = _locked_buffer(COMPRESSION_BUFFER_SIZE);
+    char drain[ FILE_BLOCK_SIZE ];
+    int initialized = 0;
+    ssize_t n;
+    z_stream z;
+    int r = Z_OK;
+
+    _zlib_init(&z);
+
+    if (in == NULL || out == NULL || inflateInit(&z) != Z_OK)
+    {
+        c->error = lxqt_wallet_failed_to_allocate_memory;
+        r = Z_MEM_ERROR;
+    }
+    else
+    {
+        initialized = 1;
+    }
+
+    while (1)
+    {
+        if (r != Z_OK)
+        {
+            /*
+             * data after the end of the stream is padding
+             */
+            n = read(c->fd_socket, drain, sizeof(drain));
+        }
+        else
+        {
+            n = read(c->fd_socket, in, COMPRESSION_BUFFER_SIZE);
+        }
+
+        if (n == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (n <= 0)
+        {
+            break;
+        }
+        else if (r != Z_OK)
+        {
+            continue;
+        }
+
+        z.next_in  = (Bytef *)in;
+        z.avail_in = (uInt)n;
+
+        do
+        {
+            z.next_out  = (Bytef *)out;
+            z.avail_out = COMPRESSION_BUFFER_SIZE;
+
+            r = inflate(&z, Z_NO_FLUSH);
+
+            if (r == Z_BUF_ERROR)
+            {
+                /*
+                 * more input is needed
+                 */
+                r = Z_OK;
+                break;
+            }
+            else if (r != Z_OK && r != Z_STREAM_END)
+            {
+                c->error = lxqt_wallet_gcry_cipher_decrypt_failed;
+            }
+            else if (z.total_out > c->size)
+            {
+                c->error = lxqt_wallet_gcry_cipher_decrypt_failed;
+                r = Z_DATA_ERROR;
+            }
+            else if (_write_all(c->fd_file, out, COMPRESSION_BUFFER_SIZE - z.avail_out) != 0)
+            {
+                c->error = lxqt_wallet_failed_to_open_file;
+                r = Z_ERRNO;
+            }
+
+        } while (r == Z_OK && (z.avail_in > 0 || z.avail_out == 0));
+    }
+
+    if (r == Z_OK)
+    {
+        /*
+         * the stream was cut short
+         */
+        c->error = lxqt_wallet_gcry_cipher_decrypt_failed;
+    }
+    else if (r == Z_STREAM_END && z.total_out != c->size)
+    {
+        c->error = lxqt_wallet_gcry_cipher_decrypt_failed;
+    }
+
+    if (initialized)
+    {
+        inflateEnd(&z);
+    }
+
+    memset(drain, '\0', sizeof(drain));
+
+    _free_locked_buffer(in, COMPRESSION_BUFFER_SIZE);
+    _free_locked_buffer(out, COMPRESSION_BUFFER_SIZE);
+
+    return NULL;
+}
+
+/*
+ * progress of a compressed file is measured in bytes of the plain text the compressor has read
+ */
+static int _file_compressor_progress(u_int64_t size, void *arg)
+{
+    struct _file_compressor *c = arg;
+    int j;
+
+    (void)size;
+
+    if (c->size == 0)
+    {
+        return 0;
+    }
+
+    j = (int)(__atomic_load_n(&c->done, __ATOMIC_RELAXED) * 100 / c->size);
+
+    if (j > c->last_percent && j < 100)
+    {
+        c->last_percent = j;
+
+        if (c->function(j, c->arg))
+        {
+            c->cancelled = 1;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * compress "size" bytes of "fd_src" and stream the result through the CBC cipher in "handle" to "fd_dest",the
+ * cipher text is padded to a multiple of FILE_BLOCK_SIZE
+ */
+static lxqt_wallet_error _file_pipeline_compressed(gcry_cipher_hd_t handle, int fd_src, int fd_dest, u_int64_t size,
+        int(*function)(int, void *), void *v)
+{
+    struct _file_compressor c;
+    struct _file_pipeline p;
+    lxqt_wallet_error r;
+    pthread_t thread;
+    int fds[ 2 ];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+    {
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    memset(&c, '\0', sizeof(c));
+
+    c.fd_file   = fd_src;
+    c.fd_socket = fds[ 1 ];
+    c.size      = size;
+    c.function  = function;
+    c.arg       = v;
+
+    if (pthread_create(&thread, NULL, _file_compressor, &c) != 0)
+    {
+        close(fds[ 0 ]);
+        close(fds[ 1 ]);
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    memset(&p, '\0', sizeof(p));
+
+    p.fd_src       = fds[ 0 ];
+    p.fd_dest      = fd_dest;
+    p.handle       = handle;
+    p.transform    = _cbc_encrypt_buffer;
+    p.read_size    = FILE_SIZE_UNKNOWN;
+    p.write_size   = FILE_SIZE_UNKNOWN;
+    p.read_stride  = _file_pipeline_buffer_size;
+    p.write_stride = p.read_stride;
+
+    r = _file_pipeline_run(&p, NULL, _file_compressor_progress, &c);
+
+    /*
+     * a compressor that is still running was cancelled and it fails to send once its peer is gone
+     */
+    close(fds[ 0 ]);
+
+    pthread_join(thread, NULL);
+
+    if (r == lxqt_wallet_no_error && !c.cancelled)
+    {
+        r = c.error;
+    }
+
+    return r;
+}
+
+/*
+ * decrypt "cipher_size" bytes of "fd_src" through the CBC cipher in "handle" and decompress the result to "fd_dest",
+ * "size" is the size of the plain text
+ */
+static lxqt_wallet_error _file_pipeline_decompressed(gcry_cipher_hd_t handle, int fd_src, int fd_dest,
+        u_int64_t cipher_size, u_int64_t size, int(*function)(int, void *), void *v)
+{
+    struct _file_compressor c;
+    struct _file_pipeline p;
+    lxqt_wallet_error r;
+    pthread_t thread;
+    int fds[ 2 ];
+
+    if (cipher_size == 0 || cipher_size % BLOCK_SIZE != 0)
+    {
+        return lxqt_wallet_gcry_cipher_decrypt_failed;
+    }
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+    {
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    memset(&c, '\0', sizeof(c));
+
+    c.fd_file   = fd_dest;
+    c.fd_socket = fds[ 1 ];
+    c.size      = size;
+
+    if (pthread_create(&thread, NULL, _file_decompressor, &c) != 0)
+    {
+        close(fds[ 0 ]);
+        close(fds[ 1 ]);
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    memset(&p, '\0', sizeof(p));
+
+    p.fd_src       = fd_src;
+    p.fd_dest      = fds[ 0 ];
+    p.handle       = handle;
+    p.transform    = _cbc_decrypt_buffer;
+    p.read_size    = cipher_size;
+    p.write_size   = cipher_size;
+    p.read_stride  = _file_pipeline_buffer_size;
+
+    if (p.read_stride > cipher_size)
+    {
+        p.read_stride = cipher_size;
+    }
+
+    p.write_stride = p.read_stride;
+
+    r = _file_pipeline_run(&p, function, NULL, v);
+
+    close(fds[ 0 ]);
+
+    pthread_join(thread, NULL);
+
+    close(fds[ 1 ]);
+
+    if (r == lxqt_wallet_no_error && p.stop == 0)
+    {
+        r = c.error;
+    }
+
+    return r;
+}
+
+static lxqt_wallet_error _create_encrypted_file(const char *password, u_int32_t password_length,
+        const char *source, const char *destination, int(*function)(int, void *), void *v, int compress)
+{
+    gcry_error_t r;
+    int fd_dest;
+    int fd_src;
+    char iv[ IV_SIZE ];
+    char key[ PASSWORD_SIZE ];
+    char salt[ SALT_SIZE ];
+    char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ] = { '\0' };
+    u_int64_t size;
+    lxqt_wallet_error e;
+    gcry_cipher_hd_t handle = 0;
+
+    struct stat st;
+
+    if (password == NULL || source == NULL || destination == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    if (stat(destination, &st) == 0)
+    {
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    r = lxqt_wallet_create_1(&handle, password, password_length, key, iv, salt);
+
+    if (_failed(r))
+    {
+        return _exit_create(lxqt_wallet_gcry_cipher_encrypt_failed, handle);
+    }
+    else
+    {
+        fd_dest = open(destination, O_WRONLY | O_CREAT, 0600);
+        if (fd_dest == -1)
+        {
+            return _exit_create(lxqt_wallet_failed_to_open_file, handle);
+        }
+        fd_src = open(source, O_RDONLY);
+        if (fd_src == -1)
+        {
+            close(fd_dest);
+            return _exit_create(lxqt_wallet_failed_to_open_file, handle);
+        }
+        /*
+         * first 16 bytes are for PBKDF2 salt
+         */
+        write(fd_dest, salt, SALT_SIZE);
+        /*
+         * second 16 bytes are for AES IV
+         */
+        write(fd_dest, iv, IV_SIZE);
+
+        fstat(fd_src, &st);
+	size = (u_int64_t)st.st_size;
+
+        _create_magic_string_header(buffer);
+
+        if (compress)
+        {
+            _set_load_flags(buffer, LOAD_FLAG_COMPRESSED);
+        }
+
+        memcpy(buffer + MAGIC_STRING_BUFFER_SIZE, &size, sizeof(u_int64_t));
+
+        gcry_cipher_encrypt(handle, buffer, MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE, NULL, 0);
+
+        /*
+         * write third 16 byte and fourth 16 to the header
+         */
+        write(fd_dest, buffer, MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE);
+
+        if (compress)
+        {
+            e = _file_pipeline_compressed(handle, fd_src, fd_dest, size, function, v);
+        }
+        else
+        {
+            e = _file_pipeline(handle, fd_src, fd_dest, size, 1, function, v);
+        }
+
+        function(100, v);
+
+        close(fd_dest);
+        close(fd_src);
+        return  _exit_create(e, handle);
+    }
+}
+
+lxqt_wallet_error lxqt_wallet_create_encrypted_file(const char *password, u_int32_t password_length,
+        const char *source, const char *destination, int(*function)(int, void *), void *v)
+{
+    return _create_encrypted_file(password, password_length, source, destination, function, v, 0);
+}
+
+lxqt_wallet_error lxqt_wallet_create_compressed_encrypted_file(const char *password, u_int32_t password_length,
+        const char *source, const char *destination, int(*function)(int, void *), void *v)
+{
+    return _create_encrypted_file(password, password_length, source, destination, function, v, 1);
+}
+
+lxqt_wallet_error lxqt_wallet_set_compression(lxqt_wallet_t wallet, int compress)
+{
+    if (wallet == NULL || wallet->read_only)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    _write_lock(wallet);
+
+    if (wallet->compressed != (compress != 0))
+    {
+        wallet->compressed      = compress != 0;
+        wallet->wallet_modified = 1;
+    }
+
+    _unlock(wallet);
+
+    return lxqt_wallet_no_error;
+}
+
+int lxqt_wallet_compression(lxqt_wallet_t wallet)
+{
+    int r;
+
+    if (wallet == NULL)
+    {
+        return 0;
+    }
+
+    _read_lock(wallet);
+    r = wallet->compressed;
+    _unlock(wallet);
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_change_wallet_password(lxqt_wallet_t wallet, const char *new_key, u_int32_t new_key_size)
+{
+    char key[ PASSWORD_SIZE ];
+    char path[ PATH_MAX ];
+    gcry_error_t r;
+
+    if (wallet == NULL || new_key == NULL || wallet->read_only)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+    else
+    {
+        r = _create_key(wallet->salt, key, new_key, new_key_size);
+        if (_failed(r))
+        {
+            return lxqt_wallet_failed_to_create_key_hash;
+        }
+        else
+        {
+            _wallet_full_path(path, PATH_MAX, wallet->wallet_name, wallet->application_name);
+            _purge_cached_keys(path);
+            _cache_key(path, wallet->salt, key, new_key, new_key_size);
+
+            _write_lock(wallet);
+            memcpy(wallet->key, key, PASSWORD_SIZE);
+            wallet->wallet_modified = 1;
+            _unlock(wallet);
+            return lxqt_wallet_no_error;
+        }
+    }
+}
+
+static lxqt_wallet_error _exit_open(lxqt_wallet_error st,
+                                    struct lxqt_wallet_struct *w, gcry_cipher_hd_t handle, int fd)
+{
+    if (handle != 0)
+    {
+        gcry_cipher_close(handle);
+    }
+    if (fd != -1)
+    {
+        close(fd);
+    }
+    if (w != NULL)
+    {
+        free(w->wallet_name);
+        free(w->application_name);
+        free(w);
+    }
+    return st;
+}
+
+/*
+ * set up a cipher handle with an already derived key and decrypt the wallet header into "buffer".
+ * On success,the file offset of "fd" is at the beginning of the load.
+ */
+static lxqt_wallet_error _lxqt_wallet_open_1(gcry_cipher_hd_t *h, const char *key, char iv[ IV_SIZE ], int fd, char *buffer)
+{
+    gcry_error_t r;
+    gcry_cipher_hd_t handle;
+
+    if (gcry_control(GCRYCTL_INITIALIZATION_FINISHED_P) == 0)
+    {
+        gcry_check_version(NULL);
+        gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+    }
+
+    r = gcry_cipher_open(h, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_CBC, 0);
+
+    handle = *h;
+
+    if (_failed(r))
+    {
+        return lxqt_wallet_gcry_cipher_open_failed;
+    }
+
+    r = gcry_cipher_setkey(handle, key, PASSWORD_SIZE);
+
+    if (_failed(r))
+    {
+        return lxqt_wallet_gcry_cipher_setkey_failed;
+    }
+
+    _get_iv_from_wallet_header(iv, fd);
+
+    r = gcry_cipher_setiv(handle, iv, IV_SIZE);
+
+    if (_failed(r))
+    {
+        return lxqt_wallet_gcry_cipher_setiv_failed;
+    }
+    else
+    {
+        _get_volume_info(buffer, fd);
+        return gcry_cipher_decrypt(handle, buffer, MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE, NULL, 0);
+    }
+}
+
+static lxqt_wallet_error _lxqt_wallet_open_0(gcry_cipher_hd_t *h, struct lxqt_wallet_struct *w,
+        const char *password, u_int32_t password_length, int fd, char *buffer, const char *path)
+{
+    gcry_error_t r;
+
+    _get_salt_from_wallet_header(w->salt, fd);
+
+    r = _create_key_cached(path, w->salt, w->key, password, password_length);
+
+    if (_failed(r))
+    {
+        return lxqt_wallet_failed_to_create_key_hash;
+    }
+    else
+    {
+        memcpy(w->file_key, w->key, PASSWORD_SIZE);
+        return _lxqt_wallet_open_1(h, w->key, w->file_iv, fd, buffer);
+    }
+}
+
+lxqt_wallet_error lxqt_wallet_create_decrypted_file(const char *password, u_int32_t password_length,
+        const char *source, const char *destination, int(*function)(int, void *), void *v)
+{
+    gcry_error_t r;
+
+    int fd_dest;
+    int fd_src;
+
+    struct stat st;
+
+    char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ] = { '\0' };
+
+    char path[ PATH_MAX ];
+
+    lxqt_wallet_error e;
+
+    gcry_cipher_hd_t handle = 0;
+
+    struct lxqt_wallet_struct *w;
+
+    if (password == NULL || source == NULL || destination == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    if (stat(destination, &st) == 0)
+    {
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    w = malloc(sizeof(struct lxqt_wallet_struct));
+
+    if (w == NULL)
+    {
+        return _exit_open(lxqt_wallet_failed_to_allocate_memory, NULL, handle, -1);
+    }
+
+    memset(w, '\0', sizeof(struct lxqt_wallet_struct));
+
+    fd_src = open(source, O_RDONLY);
+    if (fd_src == -1)
+    {
+        return _exit_open(lxqt_wallet_failed_to_open_file, w, handle, -1);
+    }
+
+    if (_is_chunked_file(fd_src))
+    {
+        e = _create_decrypted_file_chunked(password, password_length, fd_src, source, destination, function, v);
+        close(fd_src);
+        return _exit_open(e, w, handle, -1);
+    }
+
+    r = _lxqt_wallet_open_0(&handle, w, password, password_length, fd_src, buffer, source);
+
+    if (_failed(r))
+    {
+        close(fd_src);
+        return _exit_open(lxqt_wallet_failed_to_open_file, w, handle, -1);
+    }
+
+    if (_password_match(buffer) && _wallet_is_compatible(buffer))
+    {
+        fd_dest = _open_decrypted_file(path, sizeof(path), destination);
+        if (fd_dest == -1)
+        {
+            close(fd_src);
+            return _exit_open(lxqt_wallet_failed_to_open_file, w, handle, -1);
+        }
+
+        _get_load_information(w, buffer);
+
+        if (_load_flags(buffer) & LOAD_FLAG_COMPRESSED)
+        {
+            fstat(fd_src, &st);
+
+            e = _file_pipeline_decompressed(handle, fd_src, fd_dest,
+                                            (u_int64_t)st.st_size - (SALT_SIZE + IV_SIZE + MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE),
+                                            w->wallet_data_size, function, v);
+        }
+        else
+        {
+            e = _file_pipeline(handle, fd_src, fd_dest, w->wallet_data_size, 0, function, v);
+        }
+
+        close(fd_src);
+
+        e = _close_decrypted_file(e, fd_dest, path, destination);
+
+        function(100, v);
+
+        return _exit_open(e, w, handle, -1);
+    }
+    else
+    {
+        close(fd_src);
+        return _exit_open(lxqt_wallet_wrong_password, w, handle, -1);
+    }
+}
+
+static lxqt_wallet_error _lxqt_wallet_open(const char *password, u_int32_t password_length,
+        const char *wallet_name, const char *application_name, char *buffer,
+        int *ffd, struct lxqt_wallet_struct **ww, gcry_cipher_hd_t *h)
+{
+    gcry_error_t r;
+    gcry_cipher_hd_t handle = 0;
+
+    char path[ PATH_MAX ];
+    char name[ PATH_MAX ];
+
+    int dirfd;
+    int fd;
+
+    size_t len;
+
+    struct lxqt_wallet_struct *w;
+
+    _wallet_full_path(path, PATH_MAX, wallet_name, application_name);
+
+    dirfd = _application_directory(application_name, 0);
+
+    fd = openat(dirfd, _wallet_file_name(name, PATH_MAX, wallet_name), O_RDONLY | O_CLOEXEC);
+
+    _release_application_directory(dirfd);
+
+    if (fd == -1)
+    {
+        return _exit_open(lxqt_wallet_failed_to_open_file, NULL, handle, fd);
+    }
+
+    w = malloc(sizeof(struct lxqt_wallet_struct));
+
+    if (w == NULL)
+    {
+        return _exit_open(lxqt_wallet_failed_to_allocate_memory, NULL, handle, fd);
+    }
+
+    memset(w, '\0', sizeof(struct lxqt_wallet_struct));
+
+    len = strlen(wallet_name);
+
+    w->wallet_name = malloc(sizeof(char) * (len + 1));
+
+    if (w->wallet_name == NULL)
+    {
+        return _exit_open(lxqt_wallet_failed_to_allocate_memory, w, handle, fd);
+    }
+    else
+    {
+        memcpy(w->wallet_name, wallet_name, len + 1);
+    }
+
+    len = strlen(application_name);
+
+    w->application_name = malloc(sizeof(char) * (len + 1));
+
+    if (w->application_name == NULL)
+    {
+        return _exit_open(lxqt_wallet_failed_to_allocate_memory, w, handle, fd);
+    }
+    else
+    {
+        memcpy(w->application_name, application_name, len + 1);
+    }
+
+    r = _lxqt_wallet_open_0(&handle, w, password, password_length, fd, buffer, path);
+
+    if (_failed(r))
+    {
+        return _exit_open(lxqt_wallet_gcry_cipher_decrypt_failed, w, handle, fd);
+    }
+    else
+    {
+        *ww = w;
+        *ffd = fd;
+        *h = handle;
+        return lxqt_wallet_no_error;
+    }
+}
+
+static void _set_file_state(struct lxqt_wallet_struct *w, const struct stat *st, const char *buffer)
+{
+    w->file_dev   = st->st_dev;
+    w->file_ino   = st->st_ino;
+    w->file_size  = st->st_size;
+    w->file_mtime = st->st_mtime;
+    memcpy(&w->file_generation, buffer + GENERATION_OFFSET, sizeof(u_int16_t));
+    w->file_version = (u_int16_t)_volume_version(buffer);
+}
+
+/*
+ * read and decrypt the load of a wallet file whose decrypted header is in "buffer"
+ */
+static lxqt_wallet_error _lxqt_wallet_read_load(struct lxqt_wallet_struct *w, int fd, gcry_cipher_hd_t handle, const char *buffer)
+{
+    struct stat st;
+    u_int64_t len;
+    u_int64_t size;
+    lxqt_wallet_error err;
+    char *e;
+    char *d;
+    gcry_error_t r;
+
+    fstat(fd, &st);
+
+    _set_file_state(w, &st, buffer);
+
+    w->compressed = (_load_flags(buffer) & LOAD_FLAG_COMPRESSED) != 0;
+
+    len = (u_int64_t)(st.st_size - (SALT_SIZE + IV_SIZE + MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE));
+
+    if ((int64_t)len <= 0)
+    {
+        /*
+         * empty wallet
+         */
+        return _entries_load(w, NULL, 0);
+    }
+
+    _get_load_information(w, buffer);
+
+    size = w->wallet_data_size;
+
+    /*
+     * the load is split up into entries that count themselves
+     */
+    w->wallet_data_size = 0;
+    w->wallet_data_entry_count = 0;
+
+    if (size > len && !w->compressed)
+    {
+        /*
+         * Wallet is corrupt somehow,lets clear it.
+         */
+        size = 0;
+        w->wallet_modified = 1;
+    }
+
+    e = malloc(len);
+
+    if (e == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    mlock(e, len);
+    read(fd, e, len);
+    r = gcry_cipher_decrypt(handle, e, len, NULL, 0);
+
+    if (_passed(r) && w->compressed && size > 0)
+    {
+        d = _locked_buffer(size);
+
+        if (d == NULL)
+        {
+            _free_locked_buffer(e, len);
+            return lxqt_wallet_failed_to_allocate_memory;
+        }
+
+        if (_decompress_load(e, len, d, size) != 0)
+        {
+            /*
+             * Wallet is corrupt somehow,lets clear it.
+             */
+            w->wallet_modified = 1;
+            err = _entries_load(w, d, 0);
+        }
+        else
+        {
+            err = _entries_load(w, d, size);
+        }
+
+        _free_locked_buffer(e, len);
+        _free_locked_buffer(d, size);
+
+        return err;
+    }
+    else if (_passed(r))
+    {
+        err = _entries_load(w, e, size);
+
+        _free_locked_buffer(e, len);
+
+        return err;
+    }
+    else
+    {
+        _free_locked_buffer(e, len);
+        return lxqt_wallet_gcry_cipher_decrypt_failed;
+    }
+}
+
+static lxqt_wallet_error _lxqt_wallet_open_file(lxqt_wallet_t *wallet, const char *password, u_int32_t password_length,
+        const char *wallet_name, const char *application_name)
+{
+    int fd;
+    struct lxqt_wallet_struct *w = 0;
+
+    gcry_cipher_hd_t handle = 0;
+
+    char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ];
+
+    gcry_error_t r;
+
+    if (wallet_name == NULL || application_name == NULL || wallet == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    r = _lxqt_wallet_open(password, password_length, wallet_name, application_name, buffer, &fd, &w, &handle);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    if (_password_match(buffer))
+    {
+        if (_wallet_is_compatible(buffer))
+        {
+            r = _lxqt_wallet_read_load(w, fd, handle, buffer);
+
+            if (r == lxqt_wallet_no_error)
+            {
+                *wallet = w;
+                return _exit_open(lxqt_wallet_no_error, NULL, handle, fd);
+            }
+            else
+            {
+                return _exit_open(r, w, handle, fd);
+            }
+        }
+        else
+        {
+            return _exit_open(lxqt_wallet_incompatible_wallet, w, handle, fd);
+        }
+    }
+    else
+    {
+        return _exit_open(lxqt_wallet_wrong_password, w, handle, fd);
+    }
+}
+
+static int _keys_match(const char *a, const char *b)
+{
+    int i;
+    char r = 0;
+
+    /*
+     * compare in constant time
+     */
+    for (i = 0; i < PASSWORD_SIZE; i++)
+    {
+        r |= a[ i ] ^ b[ i ];
+    }
+
+    return r == 0;
+}
+
+/*
+ * returns a cached handle of the wallet file "path" with one more reference,the caller must hold the cache mutex
+ */
+static lxqt_wallet_t _cached_wallet(const char *path)
+{
+    lxqt_wallet_t e;
+
+    for (e = _handle_cache.wallets; e != NULL; e = e->cache_next)
+    {
+        if (strcmp(e->cache_path, path) == 0)
+        {
+            e->cache_references++;
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * share an already opened handle if the password derives the key the handle is using
+ */
+static lxqt_wallet_error _lxqt_wallet_open_cached(lxqt_wallet_t *wallet, lxqt_wallet_t e,
+        const char *password, u_int32_t password_length)
+{
+    char key[ PASSWORD_SIZE ];
+    int match;
+
+    if (_failed(_create_key_cached(e->cache_path, e->salt, key, password, password_length)))
+    {
+        lxqt_wallet_close(&e);
+        return lxqt_wallet_failed_to_create_key_hash;
+    }
+
+    _read_lock(e);
+    match = _keys_match(key, e->key);
+    _unlock(e);
+
+    memset(key, '\0', PASSWORD_SIZE);
+
+    if (match)
+    {
+        *wallet = e;
+        return lxqt_wallet_no_error;
+    }
+    else
+    {
+        lxqt_wallet_close(&e);
+        return lxqt_wallet_wrong_password;
+    }
+}
+
+lxqt_wallet_error lxqt_wallet_open(lxqt_wallet_t *wallet, const char *password, u_int32_t password_length,
+                                   const char *wallet_name, const char *application_name)
+{
+    char path[ PATH_MAX ];
+    lxqt_wallet_t e;
+    lxqt_wallet_t w;
+    lxqt_wallet_error r;
+
+    if (wallet_name == NULL || application_name == NULL || wallet == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    _wallet_full_path(path, PATH_MAX, wallet_name, application_name);
+
+    pthread_mutex_lock(&_handle_cache.mutex);
+
+    if (!_handle_cache.enabled)
+    {
+        pthread_mutex_unlock(&_handle_cache.mutex);
+        return _lxqt_wallet_open_file(wallet, password, password_length, wallet_name, application_name);
+    }
+
+    e = _cached_wallet(path);
+
+    pthread_mutex_unlock(&_handle_cache.mutex);
+
+    if (e != NULL)
+    {
+        /*
+         * The wallet is already opened,the file does not have to be read and decrypted again
+         */
+        return _lxqt_wallet_open_cached(wallet, e, password, password_length);
+    }
+
+    r = _lxqt_wallet_open_file(&w, password, password_length, wallet_name, application_name);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    r = lxqt_wallet_set_thread_safe(w);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        w->cache_path = strdup(path);
+
+        if (w->cache_path == NULL)
+        {
+            r = lxqt_wallet_failed_to_allocate_memory;
+        }
+    }
+
+    if (r != lxqt_wallet_no_error)
+    {
+        lxqt_wallet_close(&w);
+        return r;
+    }
+
+    pthread_mutex_lock(&_handle_cache.mutex);
+
+    e = _cached_wallet(path);
+
+    if (e == NULL)
+    {
+        w->cache_references = 1;
+        w->cache_next = _handle_cache.wallets;
+        _handle_cache.wallets = w;
+
+        pthread_mutex_unlock(&_handle_cache.mutex);
+
+        *wallet = w;
+        return lxqt_wallet_no_error;
+    }
+    else
+    {
+        /*
+         * Somebody else opened the same wallet while we were opening it,use theirs.
+         */
+        pthread_mutex_unlock(&_handle_cache.mutex);
+
+        lxqt_wallet_close(&w);
+
+        return _lxqt_wallet_open_cached(wallet, e, password, password_length);
+    }
+}
+
+void lxqt_wallet_set_handle_cache(int enable)
+{
+    pthread_mutex_lock(&_handle_cache.mutex);
+    _handle_cache.enabled = enable;
+    pthread_mutex_unlock(&_handle_cache.mutex);
+}
+
+/*
+ * arguments of lxqt_wallet_open_many() shared by the threads that open the wallets
+ */
+struct _open_many
+{
+    lxqt_wallet_t *wallets;
+    lxqt_wallet_error *errors;
+    const char **wallet_names;
+    const char *password;
+    u_int32_t password_length;
+    const char *application_name;
+};
+
+static void _open_many_work(void *arg, u_int64_t i)
+{
+    struct _open_many *e = arg;
+
+    if (e->wallet_names[ i ] == NULL)
+    {
+        e->wallets[ i ] = NULL;
+        e->errors[ i ]  = lxqt_wallet_invalid_argument;
+    }
+    else
+    {
+        e->errors[ i ] = lxqt_wallet_open(e->wallets + i, e->password, e->password_length,
+                                          e->wallet_names[ i ], e->application_name);
+
+        if (e->errors[ i ] != lxqt_wallet_no_error)
+        {
+            e->wallets[ i ] = NULL;
+        }
+    }
+}
+
+lxqt_wallet_error lxqt_wallet_open_many(lxqt_wallet_t *wallets, lxqt_wallet_error *errors, const char **wallet_names,
+                                        int count, const char *password, u_int32_t password_length,
+                                        const char *application_name)
+{
+    struct _open_many e;
+    int i;
+
+    if (wallets == NULL || errors == NULL || wallet_names == NULL || count < 0 || application_name == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    if (count == 0)
+    {
+        return lxqt_wallet_no_error;
+    }
+
+    /*
+     * libgcrypt must be initialized before threads start using it
+     */
+    if (gcry_control(GCRYCTL_INITIALIZATION_FINISHED_P) == 0)
+    {
+        gcry_check_version(NULL);
+        gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+    }
+
+    e.wallets          = wallets;
+    e.errors           = errors;
+    e.wallet_names     = wallet_names;
+    e.password         = password;
+    e.password_length  = password_length;
+    e.application_name = application_name;
+
+    _lxqt_wallet_parallel_for(count, _open_many_work, &e);
+
+    for (i = 0; i < count; i++)
+    {
+        if (errors[ i ] != lxqt_wallet_no_error)
+        {
+            return errors[ i ];
+        }
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+int lxqt_wallet_volume_version(const char *wallet_name, const char *application_name, const char *password, u_int32_t password_length)
+{
+    int fd;
+    int version;
+    struct lxqt_wallet_struct *w = 0;
+
+    gcry_cipher_hd_t handle = 0;
+
+    char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ];
+
+    gcry_error_t r;
+
+    if (wallet_name == NULL || application_name == NULL)
+    {
+        return -1;
+    }
+    else
+    {
+        r = _lxqt_wallet_open(password, password_length, wallet_name, application_name, buffer, &fd, &w, &handle);
+
+        if (r != lxqt_wallet_no_error)
+        {
+            return -1;
+        }
+        else
+        {
+            if (_password_match(buffer))
+            {
+                version = _volume_version(buffer);
+                _exit_open(lxqt_wallet_no_error, w, handle, fd);
+                return version;
+            }
+            else
+            {
+                _exit_open(lxqt_wallet_wrong_password, w, handle, fd);
+                return -1;
+            }
+        }
+    }
+}
+
+static int _lxqt_wallet_read_key_value(lxqt_wallet_t wallet, const char *key, u_int32_t key_size, lxqt_wallet_key_values_t *key_value)
+{
+    int64_t i;
+
+    if (key == NULL || wallet == NULL || key_value == NULL)
+    {
+        return 0;
+    }
+
+    i = _entries_find(wallet, key, key_size);
+
+    if (i == -1)
+    {
+        return 0;
+    }
+
+    _entries_entry(wallet, (u_int64_t)i, key_value);
+
+    return 1;
+}
+
+int lxqt_wallet_read_key_value(lxqt_wallet_t wallet, const char *key, u_int32_t key_size, lxqt_wallet_key_values_t *key_value)
+{
+    int r;
+    _read_lock(wallet);
+    r = _lxqt_wallet_read_key_value(wallet, key, key_size, key_value);
+    _unlock(wallet);
+    return r;
+}
+
+static int _lxqt_wallet_wallet_has_key(lxqt_wallet_t wallet, const char *key, u_int32_t key_size)
+{
+    return wallet != NULL && key != NULL && _entries_find(wallet, key, key_size) != -1;
+}
+
+int lxqt_wallet_wallet_has_key(lxqt_wallet_t wallet, const char *key, u_int32_t key_size)
+{
+    int r;
+    _read_lock(wallet);
+    r = _lxqt_wallet_wallet_has_key(wallet, key, key_size);
+    _unlock(wallet);
+    return r;
+}
+
+static int _lxqt_wallet_wallet_has_value(lxqt_wallet_t wallet, const char *value, u_int32_t value_size, lxqt_wallet_key_values_t *key_value)
+{
+    const struct _entry_header *h;
+    u_int64_t i;
+
+    if (key_value == NULL || wallet == NULL)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < wallet->wallet_data_entry_count; i++)
+    {
+        h = wallet->entries + i;
+
+        if (h->value_size == value_size && memcmp(value, wallet->value_data + h->value, value_size) == 0)
+        {
+            _entries_entry(wallet, i, key_value);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int lxqt_wallet_wallet_has_value(lxqt_wallet_t wallet, const char *value, u_int32_t value_size, lxqt_wallet_key_values_t *key_value)
+{
+    int r;
+    _read_lock(wallet);
+    r = _lxqt_wallet_wallet_has_value(wallet, value, value_size, key_value);
+    _unlock(wallet);
+    return r;
+}
+
+static void _changed_keys_free(struct lxqt_wallet_struct *w)
+{
+    _free_locked_buffer(w->changed_keys, w->changed_keys_capacity);
+    _free_locked_buffer((char *)w->changed_key_slots, w->changed_key_slots_capacity * sizeof(u_int64_t));
+
+    w->changed_keys               = NULL;
+    w->changed_keys_size          = 0;
+    w->changed_keys_capacity      = 0;
+    w->changed_keys_count         = 0;
+    w->changed_key_slots          = NULL;
+    w->changed_key_slots_capacity = 0;
+}
+
+/*
+ * slot of "key" in the changed key table or the free slot where it would go
+ */
+static u_int64_t _changed_key_slot(const struct lxqt_wallet_struct *w, const char *key, u_int32_t key_size)
+{
+    u_int64_t mask = w->changed_key_slots_capacity - 1;
+    u_int64_t s = _key_hash(key, key_size) & mask;
+    const char *e;
+    u_int32_t len;
+
+    while (w->changed_key_slots[ s ] != 0)
+    {
+        e = w->changed_keys + w->changed_key_slots[ s ] - 1;
+
+        memcpy(&len, e, sizeof(u_int32_t));
+
+        if (len == key_size && memcmp(e + sizeof(u_int32_t), key, key_size) == 0)
+        {
+            break;
+        }
+
+        s = (s + 1) & mask;
+    }
+
+    return s;
+}
+
+static int _changed_key_set_has(const struct lxqt_wallet_struct *w, const char *key, u_int32_t key_size)
+{
+    return w->changed_key_slots != NULL && w->changed_key_slots[ _changed_key_slot(w, key, key_size) ] != 0;
+}
+
+/*
+ * make room for "count" more keys that take "size" bytes in the changed key list,both the list and the table
+ * grow by doubling.
+ */
+static lxqt_wallet_error _changed_keys_reserve(struct lxqt_wallet_struct *w, u_int64_t size, u_int64_t count)
+{
+    u_int64_t capacity;
+    u_int64_t i;
+    u_int32_t key_size;
+    char *e;
+
+    if (w->changed_keys_size + size > w->changed_keys_capacity)
+    {
+        capacity = w->changed_keys_capacity > 0 ? w->changed_keys_capacity : 256;
+
+        while (capacity < w->changed_keys_size + size)
+        {
+            capacity *= 2;
+        }
+
+        e = _locked_buffer(capacity);
+
+        if (e == NULL)
+        {
+            return lxqt_wallet_failed_to_allocate_memory;
+        }
+
+        if (w->changed_keys_size > 0)
+        {
+            memcpy(e, w->changed_keys, w->changed_keys_size);
+        }
+
+        _free_locked_buffer(w->changed_keys, w->changed_keys_capacity);
+
+        w->changed_keys          = e;
+        w->changed_keys_capacity = capacity;
+    }
+
+    if ((w->changed_keys_count + count) * 2 > w->changed_key_slots_capacity)
+    {
+        capacity = 16;
+
+        while (capacity < (w->changed_keys_count + count) * 2)
+        {
+            capacity *= 2;
+        }
+
+        e = _locked_buffer(capacity * sizeof(u_int64_t));
+
+        if (e == NULL)
+        {
+            return lxqt_wallet_failed_to_allocate_memory;
+        }
+
+        _free_locked_buffer((char *)w->changed_key_slots, w->changed_key_slots_capacity * sizeof(u_int64_t));
+
+        w->changed_key_slots          = (u_int64_t *)e;
+        w->changed_key_slots_capacity = capacity;
+
+        for (i = 0; i < w->changed_keys_size; i += sizeof(u_int32_t) + key_size)
+        {
+            memcpy(&key_size, w->changed_keys + i, sizeof(u_int32_t));
+
+            w->changed_key_slots[ _changed_key_slot(w, w->changed_keys + i + sizeof(u_int32_t), key_size) ] = i + 1;
+        }
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * add a key to the changed key list unless it is already there,room for it must have been reserved
+ */
+static void _changed_key_append(struct lxqt_wallet_struct *w, const char *key, u_int32_t key_size)
+{
+    u_int64_t s = _changed_key_slot(w, key, key_size);
+    char *e;
+
+    if (w->changed_key_slots[ s ] == 0)
+    {
+        e = w->changed_keys + w->changed_keys_size;
+
+        memcpy(e, &key_size, sizeof(u_int32_t));
+        memcpy(e + sizeof(u_int32_t), key, key_size);
+
+        w->changed_key_slots[ s ] = w->changed_keys_size + 1;
+
+        w->changed_keys_size += sizeof(u_int32_t) + key_size;
+        w->changed_keys_count++;
+    }
+}
+
+/*
+ * remember a key that was added or deleted through this handle so that the change can be replayed
+ * on top of a wallet file that was saved by somebody else in the meantime.
+ * It is called after the change was made so that failed adds and deletes of missing keys are not replayed.
+ */
+static lxqt_wallet_error _record_changed_key(lxqt_wallet_t wallet, const char *key, u_int32_t key_size)
+{
+    if (_changed_key_set_has(wallet, key, key_size))
+    {
+        return lxqt_wallet_no_error;
+    }
+    else if (_changed_keys_reserve(wallet, sizeof(u_int32_t) + key_size, 1) != lxqt_wallet_no_error)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+    else
+    {
+        _changed_key_append(wallet, key, key_size);
+
+        return lxqt_wallet_no_error;
+    }
+}
+
+static lxqt_wallet_error _lxqt_wallet_add_key(lxqt_wallet_t wallet, const char *key, u_int32_t key_size,
+        const char *value, u_int32_t key_value_length)
+{
+    const struct _entry_header *h;
+
+    if (key == NULL || wallet == NULL || wallet->read_only || key_size == 0)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    if (value == NULL || key_value_length == 0)
+    {
+        key_value_length = 0;
+        value = "";
+    }
+
+    if (_entries_reserve(wallet, 1, key_size, key_value_length) != lxqt_wallet_no_error)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    _entries_append(wallet, key, key_size, value, key_value_length, _key_hash(key, key_size));
+
+    wallet->wallet_modified = 1;
+
+    h = wallet->entries + wallet->wallet_data_entry_count - 1;
+
+    /*
+     * the key is recorded only once it is in the wallet and the entry is taken back out if it can not be
+     */
+    if (_record_changed_key(wallet, wallet->key_data + h->key, key_size) != lxqt_wallet_no_error)
+    {
+        _entries_remove(wallet, wallet->wallet_data_entry_count - 1);
+
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+lxqt_wallet_error lxqt_wallet_add_key(lxqt_wallet_t wallet, const char *key, u_int32_t key_size,
+                                      const char *value, u_int32_t key_value_length)
+{
+    lxqt_wallet_error r;
+    _write_lock(wallet);
+    r = _lxqt_wallet_add_key(wallet, key, key_size, value, key_value_length);
+    _unlock(wallet);
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_reserve(lxqt_wallet_t wallet, u_int64_t entry_count, u_int64_t size)
+{
+    lxqt_wallet_error r;
+
+    if (wallet == NULL || wallet->read_only)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    /*
+     * how "size" splits between keys and values is not known,both arenas are made large enough for it
+     */
+    _write_lock(wallet);
+    r = _entries_reserve(wallet, entry_count, size, size);
+    _unlock(wallet);
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_add_keys(lxqt_wallet_t wallet, const lxqt_wallet_key_values_t *entries, u_int64_t count)
+{
+    lxqt_wallet_error r;
+    u_int64_t key_size = 0;
+    u_int64_t value_size = 0;
+    u_int64_t keys_size = 0;
+    u_int64_t i;
+    const char *value;
+    u_int32_t size;
+
+    if (wallet == NULL || wallet->read_only || (entries == NULL && count > 0))
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (entries[ i ].key == NULL || entries[ i ].key_size == 0)
+        {
+            return lxqt_wallet_invalid_argument;
+        }
+
+        key_size   += entries[ i ].key_size;
+        value_size += entries[ i ].key_value == NULL ? 0 : entries[ i ].key_value_size;
+        keys_size  += sizeof(u_int32_t) + entries[ i ].key_size;
+    }
+
+    if (count == 0)
+    {
+        return lxqt_wallet_no_error;
+    }
+
+    _write_lock(wallet);
+
+    r = _entries_reserve(wallet, count, key_size, value_size);
+
+    /*
+     * room for all keys is reserved up front so that nothing is added if memory runs out
+     */
+    if (r == lxqt_wallet_no_error)
+    {
+        r = _changed_keys_reserve(wallet, keys_size, count);
+    }
+
+    if (r != lxqt_wallet_no_error)
+    {
+        _unlock(wallet);
+        return r;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        _changed_key_append(wallet, entries[ i ].key, entries[ i ].key_size);
+
+        value = entries[ i ].key_value;
+        size  = value == NULL ? 0 : entries[ i ].key_value_size;
+
+        _entries_append(wallet, entries[ i ].key, entries[ i ].key_size, value, size,
+                        _key_hash(entries[ i ].key, entries[ i ].key_size));
+    }
+
+    wallet->wallet_modified = 1;
+
+    _unlock(wallet);
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * "iter_pos" of iterators is the position of the next entry
+ */
+static int _lxqt_wallet_iter_read_value(lxqt_wallet_t wallet, lxqt_wallet_iterator_t *iter)
+{
+    if (wallet == NULL || iter->iter_pos >= wallet->wallet_data_entry_count)
+    {
+        return 0;
+    }
+    else
+    {
+        _entries_entry(wallet, iter->iter_pos, &iter->entry);
+
+        iter->iter_pos++;
+
+        return 1;
+    }
+}
+
+int lxqt_wallet_iter_read_value(lxqt_wallet_t wallet, lxqt_wallet_iterator_t *iter)
+{
+    int r;
+    _read_lock(wallet);
+    r = _lxqt_wallet_iter_read_value(wallet, iter);
+    _unlock(wallet);
+    return r;
+}
+
+int lxqt_wallet_iter_read_key(lxqt_wallet_t wallet, lxqt_wallet_iterator_t *iter)
+{
+    int r;
+    _read_lock(wallet);
+    r = _lxqt_wallet_iter_read_value(wallet, iter);
+    _unlock(wallet);
+    return r;
+}
+
+/*
+ * headers and keys of entries that are passed over are read,their values are not
+ */
+static int _lxqt_wallet_iter_read_prefix(lxqt_wallet_t wallet, const char *prefix, u_int32_t prefix_size,
+        lxqt_wallet_iterator_t *iter)
+{
+    const struct _entry_header *h;
+
+    if (wallet == NULL || (prefix == NULL && prefix_size > 0))
+    {
+        return 0;
+    }
+
+    for (; iter->iter_pos < wallet->wallet_data_entry_count; iter->iter_pos++)
+    {
+        h = wallet->entries + iter->iter_pos;
+
+        if (h->key_size >= prefix_size &&
+                (prefix_size == 0 || memcmp(wallet->key_data + h->key, prefix, prefix_size) == 0))
+        {
+            _entries_entry(wallet, iter->iter_pos, &iter->entry);
+
+            iter->iter_pos++;
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int lxqt_wallet_iter_read_prefix(lxqt_wallet_t wallet, const char *prefix, u_int32_t prefix_size,
+                                 lxqt_wallet_iterator_t *iter)
+{
+    int r;
+    _read_lock(wallet);
+    r = _lxqt_wallet_iter_read_prefix(wallet, prefix, prefix_size, iter);
+    _unlock(wallet);
+    return r;
+}
+
+static int _lxqt_wallet_read_value_at(lxqt_wallet_t wallet, u_int64_t pos, lxqt_wallet_key_values_t *key_value)
+{
+    if (wallet == NULL || pos >= wallet->wallet_data_entry_count)
+    {
+        return 0;
+    }
+    else
+    {
+        _entries_entry(wallet, pos, key_value);
+
+        return 1;
+    }
+}
+
+int lxqt_wallet_read_value_at(lxqt_wallet_t wallet, u_int64_t pos, lxqt_wallet_key_values_t *key_value)
+{
+    int r;
+    _read_lock(wallet);
+    r = _lxqt_wallet_read_value_at(wallet, pos, key_value);
+    _unlock(wallet);
+    return r;
+}
+
+static lxqt_wallet_error _lxqt_wallet_delete_key(lxqt_wallet_t wallet, const char *key, u_int32_t key_size)
+{
+    const struct _entry_header *h;
+    int64_t index;
+
+    if (key == NULL || wallet == NULL || wallet->read_only)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    index = _entries_find(wallet, key, key_size);
+
+    if (index == -1)
+    {
+        return lxqt_wallet_no_error;
+    }
+
+    h = wallet->entries + index;
+
+    /*
+     * only keys that were there are recorded,"key" may be in the key arena and is not looked at after this
+     */
+    if (_record_changed_key(wallet, wallet->key_data + h->key, h->key_size) != lxqt_wallet_no_error)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    _entries_remove(wallet, (u_int64_t)index);
+
+    wallet->wallet_modified = 1;
+
+    return lxqt_wallet_no_error;
+}
+
+lxqt_wallet_error lxqt_wallet_delete_key(lxqt_wallet_t wallet, const char *key, u_int32_t key_size)
+{
+    lxqt_wallet_error r;
+    _write_lock(wallet);
+    r = _lxqt_wallet_delete_key(wallet, key, key_size);
+    _unlock(wallet);
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_delete_wallet(const char *wallet_name, const char *application_name)
+{
+    char name[ PATH_MAX ];
+    int dirfd;
+    int lock;
+
+    if (wallet_name == NULL || application_name == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    lock = _lock_application_directory(application_name);
+
+    dirfd = _application_directory(application_name, 0);
+
+    if (unlinkat(dirfd, _wallet_file_name(name, PATH_MAX, wallet_name), 0) == 0)
+    {
+        _update_manifest(wallet_name, application_name, NULL, 0, VERSION);
+    }
+
+    _release_application_directory(dirfd);
+
+    _unlock_application_directory(lock);
+
+    return lxqt_wallet_no_error;
+}
+
+static void _free_wallet_data(struct lxqt_wallet_struct *wallet)
+{
+    if (wallet->mapping != NULL)
+    {
+        munmap(wallet->mapping, wallet->mapping_size);
+        wallet->mapping    = NULL;
+        wallet->entries    = NULL;
+        wallet->key_data   = NULL;
+        wallet->value_data = NULL;
+        wallet->key_slots  = NULL;
+    }
+
+    _changed_keys_free(wallet);
+    _entries_free(wallet);
+}
+
+static lxqt_wallet_error _close_exit(lxqt_wallet_error err, lxqt_wallet_t *w, gcry_cipher_hd_t handle)
+{
+    lxqt_wallet_t wallet = *w;
+    *w = NULL;
+
+    if (handle != 0)
+    {
+        gcry_cipher_close(handle);
+    }
+
+    _free_wallet_data(wallet);
+
+    if (wallet->thread_safe)
+    {
+        pthread_rwlock_destroy(&wallet->lock);
+    }
+
+    free(wallet->wallet_name);
+    free(wallet->application_name);
+    free(wallet->cache_path);
+    memset(wallet, '\0', sizeof(struct lxqt_wallet_struct));
+    free(wallet);
+    return err;
+}
+
+/*
+ * take an exclusive advisory lock on the directory that holds wallets of an application.
+ *
+ * Saves are serialized through this lock.Reads do not take it because a saved wallet atomically
+ * replaces the previous one through rename().
+ */
+static int _lock_application_directory(const char *application_name)
+{
+    int dirfd = _application_directory(application_name, 0);
+    int fd;
+
+    /*
+     * flock() does not work on the O_PATH descriptor of the directory
+     */
+    fd = openat(dirfd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    _release_application_directory(dirfd);
+
+    if (fd != -1)
+    {
+        while (flock(fd, LOCK_EX) == -1 && errno == EINTR)
+        {
+            ;
+        }
+    }
+
+    return fd;
+}
+
+static void _unlock_application_directory(int fd)
+{
+    if (fd != -1)
+    {
+        close(fd);
+    }
+}
+
+/*
+ * returns 1 if the wallet file was saved by somebody else after this handle last read or wrote it.
+ *
+ * The inode,size and modification time of the file are checked first and the header is read only
+ * when they did not change.The IV changes on every save and hence tells apart saves that happened
+ * within the resolution of the modification time.
+ */
+static int _wallet_file_changed(lxqt_wallet_t wallet, int dirfd, const char *name)
+{
+    struct stat st;
+    gcry_cipher_hd_t handle = 0;
+    char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ];
+    char iv[ IV_SIZE ];
+    u_int16_t generation;
+    lxqt_wallet_error r;
+    int fd;
+
+    if (fstatat(dirfd, name, &st, 0) != 0)
+    {
+        return 1;
+    }
+
+    if (st.st_dev != wallet->file_dev || st.st_ino != wallet->file_ino ||
+            st.st_size != wallet->file_size || st.st_mtime != wallet->file_mtime)
+    {
+        return 1;
+    }
+
+    fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1)
+    {
+        return 1;
+    }
+
+    r = _lxqt_wallet_open_1(&handle, wallet->file_key, iv, fd, buffer);
+
+    close(fd);
+
+    if (handle != 0)
+    {
+        gcry_cipher_close(handle);
+    }
+
+    if (_failed(r) || !_password_match(buffer))
+    {
+        return 1;
+    }
+
+    memcpy(&generation, buffer + GENERATION_OFFSET, sizeof(u_int16_t));
+
+    return generation != wallet->file_generation || memcmp(iv, wallet->file_iv, IV_SIZE) != 0;
+}
+
+/*
+ * add entries of "from" to "to",entries of keys in the changed key set of "wallet" are added when "changed" is 1
+ * and the other ones are added when it is 0.Room for them was made with _entries_reserve()
+ */
+static void _copy_entries(struct lxqt_wallet_struct *to, const struct lxqt_wallet_struct *from, lxqt_wallet_t wallet,
+                          int changed)
+{
+    const struct _entry_header *h;
+    u_int64_t i;
+
+    for (i = 0; i < from->wallet_data_entry_count; i++)
+    {
+        h = from->entries + i;
+
+        if (_changed_key_set_has(wallet, from->key_data + h->key, h->key_size) == changed)
+        {
+            _entries_append(to, from->key_data + h->key, h->key_size, from->value_data + h->value, h->value_size,
+                            h->hash);
+        }
+    }
+}
+
+/*
+ * replace entries of keys changed through "wallet" in "d" with the entries those keys have in "wallet",a key
+ * deleted through "wallet" has no entry there and is hence left out
+ */
+static lxqt_wallet_error _replay_changed_keys(struct lxqt_wallet_struct *d, lxqt_wallet_t wallet)
+{
+    struct lxqt_wallet_struct e;
+
+    memset(&e, '\0', sizeof(e));
+
+    if (_entries_reserve(&e, d->wallet_data_entry_count + wallet->wallet_data_entry_count,
+                         d->key_data_size + wallet->key_data_size,
+                         d->value_data_size + wallet->value_data_size) != lxqt_wallet_no_error)
+    {
+        _entries_free(&e);
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    _copy_entries(&e, d, wallet, 0);
+    _copy_entries(&e, wallet, wallet, 1);
+
+    _entries_move(d, &e);
+
+    d->wallet_modified = 1;
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * read the wallet file "name" in directory "dirfd" that was saved by another handle or process and
+ * replay keys that were added or deleted through this handle on top of it.
+ * A wallet file that was deleted is not recreated,the deletion wins over changes made through this handle.
+ */
+static lxqt_wallet_error _lxqt_wallet_merge(lxqt_wallet_t wallet, int dirfd, const char *name)
+{
+    struct lxqt_wallet_struct d;
+    gcry_cipher_hd_t handle = 0;
+    char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ];
+    lxqt_wallet_error r;
+    int fd;
+
+    fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1)
+    {
+        if (errno == ENOENT)
+        {
+            return lxqt_wallet_failed_to_merge_changes;
+        }
+        else
+        {
+            return lxqt_wallet_failed_to_open_file;
+        }
+    }
+
+    memset(&d, '\0', sizeof(d));
+
+    r = _lxqt_wallet_open_1(&handle, wallet->file_key, d.file_iv, fd, buffer);
+
+    if (_failed(r) || !_password_match(buffer) || !_wallet_is_compatible(buffer))
+    {
+        /*
+         * The wallet was saved with a different key,saving ours would undo a password change
+         */
+        r = lxqt_wallet_failed_to_merge_changes;
+    }
+    else
+    {
+        r = _lxqt_wallet_read_load(&d, fd, handle, buffer);
+    }
+
+    close(fd);
+
+    if (handle != 0)
+    {
+        gcry_cipher_close(handle);
+    }
+
+    if (r == lxqt_wallet_no_error)
+    {
+        r = _replay_changed_keys(&d, wallet);
+    }
+
+    if (r != lxqt_wallet_no_error)
+    {
+        _free_wallet_data(&d);
+        return r;
+    }
+
+    _entries_move(wallet, &d);
+
+    memcpy(wallet->file_iv, d.file_iv, IV_SIZE);
+
+    wallet->file_dev        = d.file_dev;
+    wallet->file_ino        = d.file_ino;
+    wallet->file_size       = d.file_size;
+    wallet->file_mtime      = d.file_mtime;
+    wallet->file_generation = d.file_generation;
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * put the load together from the entries of the wallet,encrypt it and atomically replace the wallet file "name" in
+ * directory "dirfd" with it
+ */
+static lxqt_wallet_error _lxqt_wallet_save(lxqt_wallet_t wallet, int dirfd, const char *name)
+{
+    gcry_cipher_hd_t handle;
+    int fd;
+    char iv[ IV_SIZE ];
+    char path_1[ PATH_MAX + 16 ];
+    char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ] = { '\0' };
+    u_int16_t generation = wallet->file_generation + 1;
+    u_int16_t version;
+
+    u_int64_t k;
+    u_int64_t load_size = (wallet->wallet_data_size + 31) / 32 * 32;
+    u_int64_t compressed_size = 0;
+    u_int64_t compressed_buffer_size = 0;
+    char *compressed = NULL;
+    char *load;
+    char *e;
+
+    lxqt_wallet_error err = lxqt_wallet_no_error;
+    gcry_error_t r;
+
+    gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+
+    r = gcry_cipher_open(&handle, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_CBC, 0);
+
+    if (_failed(r))
+    {
+        return lxqt_wallet_gcry_cipher_open_failed;
+    }
+
+    r = gcry_cipher_setkey(handle, wallet->key, PASSWORD_SIZE);
+
+    if (_failed(r))
+    {
+        return _exit_create(lxqt_wallet_gcry_cipher_setkey_failed, handle);
+    }
+
+    _get_random_data(iv, IV_SIZE);
+
+    r = gcry_cipher_setiv(handle, iv, IV_SIZE);
+
+    if (_failed(r))
+    {
+        return _exit_create(lxqt_wallet_gcry_cipher_setiv_failed, handle);
+    }
+
+    load = _locked_buffer(load_size > 0 ? load_size : 1);
+
+    if (load == NULL)
+    {
+        return _exit_create(lxqt_wallet_failed_to_allocate_memory, handle);
+    }
+
+    _entries_store(wallet, load);
+
+    _create_magic_string_header(buffer);
+
+    /*
+     * a load that does not get smaller is stored uncompressed
+     */
+    if (wallet->compressed && wallet->wallet_data_size > 0 &&
+            _compress_load(load, wallet->wallet_data_size, &compressed, &compressed_buffer_size,
+                           &compressed_size) == 0)
+    {
+        _set_load_flags(buffer, LOAD_FLAG_COMPRESSED);
+    }
+
+    memcpy(buffer + GENERATION_OFFSET, &generation, sizeof(u_int16_t));
+    memcpy(buffer + MAGIC_STRING_BUFFER_SIZE, &wallet->wallet_data_size, sizeof(u_int64_t));
+    memcpy(buffer + MAGIC_STRING_BUFFER_SIZE + sizeof(u_int64_t), &wallet->wallet_data_entry_count, sizeof(u_int64_t));
+
+    version = (u_int16_t)_volume_version(buffer);
+
+    if (compressed != NULL)
+    {
+        k = (compressed_size + 31) / 32 * 32;
+        e = compressed;
+    }
+    else
+    {
+        k = load_size;
+        e = load;
+    }
+
+    snprintf(path_1, sizeof (path_1), "%s.tmp", name);
+
+    if (_failed(gcry_cipher_encrypt(handle, buffer, MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE, NULL, 0)) ||
+            (k > 0 && _failed(gcry_cipher_encrypt(handle, e, k, NULL, 0))))
+    {
+        err = lxqt_wallet_gcry_cipher_encrypt_failed;
+    }
+    else
+    {
+        fd = openat(dirfd, path_1, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+
+        if (fd == -1)
+        {
+            err = lxqt_wallet_failed_to_open_file;
+        }
+        /*
+         * the wallet file is replaced only once the new one is completely on disk,a failed write leaves the old one
+         */
+        else if (_write_all(fd, wallet->salt, SALT_SIZE) != 0 || _write_all(fd, iv, IV_SIZE) != 0 ||
+                 _write_all(fd, buffer, MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE) != 0 || _write_all(fd, e, k) != 0 ||
+                 fsync(fd) != 0)
+        {
+            close(fd);
+            unlinkat(dirfd, path_1, 0);
+            err = lxqt_wallet_failed_to_open_file;
+        }
+        else if (close(fd) != 0 || renameat(dirfd, path_1, dirfd, name) != 0)
+        {
+            unlinkat(dirfd, path_1, 0);
+            err = lxqt_wallet_failed_to_open_file;
+        }
+    }
+
+    _free_locked_buffer(compressed, compressed_buffer_size);
+    _free_locked_buffer(load, load_size > 0 ? load_size : 1);
+
+    if (err == lxqt_wallet_no_error)
+    {
+        memcpy(wallet->file_key, wallet->key, PASSWORD_SIZE);
+        memcpy(wallet->file_iv, iv, IV_SIZE);
+        wallet->file_generation = generation;
+        wallet->file_version    = version;
+    }
+
+    return _exit_create(err, handle);
+}
+
+/*
+ * drop a reference to a cached handle,returns 1 if other references remain
+ */
+static int _release_cached_wallet(lxqt_wallet_t wallet)
+{
+    lxqt_wallet_t *e;
+    int r = 0;
+
+    pthread_mutex_lock(&_handle_cache.mutex);
+
+    if (wallet->cache_references > 1)
+    {
+        wallet->cache_references--;
+        r = 1;
+    }
+    else if (wallet->cache_references == 1)
+    {
+        wallet->cache_references = 0;
+
+        for (e = &_handle_cache.wallets; *e != NULL; e = &(*e)->cache_next)
+        {
+            if (*e == wallet)
+            {
+                *e = wallet->cache_next;
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&_handle_cache.mutex);
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_close(lxqt_wallet_t *w)
+{
+    char name[ PATH_MAX ];
+    struct stat st;
+    lxqt_wallet_t wallet;
+    lxqt_wallet_error r;
+    int lock;
+    int dirfd;
+
+    if (w == NULL || *w == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    wallet = *w;
+
+    if (_release_cached_wallet(wallet))
+    {
+        *w = NULL;
+        return lxqt_wallet_no_error;
+    }
+
+    if (wallet->wallet_modified == 0)
+    {
+        return _close_exit(lxqt_wallet_no_error, w, 0);
+    }
+
+    dirfd = _application_directory(wallet->application_name, 1);
+
+    _wallet_file_name(name, sizeof (name), wallet->wallet_name);
+
+    lock = _lock_application_directory(wallet->application_name);
+
+    if (_wallet_file_changed(wallet, dirfd, name))
+    {
+        r = _lxqt_wallet_merge(wallet, dirfd, name);
+    }
+    else
+    {
+        r = lxqt_wallet_no_error;
+    }
+
+    if (r == lxqt_wallet_no_error)
+    {
+        r = _lxqt_wallet_save(wallet, dirfd, name);
+    }
+
+    if (r == lxqt_wallet_no_error && fstatat(dirfd, name, &st, 0) == 0)
+    {
+        _update_manifest(wallet->wallet_name, wallet->application_name, &st, wallet->wallet_data_entry_count,
+                         wallet->file_version);
+    }
+
+    _release_application_directory(dirfd);
+
+    _unlock_application_directory(lock);
+
+    return _close_exit(r, w, 0);
+}
+
+lxqt_wallet_error lxqt_wallet_save(lxqt_wallet_t wallet)
+{
+    struct stat st;
+    char name[ PATH_MAX ];
+    lxqt_wallet_error r = lxqt_wallet_no_error;
+    int lock;
+    int dirfd;
+
+    if (wallet == NULL || wallet->read_only)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    _write_lock(wallet);
+
+    if (wallet->wallet_modified == 0)
+    {
+        _unlock(wallet);
+        return lxqt_wallet_no_error;
+    }
+
+    dirfd = _application_directory(wallet->application_name, 1);
+
+    _wallet_file_name(name, sizeof (name), wallet->wallet_name);
+
+    lock = _lock_application_directory(wallet->application_name);
+
+    if (_wallet_file_changed(wallet, dirfd, name))
+    {
+        r = _lxqt_wallet_merge(wallet, dirfd, name);
+    }
+
+    if (r == lxqt_wallet_no_error)
+    {
+        r = _lxqt_wallet_save(wallet, dirfd, name);
+    }
+
+    if (r == lxqt_wallet_no_error && fstatat(dirfd, name, &st, 0) == 0)
+    {
+        wallet->file_dev        = st.st_dev;
+        wallet->file_ino        = st.st_ino;
+        wallet->file_size       = st.st_size;
+        wallet->file_mtime      = st.st_mtime;
+        wallet->wallet_modified = 0;
+
+        _update_manifest(wallet->wallet_name, wallet->application_name, &st, wallet->wallet_data_entry_count,
+                         wallet->file_version);
+
+        _changed_keys_free(wallet);
+    }
+
+    _release_application_directory(dirfd);
+
+    _unlock_application_directory(lock);
+
+    _unlock(wallet);
+
+    return r;
+}
+
+int lxqt_wallet_wallet_changed(lxqt_wallet_t wallet)
+{
+    char name[ PATH_MAX ];
+    int dirfd;
+    int r;
+
+    if (wallet == NULL || wallet->read_only)
+    {
+        return 0;
+    }
+    else
+    {
+        _wallet_file_name(name, sizeof (name), wallet->wallet_name);
+        dirfd = _application_directory(wallet->application_name, 0);
+        _read_lock(wallet);
+        r = _wallet_file_changed(wallet, dirfd, name);
+        _unlock(wallet);
+        _release_application_directory(dirfd);
+        return r;
+    }
+}
+
+lxqt_wallet_error lxqt_wallet_reload(lxqt_wallet_t wallet)
+{
+    char name[ PATH_MAX ];
+    lxqt_wallet_error r;
+    int dirfd;
+
+    if (wallet == NULL || wallet->read_only)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    dirfd = _application_directory(wallet->application_name, 0);
+
+    _wallet_file_name(name, sizeof (name), wallet->wallet_name);
+
+    _write_lock(wallet);
+
+    if (_wallet_file_changed(wallet, dirfd, name))
+    {
+        r = _lxqt_wallet_merge(wallet, dirfd, name);
+    }
+    else
+    {
+        r = lxqt_wallet_no_error;
+    }
+
+    _unlock(wallet);
+
+    _release_application_directory(dirfd);
+
+    return r;
+}
+
+#if defined( MFD_ALLOW_SEALING ) && defined( F_ADD_SEALS )
+
+#define SHARED_SEALS ( F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL )
+
+lxqt_wallet_error lxqt_wallet_share(lxqt_wallet_t wallet, int *fd)
+{
+    char header[ SHARED_HEADER_SIZE ] = { '\0' };
+    u_int64_t sizes[ 4 ];
+    int e;
+    int r = 0;
+
+    if (wallet == NULL || fd == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    e = memfd_create("lxqt_wallet", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+    if (e == -1)
+    {
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    _read_lock(wallet);
+
+    sizes[ 0 ] = wallet->wallet_data_entry_count;
+    sizes[ 1 ] = wallet->key_slots == NULL ? 0 : wallet->key_slots_capacity;
+    sizes[ 2 ] = wallet->key_data_size;
+    sizes[ 3 ] = wallet->value_data_size;
+
+    memcpy(header, SHARED_MAGIC_STRING, sizeof(SHARED_MAGIC_STRING));
+    memcpy(header + MAGIC_STRING_BUFFER_SIZE, sizes, sizeof(sizes));
+
+    /*
+     * The memory file has no name in any file system and is only reachable through file descriptors
+     * the caller hands out.
+     */
+    r |= _write_all(e, header, SHARED_HEADER_SIZE);
+    r |= _write_all(e, (const char *)wallet->entries, sizes[ 0 ] * sizeof(struct _entry_header));
+    r |= _write_all(e, (const char *)wallet->key_slots, sizes[ 1 ] * sizeof(u_int64_t));
+    r |= _write_all(e, wallet->key_data, sizes[ 2 ]);
+    r |= _write_all(e, wallet->value_data, sizes[ 3 ]);
+
+    _unlock(wallet);
+
+    if (r != 0 || fcntl(e, F_ADD_SEALS, SHARED_SEALS) != 0)
+    {
+        close(e);
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    *fd = e;
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * check that the entry headers and the hash table of a shared wallet only point into the mapping,returns 0 if they
+ * do.Offsets are checked against arena sizes before anything is added to them so that a crafted offset can not wrap
+ * around.
+ */
+static int _check_shared_entries(const struct lxqt_wallet_struct *w, u_int64_t slot_count)
+{
+    const struct _entry_header *h;
+    u_int64_t free_slots = 0;
+    u_int64_t i;
+
+    for (i = 0; i < slot_count; i++)
+    {
+        if (w->key_slots[ i ] > w->wallet_data_entry_count)
+        {
+            return 1;
+        }
+
+        if (w->key_slots[ i ] == 0)
+        {
+            free_slots++;
+        }
+    }
+
+    /*
+     * a lookup stops at a free slot,a full table would have it go round forever
+     */
+    if (slot_count > 0 && free_slots == 0)
+    {
+        return 1;
+    }
+
+    for (i = 0; i < w->wallet_data_entry_count; i++)
+    {
+        h = w->entries + i;
+
+        if (h->key > w->key_data_size || w->key_data_size - h->key < h->key_size ||
+                h->value > w->value_data_size || w->value_data_size - h->value < h->value_size)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+lxqt_wallet_error lxqt_wallet_attach(lxqt_wallet_t *wallet, int fd)
+{
+    struct lxqt_wallet_struct *w;
+    struct stat st;
+    u_int64_t sizes[ 4 ];
+    u_int64_t size;
+    char *e;
+
+    if (wallet == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    *wallet = NULL;
+
+    /*
+     * A memory file that can still be written to could change under our feet
+     */
+    if ((fcntl(fd, F_GET_SEALS) & SHARED_SEALS) != SHARED_SEALS || fstat(fd, &st) != 0 ||
+            (u_int64_t)st.st_size < SHARED_HEADER_SIZE)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    e = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    if (e == MAP_FAILED)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    mlock(e, st.st_size);
+
+    memcpy(sizes, e + MAGIC_STRING_BUFFER_SIZE, sizeof(sizes));
+
+    size = (u_int64_t)st.st_size - SHARED_HEADER_SIZE;
+
+    /*
+     * every part is checked against what is left of the file so that the sizes can not add up past it by wrapping
+     * around,the hash table is a power of two in size with a free slot or is missing if there are no entries
+     */
+    if (memcmp(e, SHARED_MAGIC_STRING, sizeof(SHARED_MAGIC_STRING)) != 0 ||
+            sizes[ 0 ] > size / sizeof(struct _entry_header) ||
+            sizes[ 1 ] > (size - sizes[ 0 ] * sizeof(struct _entry_header)) / sizeof(u_int64_t) ||
+            sizes[ 2 ] > size - sizes[ 0 ] * sizeof(struct _entry_header) - sizes[ 1 ] * sizeof(u_int64_t) ||
+            sizes[ 3 ] != size - sizes[ 0 ] * sizeof(struct _entry_header) - sizes[ 1 ] * sizeof(u_int64_t) -
+            sizes[ 2 ] ||
+            (sizes[ 1 ] & (sizes[ 1 ] - 1)) != 0 || (sizes[ 1 ] == 0 && sizes[ 0 ] != 0) ||
+            (sizes[ 1 ] != 0 && sizes[ 1 ] <= sizes[ 0 ]))
+    {
+        munmap(e, st.st_size);
+        return lxqt_wallet_incompatible_wallet;
+    }
+
+    w = calloc(1, sizeof(struct lxqt_wallet_struct));
+
+    if (w == NULL)
+    {
+        munmap(e, st.st_size);
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    w->read_only               = 1;
+    w->mapping                 = e;
+    w->mapping_size            = st.st_size;
+    w->wallet_data_entry_count = sizes[ 0 ];
+    w->key_slots_capacity      = sizes[ 1 ];
+    w->key_data_size           = sizes[ 2 ];
+    w->value_data_size         = sizes[ 3 ];
+    w->wallet_data_size        = NODE_HEADER_SIZE * sizes[ 0 ] + sizes[ 2 ] + sizes[ 3 ];
+
+    e += SHARED_HEADER_SIZE;
+
+    w->entries = (struct _entry_header *)e;
+    e += sizes[ 0 ] * sizeof(struct _entry_header);
+
+    w->key_slots = sizes[ 1 ] == 0 ? NULL : (u_int64_t *)e;
+    e += sizes[ 1 ] * sizeof(u_int64_t);
+
+    w->key_data = e;
+    e += sizes[ 2 ];
+
+    w->value_data = e;
+
+    if (_check_shared_entries(w, sizes[ 1 ]) != 0)
+    {
+        return _close_exit(lxqt_wallet_incompatible_wallet, &w, 0);
+    }
+
+    /*
+     * the headers,the hash table and the arenas are used where they are in the mapping,no attached process keeps a
+     * private copy of them
+     */
+    *wallet = w;
+
+    return lxqt_wallet_no_error;
+}
+
+#else
+
+lxqt_wallet_error lxqt_wallet_share(lxqt_wallet_t wallet, int *fd)
+{
+    (void)wallet;
+    (void)fd;
+    return lxqt_wallet_failed_to_open_file;
+}
+
+lxqt_wallet_error lxqt_wallet_attach(lxqt_wallet_t *wallet, int fd)
+{
+    (void)fd;
+
+    if (wallet != NULL)
+    {
+        *wallet = NULL;
+    }
+
+    return lxqt_wallet_failed_to_open_file;
+}
+
+#endif
+
+/*
+ * Manifest file documentation.
+ *
+ * Every application wallet directory has a manifest file that lists wallets in the directory so that they can be
+ * enumerated with one read.It is updated when a wallet is created,saved or deleted while holding the lock of the
+ * directory and it is rebuilt from the directory contents when it is missing or damaged.
+ *
+ * The first 16 bytes are a magic string.
+ * The next 4 bytes are a u_int32_t data type and are used to store the number of entries.
+ * Each entry is made up of a u_int32_t name size,a u_int64_t wallet file size,a u_int64_t number of entries in the
+ * wallet,a u_int32_t wallet format version and the wallet name without its extension.
+ *
+ * The number of entries and the version of a wallet are not known until it is created or saved by this library and
+ * are stored as all bits set and 0 respectively until then.
+ */
+struct _manifest_entry
+{
+    char *name;
+    u_int64_t size;
+    u_int64_t entry_count;
+    u_int32_t version;
+};
+
+struct _manifest
+{
+    struct _manifest_entry *entries;
+    int count;
+    int capacity;
+};
+
+static void _free_manifest(struct _manifest *m)
+{
+    int i;
+
+    for (i = 0; i < m->count; i++)
+    {
+        free(m->entries[ i ].name);
+    }
+
+    free(m->entries);
+
+    m->entries  = NULL;
+    m->count    = 0;
+    m->capacity = 0;
+}
+
+static struct _manifest_entry *_manifest_add(struct _manifest *m, const char *name, size_t name_size)
+{
+    struct _manifest_entry *e;
+    int capacity;
+
+    if (m->count == m->capacity)
+    {
+        capacity = m->capacity == 0 ? 16 : m->capacity * 2;
+
+        e = realloc(m->entries, sizeof(struct _manifest_entry) * capacity);
+
+        if (e == NULL)
+        {
+            return NULL;
+        }
+
+        m->entries  = e;
+        m->capacity = capacity;
+    }
+
+    e = m->entries + m->count;
+
+    e->name = malloc(name_size + 1);
+
+    if (e->name == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(e->name, name, name_size);
+    e->name[ name_size ] = '\0';
+
+    e->size        = 0;
+    e->entry_count = (u_int64_t)-1;
+    e->version     = 0;
+
+    m->count++;
+
+    return e;
+}
+
+static struct _manifest_entry *_manifest_find(struct _manifest *m, const char *name)
+{
+    int i;
+
+    for (i = 0; i < m->count; i++)
+    {
+        if (strcmp(m->entries[ i ].name, name) == 0)
+        {
+            return m->entries + i;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * returns 0 if the manifest was read
+ */
+static int _read_manifest(const char *application_name, struct _manifest *m)
+{
+    struct stat st;
+    struct _manifest_entry *e;
+    u_int32_t count;
+    u_int32_t name_size;
+    u_int32_t i;
+    char *buffer;
+    char *z;
+    char *end;
+    int dirfd;
+    int fd;
+    ssize_t n;
+
+    memset(m, '\0', sizeof(struct _manifest));
+
+    dirfd = _application_directory(application_name, 0);
+
+    fd = openat(dirfd, MANIFEST_FILE_NAME, O_RDONLY | O_CLOEXEC);
+
+    _release_application_directory(dirfd);
+
+    if (fd == -1)
+    {
+        return 1;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)(MAGIC_STRING_BUFFER_SIZE + sizeof(u_int32_t)))
+    {
+        close(fd);
+        return 1;
+    }
+
+    buffer = malloc(st.st_size);
+
+    if (buffer == NULL)
+    {
+        close(fd);
+        return 1;
+    }
+
+    n = read(fd, buffer, st.st_size);
+
+    close(fd);
+
+    if (n != st.st_size || memcmp(buffer, MANIFEST_MAGIC_STRING, sizeof(MANIFEST_MAGIC_STRING)) != 0)
+    {
+        free(buffer);
+        return 1;
+    }
+
+    memcpy(&count, buffer + MAGIC_STRING_BUFFER_SIZE, sizeof(u_int32_t));
+
+    z   = buffer + MAGIC_STRING_BUFFER_SIZE + sizeof(u_int32_t);
+    end = buffer + st.st_size;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((size_t)(end - z) < MANIFEST_ENTRY_HEADER_SIZE)
+        {
+            break;
+        }
+
+        memcpy(&name_size, z, sizeof(u_int32_t));
+
+        if ((size_t)(end - z) - MANIFEST_ENTRY_HEADER_SIZE < name_size)
+        {
+            break;
+        }
+
+        e = _manifest_add(m, z + MANIFEST_ENTRY_HEADER_SIZE, name_size);
+
+        if (e == NULL)
+        {
+            break;
+        }
+
+        memcpy(&e->size, z + sizeof(u_int32_t), sizeof(u_int64_t));
+        memcpy(&e->entry_count, z + sizeof(u_int32_t) + sizeof(u_int64_t), sizeof(u_int64_t));
+        memcpy(&e->version, z + sizeof(u_int32_t) + 2 * sizeof(u_int64_t), sizeof(u_int32_t));
+
+        z += MANIFEST_ENTRY_HEADER_SIZE + name_size;
+    }
+
+    free(buffer);
+
+    if (i != count || z != end)
+    {
+        _free_manifest(m);
+        return 1;
+    }
+
+    return 0;
+}
+
+static void _write_manifest(const char *application_name, const struct _manifest *m)
+{
+    char header[ MAGIC_STRING_BUFFER_SIZE + sizeof(u_int32_t) ] = { '\0' };
+    char entry[ MANIFEST_ENTRY_HEADER_SIZE ];
+    const struct _manifest_entry *e;
+    u_int32_t name_size;
+    u_int32_t count = m->count;
+    int dirfd = _application_directory(application_name, 0);
+    int fd;
+    int i;
+
+    fd = openat(dirfd, MANIFEST_FILE_NAME ".tmp", O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+
+    if (fd == -1)
+    {
+        _release_application_directory(dirfd);
+        return;
+    }
+
+    memcpy(header, MANIFEST_MAGIC_STRING, sizeof(MANIFEST_MAGIC_STRING));
+    memcpy(header + MAGIC_STRING_BUFFER_SIZE, &count, sizeof(u_int32_t));
+
+    write(fd, header, sizeof(header));
+
+    for (i = 0; i < m->count; i++)
+    {
+        e = m->entries + i;
+
+        name_size = strlen(e->name);
+
+        memcpy(entry, &name_size, sizeof(u_int32_t));
+        memcpy(entry + sizeof(u_int32_t), &e->size, sizeof(u_int64_t));
+        memcpy(entry + sizeof(u_int32_t) + sizeof(u_int64_t), &e->entry_count, sizeof(u_int64_t));
+        memcpy(entry + sizeof(u_int32_t) + 2 * sizeof(u_int64_t), &e->version, sizeof(u_int32_t));
+
+        write(fd, entry, MANIFEST_ENTRY_HEADER_SIZE);
+        write(fd, e->name, name_size);
+    }
+
+    close(fd);
+    renameat(dirfd, MANIFEST_FILE_NAME ".tmp", dirfd, MANIFEST_FILE_NAME);
+
+    _release_application_directory(dirfd);
+}
+
+/*
+ * build a manifest from wallet files found in the application directory
+ */
+static int _scan_wallet_directory(const char *application_name, struct _manifest *m)
+{
+    struct _manifest_entry *e;
+    struct dirent *entry;
+    struct stat st;
+    size_t extension_size = strlen(WALLET_EXTENSION);
+    size_t sharded_extension_size = strlen(LXQT_WALLET_SHARDED_EXTENSION);
+    size_t paged_extension_size = strlen(LXQT_WALLET_PAGED_EXTENSION);
+    size_t len;
+    int application_dirfd;
+    int dirfd;
+    DIR *dir;
+
+    memset(m, '\0', sizeof(struct _manifest));
+
+    application_dirfd = _application_directory(application_name, 0);
+
+    dirfd = openat(application_dirfd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    _release_application_directory(application_dirfd);
+
+    if (dirfd == -1)
+    {
+        return 1;
+    }
+
+    dir = fdopendir(dirfd);
+
+    if (dir == NULL)
+    {
+        close(dirfd);
+        return 1;
+    }
+
+    while ((entry = readdir(dir)) != NULL)
+    {
+        len = strlen(entry->d_name);
+
+        if (len > extension_size && strcmp(entry->d_name + len - extension_size, WALLET_EXTENSION) == 0)
+        {
+            e = _manifest_add(m, entry->d_name, len - extension_size);
+        }
+        else if (len > sharded_extension_size &&
+                 strcmp(entry->d_name + len - sharded_extension_size, LXQT_WALLET_SHARDED_EXTENSION) == 0)
+        {
+            e = _manifest_add(m, entry->d_name, len - sharded_extension_size);
+
+            if (e != NULL)
+            {
+                e->version = LXQT_WALLET_SHARDED_VERSION_FLAG;
+            }
+        }
+        else if (len > paged_extension_size &&
+                 strcmp(entry->d_name + len - paged_extension_size, LXQT_WALLET_PAGED_EXTENSION) == 0)
+        {
+            e = _manifest_add(m, entry->d_name, len - paged_extension_size);
+
+            if (e != NULL)
+            {
+                e->version = LXQT_WALLET_PAGED_VERSION_FLAG;
+            }
+        }
+        else
+        {
+            continue;
+        }
+
+        if (e != NULL)
+        {
+            if (fstatat(dirfd, entry->d_name, &st, 0) == 0)
+            {
+                e->size = st.st_size;
+            }
+        }
+    }
+
+    closedir(dir);
+
+    return 0;
+}
+
+/*
+ * record the state of a wallet file in the manifest or remove the wallet from it if "st" is NULL,
+ * the caller must hold the lock of the application directory.
+ */
+static void _update_manifest(const char *wallet_name, const char *application_name, const struct stat *st,
+                             u_int64_t entry_count, int version)
+{
+    struct _manifest m;
+    struct _manifest_entry *e;
+
+    if (_read_manifest(application_name, &m) != 0)
+    {
+        /*
+         * the wallet being updated may or may not be in the directory at this point,it is taken care of below
+         */
+        if (_scan_wallet_directory(application_name, &m) != 0)
+        {
+            return;
+        }
+    }
+
+    e = _manifest_find(&m, wallet_name);
+
+    if (st == NULL)
+    {
+        if (e != NULL)
+        {
+            free(e->name);
+            *e = m.entries[ m.count - 1 ];
+            m.count--;
+        }
+    }
+    else
+    {
+        if (e == NULL)
+        {
+            e = _manifest_add(&m, wallet_name, strlen(wallet_name));
+        }
+
+        if (e != NULL)
+        {
+            e->size        = st->st_size;
+            e->entry_count = entry_count;
+            e->version     = version;
+        }
+    }
+
+    _write_manifest(application_name, &m);
+    _free_manifest(&m);
+}
+
+/*
+ * get the manifest of an application,it is rebuilt if it is missing or damaged
+ */
+static int _get_manifest(const char *application_name, struct _manifest *m)
+{
+    int lock;
+
+    if (_read_manifest(application_name, m) == 0)
+    {
+        return 0;
+    }
+
+    lock = _lock_application_directory(application_name);
+
+    if (_read_manifest(application_name, m) != 0)
+    {
+        if (_scan_wallet_directory(application_name, m) != 0)
+        {
+            _unlock_application_directory(lock);
+            return 1;
+        }
+
+        if (lock != -1)
+        {
+            _write_manifest(application_name, m);
+        }
+    }
+
+    _unlock_application_directory(lock);
+
+    return 0;
+}
+
+int _lxqt_wallet_write_all(int fd, const char *buffer, u_int64_t size)
+{
+    return _write_all(fd, buffer, size);
+}
+
+int _lxqt_wallet_read_all(int fd, char *buffer, u_int64_t size, off_t offset)
+{
+    return _read_all(fd, buffer, size, offset);
+}
+
+int _lxqt_wallet_write_all_at(int fd, const char *buffer, u_int64_t size, off_t offset)
+{
+    return _write_all_at(fd, buffer, size, offset);
+}
+
+char *_lxqt_wallet_locked_buffer(u_int64_t size)
+{
+    return _locked_buffer(size);
+}
+
+void _lxqt_wallet_free_locked_buffer(char *buffer, u_int64_t size)
+{
+    _free_locked_buffer(buffer, size);
+}
+
+int _lxqt_wallet_application_directory(const char *application_name, int create)
+{
+    return _application_directory(application_name, create);
+}
+
+void _lxqt_wallet_release_application_directory(int fd)
+{
+    _release_application_directory(fd);
+}
+
+int _lxqt_wallet_lock_application_directory(const char *application_name)
+{
+    return _lock_application_directory(application_name);
+}
+
+void _lxqt_wallet_unlock_application_directory(int fd)
+{
+    _unlock_application_directory(fd);
+}
+
+void _lxqt_wallet_update_manifest(const char *wallet_name, const char *application_name, const struct stat *st,
+                                  u_int64_t entry_count, int version)
+{
+    _update_manifest(wallet_name, application_name, st, entry_count, version);
+}
+
+char **lxqt_wallet_wallet_list(const char *application_name, int *size)
+{
+    struct _manifest m;
+    char **result;
+    int count = 0;
+    int i;
+
+    if (application_name == NULL || size == NULL)
+    {
+        return NULL;
+    }
+
+    if (_get_manifest(application_name, &m) != 0)
+    {
+        return NULL;
+    }
+
+    result = malloc(sizeof(char *) * ((size_t)m.count + 1));
+
+    if (result == NULL)
+    {
+        _free_manifest(&m);
+        return NULL;
+    }
+
+    /*
+     * names are handed over to the caller,sharded and paged wallets can not be opened with lxqt_wallet_open() and are
+     * left out
+     */
+    for (i = 0; i < m.count; i++)
+    {
+        if (m.entries[ i ].version & (LXQT_WALLET_SHARDED_VERSION_FLAG | LXQT_WALLET_PAGED_VERSION_FLAG))
+        {
+            free(m.entries[ i ].name);
+        }
+        else
+        {
+            result[ count++ ] = m.entries[ i ].name;
+        }
+    }
+
+    result[ count ] = NULL;
+
+    *size = count;
+
+    free(m.entries);
+
+    return result;
+}
+
+lxqt_wallet_info_t *lxqt_wallet_wallet_info_list(const char *application_name, int *size)
+{
+    struct _manifest m;
+    lxqt_wallet_info_t *result;
+    int i;
+
+    if (application_name == NULL || size == NULL)
+    {
+        return NULL;
+    }
+
+    if (_get_manifest(application_name, &m) != 0)
+    {
+        return NULL;
+    }
+
+    result = malloc(sizeof(lxqt_wallet_info_t) * ((size_t)m.count + 1));
+
+    if (result == NULL)
+    {
+        _free_manifest(&m);
+        return NULL;
+    }
+
+    for (i = 0; i < m.count; i++)
+    {
+        result[ i ].wallet_name = m.entries[ i ].name;
+        result[ i ].file_size   = m.entries[ i ].size;
+        result[ i ].entry_count = m.entries[ i ].entry_count == (u_int64_t)-1 ? -1 : (int64_t)m.entries[ i ].entry_count;
+        result[ i ].version     = m.entries[ i ].version == 0 ? -1 : (int)m.entries[ i ].version;
+    }
+
+    memset(result + m.count, '\0', sizeof(lxqt_wallet_info_t));
+
+    *size = m.count;
+
+    free(m.entries);
+
+    return result;
+}
+
+void lxqt_wallet_free_wallet_info_list(lxqt_wallet_info_t *list, int size)
+{
+    int i;
+
+    if (list != NULL)
+    {
+        for (i = 0; i < size; i++)
+        {
+            free(list[ i ].wallet_name);
+        }
+
+        free(list);
     }
 }
 
-int lxqt_wallet_volume_version(const char *wallet_name, const char *application_name, const char *password, u_int32_t password_length)
+int lxqt_wallet_exists(const char *wallet_name, const char *application_name)
 {
-    int fd;
-    int version;
-    struct lxqt_wallet_struct *w = 0;
-
-    gcry_cipher_hd_t handle = 0;
+    struct stat st;
+    char name[ PATH_MAX ];
+    int dirfd;
+    int r;
 
-    char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ];
+    if (wallet_name == NULL || application_name == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
 
-    gcry_error_t r;
+    dirfd = _application_directory(application_name, 0);
 
-    if (wallet_name == NULL || application_name == NULL)
+    if (dirfd == -1)
     {
         return -1;
     }
     else
     {
-        r = _lxqt_wallet_open(password, password_length, wallet_name, application_name, buffer, &fd, &w, &handle);
-
-        if (r != lxqt_wallet_no_error)
-        {
-            return -1;
-        }
-        else
-        {
-            if (_password_match(buffer))
-            {
-                version = _volume_version(buffer);
-                _exit_open(lxqt_wallet_no_error, w, handle, fd);
-                return version;
-            }
-            else
-            {
-                _exit_open(lxqt_wallet_wrong_password, w, handle, fd);
-                return -1;
-            }
-        }
+        r = fstatat(dirfd, _wallet_file_name(name, sizeof(name), wallet_name), &st, 0);
+        _release_application_directory(dirfd);
+        return r;
     }
 }
 
-int lxqt_wallet_read_key_value(lxqt_wallet_t wallet, const char *key, u_int32_t key_size, lxqt_wallet_key_values_t *key_value)
+/*
+ * the caller must hold the storage mutex
+ */
+static void _resolve_storage_root(void)
 {
+    struct passwd *pass;
+    struct stat st;
+    const char *home;
     const char *e;
-    const char *z;
-
-    u_int64_t k = 0;
-    u_int64_t i = 0;
-
-    u_int32_t key_len;
-    u_int32_t key_value_len;
+    char path[ PATH_MAX ];
 
-    if (key == NULL || wallet == NULL || key_value == NULL)
+    if (_storage.resolved)
     {
+        return;
     }
-    else
-    {
-        e = wallet->wallet_data;
-        z = e;
-        k = wallet->wallet_data_size;
 
-        while (i < k)
-        {
-            _get_header_components(&key_len, &key_value_len, e);
+    _storage.resolved = 1;
 
-            if (key_len == key_size && memcmp(key, e + NODE_HEADER_SIZE, key_size) == 0)
-            {
-                key_value->key            = e + NODE_HEADER_SIZE;
-                key_value->key_size       = key_len;
-                key_value->key_value      = e + NODE_HEADER_SIZE + key_len;
-                key_value->key_value_size = key_value_len;
-                return 1;
-            }
-            else
-            {
-                i = i + NODE_HEADER_SIZE + key_len + key_value_len;
-                e = z + i;
-            }
-        }
+    e = getenv(STORAGE_ROOT_ENV);
+
+    if (e != NULL && *e != '\0')
+    {
+        snprintf(_storage.root, sizeof(_storage.root), "%s", e);
+        return;
     }
 
-    return 0;
-}
+    if (_storage.root_override[ 0 ] != '\0')
+    {
+        snprintf(_storage.root, sizeof(_storage.root), "%s", _storage.root_override);
+        return;
+    }
 
-int lxqt_wallet_wallet_has_key(lxqt_wallet_t wallet, const char *key, u_int32_t key_size)
-{
-    lxqt_wallet_key_values_t key_value;
-    return lxqt_wallet_read_key_value(wallet, key, key_size, &key_value);
-}
+    home = getenv("HOME");
 
-int lxqt_wallet_wallet_has_value(lxqt_wallet_t wallet, const char *value, u_int32_t value_size, lxqt_wallet_key_values_t *key_value)
-{
-    const char *e;
-    const char *z;
+    if (home == NULL || *home == '\0')
+    {
+        pass = getpwuid(getuid());
+        home = pass == NULL ? "" : pass->pw_dir;
+    }
 
-    u_int64_t k = 0;
-    u_int64_t i = 0;
+    snprintf(path, sizeof(path), "%s/.config/lxqt/wallets", home);
 
-    u_int32_t key_len;
-    u_int32_t key_value_len;
+    e = getenv("XDG_CONFIG_HOME");
 
-    if (key_value == NULL || wallet == NULL)
+    /*
+     * wallets stay where they are if they were created in "~/.config" before XDG_CONFIG_HOME was set
+     */
+    if (e != NULL && *e == '/')
     {
-        return 0;
+        snprintf(_storage.root, sizeof(_storage.root), "%s/lxqt/wallets", e);
+
+        if (strcmp(_storage.root, path) != 0 && stat(_storage.root, &st) != 0 && stat(path, &st) == 0)
+        {
+            snprintf(_storage.root, sizeof(_storage.root), "%s", path);
+        }
     }
     else
     {
-        e = wallet->wallet_data;
-        z = e;
-        k = wallet->wallet_data_size;
+        snprintf(_storage.root, sizeof(_storage.root), "%s", path);
+    }
+}
+
+/*
+ * close descriptors of stale directories that are no longer in use,called with _storage.mutex held
+ */
+static void _prune_application_directories(void)
+{
+    struct _application_directory **e = &_storage.directories;
+    struct _application_directory *x;
+
+    while (*e != NULL)
+    {
+        x = *e;
 
-        while (i < k)
+        if (x->stale && x->users == 0)
         {
-            _get_header_components(&key_len, &key_value_len, e);
+            *e = x->next;
 
-            if (key_value_len == value_size && memcmp(value, e + NODE_HEADER_SIZE + key_len, value_size) == 0)
-            {
-                key_value->key            = e + NODE_HEADER_SIZE;
-                key_value->key_size       = key_len;
-                key_value->key_value      = e + NODE_HEADER_SIZE + key_len;
-                key_value->key_value_size = key_value_len;
-                return 1;
-            }
-            else
-            {
-                i = i + NODE_HEADER_SIZE + key_len + key_value_len;
-                e = z + i;
-            }
+            close(x->fd);
+            free(x->application_name);
+            free(x);
+        }
+        else
+        {
+            e = &x->next;
         }
-
-        return 0;
     }
 }
 
-lxqt_wallet_error lxqt_wallet_add_key(lxqt_wallet_t wallet, const char *key, u_int32_t key_size,
-                                      const char *value, u_int32_t key_value_length)
+lxqt_wallet_error lxqt_wallet_set_storage_root(const char *path)
 {
-    char *e;
-    char *f;
-
-    u_int64_t len;
+    struct _application_directory *e;
 
-    if (key == NULL || wallet == NULL)
+    if (path != NULL && (*path != '/' || strlen(path) >= PATH_MAX))
     {
         return lxqt_wallet_invalid_argument;
     }
-    else
-    {
-        if (key_size == 0)
-        {
-            return lxqt_wallet_invalid_argument;
-        }
-        else
-        {
-            if (value == NULL || key_value_length == 0)
-            {
-                key_value_length = 0;
-                value = "";
-            }
 
-            len = NODE_HEADER_SIZE + key_size + key_value_length;
-            f = realloc(wallet->wallet_data, wallet->wallet_data_size + len);
-
-            if (f != NULL)
-            {
-                mlock(f, wallet->wallet_data_size + len);
-                e = f + wallet->wallet_data_size;
+    pthread_mutex_lock(&_storage.mutex);
 
-                memcpy(e, &key_size, sizeof(u_int32_t));
-                memcpy(e + sizeof(u_int32_t), &key_value_length, sizeof(u_int32_t));
-                memcpy(e + NODE_HEADER_SIZE, key, key_size);
-                memcpy(e + NODE_HEADER_SIZE + key_size, value, key_value_length);
+    snprintf(_storage.root_override, sizeof(_storage.root_override), "%s", path == NULL ? "" : path);
 
-                wallet->wallet_data_size += len;
-                wallet->wallet_modified = 1;
-                wallet->wallet_data = f;
-                wallet->wallet_data_entry_count++;
+    _storage.resolved = 0;
 
-                return lxqt_wallet_no_error;
-            }
-            else
-            {
-                return lxqt_wallet_failed_to_allocate_memory;
-            }
-        }
+    for (e = _storage.directories; e != NULL; e = e->next)
+    {
+        e->stale = 1;
     }
+
+    _prune_application_directories();
+
+    pthread_mutex_unlock(&_storage.mutex);
+
+    return lxqt_wallet_no_error;
 }
 
-int lxqt_wallet_iter_read_value(lxqt_wallet_t wallet, lxqt_wallet_iterator_t *iter)
+void lxqt_wallet_application_wallet_path(char *path, u_int32_t path_buffer_size, const char *application_name)
 {
-    u_int32_t key_len;
-    u_int32_t key_value_len;
+    pthread_mutex_lock(&_storage.mutex);
 
-    const char *e;
+    _resolve_storage_root();
 
-    if (wallet == NULL || iter->iter_pos >= wallet->wallet_data_size)
-    {
-        return 0;
-    }
-    else
-    {
-        e = wallet->wallet_data + iter->iter_pos;
+    snprintf(path, path_buffer_size, "%s/%s/", _storage.root, application_name);
 
-        _get_header_components(&key_len, &key_value_len, e);
+    pthread_mutex_unlock(&_storage.mutex);
+}
 
-        iter->entry.key             = e + NODE_HEADER_SIZE;
-        iter->entry.key_size        = key_len;
-        iter->entry.key_value       = e + NODE_HEADER_SIZE + key_len;
-        iter->entry.key_value_size  = key_value_len;
+static char *_wallet_full_path(char *path_buffer, u_int32_t path_buffer_size, const char *wallet_name, const char *application_name)
+{
+    char path_1[ PATH_MAX ];
+    lxqt_wallet_application_wallet_path(path_1, sizeof (path_1), application_name);
+    snprintf(path_buffer, path_buffer_size, "%s%s%s", path_1, wallet_name, WALLET_EXTENSION);
+    return path_buffer;
+}
 
-        iter->iter_pos += NODE_HEADER_SIZE + key_len + key_value_len;
+static const char *_wallet_file_name(char *buffer, u_int32_t buffer_size, const char *wallet_name)
+{
+    snprintf(buffer, buffer_size, "%s%s", wallet_name, WALLET_EXTENSION);
+    return buffer;
+}
 
-        return 1;
+static void _create_application_wallet_path(const char *application_name)
+{
+    char path[ PATH_MAX ];
+    char *e;
+
+    lxqt_wallet_application_wallet_path(path, PATH_MAX, application_name);
+
+    for (e = path + 1; *e != '\0'; e++)
+    {
+        if (*e == '/')
+        {
+            *e = '\0';
+            mkdir(path, 0755);
+            *e = '/';
+        }
     }
 }
 
-int lxqt_wallet_read_value_at(lxqt_wallet_t wallet, u_int64_t pos, lxqt_wallet_key_values_t *key_value)
+/*
+ * get a cached descriptor of the directory that holds wallets of an application,all wallet files are
+ * accessed relative to it.The directory is created if "create" is non zero and it does not exist.
+ *
+ * -1 is returned if the directory does not exist or can not be opened.The returned descriptor belongs
+ * to the cache,it must not be closed and it must be given back with _release_application_directory().
+ */
+static int _application_directory(const char *application_name, int create)
 {
-    char *e;
-    char *z;
+    struct _application_directory *e;
+    struct _application_directory *x;
+    struct stat st;
+    char path[ PATH_MAX ];
+    int fd = -1;
 
-    u_int64_t k = 0;
-    u_int64_t i = 0;
+    pthread_mutex_lock(&_storage.mutex);
 
-    u_int32_t key_len = 0;
-    u_int32_t key_value_len = 0;
+    for (e = _storage.directories; e != NULL; e = e->next)
+    {
+        if (!e->stale && strcmp(e->application_name, application_name) == 0)
+        {
+            break;
+        }
+    }
 
-    if (wallet == NULL || wallet->wallet_data_entry_count == 0 || pos > wallet->wallet_data_entry_count)
+    /*
+     * A directory that was removed behind our back has no links left,a descriptor of a replacement directory
+     * is opened then.The old descriptor is closed when the last thread that uses it gives it back.
+     */
+    if (e != NULL && fstat(e->fd, &st) == 0 && st.st_nlink > 0)
     {
-        return 0;
+        e->users++;
+        fd = e->fd;
     }
     else
     {
-        e = wallet->wallet_data;
-        z = e;
-        while (1)
+        _resolve_storage_root();
+
+        snprintf(path, sizeof(path), "%s/%s/", _storage.root, application_name);
+
+        pthread_mutex_unlock(&_storage.mutex);
+
+        if (create)
+        {
+            _create_application_wallet_path(application_name);
+        }
+
+        fd = open(path, DIRECTORY_HANDLE_FLAGS);
+
+        if (fd == -1)
         {
-            _get_header_components(&key_len, &key_value_len, e);
+            return -1;
+        }
 
-            if (k == pos)
-            {
-                key_value->key            = e + NODE_HEADER_SIZE;
-                key_value->key_size       = key_len;
-                key_value->key_value      = e + NODE_HEADER_SIZE + key_len;
-                key_value->key_value_size = key_value_len;
-                break;
-            }
-            else
+        e = malloc(sizeof(struct _application_directory));
+
+        if (e != NULL)
+        {
+            e->application_name = strdup(application_name);
+
+            if (e->application_name == NULL)
             {
-                i = i + NODE_HEADER_SIZE + key_len + key_value_len;
-                e = z + i;
-                k++;
+                free(e);
+                e = NULL;
             }
         }
-        return 1;
-    }
-}
 
-lxqt_wallet_error lxqt_wallet_delete_key(lxqt_wallet_t wallet, const char *key, u_int32_t key_size)
-{
-    char *e;
-    char *z;
+        if (e == NULL)
+        {
+            close(fd);
+            return -1;
+        }
 
-    u_int64_t k = 0;
-    u_int64_t i = 0;
+        e->fd    = fd;
+        e->users = 1;
+        e->stale = 0;
 
-    u_int32_t key_len;
-    u_int32_t key_value_len;
+        pthread_mutex_lock(&_storage.mutex);
+
+        /*
+         * the descriptor this one replaces,or one another thread opened in the meantime,is retired
+         */
+        for (x = _storage.directories; x != NULL; x = x->next)
+        {
+            if (strcmp(x->application_name, application_name) == 0)
+            {
+                x->stale = 1;
+            }
+        }
 
-    u_int64_t block_size;
+        _prune_application_directories();
 
-    if (key == NULL || wallet == NULL)
-    {
-        return lxqt_wallet_invalid_argument;
+        e->next = _storage.directories;
+        _storage.directories = e;
     }
-    else
-    {
-        e = wallet->wallet_data;
-        z = e;
-        k = wallet->wallet_data_size;
 
-        while (i < k)
-        {
-            _get_header_components(&key_len, &key_value_len, e);
+    pthread_mutex_unlock(&_storage.mutex);
 
-            if (key_len == key_size && memcmp(key, e + NODE_HEADER_SIZE, key_size) == 0)
-            {
+    return fd;
+}
 
-                if (wallet->wallet_data_entry_count == 1)
-                {
-                    memset(wallet->wallet_data, '\0', wallet->wallet_data_size);
-                    free(wallet->wallet_data);
-                    wallet->wallet_data_size = 0;
-                    wallet->wallet_modified = 1;
-                    wallet->wallet_data = NULL;
-                    wallet->wallet_data_entry_count = 0;
-                }
-                else
-                {
-                    block_size = NODE_HEADER_SIZE + key_len + key_value_len;
+static void _release_application_directory(int fd)
+{
+    struct _application_directory *e;
 
-                    memmove(e, e + block_size, wallet->wallet_data_size - (i + block_size));
+    if (fd == -1)
+    {
+        return;
+    }
 
-                    memset(z + wallet->wallet_data_size - block_size, '\0', block_size);
+    pthread_mutex_lock(&_storage.mutex);
 
-                    wallet->wallet_data_size -= block_size;
-                    wallet->wallet_modified = 1;
-                    wallet->wallet_data_entry_count--;
-                }
+    for (e = _storage.directories; e != NULL; e = e->next)
+    {
+        if (e->fd == fd && e->users > 0)
+        {
+            e->users--;
 
-                break;
-            }
-            else
+            if (e->stale && e->users == 0)
             {
-                i = i + NODE_HEADER_SIZE + key_len + key_value_len;
-                e = z + i;
+                _prune_application_directories();
             }
+
+            break;
         }
     }
 
-    return lxqt_wallet_no_error;
+    pthread_mutex_unlock(&_storage.mutex);
 }
 
-lxqt_wallet_error lxqt_wallet_delete_wallet(const char *wallet_name, const char *application_name)
+static gcry_error_t _create_temp_key(char *output_key, u_int32_t output_key_size, const char *input_key, u_int32_t input_key_length)
 {
-    char path[ PATH_MAX ];
-    _wallet_full_path(path, PATH_MAX, wallet_name, application_name);
-    unlink(path);
-    return lxqt_wallet_no_error;
+    gcry_md_hd_t md;
+    unsigned char *digest;
+
+    gcry_error_t r = gcry_md_open(&md, GCRY_MD_SHA256, GCRY_MD_FLAG_SECURE);
+
+    if (_passed(r))
+    {
+        gcry_md_write(md, input_key, input_key_length);
+        gcry_md_final(md);
+        digest = gcry_md_read(md, 0);
+        if (digest == NULL)
+        {
+            r = !GPG_ERR_NO_ERROR;
+        }
+        else
+        {
+            memcpy(output_key, digest, output_key_size);
+        }
+        gcry_md_close(md);
+    }
+
+    return r;
 }
 
-static lxqt_wallet_error _close_exit(lxqt_wallet_error err, lxqt_wallet_t *w, gcry_cipher_hd_t handle)
+/*
+ * gcry_kdf_derive() doesnt seem to work with empty passphrases,to work around it,we create a temporary passphrases
+ * based on provided passphrase and then feed the temporary key to gcry_kdf_derive()
+ */
+static gcry_error_t _create_key(const char salt[ SALT_SIZE ],
+                                char output_key[ PASSWORD_SIZE ], const char *input_key, u_int32_t input_key_length)
 {
-    lxqt_wallet_t wallet = *w;
-    *w = NULL;
+    char temp_key[ PASSWORD_SIZE ];
+    gcry_error_t r = _create_temp_key(temp_key, PASSWORD_SIZE, input_key, input_key_length);
 
-    if (handle != 0)
+    if (_passed(r))
     {
-        gcry_cipher_close(handle);
+        r = gcry_kdf_derive(temp_key, PASSWORD_SIZE, GCRY_KDF_PBKDF2, GCRY_MD_SHA256,
+                            salt, SALT_SIZE, PBKDF2_ITERATIONS, PASSWORD_SIZE, output_key);
     }
 
-    if (wallet->wallet_data_size > 0)
-    {
-        memset(wallet->wallet_data, '\0', wallet->wallet_data_size);
-        munlock(wallet->wallet_data, wallet->wallet_data_size);
-        free(wallet->wallet_data);
-    }
-    free(wallet->wallet_name);
-    free(wallet->application_name);
-    free(wallet);
-    return err;
+    memset(temp_key, '\0', PASSWORD_SIZE);
+
+    return r;
 }
 
-lxqt_wallet_error lxqt_wallet_close(lxqt_wallet_t *w)
+/*
+ * Cache of derived keys,enabled with lxqt_wallet_set_key_cache_timeout().
+ *
+ * An entry is looked up through a SHA-256 hash of the wallet path,the salt and the password and it holds
+ * the key derived from them.Entries live in a locked memory page and are wiped when they expire or are purged.
+ */
+struct _cached_key
 {
-    gcry_cipher_hd_t handle;
-    int fd;
-    char iv[ IV_SIZE ];
-    char path[ PATH_MAX ];
-    char path_1[ PATH_MAX+16 ];
-    char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ];
-
-    lxqt_wallet_t wallet;
-
-    u_int64_t k;
-    char *e;
-
-    gcry_error_t r;
+    char path_hash[ PASSWORD_SIZE ];
+    char lookup_hash[ PASSWORD_SIZE ];
+    char key[ PASSWORD_SIZE ];
+    struct timespec expires;
+    int used;
+};
 
-    if (w == NULL || *w == NULL)
-    {
-        return lxqt_wallet_invalid_argument;
-    }
+static struct
+{
+    pthread_mutex_t mutex;
+    int timeout;
+    struct _cached_key *entries;
+} _key_cache = { PTHREAD_MUTEX_INITIALIZER, 0, NULL };
 
-    wallet = *w;
+static int _hash(char output[ PASSWORD_SIZE ], const char *a, size_t a_size,
+                 const char *b, size_t b_size, const char *c, size_t c_size)
+{
+    gcry_md_hd_t md;
+    unsigned char *digest;
 
-    if (wallet->wallet_modified == 0)
+    if (_failed(gcry_md_open(&md, GCRY_MD_SHA256, GCRY_MD_FLAG_SECURE)))
     {
-        return _close_exit(lxqt_wallet_no_error, w, 0);
+        return 0;
     }
 
-    gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+    gcry_md_write(md, a, a_size);
+    gcry_md_write(md, b, b_size);
+    gcry_md_write(md, c, c_size);
+    gcry_md_final(md);
 
-    r = gcry_cipher_open(&handle, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_CBC, 0);
+    digest = gcry_md_read(md, 0);
 
-    if (_failed(r))
+    if (digest != NULL)
     {
-        return _close_exit(lxqt_wallet_gcry_cipher_open_failed, w, 0);
+        memcpy(output, digest, PASSWORD_SIZE);
     }
 
-    r = gcry_cipher_setkey(handle, wallet->key, PASSWORD_SIZE);
+    gcry_md_close(md);
 
-    if (_failed(r))
+    return digest != NULL;
+}
+
+static int _cached_key_expired(const struct _cached_key *e, const struct timespec *now)
+{
+    if (now->tv_sec != e->expires.tv_sec)
     {
-        return _close_exit(lxqt_wallet_gcry_cipher_setkey_failed, w, handle);
+        return now->tv_sec > e->expires.tv_sec;
     }
-
-    _get_random_data(iv, IV_SIZE);
-
-    r = gcry_cipher_setiv(handle, iv, IV_SIZE);
-
-    if (_failed(r))
+    else
     {
-        return _close_exit(lxqt_wallet_gcry_cipher_setiv_failed, w, handle);
+        return now->tv_nsec >= e->expires.tv_nsec;
     }
+}
 
-    _create_magic_string_header(buffer);
-
-    memcpy(buffer + MAGIC_STRING_BUFFER_SIZE, &wallet->wallet_data_size, sizeof(u_int64_t));
-    memcpy(buffer + MAGIC_STRING_BUFFER_SIZE + sizeof(u_int64_t), &wallet->wallet_data_entry_count, sizeof(u_int64_t));
+static void _clear_cached_key(struct _cached_key *e)
+{
+    memset(e, '\0', sizeof(struct _cached_key));
+}
 
-    r = gcry_cipher_encrypt(handle, buffer, MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE, NULL, 0);
+/*
+ * the caller must hold the cache mutex
+ */
+static struct _cached_key *_find_cached_key(const char *path_hash, const char *lookup_hash)
+{
+    struct timespec now;
+    struct _cached_key *e;
+    struct _cached_key *r = NULL;
+    int i;
 
-    if (_failed(r))
+    if (_key_cache.entries == NULL)
     {
-        return _close_exit(lxqt_wallet_gcry_cipher_encrypt_failed, w, handle);
+        return NULL;
     }
 
-    _wallet_full_path(path, sizeof (path), wallet->wallet_name, wallet->application_name);
-    snprintf(path_1, sizeof (path_1), "%s.tmp", path);
-
-    k = wallet->wallet_data_size;
+    clock_gettime(CLOCK_MONOTONIC, &now);
 
-    if (k == 0)
-    {
-        fd = open(path_1, O_WRONLY | O_CREAT, 0600);
-        if (fd == -1)
-        {
-            return _close_exit(lxqt_wallet_gcry_cipher_open_failed, w, handle);
-        }
-        else
-        {
-            write(fd, wallet->salt, SALT_SIZE);
-            write(fd, iv, IV_SIZE);
-            write(fd, buffer, MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE);
-            close(fd);
-            rename(path_1, path);
-            return _close_exit(lxqt_wallet_no_error, w, handle);
-        }
-    }
-    else
+    for (i = 0; i < KEY_CACHE_SIZE; i++)
     {
-        while (k % 32 != 0)
-        {
-            k++;
-        }
-
-        e = realloc(wallet->wallet_data, k);
+        e = _key_cache.entries + i;
 
-        if (e != NULL)
+        if (e->used)
         {
-            wallet->wallet_data = e;
-            r = gcry_cipher_encrypt(handle, wallet->wallet_data, k, NULL, 0);
-            if (_failed(r))
+            if (_cached_key_expired(e, &now))
             {
-                return _close_exit(lxqt_wallet_gcry_cipher_encrypt_failed, w, handle);
+                _clear_cached_key(e);
             }
-            else
+            else if (memcmp(e->path_hash, path_hash, PASSWORD_SIZE) == 0 &&
+                     memcmp(e->lookup_hash, lookup_hash, PASSWORD_SIZE) == 0)
             {
-                fd = open(path_1, O_WRONLY | O_CREAT, 0600);
-                if (fd == -1)
-                {
-                    return _close_exit(lxqt_wallet_gcry_cipher_open_failed, w, handle);
-                }
-                else
-                {
-                    write(fd, wallet->salt, SALT_SIZE);
-                    write(fd, iv, IV_SIZE);
-                    write(fd, buffer, MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE);
-                    write(fd, wallet->wallet_data, k);
-                    close(fd);
-                    rename(path_1, path);
-                    return _close_exit(lxqt_wallet_no_error, w, handle);
-                }
+                r = e;
             }
         }
-        else
-        {
-            return _close_exit(lxqt_wallet_failed_to_allocate_memory, w, handle);
-        }
     }
+
+    return r;
 }
 
-char **lxqt_wallet_wallet_list(const char *application_name, int *size)
+static void _cache_key(const char *path, const char salt[ SALT_SIZE ], const char key[ PASSWORD_SIZE ],
+                       const char *input_key, u_int32_t input_key_length)
 {
-    char path[ PATH_MAX ];
-    char **result = NULL;
-    char **result_1;
-    char *e;
-
-    int count = 0;
-    u_int32_t len;
-    struct dirent *entry;
-    DIR *dir;
-
-    if (application_name == NULL || size == NULL)
-    {
-        return NULL;
-    }
-
-    lxqt_wallet_application_wallet_path(path, PATH_MAX, application_name);
+    char path_hash[ PASSWORD_SIZE ];
+    char lookup_hash[ PASSWORD_SIZE ];
+    struct _cached_key *e;
+    struct _cached_key *f;
+    int i;
 
-    dir = opendir(path);
+    pthread_mutex_lock(&_key_cache.mutex);
 
-    if (dir == NULL)
+    if (_key_cache.timeout > 0 && _key_cache.entries != NULL &&
+            _hash(path_hash, path, strlen(path), "", 0, "", 0) &&
+            _hash(lookup_hash, path_hash, PASSWORD_SIZE, salt, SALT_SIZE, input_key, input_key_length))
     {
-        return NULL;
-    }
+        e = _find_cached_key(path_hash, lookup_hash);
 
-    while ((entry = readdir(dir)) != NULL)
-    {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+        /*
+         * use a free slot or the one that expires first
+         */
+        for (i = 0; e == NULL && i < KEY_CACHE_SIZE; i++)
         {
-            continue;
+            if (!_key_cache.entries[ i ].used)
+            {
+                e = _key_cache.entries + i;
+            }
         }
-
-        len = (u_int32_t)(strlen(entry->d_name) - strlen(WALLET_EXTENSION));
-        if ((int32_t)len > 0)
+        for (i = 0; e == NULL && i < KEY_CACHE_SIZE; i++)
         {
-            result_1 = realloc(result, sizeof(char *) * ((size_t)count + 1));
-            if (result_1 != NULL)
+            f = _key_cache.entries + i;
+
+            if (i == 0 || f->expires.tv_sec < e->expires.tv_sec)
             {
-                e = malloc(len + 1);
-                if (e != NULL)
-                {
-                    memcpy(e, entry->d_name, len);
-                    *(e + len) = '\0';
-                    result_1[ count ] = e;
-                    result = result_1;
-                    count++;
-                }
+                e = f;
             }
         }
+
+        memcpy(e->path_hash, path_hash, PASSWORD_SIZE);
+        memcpy(e->lookup_hash, lookup_hash, PASSWORD_SIZE);
+        memcpy(e->key, key, PASSWORD_SIZE);
+
+        clock_gettime(CLOCK_MONOTONIC, &e->expires);
+        e->expires.tv_sec += _key_cache.timeout;
+        e->used = 1;
     }
 
-    *size = count;
-    closedir(dir);
+    pthread_mutex_unlock(&_key_cache.mutex);
 
-    return result;
+    memset(lookup_hash, '\0', PASSWORD_SIZE);
 }
 
-int lxqt_wallet_exists(const char *wallet_name, const char *application_name)
+/*
+ * derive a key or get it from the cache of derived keys.
+ */
+static gcry_error_t _create_key_cached(const char *path, const char salt[ SALT_SIZE ], char output_key[ PASSWORD_SIZE ],
+                                       const char *input_key, u_int32_t input_key_length)
 {
-    struct stat st;
-    char path[ PATH_MAX ];
-    if (wallet_name == NULL || application_name == NULL)
+    char path_hash[ PASSWORD_SIZE ];
+    char lookup_hash[ PASSWORD_SIZE ];
+    struct _cached_key *e = NULL;
+    gcry_error_t r;
+
+    pthread_mutex_lock(&_key_cache.mutex);
+
+    if (_key_cache.timeout > 0 && _key_cache.entries != NULL &&
+            _hash(path_hash, path, strlen(path), "", 0, "", 0) &&
+            _hash(lookup_hash, path_hash, PASSWORD_SIZE, salt, SALT_SIZE, input_key, input_key_length))
     {
-        return lxqt_wallet_invalid_argument;
+        e = _find_cached_key(path_hash, lookup_hash);
+
+        if (e != NULL)
+        {
+            memcpy(output_key, e->key, PASSWORD_SIZE);
+        }
+
+        memset(lookup_hash, '\0', PASSWORD_SIZE);
     }
-    else
+
+    pthread_mutex_unlock(&_key_cache.mutex);
+
+    if (e != NULL)
     {
-        _wallet_full_path(path, PATH_MAX, wallet_name, application_name);
-        return stat(path, &st);
+        return GPG_ERR_NO_ERROR;
     }
-}
 
-void lxqt_wallet_application_wallet_path(char *path, u_int32_t path_buffer_size, const char *application_name)
-{
-    struct passwd *pass = getpwuid(getuid());
-    snprintf(path, path_buffer_size, "%s/.config/lxqt/wallets/%s/", pass->pw_dir, application_name);
-}
+    r = _create_key(salt, output_key, input_key, input_key_length);
 
-static char *_wallet_full_path(char *path_buffer, u_int32_t path_buffer_size, const char *wallet_name, const char *application_name)
-{
-    char path_1[ PATH_MAX ];
-    lxqt_wallet_application_wallet_path(path_1, sizeof (path_1), application_name);
-    snprintf(path_buffer, path_buffer_size, "%s/%s%s", path_1, wallet_name, WALLET_EXTENSION);
-    return path_buffer;
+    if (_passed(r))
+    {
+        _cache_key(path, salt, output_key, input_key, input_key_length);
+    }
+
+    return r;
 }
 
-static void _create_application_wallet_path(const char *application_name)
+static void _purge_cached_keys(const char *path)
 {
-    char path[ PATH_MAX ];
-    char *e;
+    char path_hash[ PASSWORD_SIZE ];
+    int i;
 
-    lxqt_wallet_application_wallet_path(path, PATH_MAX, application_name);
+    pthread_mutex_lock(&_key_cache.mutex);
 
-    for (e = path + 1; *e != '\0'; e++)
+    if (_key_cache.entries != NULL)
     {
-        if (*e == '/')
+        if (path == NULL)
         {
-            *e = '\0';
-            mkdir(path, 0755);
-            *e = '/';
+            memset(_key_cache.entries, '\0', sizeof(struct _cached_key) * KEY_CACHE_SIZE);
+        }
+        else if (_hash(path_hash, path, strlen(path), "", 0, "", 0))
+        {
+            for (i = 0; i < KEY_CACHE_SIZE; i++)
+            {
+                if (memcmp(_key_cache.entries[ i ].path_hash, path_hash, PASSWORD_SIZE) == 0)
+                {
+                    _clear_cached_key(_key_cache.entries + i);
+                }
+            }
         }
     }
+
+    pthread_mutex_unlock(&_key_cache.mutex);
 }
 
-static gcry_error_t _create_temp_key(char *output_key, u_int32_t output_key_size, const char *input_key, u_int32_t input_key_length)
+lxqt_wallet_error lxqt_wallet_set_key_cache_timeout(int seconds)
 {
-    gcry_md_hd_t md;
-    unsigned char *digest;
+    void *e;
+    size_t size = sizeof(struct _cached_key) * KEY_CACHE_SIZE;
 
-    gcry_error_t r = gcry_md_open(&md, GCRY_MD_SHA256, GCRY_MD_FLAG_SECURE);
+    if (seconds <= 0)
+    {
+        _purge_cached_keys(NULL);
 
-    if (_passed(r))
+        pthread_mutex_lock(&_key_cache.mutex);
+        _key_cache.timeout = 0;
+        pthread_mutex_unlock(&_key_cache.mutex);
+
+        return lxqt_wallet_no_error;
+    }
+
+    pthread_mutex_lock(&_key_cache.mutex);
+
+    if (_key_cache.entries == NULL)
     {
-        gcry_md_write(md, input_key, input_key_length);
-        gcry_md_final(md);
-        digest = gcry_md_read(md, 0);
-        if (digest == NULL)
+        e = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (e == MAP_FAILED)
         {
-            r = !GPG_ERR_NO_ERROR;
+            pthread_mutex_unlock(&_key_cache.mutex);
+            return lxqt_wallet_failed_to_allocate_memory;
         }
-        else
+
+        if (mlock(e, size) != 0)
         {
-            memcpy(output_key, digest, output_key_size);
+            /*
+             * cached keys must never be swapped out
+             */
+            munmap(e, size);
+            pthread_mutex_unlock(&_key_cache.mutex);
+            return lxqt_wallet_failed_to_allocate_memory;
         }
-        gcry_md_close(md);
+#ifdef MADV_DONTDUMP
+        madvise(e, size, MADV_DONTDUMP);
+#endif
+        _key_cache.entries = e;
     }
 
-    return r;
+    _key_cache.timeout = seconds;
+
+    pthread_mutex_unlock(&_key_cache.mutex);
+
+    return lxqt_wallet_no_error;
 }
 
-/*
- * gcry_kdf_derive() doesnt seem to work with empty passphrases,to work around it,we create a temporary passphrases
- * based on provided passphrase and then feed the temporary key to gcry_kdf_derive()
- */
-static gcry_error_t _create_key(const char salt[ SALT_SIZE ],
-                                char output_key[ PASSWORD_SIZE ], const char *input_key, u_int32_t input_key_length)
+void lxqt_wallet_purge_key_cache(void)
 {
-    char temp_key[ PASSWORD_SIZE ];
-    gcry_error_t r = _create_temp_key(temp_key, PASSWORD_SIZE, input_key, input_key_length);
+    _purge_cached_keys(NULL);
+}
 
-    if (_passed(r))
-    {
-        return gcry_kdf_derive(temp_key, PASSWORD_SIZE, GCRY_KDF_PBKDF2, GCRY_MD_SHA256,
-                               salt, SALT_SIZE, PBKDF2_ITERATIONS, PASSWORD_SIZE, output_key);
-    }
-    else
+void lxqt_wallet_purge_wallet_key_cache(const char *wallet_name, const char *application_name)
+{
+    char path[ PATH_MAX ];
+
+    if (wallet_name != NULL && application_name != NULL)
     {
-        return r;
+        _wallet_full_path(path, PATH_MAX, wallet_name, application_name);
+        _purge_cached_keys(path);
     }
 }
 
@@ -1527,14 +7297,43 @@ static void _create_magic_string_header(char magic_string[ MAGIC_STRING_BUFFER_S
     memcpy(magic_string + MAGIC_STRING_SIZE, &version, sizeof(u_int16_t));
 }
 
+/*
+ * set flags of a header created by _create_magic_string_header(),the version is raised to FLAGS_VERSION when a
+ * flag is set to keep older versions of the library from misreading the load
+ */
+static void _set_load_flags(char magic_string[ MAGIC_STRING_BUFFER_SIZE ], int flags)
+{
+    u_int16_t version = FLAGS_VERSION;
+
+    magic_string[ FLAGS_OFFSET ] = (char)flags;
+
+    if (flags != 0)
+    {
+        memcpy(magic_string + MAGIC_STRING_SIZE, &version, sizeof(u_int16_t));
+    }
+}
+
+static int _load_flags(const char *buffer)
+{
+    if (_volume_version(buffer) >= FLAGS_VERSION)
+    {
+        return (unsigned char)buffer[ FLAGS_OFFSET ];
+    }
+    else
+    {
+        return 0;
+    }
+}
+
 static int _wallet_is_compatible(const char *buffer)
 {
     u_int16_t version;
     memcpy(&version, buffer + MAGIC_STRING_SIZE, sizeof(u_int16_t));
     /*
      * This source file should be able to guarantee it can open volumes that have the same major version number
+     * and volumes that use flags
      */
-    return version >= VERSION && version < (VERSION + 100);
+    return version >= VERSION && version < (FLAGS_VERSION + 100);
 }
 
 static int _volume_version(const char *buffer)
@@ -65,7 +65,16 @@ extern "C" {
         lxqt_wallet_invalid_argument,
         lxqt_wallet_incompatible_wallet,
         lxqt_wallet_failed_to_create_key_hash,
-        lxqt_wallet_libgcrypt_version_mismatch
+        lxqt_wallet_libgcrypt_version_mismatch,
+        lxqt_wallet_failed_to_merge_changes,
+        lxqt_wallet_failed_to_connect_to_agent,
+        lxqt_wallet_wallet_not_unlocked,
+        lxqt_wallet_key_not_found,
+        lxqt_wallet_authentication_failed,
+        /*
+         * the wallet is open in another handle that has it to itself
+         */
+        lxqt_wallet_wallet_busy
     } lxqt_wallet_error;
 
     /*
@@ -74,6 +83,13 @@ extern "C" {
      */
     lxqt_wallet_error lxqt_wallet_add_key(lxqt_wallet_t, const char *key, u_int32_t key_size, const char *key_value, u_int32_t key_value_length) ;
 
+    /*
+     * make room for "entry_count" more entries whose keys and values add up to "size" bytes so that adding them
+     * does not reallocate the memory that holds the entries of the wallet.Keys and values are kept apart and both
+     * are made large enough for "size" bytes.
+     */
+    lxqt_wallet_error lxqt_wallet_reserve(lxqt_wallet_t, u_int64_t entry_count, u_int64_t size) ;
+
     /*
      * open "wallet_name" wallet of application "application_name" using a password of size password_length.
      *
@@ -82,6 +98,60 @@ extern "C" {
     lxqt_wallet_error lxqt_wallet_open(lxqt_wallet_t *, const char *password, u_int32_t password_length,
                                        const char *wallet_name, const char *application_name) ;
 
+    /*
+     * enable or disable a process wide cache of opened wallets,the cache is disabled by default.
+     *
+     * With the cache enabled,opening a wallet that is already opened in the process returns the already opened
+     * handle if the password derives the same key.The wallet file is not read and decrypted again and all
+     * openers share the same entries.Shared handles are thread safe,see lxqt_wallet_set_thread_safe().
+     * Handles are matched by the full path of the wallet file,a wallet opened after the storage root changed
+     * is read from its new location and does not share a handle opened from the old one.
+     *
+     * Each successful lxqt_wallet_open() must be matched by lxqt_wallet_close().A shared wallet is saved,wiped and
+     * freed when its last opener closes it.
+     *
+     * Disabling the cache does not affect handles that are already shared.
+     */
+    void lxqt_wallet_set_handle_cache(int enable) ;
+
+    /*
+     * open "count" wallets of application "application_name" whose names are in "wallet_names" using the same password.
+     *
+     * Wallets are opened in parallel by a pool of threads sized to the number of processors and hence opening
+     * many wallets takes about as long as opening the slowest of them.
+     * On return,"wallets[ i ]" holds the handle of wallet "wallet_names[ i ]" and "errors[ i ]" holds the result of
+     * opening it.Handles of wallets that failed to open are set to NULL and every opened handle must be closed with
+     * lxqt_wallet_close().
+     *
+     * lxqt_wallet_no_error is returned if all wallets were opened,otherwise the error of the first wallet in the
+     * list that failed to open is returned.
+     */
+    lxqt_wallet_error lxqt_wallet_open_many(lxqt_wallet_t *wallets, lxqt_wallet_error *errors, const char **wallet_names,
+                                            int count, const char *password, u_int32_t password_length,
+                                            const char *application_name) ;
+
+    /*
+     * enable a cache of keys derived from wallet passwords,the cache is disabled by default.
+     *
+     * With the cache enabled,a key derived when a wallet is opened or its password is changed is kept in locked
+     * memory for "seconds" seconds and opening the same wallet with the same password again within that time skips
+     * the expensive key derivation.Entries are looked up through a hash of the wallet path,its salt and the password.
+     *
+     * A value of 0 or less disables the cache and wipes all cached keys.
+     * lxqt_wallet_failed_to_allocate_memory is returned if memory for the cache could not be locked.
+     */
+    lxqt_wallet_error lxqt_wallet_set_key_cache_timeout(int seconds) ;
+
+    /*
+     * wipe all cached keys
+     */
+    void lxqt_wallet_purge_key_cache(void) ;
+
+    /*
+     * wipe cached keys of wallet "wallet_name" of application "application_name"
+     */
+    void lxqt_wallet_purge_wallet_key_cache(const char *wallet_name, const char *application_name) ;
+
     /*
      * create a new wallet named "wallet_name" owned by application "application_name" using a password "password" of size "password_length".
      */
@@ -96,6 +166,41 @@ extern "C" {
      */
     char **lxqt_wallet_wallet_list(const char *application_name, int *size) ;
 
+    typedef struct
+    {
+        char *wallet_name ;
+        /*
+         * size of the wallet file in bytes
+         */
+        u_int64_t file_size ;
+        /*
+         * number of entries in the wallet and its format version,
+         * -1 if the wallet was not created or saved by this library since the wallet list was last rebuilt.
+         */
+        int64_t entry_count ;
+        int version ;
+    } lxqt_wallet_info_t ;
+
+    /*
+     * set in "version" of sharded wallets
+     */
+#define LXQT_WALLET_SHARDED_VERSION_FLAG 0x10000
+
+    /*
+     * set in "version" of paged wallets
+     */
+#define LXQT_WALLET_PAGED_VERSION_FLAG 0x20000
+
+    /*
+     * give a list of all wallets that belong to a program together with information about them.
+     * Information comes from a manifest file kept in the program's wallet directory and wallets are not opened.
+     * Returned array is terminated by an entry with a NULL wallet_name and "size" argument will contain the number
+     * of wallets.The returned list must be released with lxqt_wallet_free_wallet_info_list().
+     */
+    lxqt_wallet_info_t *lxqt_wallet_wallet_info_list(const char *application_name, int *size) ;
+
+    void lxqt_wallet_free_wallet_info_list(lxqt_wallet_info_t *, int size) ;
+
     /*
      * return the version of the library used to create the volume.
      * -1 is returned on error
@@ -119,9 +224,59 @@ extern "C" {
 
     /*
      * close a wallet handle.
+     *
+     * A modified wallet is saved while holding an exclusive advisory lock on the application's wallet directory.
+     * If the wallet file was saved by another handle or process since this handle opened it,the newer file is
+     * read and keys added or deleted through this handle are replayed on top of it before saving,other changes
+     * are kept.
+     *
+     * lxqt_wallet_failed_to_merge_changes is returned and nothing is saved if the newer file can not be decrypted
+     * with the key of this handle,ie when its password was changed somewhere else,or if the wallet was deleted
+     * since this handle opened it.
      */
     lxqt_wallet_error lxqt_wallet_close(lxqt_wallet_t *) ;
 
+    /*
+     * save changes made to the wallet without closing it.
+     * Saving follows the same locking and merging rules as lxqt_wallet_close() and the handle remains usable afterwards.
+     */
+    lxqt_wallet_error lxqt_wallet_save(lxqt_wallet_t) ;
+
+    /*
+     * Functions below share one decrypted copy of a wallet between processes.
+     *
+     * lxqt_wallet_share() copies the decrypted entries of a wallet with their keys,values and hash table into a sealed
+     * memory file created with memfd_create() and returns its file descriptor through "fd".The file can not be
+     * modified once created and the caller is responsible for closing it and for passing it only to trusted processes,
+     * lxqt_wallet-agent passes it with SCM_RIGHTS to processes of the same user through lxqt_wallet_agent_attach().
+     *
+     * lxqt_wallet_attach() opens a read only handle backed by a shared mapping of a memory file created by
+     * lxqt_wallet_share(),all processes attached to the same file share one copy of the wallet in memory.
+     * Functions that modify a wallet,lxqt_wallet_save() and lxqt_wallet_reload() return lxqt_wallet_invalid_argument
+     * on an attached handle.The handle is a snapshot of the wallet at the time it was shared and it must be
+     * released with lxqt_wallet_close().The file descriptor is not closed and may be closed after the call.
+     *
+     * lxqt_wallet_invalid_argument is returned if the file is not sealed and lxqt_wallet_incompatible_wallet is returned
+     * if it was not created by lxqt_wallet_share().
+     * Both functions return lxqt_wallet_failed_to_open_file on systems without support for sealed memory files.
+     */
+    lxqt_wallet_error lxqt_wallet_share(lxqt_wallet_t, int *fd) ;
+
+    lxqt_wallet_error lxqt_wallet_attach(lxqt_wallet_t *, int fd) ;
+
+    /*
+     * returns 1 if the wallet file was saved by another handle or process after this handle opened it and 0 otherwise.
+     * The check costs a stat() and,if the file looks unchanged,a read and decryption of the 64 bytes wallet header.
+     */
+    int lxqt_wallet_wallet_changed(lxqt_wallet_t) ;
+
+    /*
+     * bring in changes made to the wallet file by another handle or process.
+     * Keys added or deleted through this handle take precedence over the ones in the file.
+     * Content of lxqt_wallet_key_values_t structures returned earlier are undefined after this call.
+     */
+    lxqt_wallet_error lxqt_wallet_reload(lxqt_wallet_t) ;
+
     /*
      * Check if a wallet named "wallet_name" of an application named "application_name" exists
      * returns 0 if the wallet exist
@@ -130,10 +285,25 @@ extern "C" {
 
     /*
      * returns a path to where the wallet file is stored.
-     * on return path_buffer will contain something like "/home/$USER/.local/application_name/wallets"
+     * on return path_buffer will contain something like "/home/$USER/.config/lxqt/wallets/application_name/"
      */
     void lxqt_wallet_application_wallet_path(char *path_buffer, u_int32_t path_buffer_size, const char *application_name) ;
 
+    /*
+     * set the directory wallets of all applications are stored in,"path" must be an absolute path.
+     * Passing NULL restores the default location.
+     *
+     * The location is looked up in this order:
+     * 1. the "LXQT_WALLET_STORAGE_ROOT" environment variable.
+     * 2. the path set with this function.
+     * 3. "$XDG_CONFIG_HOME/lxqt/wallets" unless wallets already exist in "~/.config/lxqt/wallets".
+     * 4. "~/.config/lxqt/wallets".
+     *
+     * Descriptors of application directories are cached and this function drops them,it should be called
+     * before wallets are opened and not while other threads are using the library.
+     */
+    lxqt_wallet_error lxqt_wallet_set_storage_root(const char *path) ;
+
     /*
      * returns the amount of memory managed data consumes.
      */
@@ -158,6 +328,13 @@ extern "C" {
         lxqt_wallet_key_values_t entry ;
     } lxqt_wallet_iterator_t ;
 
+    /*
+     * add "count" entries in one go,the memory that holds the entries of the wallet is grown once for all of them.
+     * Entries are added the same way lxqt_wallet_add_key() adds them and keys that are already in the wallet are
+     * not looked for.Either all entries are added or none is.
+     */
+    lxqt_wallet_error lxqt_wallet_add_keys(lxqt_wallet_t, const lxqt_wallet_key_values_t *entries, u_int64_t count) ;
+
     /*
      * iterate over the internal data structure and return an entry at the current interator position.
      * Any operation that modifies the internal data structure invalidates the iterator.
@@ -170,6 +347,21 @@ extern "C" {
      */
     int lxqt_wallet_iter_read_value(lxqt_wallet_t, lxqt_wallet_iterator_t *) ;
 
+    /*
+     * iterate over entries the same way lxqt_wallet_iter_read_value() does,for callers that only look at keys.
+     * Keys are kept apart from values and walking over keys does not read any value.Returned keys and values point
+     * into the wallet and stay valid until the next change to the wallet.
+     * Both functions use the same iterator positions.
+     */
+    int lxqt_wallet_iter_read_key(lxqt_wallet_t, lxqt_wallet_iterator_t *) ;
+
+    /*
+     * iterate over entries whose keys start with the first "prefix_size" bytes of "prefix",only keys of entries
+     * that are passed over are read.
+     * It returns the same way lxqt_wallet_iter_read_value() does and uses the same iterator positions.
+     */
+    int lxqt_wallet_iter_read_prefix(lxqt_wallet_t, const char *prefix, u_int32_t prefix_size, lxqt_wallet_iterator_t *) ;
+
     /*
      * 1 is returned if a matching key was found and key_value structure was filled up.
      * 0 is returned if a matching key was not found.
@@ -190,11 +382,49 @@ extern "C" {
      */
     int lxqt_wallet_wallet_has_value(lxqt_wallet_t, const char *value, u_int32_t value_size, lxqt_wallet_key_values_t *key_value) ;
 
+    /*
+     * make a wallet handle safe to use from multiple threads at the same time.
+     * This function must be called before the handle is shared with other threads and can not be undone.
+     *
+     * A thread safe handle is protected by a reader-writer lock.Lookups and iterations take the lock in shared
+     * mode and do not block each other,lxqt_wallet_add_key(),lxqt_wallet_delete_key(),lxqt_wallet_reload() and
+     * lxqt_wallet_change_wallet_password() take it exclusively and their changes become visible to readers all at once.
+     *
+     * Returned lxqt_wallet_key_values_t structures point into the wallet and are undefined after a change made by
+     * any thread.A thread that wants to keep using them while other threads are adding or deleting entries should
+     * bracket the lookup and the use of the result with lxqt_wallet_read_lock() and lxqt_wallet_read_unlock().
+     *
+     * lxqt_wallet_close() must not be called while other threads are still using the handle.
+     */
+    lxqt_wallet_error lxqt_wallet_set_thread_safe(lxqt_wallet_t) ;
+
+    /*
+     * hold the lock of a thread safe handle in shared mode,read locks may be nested.
+     * These functions do nothing on handles that are not thread safe.
+     */
+    void lxqt_wallet_read_lock(lxqt_wallet_t) ;
+    void lxqt_wallet_read_unlock(lxqt_wallet_t) ;
+
     /*
      * change the wallet password
      */
     lxqt_wallet_error lxqt_wallet_change_wallet_password(lxqt_wallet_t, const char *new_password, u_int32_t new_password_size) ;
 
+    /*
+     * store the entries of the wallet compressed with zlib from the next time the wallet is saved on,or stop doing so
+     * if "compress" is 0.Compression is on for wallets that were saved compressed.
+     *
+     * Entries are kept uncompressed in memory and only their stored form is compressed.A wallet whose entries do not
+     * get smaller is stored uncompressed.Compressed wallets have version 300 and can not be opened by versions of
+     * this library older than 3.0.0.
+     */
+    lxqt_wallet_error lxqt_wallet_set_compression(lxqt_wallet_t, int compress) ;
+
+    /*
+     * returns 1 if the wallet is stored compressed or is going to be on the next save
+     */
+    int lxqt_wallet_compression(lxqt_wallet_t) ;
+
     /*
      * get a file given by argument "source" and create an encrypted version of the file given by argument "destination" using
      * a password "password" of length "password_length"
@@ -214,8 +444,340 @@ extern "C" {
      */
     lxqt_wallet_error lxqt_wallet_create_decrypted_file(const char *password, u_int32_t password_length,
             const char *source, const char *destination, int(*function)(int, void *), void *) ;
+
+    /*
+     * work the same way as lxqt_wallet_create_encrypted_file() but compress the file with zlib before encrypting it.
+     *
+     * lxqt_wallet_create_decrypted_file() tells compressed files apart through a flag in their header.Compressed files
+     * can not be used with lxqt_wallet_decrypt_range().
+     */
+    lxqt_wallet_error lxqt_wallet_create_compressed_encrypted_file(const char *password, u_int32_t password_length,
+            const char *source, const char *destination, int(*function)(int, void *), void *) ;
+
+    /*
+     * get a file given by argument "source" and create an encrypted version of the file given by argument "destination" using
+     * a password "password" of length "password_length".
+     *
+     * The file is encrypted in independently authenticated chunks and any part of it can be decrypted with
+     * lxqt_wallet_decrypt_range() without decrypting the rest.lxqt_wallet_create_decrypted_file() decrypts files
+     * created by both this function and lxqt_wallet_create_encrypted_file().
+     *
+     * lxqt_wallet_authentication_failed is returned when decrypting a file that was modified after it was created.
+     *
+     * function works the same way as in lxqt_wallet_create_encrypted_file().
+     */
+    lxqt_wallet_error lxqt_wallet_create_seekable_encrypted_file(const char *password, u_int32_t password_length,
+            const char *source, const char *destination, int(*function)(int, void *), void *) ;
+
+    /*
+     * decrypt "length" bytes starting at "offset" of the plain text of an encrypted file "source" into "buffer".
+     *
+     * Only the parts of the file that hold the requested bytes are read and decrypted,a few MiB at a time no matter how
+     * long the range is.On success,"buffer_size" is set to the number of bytes put in the buffer,it is less than
+     * "length" if the range goes past the end of the file.
+     *
+     * The file may have been created by lxqt_wallet_create_seekable_encrypted_file() or by
+     * lxqt_wallet_create_encrypted_file().Ranges of the former are authenticated and lxqt_wallet_authentication_failed
+     * is returned with nothing put in the buffer if any part of the range was modified.The latter format has no
+     * authentication and its ranges are returned as they decrypt,a modified file gives garbage instead of an error.
+     */
+    lxqt_wallet_error lxqt_wallet_decrypt_range(const char *password, u_int32_t password_length, const char *source,
+            u_int64_t offset, u_int64_t length, char *buffer, u_int64_t *buffer_size) ;
+
+    /*
+     * encrypt everything read from file descriptor "fd_src" until its end and write the result to file descriptor
+     * "fd_dest".The descriptors may be pipes or sockets,neither is seeked and neither is closed.
+     *
+     * The output is a seekable encrypted file whose header does not record its size,it can be decrypted by
+     * lxqt_wallet_decrypt_stream() or,once saved to a file,by lxqt_wallet_create_decrypted_file() and
+     * lxqt_wallet_decrypt_range().
+     *
+     * "function" may be NULL,it is called with the number of bytes read from "fd_src" so far,not counting the header
+     * of an encrypted stream,and the operation is stopped if it returns 1.
+     */
+    lxqt_wallet_error lxqt_wallet_encrypt_stream(const char *password, u_int32_t password_length, int fd_src,
+            int fd_dest, int(*function)(u_int64_t, void *), void *) ;
+
+    /*
+     * work the same way as lxqt_wallet_encrypt_stream() but encrypt "size" bytes in "buffer",the size is recorded
+     * in the header.The buffer is read a few chunks at a time and is not copied as a whole.
+     */
+    lxqt_wallet_error lxqt_wallet_encrypt_buffer(const char *password, u_int32_t password_length, const char *buffer,
+            u_int64_t size, int fd_dest) ;
+
+    /*
+     * decrypt a seekable encrypted file read from file descriptor "fd_src" until its end and write the plain text to
+     * file descriptor "fd_dest".
+     *
+     * Plain text is written as soon as each chunk is authenticated and lxqt_wallet_authentication_failed is returned
+     * if the stream is cut short or modified,the plain text written until then should then be thrown away.
+     *
+     * "function" works the same way as in lxqt_wallet_encrypt_stream().
+     */
+    lxqt_wallet_error lxqt_wallet_decrypt_stream(const char *password, u_int32_t password_length, int fd_src,
+            int fd_dest, int(*function)(u_int64_t, void *), void *) ;
+
+    /*
+     * set the size of buffers lxqt_wallet_create_encrypted_file() and lxqt_wallet_create_decrypted_file() stream files
+     * through.Files are read,encrypted or decrypted and written concurrently through a ring of such buffers.
+     * On linux,reads and writes are done through io_uring when the running kernel supports it.
+     *
+     * The size is rounded down to a multiple of 1024 and is kept between 1 MiB and 8 MiB,the default is 1 MiB.
+     * This function should be called before either of the two functions above is in use.
+     */
+    void lxqt_wallet_set_file_buffer_size(u_int32_t size) ;
+
+    /*
+     * Functions below talk to a running lxqt_wallet-agent.
+     *
+     * The agent keeps unlocked wallets in locked memory and lets processes of the user that started it read and
+     * modify them without knowing their passwords and without paying the cost of opening them.
+     *
+     * The agent listens on a unix domain socket whose path is taken from "LXQT_WALLET_AGENT_SOCKET" environment
+     * variable and defaults to "$XDG_RUNTIME_DIR/lxqt_wallet-agent.socket" or "/tmp/lxqt_wallet-agent-$UID/agent.socket"
+     * if XDG_RUNTIME_DIR is not set.The agent and its clients refuse to talk to processes of other users.
+     *
+     * Changes made through the agent are saved shortly after they are made and when the wallet is locked.
+     */
+    typedef struct lxqt_wallet_agent_struct *lxqt_wallet_agent_t ;
+
+    /*
+     * get the path of the agent socket
+     */
+    void lxqt_wallet_agent_socket_path(char *path_buffer, u_int32_t path_buffer_size) ;
+
+    /*
+     * connect to the agent,lxqt_wallet_failed_to_connect_to_agent is returned if the agent is not running.
+     */
+    lxqt_wallet_error lxqt_wallet_agent_connect(lxqt_wallet_agent_t *) ;
+
+    void lxqt_wallet_agent_disconnect(lxqt_wallet_agent_t *) ;
+
+    /*
+     * ask the agent to open a wallet and keep it unlocked.
+     * Unlocking a wallet the agent already has unlocked succeeds without checking the password.
+     */
+    lxqt_wallet_error lxqt_wallet_agent_unlock(lxqt_wallet_agent_t, const char *password, u_int32_t password_length,
+            const char *wallet_name, const char *application_name) ;
+
+    /*
+     * ask the agent to save and close a wallet
+     */
+    lxqt_wallet_error lxqt_wallet_agent_lock(lxqt_wallet_agent_t, const char *wallet_name, const char *application_name) ;
+
+    /*
+     * ask the agent to save a wallet now instead of shortly after it was last modified,the wallet stays unlocked
+     */
+    lxqt_wallet_error lxqt_wallet_agent_save(lxqt_wallet_agent_t, const char *wallet_name, const char *application_name) ;
+
+    /*
+     * returns 1 if the agent has the wallet unlocked and 0 otherwise
+     */
+    int lxqt_wallet_agent_has_wallet(lxqt_wallet_agent_t, const char *wallet_name, const char *application_name) ;
+
+    /*
+     * Functions below return lxqt_wallet_wallet_not_unlocked if the agent does not have the wallet unlocked.
+     */
+
+    /*
+     * returns lxqt_wallet_no_error if the wallet has the key and lxqt_wallet_key_not_found if it does not.
+     */
+    lxqt_wallet_error lxqt_wallet_agent_has_key(lxqt_wallet_agent_t, const char *wallet_name, const char *application_name,
+            const char *key, u_int32_t key_size) ;
+
+    /*
+     * get a value of a key,lxqt_wallet_key_not_found is returned if the wallet does not have the key.
+     * On success,"value" will point to a copy of the value that must be released with lxqt_wallet_agent_free_value().
+     */
+    lxqt_wallet_error lxqt_wallet_agent_get(lxqt_wallet_agent_t, const char *wallet_name, const char *application_name,
+                                            const char *key, u_int32_t key_size, char **value, u_int32_t *value_size) ;
+
+    /*
+     * wipe and free a value returned by lxqt_wallet_agent_get()
+     */
+    void lxqt_wallet_agent_free_value(char *value, u_int32_t value_size) ;
+
+    lxqt_wallet_error lxqt_wallet_agent_add_key(lxqt_wallet_agent_t, const char *wallet_name, const char *application_name,
+            const char *key, u_int32_t key_size, const char *value, u_int32_t value_size) ;
+
+    lxqt_wallet_error lxqt_wallet_agent_delete_key(lxqt_wallet_agent_t, const char *wallet_name, const char *application_name,
+            const char *key, u_int32_t key_size) ;
+
+    /*
+     * call "function" with every key in the wallet,listing stops if "function" returns non zero.
+     */
+    lxqt_wallet_error lxqt_wallet_agent_list(lxqt_wallet_agent_t, const char *wallet_name, const char *application_name,
+            int(*function)(const char *key, u_int32_t key_size, void *), void *) ;
+
+    /*
+     * get a read only handle to a wallet the agent has unlocked,see lxqt_wallet_attach().
+     * Processes attached to the same wallet share its decrypted copy until the wallet is modified.
+     */
+    lxqt_wallet_error lxqt_wallet_agent_attach(lxqt_wallet_agent_t, const char *wallet_name, const char *application_name,
+            lxqt_wallet_t *) ;
+
+    /*
+     * ask the agent to save and close all wallets and exit
+     */
+    lxqt_wallet_error lxqt_wallet_agent_stop(lxqt_wallet_agent_t) ;
+
+    /*
+     * Functions below work on sharded wallets.
+     *
+     * A sharded wallet is one logical wallet whose entries are spread over "shard_count" encrypted shard files by a
+     * keyed hash of their keys.The password is run through PBKDF2 once when the wallet is opened,a shard is read and
+     * decrypted only when an entry in it is first looked up or changed and only shards that changed are written when
+     * the wallet is saved.They suit wallets with very many entries,a single key read or write costs work proportional
+     * to the size of one shard.
+     *
+     * Sharded wallets are kept in "YYY.lws" and "YYY.shards/" in the wallet folder of the application.They do not show
+     * up in lxqt_wallet_wallet_list() but are listed by lxqt_wallet_wallet_info_list() with
+     * LXQT_WALLET_SHARDED_VERSION_FLAG set in their version.Sharded,paged and ".lwt" wallets of an application share
+     * one name space.A handle must not be used by more than one thread at a time.
+     */
+    typedef struct lxqt_wallet_sharded_struct *lxqt_wallet_sharded_t ;
+
+    /*
+     * "shard_count" must be between 1 and 65536,lxqt_wallet_wallet_exists is returned if a wallet of any kind with
+     * the name exists.
+     */
+    lxqt_wallet_error lxqt_wallet_sharded_create(const char *password, u_int32_t password_length, u_int32_t shard_count,
+            const char *wallet_name, const char *application_name) ;
+
+    lxqt_wallet_error lxqt_wallet_sharded_open(lxqt_wallet_sharded_t *, const char *password, u_int32_t password_length,
+            const char *wallet_name, const char *application_name) ;
+
+    /*
+     * returns 0 if the sharded wallet exists
+     */
+    int lxqt_wallet_sharded_exists(const char *wallet_name, const char *application_name) ;
+
+    u_int32_t lxqt_wallet_sharded_shard_count(lxqt_wallet_sharded_t) ;
+
+    /*
+     * work the same way as their lxqt_wallet_t counterparts,values returned through "key_value" and iterators are
+     * invalidated by changes to the wallet and by saves.lxqt_wallet_sharded_add_key() replaces the value of a key the
+     * wallet has.lxqt_wallet_authentication_failed is returned when a shard file is missing,damaged or is not the one
+     * the index of the wallet lists.
+     */
+    int lxqt_wallet_sharded_read_key_value(lxqt_wallet_sharded_t, const char *key, u_int32_t key_size,
+                                           lxqt_wallet_key_values_t *key_value) ;
+
+    int lxqt_wallet_sharded_has_key(lxqt_wallet_sharded_t, const char *key, u_int32_t key_size) ;
+
+    lxqt_wallet_error lxqt_wallet_sharded_add_key(lxqt_wallet_sharded_t, const char *key, u_int32_t key_size,
+            const char *value, u_int32_t value_size) ;
+
+    lxqt_wallet_error lxqt_wallet_sharded_delete_key(lxqt_wallet_sharded_t, const char *key, u_int32_t key_size) ;
+
+    /*
+     * iterate over entries of all shards,shards are read as the iteration gets to them
+     */
+    int lxqt_wallet_sharded_iter_read_value(lxqt_wallet_sharded_t, lxqt_wallet_iterator_t *) ;
+
+    /*
+     * tell apart a key that is not in the wallet or the end of an iteration from a shard that could not be read when
+     * lxqt_wallet_sharded_read_key_value(),lxqt_wallet_sharded_has_key() or lxqt_wallet_sharded_iter_read_value()
+     * returns 0,lxqt_wallet_no_error is returned in the former case.
+     */
+    lxqt_wallet_error lxqt_wallet_sharded_last_error(lxqt_wallet_sharded_t) ;
+
+    /*
+     * Write shards that changed since they were last saved.The shards and the index that lists them are replaced as
+     * one,a save that is cut short leaves the wallet as it was.Changes saved by other handles in the meantime are kept
+     * and keys added or deleted through this handle are replayed on top of them,the last handle to save a key wins.
+     */
+    lxqt_wallet_error lxqt_wallet_sharded_save(lxqt_wallet_sharded_t) ;
+
+    lxqt_wallet_error lxqt_wallet_sharded_close(lxqt_wallet_sharded_t *) ;
+
+    lxqt_wallet_error lxqt_wallet_sharded_delete_wallet(const char *wallet_name, const char *application_name) ;
+
+    /*
+     * Functions below work on paged wallets.
+     *
+     * A paged wallet keeps its entries sorted by key in a copy on write B+tree of 4 KiB pages that are encrypted and
+     * authenticated one by one.A lookup,an insert or a delete reads only the pages on the path from the root to the
+     * entry,decrypted pages are kept in a small cache and a save writes only pages that changed before it switches
+     * the wallet over to them,a save that is cut short leaves the wallet as it was at the previous save.
+     *
+     * Keys can be up to 512 bytes long and values up to 2 GiB,values larger than about 1000 bytes are kept in pages
+     * of their own.Paged wallets are kept in "YYY.lwp" in the wallet folder of the application,they do not show up in
+     * lxqt_wallet_wallet_list() but are listed by lxqt_wallet_wallet_info_list() with LXQT_WALLET_PAGED_VERSION_FLAG
+     * set in their version.A paged wallet can be open in only one handle at a time and a handle must not be used by
+     * more than one thread at a time.
+     */
+    typedef struct lxqt_wallet_paged_struct *lxqt_wallet_paged_t ;
+
+    /*
+     * lxqt_wallet_wallet_exists is returned if a wallet of any kind with the name exists.
+     */
+    lxqt_wallet_error lxqt_wallet_paged_create(const char *password, u_int32_t password_length,
+            const char *wallet_name, const char *application_name) ;
+
+    /*
+     * lxqt_wallet_wallet_busy is returned if the wallet is open in another handle
+     */
+    lxqt_wallet_error lxqt_wallet_paged_open(lxqt_wallet_paged_t *, const char *password, u_int32_t password_length,
+            const char *wallet_name, const char *application_name) ;
+
+    /*
+     * returns 0 if the paged wallet exists
+     */
+    int lxqt_wallet_paged_exists(const char *wallet_name, const char *application_name) ;
+
+    u_int64_t lxqt_wallet_paged_entry_count(lxqt_wallet_paged_t) ;
+
+    /*
+     * set the number of decrypted pages kept in memory,the default is 256 pages or 1 MiB.Pages changed since the last
+     * save are kept on top of these
+     */
+    void lxqt_wallet_paged_set_cache_size(lxqt_wallet_paged_t, u_int32_t page_count) ;
+
+    /*
+     * work the same way as their lxqt_wallet_t counterparts,entries returned through "key_value" and iterators are
+     * copies that are good until the next call on the handle.lxqt_wallet_paged_add_key() replaces the value of a key
+     * the wallet has.
+     */
+    int lxqt_wallet_paged_read_key_value(lxqt_wallet_paged_t, const char *key, u_int32_t key_size,
+                                         lxqt_wallet_key_values_t *key_value) ;
+
+    int lxqt_wallet_paged_has_key(lxqt_wallet_paged_t, const char *key, u_int32_t key_size) ;
+
+    /*
+     * keys longer than 512 bytes are refused with lxqt_wallet_invalid_argument,entries of ".lwt" wallets with longer
+     * keys can not be moved to a paged wallet as they are
+     */
+    lxqt_wallet_error lxqt_wallet_paged_add_key(lxqt_wallet_paged_t, const char *key, u_int32_t key_size,
+            const char *value, u_int32_t value_size) ;
+
+    lxqt_wallet_error lxqt_wallet_paged_delete_key(lxqt_wallet_paged_t, const char *key, u_int32_t key_size) ;
+
+    /*
+     * Iterate over entries in key order,a step returns the first entry whose key is larger than the key the previous
+     * step returned.The wallet can be changed and saved during an iteration,entries added after the current key are
+     * seen by the iteration.Only one iteration can be in progress on a handle at a time.
+     */
+    int lxqt_wallet_paged_iter_read_value(lxqt_wallet_paged_t, lxqt_wallet_iterator_t *) ;
+
+    /*
+     * tell apart a key that is not in the wallet or the end of an iteration from a page that could not be read when
+     * lxqt_wallet_paged_read_key_value(),lxqt_wallet_paged_has_key() or lxqt_wallet_paged_iter_read_value() returns
+     * 0,lxqt_wallet_no_error is returned in the former case.
+     */
+    lxqt_wallet_error lxqt_wallet_paged_last_error(lxqt_wallet_paged_t) ;
+
+    /*
+     * write pages that changed since the last save and then the superblock that points to them
+     */
+    lxqt_wallet_error lxqt_wallet_paged_save(lxqt_wallet_paged_t) ;
+
+    lxqt_wallet_error lxqt_wallet_paged_close(lxqt_wallet_paged_t *) ;
+
+    lxqt_wallet_error lxqt_wallet_paged_delete_wallet(const char *wallet_name, const char *application_name) ;
+
     /*
-     * undocumented API
+     * undocumented API,returns the memory keys of the wallet are kept in
      */
     char *_lxqt_wallet_get_wallet_data(lxqt_wallet_t wallet) ;
 
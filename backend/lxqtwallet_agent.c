@@ -0,0 +1,937 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "lxqtwallet.h"
+#include "lxqtwallet_agent.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+struct lxqt_wallet_agent_struct
+{
+    int fd;
+};
+
+/*
+ * send all buffers in "iov","control" is ancillary data that goes out with the first byte
+ */
+static int _send_all(int fd, struct iovec *iov, int count, void *control, size_t control_size)
+{
+    struct msghdr msg;
+    ssize_t n;
+
+    while (count > 0)
+    {
+        memset(&msg, '\0', sizeof(msg));
+
+        msg.msg_iov        = iov;
+        msg.msg_iovlen     = count;
+        msg.msg_control    = control;
+        msg.msg_controllen = control_size;
+
+        /*
+         * MSG_NOSIGNAL keeps a dead peer from killing us with SIGPIPE
+         */
+        n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+
+        if (n == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            else
+            {
+                return 1;
+            }
+        }
+
+        control      = NULL;
+        control_size = 0;
+
+        while (count > 0 && (size_t)n >= iov->iov_len)
+        {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+
+        if (count > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+
+    return 0;
+}
+
+static int _receive_all(int fd, char *buffer, u_int64_t size)
+{
+    ssize_t n;
+
+    while (size > 0)
+    {
+        n = read(fd, buffer, size);
+
+        if (n == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (n <= 0)
+        {
+            return 1;
+        }
+        else
+        {
+            buffer += n;
+            size -= n;
+        }
+    }
+
+    return 0;
+}
+
+int _lxqt_wallet_agent_send(int fd, u_int32_t type, u_int32_t count, const char **argument, const u_int32_t *size)
+{
+    struct iovec iov[ 1 + 2 * LXQT_WALLET_AGENT_MAX_ARGUMENTS ];
+    u_int32_t header[ 2 ];
+    u_int32_t i;
+    u_int64_t total = sizeof(header);
+
+    if (count > LXQT_WALLET_AGENT_MAX_ARGUMENTS)
+    {
+        return 1;
+    }
+
+    header[ 0 ] = type;
+    header[ 1 ] = count;
+
+    iov[ 0 ].iov_base = header;
+    iov[ 0 ].iov_len  = sizeof(header);
+
+    for (i = 0; i < count; i++)
+    {
+        iov[ 1 + 2 * i ].iov_base = (void *)&size[ i ];
+        iov[ 1 + 2 * i ].iov_len  = sizeof(u_int32_t);
+
+        iov[ 2 + 2 * i ].iov_base = (void *)argument[ i ];
+        iov[ 2 + 2 * i ].iov_len  = size[ i ];
+
+        total += sizeof(u_int32_t) + size[ i ];
+    }
+
+    if (total > LXQT_WALLET_AGENT_MAX_MESSAGE_SIZE)
+    {
+        return 1;
+    }
+
+    return _send_all(fd, iov, 1 + 2 * count, NULL, 0);
+}
+
+typedef union
+{
+    char buffer[ CMSG_SPACE(sizeof(int)) ];
+    struct cmsghdr align;
+} fd_control_t;
+
+/*
+ * fill "control" with SCM_RIGHTS ancillary data that carries "passed_fd"
+ */
+static void _fd_control(fd_control_t *control, int passed_fd)
+{
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+
+    memset(control, '\0', sizeof(fd_control_t));
+    memset(&msg, '\0', sizeof(msg));
+
+    msg.msg_control    = control->buffer;
+    msg.msg_controllen = sizeof(control->buffer);
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+
+    memcpy(CMSG_DATA(cmsg), &passed_fd, sizeof(int));
+}
+
+int _lxqt_wallet_agent_send_fd(int fd, u_int32_t type, int passed_fd)
+{
+    fd_control_t control;
+    struct iovec iov;
+    u_int32_t header[ 2 ];
+
+    header[ 0 ] = type;
+    header[ 1 ] = 0;
+
+    iov.iov_base = header;
+    iov.iov_len  = sizeof(header);
+
+    _fd_control(&control, passed_fd);
+
+    return _send_all(fd, &iov, 1, control.buffer, sizeof(control.buffer));
+}
+
+int64_t _lxqt_wallet_agent_send_some(int fd, const char *buffer, u_int64_t size, int passed_fd)
+{
+    fd_control_t control;
+    struct msghdr msg;
+    struct iovec iov;
+    ssize_t n;
+
+    iov.iov_base = (void *)buffer;
+    iov.iov_len  = size;
+
+    memset(&msg, '\0', sizeof(msg));
+
+    msg.msg_iov    = &iov;
+    msg.msg_iovlen = 1;
+
+    if (passed_fd != -1)
+    {
+        _fd_control(&control, passed_fd);
+
+        msg.msg_control    = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+    }
+
+    do
+    {
+        n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    }
+    while (n == -1 && errno == EINTR);
+
+    if (n == -1)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    else
+    {
+        return n;
+    }
+}
+
+/*
+ * read the message header and pick up a file descriptor that may come with it
+ */
+static int _receive_header(int fd, u_int32_t header[ 2 ], int *passed_fd)
+{
+    union
+    {
+        char buffer[ CMSG_SPACE(sizeof(int)) ];
+        struct cmsghdr align;
+    } control;
+
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec iov;
+    ssize_t n;
+
+    if (passed_fd == NULL)
+    {
+        return _receive_all(fd, (char *)header, 2 * sizeof(u_int32_t));
+    }
+
+    *passed_fd = -1;
+
+    iov.iov_base = header;
+    iov.iov_len  = 2 * sizeof(u_int32_t);
+
+    memset(&msg, '\0', sizeof(msg));
+
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    do
+    {
+        n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    }
+    while (n == -1 && errno == EINTR);
+
+    if (n <= 0)
+    {
+        return 1;
+    }
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+        {
+            memcpy(passed_fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+
+    if ((size_t)n < iov.iov_len && _receive_all(fd, (char *)header + n, iov.iov_len - n))
+    {
+        if (*passed_fd != -1)
+        {
+            close(*passed_fd);
+            *passed_fd = -1;
+        }
+
+        return 1;
+    }
+
+    return 0;
+}
+
+int _lxqt_wallet_agent_receive(int fd, lxqt_wallet_agent_message_t *m)
+{
+    return _lxqt_wallet_agent_receive_fd(fd, m, NULL);
+}
+
+int _lxqt_wallet_agent_receive_fd(int fd, lxqt_wallet_agent_message_t *m, int *passed_fd)
+{
+    u_int32_t header[ 2 ];
+    u_int32_t i;
+    u_int64_t total = sizeof(header);
+    char *e;
+
+    memset(m, '\0', sizeof(lxqt_wallet_agent_message_t));
+
+    if (_receive_header(fd, header, passed_fd))
+    {
+        return 1;
+    }
+
+    m->type  = header[ 0 ];
+    m->count = header[ 1 ];
+
+    if (m->count > LXQT_WALLET_AGENT_MAX_ARGUMENTS)
+    {
+        return 1;
+    }
+
+    /*
+     * Arguments are read one at a time into a buffer that grows as they arrive,each one followed by a '\0'.
+     * Pointers to arguments are set when all of them are in since the buffer may move.
+     */
+    for (i = 0; i < m->count; i++)
+    {
+        if (_receive_all(fd, (char *)&m->size[ i ], sizeof(u_int32_t)))
+        {
+            _lxqt_wallet_agent_message_free(m);
+            return 1;
+        }
+
+        total += sizeof(u_int32_t) + m->size[ i ];
+
+        if (total > LXQT_WALLET_AGENT_MAX_MESSAGE_SIZE)
+        {
+            _lxqt_wallet_agent_message_free(m);
+            return 1;
+        }
+
+        e = malloc(m->buffer_size + m->size[ i ] + 1);
+
+        if (e == NULL)
+        {
+            _lxqt_wallet_agent_message_free(m);
+            return 1;
+        }
+
+        mlock(e, m->buffer_size + m->size[ i ] + 1);
+
+        if (m->buffer != NULL)
+        {
+            memcpy(e, m->buffer, m->buffer_size);
+            memset(m->buffer, '\0', m->buffer_size);
+            munlock(m->buffer, m->buffer_size);
+            free(m->buffer);
+        }
+
+        m->buffer = e;
+
+        if (_receive_all(fd, m->buffer + m->buffer_size, m->size[ i ]))
+        {
+            _lxqt_wallet_agent_message_free(m);
+            return 1;
+        }
+
+        m->buffer_size += m->size[ i ] + 1;
+        *(m->buffer + m->buffer_size - 1) = '\0';
+    }
+
+    e = m->buffer;
+
+    for (i = 0; i < m->count; i++)
+    {
+        m->argument[ i ] = e;
+        e += m->size[ i ] + 1;
+    }
+
+    return 0;
+}
+
+int _lxqt_wallet_agent_parse(const char *buffer, u_int64_t size, lxqt_wallet_agent_message_t *m,
+                             u_int64_t *message_size)
+{
+    u_int32_t header[ 2 ];
+    u_int32_t argument_size[ LXQT_WALLET_AGENT_MAX_ARGUMENTS ];
+    u_int64_t offset[ LXQT_WALLET_AGENT_MAX_ARGUMENTS ];
+    u_int64_t n = sizeof(header);
+    u_int64_t arguments_size = 0;
+    u_int32_t i;
+    char *e;
+
+    memset(m, '\0', sizeof(lxqt_wallet_agent_message_t));
+
+    if (size < sizeof(header))
+    {
+        return 1;
+    }
+
+    memcpy(header, buffer, sizeof(header));
+
+    if (header[ 1 ] > LXQT_WALLET_AGENT_MAX_ARGUMENTS)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < header[ 1 ]; i++)
+    {
+        if (size - n < sizeof(u_int32_t))
+        {
+            return 1;
+        }
+
+        memcpy(&argument_size[ i ], buffer + n, sizeof(u_int32_t));
+
+        n += sizeof(u_int32_t);
+
+        if (n + argument_size[ i ] > LXQT_WALLET_AGENT_MAX_MESSAGE_SIZE)
+        {
+            return -1;
+        }
+
+        if (size - n < argument_size[ i ])
+        {
+            return 1;
+        }
+
+        offset[ i ] = n;
+
+        n += argument_size[ i ];
+        arguments_size += argument_size[ i ] + 1;
+    }
+
+    if (arguments_size > 0)
+    {
+        e = malloc(arguments_size);
+
+        if (e == NULL)
+        {
+            return -1;
+        }
+
+        mlock(e, arguments_size);
+
+        m->buffer      = e;
+        m->buffer_size = arguments_size;
+
+        for (i = 0; i < header[ 1 ]; i++)
+        {
+            memcpy(e, buffer + offset[ i ], argument_size[ i ]);
+
+            e[ argument_size[ i ] ] = '\0';
+
+            m->argument[ i ] = e;
+            m->size[ i ]     = argument_size[ i ];
+
+            e += argument_size[ i ] + 1;
+        }
+    }
+
+    m->type  = header[ 0 ];
+    m->count = header[ 1 ];
+
+    *message_size = n;
+
+    return 0;
+}
+
+int _lxqt_wallet_agent_pack(u_int32_t type, u_int32_t count, const char **argument, const u_int32_t *size,
+                            char **buffer, u_int64_t *buffer_size)
+{
+    u_int32_t header[ 2 ];
+    u_int64_t total = sizeof(header);
+    u_int32_t i;
+    char *e;
+
+    if (count > LXQT_WALLET_AGENT_MAX_ARGUMENTS)
+    {
+        return 1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        total += sizeof(u_int32_t) + size[ i ];
+    }
+
+    if (total > LXQT_WALLET_AGENT_MAX_MESSAGE_SIZE)
+    {
+        return 1;
+    }
+
+    e = calloc(1, total);
+
+    if (e == NULL)
+    {
+        return 1;
+    }
+
+    mlock(e, total);
+
+    *buffer      = e;
+    *buffer_size = total;
+
+    header[ 0 ] = type;
+    header[ 1 ] = count;
+
+    memcpy(e, header, sizeof(header));
+    e += sizeof(header);
+
+    for (i = 0; i < count; i++)
+    {
+        memcpy(e, &size[ i ], sizeof(u_int32_t));
+        memcpy(e + sizeof(u_int32_t), argument[ i ], size[ i ]);
+        e += sizeof(u_int32_t) + size[ i ];
+    }
+
+    return 0;
+}
+
+void _lxqt_wallet_agent_buffer_free(char *buffer, u_int64_t buffer_size)
+{
+    if (buffer != NULL)
+    {
+        memset(buffer, '\0', buffer_size);
+        munlock(buffer, buffer_size);
+        free(buffer);
+    }
+}
+
+void _lxqt_wallet_agent_message_free(lxqt_wallet_agent_message_t *m)
+{
+    if (m->buffer != NULL)
+    {
+        memset(m->buffer, '\0', m->buffer_size);
+        munlock(m->buffer, m->buffer_size);
+        free(m->buffer);
+    }
+
+    memset(m, '\0', sizeof(lxqt_wallet_agent_message_t));
+}
+
+int _lxqt_wallet_agent_peer_is_trusted(int fd)
+{
+#ifdef SO_PEERCRED
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0)
+    {
+        return 0;
+    }
+
+    return cred.uid == geteuid();
+#else
+    uid_t uid;
+    gid_t gid;
+
+    if (getpeereid(fd, &uid, &gid) != 0)
+    {
+        return 0;
+    }
+
+    return uid == geteuid();
+#endif
+}
+
+void lxqt_wallet_agent_socket_path(char *path, u_int32_t path_buffer_size)
+{
+    const char *e = getenv(LXQT_WALLET_AGENT_SOCKET_ENV);
+
+    if (e != NULL && *e != '\0')
+    {
+        snprintf(path, path_buffer_size, "%s", e);
+        return;
+    }
+
+    e = getenv("XDG_RUNTIME_DIR");
+
+    if (e != NULL && *e != '\0')
+    {
+        snprintf(path, path_buffer_size, "%s/lxqt_wallet-agent.socket", e);
+    }
+    else
+    {
+        snprintf(path, path_buffer_size, "/tmp/lxqt_wallet-agent-%lu/agent.socket", (unsigned long)geteuid());
+    }
+}
+
+lxqt_wallet_error lxqt_wallet_agent_connect(lxqt_wallet_agent_t *agent)
+{
+    struct sockaddr_un addr;
+    lxqt_wallet_agent_t e;
+    int fd;
+
+    if (agent == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    *agent = NULL;
+
+    memset(&addr, '\0', sizeof(addr));
+
+    addr.sun_family = AF_UNIX;
+
+    lxqt_wallet_agent_socket_path(addr.sun_path, sizeof(addr.sun_path));
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd == -1)
+    {
+        return lxqt_wallet_failed_to_connect_to_agent;
+    }
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || !_lxqt_wallet_agent_peer_is_trusted(fd))
+    {
+        close(fd);
+        return lxqt_wallet_failed_to_connect_to_agent;
+    }
+
+    e = malloc(sizeof(struct lxqt_wallet_agent_struct));
+
+    if (e == NULL)
+    {
+        close(fd);
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    e->fd = fd;
+    *agent = e;
+
+    return lxqt_wallet_no_error;
+}
+
+void lxqt_wallet_agent_disconnect(lxqt_wallet_agent_t *agent)
+{
+    if (agent != NULL && *agent != NULL)
+    {
+        close((*agent)->fd);
+        free(*agent);
+        *agent = NULL;
+    }
+}
+
+/*
+ * send a request about a wallet and wait for the reply.
+ * The reply is returned through "reply" and has to be released by the caller only when lxqt_wallet_no_error is returned.
+ */
+static lxqt_wallet_error _agent_request(lxqt_wallet_agent_t agent, u_int32_t type, const char *wallet_name,
+                                        const char *application_name, u_int32_t count, const char **argument,
+                                        const u_int32_t *size, lxqt_wallet_agent_message_t *reply)
+{
+    const char *args[ LXQT_WALLET_AGENT_MAX_ARGUMENTS ];
+    u_int32_t sizes[ LXQT_WALLET_AGENT_MAX_ARGUMENTS ];
+    u_int32_t i;
+    lxqt_wallet_error r;
+
+    if (agent == NULL || wallet_name == NULL || application_name == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    args[ 0 ]  = wallet_name;
+    sizes[ 0 ] = strlen(wallet_name);
+    args[ 1 ]  = application_name;
+    sizes[ 1 ] = strlen(application_name);
+
+    for (i = 0; i < count; i++)
+    {
+        args[ 2 + i ]  = argument[ i ];
+        sizes[ 2 + i ] = size[ i ];
+    }
+
+    if (_lxqt_wallet_agent_send(agent->fd, type, 2 + count, args, sizes) ||
+            _lxqt_wallet_agent_receive(agent->fd, reply))
+    {
+        return lxqt_wallet_failed_to_connect_to_agent;
+    }
+
+    r = (lxqt_wallet_error)reply->type;
+
+    if (r != lxqt_wallet_no_error)
+    {
+        _lxqt_wallet_agent_message_free(reply);
+    }
+
+    return r;
+}
+
+static lxqt_wallet_error _agent_request_1(lxqt_wallet_agent_t agent, u_int32_t type, const char *wallet_name,
+        const char *application_name, u_int32_t count, const char **argument, const u_int32_t *size)
+{
+    lxqt_wallet_agent_message_t reply;
+    lxqt_wallet_error r = _agent_request(agent, type, wallet_name, application_name, count, argument, size, &reply);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        _lxqt_wallet_agent_message_free(&reply);
+    }
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_agent_unlock(lxqt_wallet_agent_t agent, const char *password, u_int32_t password_length,
+        const char *wallet_name, const char *application_name)
+{
+    return _agent_request_1(agent, LXQT_WALLET_AGENT_UNLOCK, wallet_name, application_name, 1, &password, &password_length);
+}
+
+lxqt_wallet_error lxqt_wallet_agent_lock(lxqt_wallet_agent_t agent, const char *wallet_name, const char *application_name)
+{
+    return _agent_request_1(agent, LXQT_WALLET_AGENT_LOCK, wallet_name, application_name, 0, NULL, NULL);
+}
+
+lxqt_wallet_error lxqt_wallet_agent_save(lxqt_wallet_agent_t agent, const char *wallet_name, const char *application_name)
+{
+    return _agent_request_1(agent, LXQT_WALLET_AGENT_SAVE, wallet_name, application_name, 0, NULL, NULL);
+}
+
+int lxqt_wallet_agent_has_wallet(lxqt_wallet_agent_t agent, const char *wallet_name, const char *application_name)
+{
+    return _agent_request_1(agent, LXQT_WALLET_AGENT_HAS_WALLET, wallet_name, application_name, 0, NULL, NULL) == lxqt_wallet_no_error;
+}
+
+lxqt_wallet_error lxqt_wallet_agent_has_key(lxqt_wallet_agent_t agent, const char *wallet_name, const char *application_name,
+        const char *key, u_int32_t key_size)
+{
+    return _agent_request_1(agent, LXQT_WALLET_AGENT_HAS_KEY, wallet_name, application_name, 1, &key, &key_size);
+}
+
+lxqt_wallet_error lxqt_wallet_agent_get(lxqt_wallet_agent_t agent, const char *wallet_name, const char *application_name,
+                                        const char *key, u_int32_t key_size, char **value, u_int32_t *value_size)
+{
+    lxqt_wallet_agent_message_t reply;
+    lxqt_wallet_error r;
+
+    if (value == NULL || value_size == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    r = _agent_request(agent, LXQT_WALLET_AGENT_GET, wallet_name, application_name, 1, &key, &key_size, &reply);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    if (reply.count != 1)
+    {
+        _lxqt_wallet_agent_message_free(&reply);
+        return lxqt_wallet_failed_to_connect_to_agent;
+    }
+
+    /*
+     * the value is the only argument and hence sits at the start of the buffer,hand the buffer over
+     */
+    *value      = reply.buffer;
+    *value_size = reply.size[ 0 ];
+
+    reply.buffer = NULL;
+
+    return lxqt_wallet_no_error;
+}
+
+void lxqt_wallet_agent_free_value(char *value, u_int32_t value_size)
+{
+    if (value != NULL)
+    {
+        memset(value, '\0', value_size);
+        munlock(value, value_size + 1);
+        free(value);
+    }
+}
+
+lxqt_wallet_error lxqt_wallet_agent_add_key(lxqt_wallet_agent_t agent, const char *wallet_name, const char *application_name,
+        const char *key, u_int32_t key_size, const char *value, u_int32_t value_size)
+{
+    const char *args[ 2 ];
+    u_int32_t sizes[ 2 ];
+
+    args[ 0 ]  = key;
+    sizes[ 0 ] = key_size;
+    args[ 1 ]  = value == NULL ? "" : value;
+    sizes[ 1 ] = value == NULL ? 0 : value_size;
+
+    return _agent_request_1(agent, LXQT_WALLET_AGENT_SET, wallet_name, application_name, 2, args, sizes);
+}
+
+lxqt_wallet_error lxqt_wallet_agent_delete_key(lxqt_wallet_agent_t agent, const char *wallet_name, const char *application_name,
+        const char *key, u_int32_t key_size)
+{
+    return _agent_request_1(agent, LXQT_WALLET_AGENT_DELETE, wallet_name, application_name, 1, &key, &key_size);
+}
+
+lxqt_wallet_error lxqt_wallet_agent_list(lxqt_wallet_agent_t agent, const char *wallet_name, const char *application_name,
+        int(*function)(const char *key, u_int32_t key_size, void *), void *v)
+{
+    lxqt_wallet_agent_message_t reply;
+    lxqt_wallet_error r;
+    u_int32_t key_size;
+    u_int64_t i = 0;
+    const char *e;
+
+    if (function == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    r = _agent_request(agent, LXQT_WALLET_AGENT_LIST, wallet_name, application_name, 0, NULL, NULL, &reply);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    if (reply.count == 1)
+    {
+        e = reply.argument[ 0 ];
+
+        while (i + sizeof(u_int32_t) <= reply.size[ 0 ])
+        {
+            memcpy(&key_size, e + i, sizeof(u_int32_t));
+
+            i += sizeof(u_int32_t);
+
+            if (key_size > reply.size[ 0 ] - i || function(e + i, key_size, v))
+            {
+                break;
+            }
+
+            i += key_size;
+        }
+    }
+
+    _lxqt_wallet_agent_message_free(&reply);
+
+    return lxqt_wallet_no_error;
+}
+
+lxqt_wallet_error lxqt_wallet_agent_attach(lxqt_wallet_agent_t agent, const char *wallet_name, const char *application_name,
+        lxqt_wallet_t *wallet)
+{
+    const char *args[ 2 ];
+    u_int32_t sizes[ 2 ];
+    lxqt_wallet_agent_message_t reply;
+    lxqt_wallet_error r;
+    int fd;
+
+    if (agent == NULL || wallet_name == NULL || application_name == NULL || wallet == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    *wallet = NULL;
+
+    args[ 0 ]  = wallet_name;
+    sizes[ 0 ] = strlen(wallet_name);
+    args[ 1 ]  = application_name;
+    sizes[ 1 ] = strlen(application_name);
+
+    if (_lxqt_wallet_agent_send(agent->fd, LXQT_WALLET_AGENT_SHARE, 2, args, sizes) ||
+            _lxqt_wallet_agent_receive_fd(agent->fd, &reply, &fd))
+    {
+        return lxqt_wallet_failed_to_connect_to_agent;
+    }
+
+    r = (lxqt_wallet_error)reply.type;
+
+    _lxqt_wallet_agent_message_free(&reply);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        if (fd == -1)
+        {
+            return lxqt_wallet_failed_to_connect_to_agent;
+        }
+
+        r = lxqt_wallet_attach(wallet, fd);
+    }
+
+    if (fd != -1)
+    {
+        close(fd);
+    }
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_agent_stop(lxqt_wallet_agent_t agent)
+{
+    lxqt_wallet_agent_message_t reply;
+
+    if (agent == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    if (_lxqt_wallet_agent_send(agent->fd, LXQT_WALLET_AGENT_STOP, 0, NULL, NULL) ||
+            _lxqt_wallet_agent_receive(agent->fd, &reply))
+    {
+        return lxqt_wallet_failed_to_connect_to_agent;
+    }
+
+    _lxqt_wallet_agent_message_free(&reply);
+
+    return lxqt_wallet_no_error;
+}
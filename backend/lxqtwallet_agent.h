@@ -0,0 +1,154 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Private header shared by the agent client functions in libwallet and the lxqt_wallet-agent program.
+ */
+
+#ifndef LXQTWALLET_AGENT_H
+#define LXQTWALLET_AGENT_H
+
+#include <sys/types.h>
+#include <stdint.h>
+
+/*
+ * Agent protocol documentation.
+ *
+ * Requests and replies are messages sent over a SOCK_STREAM unix domain socket.
+ *
+ * The first 4 bytes of a message are a u_int32_t data type and are used to store a request type in requests
+ * and a lxqt_wallet_error value in replies.
+ * The next 4 bytes are a u_int32_t data type and are used to store the number of arguments that follow.
+ * Each argument is made up of a u_int32_t data type that stores the size of the argument followed by the argument.
+ *
+ * Wallet name and application name are the first two arguments of every request that works on a wallet.
+ *
+ * Replies to LXQT_WALLET_AGENT_GET carry the value as their only argument and replies to LXQT_WALLET_AGENT_LIST
+ * carry all keys as one argument made up of [ u_int32_t key size ][ key ] nodes.
+ *
+ * A successful reply to LXQT_WALLET_AGENT_SHARE has no arguments and carries a file descriptor created by
+ * lxqt_wallet_share() as SCM_RIGHTS ancillary data.
+ */
+
+#define LXQT_WALLET_AGENT_UNLOCK     1 /* wallet name,application name,password */
+#define LXQT_WALLET_AGENT_LOCK       2 /* wallet name,application name */
+#define LXQT_WALLET_AGENT_HAS_WALLET 3 /* wallet name,application name */
+#define LXQT_WALLET_AGENT_HAS_KEY    4 /* wallet name,application name,key */
+#define LXQT_WALLET_AGENT_GET        5 /* wallet name,application name,key */
+#define LXQT_WALLET_AGENT_SET        6 /* wallet name,application name,key,value */
+#define LXQT_WALLET_AGENT_DELETE     7 /* wallet name,application name,key */
+#define LXQT_WALLET_AGENT_LIST       8 /* wallet name,application name */
+#define LXQT_WALLET_AGENT_STOP       9
+#define LXQT_WALLET_AGENT_SHARE      10 /* wallet name,application name */
+#define LXQT_WALLET_AGENT_SAVE       11 /* wallet name,application name */
+
+#define LXQT_WALLET_AGENT_MAX_ARGUMENTS 4
+
+/*
+ * upper limit of the size of a message,larger messages are rejected
+ */
+#define LXQT_WALLET_AGENT_MAX_MESSAGE_SIZE ( 1024 * 1024 * 1024 )
+
+/*
+ * environment variable that overrides the default location of the agent socket
+ */
+#define LXQT_WALLET_AGENT_SOCKET_ENV "LXQT_WALLET_AGENT_SOCKET"
+
+typedef struct
+{
+    u_int32_t type ;
+    u_int32_t count ;
+    const char *argument[ LXQT_WALLET_AGENT_MAX_ARGUMENTS ] ;
+    u_int32_t size[ LXQT_WALLET_AGENT_MAX_ARGUMENTS ] ;
+    char *buffer ;
+    u_int64_t buffer_size ;
+} lxqt_wallet_agent_message_t ;
+
+/*
+ * send a message,returns 0 on success
+ */
+int _lxqt_wallet_agent_send(int fd, u_int32_t type, u_int32_t count, const char **argument, const u_int32_t *size) ;
+
+/*
+ * send a message that carries file descriptor "passed_fd",returns 0 on success
+ */
+int _lxqt_wallet_agent_send_fd(int fd, u_int32_t type, int passed_fd) ;
+
+/*
+ * receive a message,returns 0 on success.
+ * Each received argument is followed by a '\0' character that is not included in its size.
+ * The message must be released with _lxqt_wallet_agent_message_free().
+ */
+int _lxqt_wallet_agent_receive(int fd, lxqt_wallet_agent_message_t *) ;
+
+/*
+ * receive a message that may carry a file descriptor,"passed_fd" is set to -1 if it does not.
+ */
+int _lxqt_wallet_agent_receive_fd(int fd, lxqt_wallet_agent_message_t *, int *passed_fd) ;
+
+/*
+ * wipe and free a received message
+ */
+void _lxqt_wallet_agent_message_free(lxqt_wallet_agent_message_t *) ;
+
+/*
+ * Functions below are used by lxqt_wallet-agent that reads requests and writes replies through non blocking sockets.
+ */
+
+/*
+ * parse a message at the start of "buffer" that holds "size" bytes read from a socket.
+ * Returns 0 and sets "message_size" to the number of bytes the message takes up in "buffer" if the buffer starts
+ * with a whole message,1 if more bytes are needed and -1 if the message is invalid.
+ * A parsed message is a copy that must be released with _lxqt_wallet_agent_message_free().
+ */
+int _lxqt_wallet_agent_parse(const char *buffer, u_int64_t size, lxqt_wallet_agent_message_t *,
+                             u_int64_t *message_size) ;
+
+/*
+ * pack a message into a locked buffer that must be released with _lxqt_wallet_agent_buffer_free(),
+ * returns 0 on success
+ */
+int _lxqt_wallet_agent_pack(u_int32_t type, u_int32_t count, const char **argument, const u_int32_t *size,
+                            char **buffer, u_int64_t *buffer_size) ;
+
+void _lxqt_wallet_agent_buffer_free(char *buffer, u_int64_t buffer_size) ;
+
+/*
+ * send as much of "buffer" as a non blocking socket takes,"passed_fd" goes out with the first byte if it is not -1.
+ * Returns the number of bytes sent,0 if the socket takes nothing at the moment and -1 on error.
+ */
+int64_t _lxqt_wallet_agent_send_some(int fd, const char *buffer, u_int64_t size, int passed_fd) ;
+
+/*
+ * returns 1 if the process at the other end of a connected socket runs as the same user as this process
+ */
+int _lxqt_wallet_agent_peer_is_trusted(int fd) ;
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Private header for helpers in libwallet that are shared with the other source files of the library and with
+ * lxqt_wallet-cli and lxqt_wallet-agent.It is not installed.
+ */
+
+#ifndef LXQTWALLET_INTERNAL_H
+#define LXQTWALLET_INTERNAL_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/*
+ * extension of index files of sharded wallets
+ */
+#define LXQT_WALLET_SHARDED_EXTENSION ".lws"
+
+/*
+ * extension of paged wallets
+ */
+#define LXQT_WALLET_PAGED_EXTENSION ".lwp"
+
+/*
+ * Run "function" on numbers 0 to "count" - 1 using a pool of threads,the calling thread is one of the workers.
+ * Workers take the next number from a shared counter until none is left.
+ * The pool has one thread per CPU,capped at 16 threads and at "count".
+ */
+void _lxqt_wallet_parallel_for(u_int64_t count, void (*function)(void *, u_int64_t), void *arg) ;
+
+/*
+ * Functions below give other source files of the library the file and memory helpers lxqtwallet.c uses.
+ *
+ * _lxqt_wallet_write_all() and _lxqt_wallet_read_all() return 0 when all "size" bytes were written or read,reads
+ * start at "offset" and do not move the file offset.
+ */
+int _lxqt_wallet_write_all(int fd, const char *buffer, u_int64_t size) ;
+
+int _lxqt_wallet_read_all(int fd, char *buffer, u_int64_t size, off_t offset) ;
+
+/*
+ * works like _lxqt_wallet_write_all() but writes at "offset" and does not move the file offset
+ */
+int _lxqt_wallet_write_all_at(int fd, const char *buffer, u_int64_t size, off_t offset) ;
+
+/*
+ * zeroed and locked memory that is wiped when it is freed
+ */
+char *_lxqt_wallet_locked_buffer(u_int64_t size) ;
+
+void _lxqt_wallet_free_locked_buffer(char *buffer, u_int64_t size) ;
+
+/*
+ * Descriptor of the wallet directory of an application,-1 if it can not be opened.It is an O_PATH descriptor
+ * shared with other threads that is to be used with the *at() functions and given back once it is no longer needed.
+ */
+int _lxqt_wallet_application_directory(const char *application_name, int create) ;
+
+void _lxqt_wallet_release_application_directory(int fd) ;
+
+/*
+ * Take the lock saves of wallets of an application are serialized through,the returned descriptor is a readable
+ * descriptor of the wallet directory of the application or -1.
+ */
+int _lxqt_wallet_lock_application_directory(const char *application_name) ;
+
+void _lxqt_wallet_unlock_application_directory(int fd) ;
+
+/*
+ * record a wallet in the manifest of its application or remove it from there if "st" is NULL,the caller must hold
+ * the lock of the wallet directory of the application.
+ */
+void _lxqt_wallet_update_manifest(const char *wallet_name, const char *application_name, const struct stat *st,
+                                  u_int64_t entry_count, int version) ;
+
+#endif
@@ -0,0 +1,2622 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Paged wallets.
+ *
+ * A paged wallet keeps its entries in a copy on write B+tree of individually encrypted pages,lookups,inserts and
+ * deletes read and decrypt only the pages on the path from the root to the entry and a save writes only pages that
+ * changed.Decrypted pages are kept in a small cache.
+ *
+ * A paged wallet "YYY" of an application is kept in "YYY.lwp" in the wallet folder of the application.The file is made
+ * up of PAGED_PAGE_SIZE pages,pages 0 and 1 are superblocks and the rest are tree,overflow and free list pages.
+ *
+ * A superblock is made up of:
+ * [ 16 bytes magic string ][ u_int32_t version ][ u_int32_t page size ][ 16 bytes salt ][ u_int64_t generation ]
+ * [ u_int64_t root page ][ 16 bytes root tag ][ u_int64_t page count ][ u_int64_t free list page ]
+ * [ 16 bytes free list tag ][ u_int64_t entry count ][ 12 bytes nonce ][ 16 bytes tag ][ 16 bytes encrypted magic string ]
+ * The magic string is encrypted with AES256-GCM and everything before the nonce is its authenticated data,the superblock
+ * with the largest generation that authenticates is the current one.
+ *
+ * Every other page is [ 12 bytes nonce ][ PAGED_PAYLOAD_SIZE bytes encrypted payload ],it is encrypted with AES256-GCM
+ * with its page number as authenticated data and its tag is kept next to the pointer to it in its parent page or in the
+ * superblock.The tags of the superblock hence authenticate the whole tree and an old copy of a page can not be passed
+ * off as the current one.
+ *
+ * Payloads of tree pages start with a PAGED_NODE_HEADER_SIZE bytes header:
+ * [ u_int8_t type ][ u_int8_t ][ u_int16_t entry count ][ u_int16_t offset of the first entry ][ u_int16_t ]
+ * An internal page follows it with [ u_int64_t first child ][ 16 bytes tag ],both kinds then have an array of
+ * u_int16_t offsets of entries sorted by key and entries are packed at the end of the payload.
+ * A leaf entry is [ u_int32_t key size ][ u_int32_t value size ][ key ][ value ],values that do not fit in a page are
+ * kept in a chain of overflow pages,the high bit of their value size is set and the value is replaced with
+ * [ u_int64_t first overflow page ][ 16 bytes tag ].
+ * An internal entry is [ u_int32_t key size ][ key ][ u_int64_t child ][ 16 bytes tag ] where the child holds keys that
+ * are not smaller than the key.
+ *
+ * Overflow and free list pages are [ u_int8_t type ][ 3 bytes ][ u_int32_t count ][ u_int64_t next page ][ 16 bytes tag ]
+ * followed by "count" bytes of a value or "count" u_int64_t numbers of free pages.
+ *
+ * Pages are never written in place.A page that is changed is given a new page number the first time it is changed
+ * after a save and the pages it replaces are reused only after the next save,a save writes changed pages,fsyncs the
+ * file and then writes the other superblock.A save that is cut short hence leaves the wallet as it was at the previous
+ * save.Pages are not merged when entries are deleted,a page is freed when it becomes empty.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "lxqtwallet.h"
+#include "lxqtwallet_internal.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+
+#include <gcrypt.h>
+
+#define PAGED_MAGIC_STRING          "lxqt_wallet_pgw"
+#define PAGED_MAGIC_STRING_SIZE     16
+#define PAGED_VERSION               1
+#define PAGED_EXTENSION             LXQT_WALLET_PAGED_EXTENSION
+#define PAGED_PAGE_SIZE             4096
+#define PAGED_SALT_SIZE             16
+#define PAGED_NONCE_SIZE            12
+#define PAGED_TAG_SIZE              16
+#define PAGED_KEY_SIZE              32
+#define PAGED_PBKDF2_ITERATIONS     10000
+#define PAGED_PAYLOAD_SIZE          ( PAGED_PAGE_SIZE - PAGED_NONCE_SIZE )
+#define PAGED_POINTER_SIZE          ( sizeof( u_int64_t ) + PAGED_TAG_SIZE )
+#define PAGED_NODE_HEADER_SIZE      8
+#define PAGED_CHAIN_HEADER_SIZE     ( 8 + PAGED_POINTER_SIZE )
+#define PAGED_CHAIN_CAPACITY        ( PAGED_PAYLOAD_SIZE - PAGED_CHAIN_HEADER_SIZE )
+#define PAGED_MAX_KEY_SIZE          512
+#define PAGED_MAX_INLINE_SIZE       1000
+#define PAGED_MAX_DEPTH             32
+#define PAGED_MAX_ENTRIES           ( PAGED_PAYLOAD_SIZE / 8 )
+#define PAGED_OVERFLOW_FLAG         0x80000000u
+#define PAGED_DEFAULT_CACHE_SIZE    256
+#define PAGED_NO_PAGE               0
+#define PAGED_ITER_END              1
+#define PAGED_ITER_STEP             2
+
+#define PAGED_LEAF                  1
+#define PAGED_INTERNAL              2
+#define PAGED_OVERFLOW              3
+#define PAGED_FREE_LIST             4
+
+
+#define PAGED_SUPERBLOCK_DATA_SIZE  ( PAGED_MAGIC_STRING_SIZE + 2 * sizeof( u_int32_t ) + PAGED_SALT_SIZE + \
+                                      5 * sizeof( u_int64_t ) + 2 * PAGED_TAG_SIZE )
+#define PAGED_SUPERBLOCK_SIZE       ( PAGED_SUPERBLOCK_DATA_SIZE + PAGED_NONCE_SIZE + PAGED_TAG_SIZE + \
+                                      PAGED_MAGIC_STRING_SIZE )
+
+/*
+ * a decrypted page,"dirty" pages were given their page number since the last save,they are written by the next save
+ * and are never evicted.Clean pages are kept in "lru" order and are evicted when they are not pinned
+ */
+struct _page
+{
+    u_int64_t number;
+    char *data;
+    int dirty;
+    int pins;
+    struct _page *hash_next;
+    struct _page *lru_previous;
+    struct _page *lru_next;
+};
+
+struct _superblock
+{
+    u_int64_t generation;
+    u_int64_t root;
+    char root_tag[ PAGED_TAG_SIZE ];
+    u_int64_t page_count;
+    u_int64_t free_list;
+    char free_list_tag[ PAGED_TAG_SIZE ];
+    u_int64_t entry_count;
+};
+
+struct _page_list
+{
+    u_int64_t *pages;
+    size_t count;
+    size_t capacity;
+};
+
+struct lxqt_wallet_paged_struct
+{
+    int fd;
+    char *wallet_name;
+    char *application_name;
+    char salt[ PAGED_SALT_SIZE ];
+    gcry_cipher_hd_t cipher;
+    struct _superblock sb;
+    int modified;
+    struct _page **buckets;
+    size_t bucket_count;
+    size_t cached_count;
+    size_t clean_count;
+    size_t cache_size;
+    struct _page *lru_head;
+    struct _page *lru_tail;
+    /*
+     * pages that can be given out,pages freed since the last save and pages holding the free list of the last save
+     */
+    struct _page_list available;
+    struct _page_list pending;
+    struct _page_list free_list_pages;
+    /*
+     * locked buffer with the key the last iteration step returned,the next step continues after it
+     */
+    char *iter_key;
+    u_int32_t iter_key_size;
+    /*
+     * why the last lookup or iteration step returned 0,see lxqt_wallet_paged_last_error()
+     */
+    lxqt_wallet_error error;
+    /*
+     * locked buffers entries returned to callers are copied to and overflow pages are put together in
+     */
+    char *result;
+    size_t result_size;
+    char *scratch;
+};
+
+/*
+ * an entry of a page or a key
+ */
+struct _entry
+{
+    const char *data;
+    u_int32_t size;
+};
+
+struct _path
+{
+    struct _page *page;
+    int index;
+};
+
+static u_int16_t _paged_u16(const char *e)
+{
+    u_int16_t r;
+    memcpy(&r, e, sizeof(r));
+    return r;
+}
+
+static u_int32_t _paged_u32(const char *e)
+{
+    u_int32_t r;
+    memcpy(&r, e, sizeof(r));
+    return r;
+}
+
+static u_int64_t _paged_u64(const char *e)
+{
+    u_int64_t r;
+    memcpy(&r, e, sizeof(r));
+    return r;
+}
+
+static void _paged_set_u16(char *e, u_int16_t s)
+{
+    memcpy(e, &s, sizeof(s));
+}
+
+static void _paged_set_u32(char *e, u_int32_t s)
+{
+    memcpy(e, &s, sizeof(s));
+}
+
+static void _paged_set_u64(char *e, u_int64_t s)
+{
+    memcpy(e, &s, sizeof(s));
+}
+
+static void _paged_name(char name[ PATH_MAX ], const char *wallet_name, const char *extension)
+{
+    snprintf(name, PATH_MAX, "%s%s", wallet_name, extension);
+}
+
+static int _paged_stat(int dirfd, const char *wallet_name, struct stat *st)
+{
+    char name[ PATH_MAX ];
+
+    _paged_name(name, wallet_name, PAGED_EXTENSION);
+
+    return fstatat(dirfd, name, st, 0);
+}
+
+/*
+ * write the file of a new wallet to the folder "dirfd" through a temporary file that takes its name once it is on disk
+ */
+static lxqt_wallet_error _paged_write_file(int dirfd, const char *wallet_name, const char *buffer, u_int64_t size)
+{
+    char name[ PATH_MAX ];
+    char temp[ PATH_MAX ];
+    int fd;
+
+    _paged_name(name, wallet_name, PAGED_EXTENSION);
+    _paged_name(temp, wallet_name, PAGED_EXTENSION ".tmp");
+
+    fd = openat(dirfd, temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+
+    if (fd == -1)
+    {
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    if (_lxqt_wallet_write_all(fd, buffer, size) != 0 || fsync(fd) != 0)
+    {
+        close(fd);
+        unlinkat(dirfd, temp, 0);
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    if (close(fd) != 0 || renameat(dirfd, temp, dirfd, name) != 0)
+    {
+        unlinkat(dirfd, temp, 0);
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+static void _paged_initialize_gcrypt(void)
+{
+    if (gcry_control(GCRYCTL_INITIALIZATION_FINISHED_P) == 0)
+    {
+        gcry_check_version(NULL);
+        gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+    }
+}
+
+static lxqt_wallet_error _paged_open_cipher(lxqt_wallet_paged_t w, const char *password, u_int32_t password_length)
+{
+    char key[ PAGED_KEY_SIZE ];
+    gcry_error_t r;
+
+    _paged_initialize_gcrypt();
+
+    r = gcry_kdf_derive(password, password_length, GCRY_KDF_PBKDF2, GCRY_MD_SHA256, w->salt, PAGED_SALT_SIZE,
+                        PAGED_PBKDF2_ITERATIONS, PAGED_KEY_SIZE, key);
+
+    if (r != GPG_ERR_NO_ERROR)
+    {
+        return lxqt_wallet_failed_to_create_key_hash;
+    }
+
+    if (gcry_cipher_open(&w->cipher, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_GCM, GCRY_CIPHER_SECURE) != 0)
+    {
+        memset(key, '\0', sizeof(key));
+        w->cipher = NULL;
+        return lxqt_wallet_gcry_cipher_open_failed;
+    }
+
+    r = gcry_cipher_setkey(w->cipher, key, PAGED_KEY_SIZE);
+
+    memset(key, '\0', sizeof(key));
+
+    return r == 0 ? lxqt_wallet_no_error : lxqt_wallet_gcry_cipher_setkey_failed;
+}
+
+/*
+ * encrypt or decrypt "size" bytes of "input" to "output","data" is authenticated along with them and "tag" is checked
+ * when decrypting
+ */
+static lxqt_wallet_error _paged_crypt(lxqt_wallet_paged_t w, const char *nonce, const char *data, size_t data_size,
+                                      char *output, const char *input, size_t size, char *tag, int encrypt)
+{
+    gcry_error_t r;
+
+    gcry_cipher_reset(w->cipher);
+
+    if (gcry_cipher_setiv(w->cipher, nonce, PAGED_NONCE_SIZE) != 0)
+    {
+        return lxqt_wallet_gcry_cipher_setiv_failed;
+    }
+
+    if (gcry_cipher_authenticate(w->cipher, data, data_size) != 0)
+    {
+        return lxqt_wallet_gcry_cipher_encrypt_failed;
+    }
+
+    if (encrypt)
+    {
+        if (gcry_cipher_final(w->cipher) != 0 || gcry_cipher_encrypt(w->cipher, output, size, input, size) != 0)
+        {
+            return lxqt_wallet_gcry_cipher_encrypt_failed;
+        }
+
+        r = gcry_cipher_gettag(w->cipher, tag, PAGED_TAG_SIZE);
+
+        return r == 0 ? lxqt_wallet_no_error : lxqt_wallet_gcry_cipher_encrypt_failed;
+    }
+    else
+    {
+        if (gcry_cipher_final(w->cipher) != 0 || gcry_cipher_decrypt(w->cipher, output, size, input, size) != 0)
+        {
+            return lxqt_wallet_gcry_cipher_decrypt_failed;
+        }
+
+        r = gcry_cipher_checktag(w->cipher, tag, PAGED_TAG_SIZE);
+
+        return r == 0 ? lxqt_wallet_no_error : lxqt_wallet_authentication_failed;
+    }
+}
+
+static lxqt_wallet_error _paged_read_page(lxqt_wallet_paged_t w, u_int64_t number, const char *tag, char *payload)
+{
+    char page[ PAGED_PAGE_SIZE ];
+    char e[ PAGED_TAG_SIZE ];
+    char n[ sizeof(u_int64_t) ];
+
+    if (number < 2 || number >= w->sb.page_count)
+    {
+        return lxqt_wallet_incompatible_wallet;
+    }
+
+    if (_lxqt_wallet_read_all(w->fd, page, PAGED_PAGE_SIZE, (off_t)(number * PAGED_PAGE_SIZE)) != 0)
+    {
+        return lxqt_wallet_incompatible_wallet;
+    }
+
+    _paged_set_u64(n, number);
+    memcpy(e, tag, PAGED_TAG_SIZE);
+
+    return _paged_crypt(w, page, n, sizeof(n), payload, page + PAGED_NONCE_SIZE, PAGED_PAYLOAD_SIZE, e, 0);
+}
+
+static lxqt_wallet_error _paged_write_page(lxqt_wallet_paged_t w, u_int64_t number, const char *payload, char *tag)
+{
+    char page[ PAGED_PAGE_SIZE ];
+    char n[ sizeof(u_int64_t) ];
+    lxqt_wallet_error r;
+
+    _paged_set_u64(n, number);
+
+    gcry_create_nonce(page, PAGED_NONCE_SIZE);
+
+    r = _paged_crypt(w, page, n, sizeof(n), page + PAGED_NONCE_SIZE, payload, PAGED_PAYLOAD_SIZE, tag, 1);
+
+    if (r == lxqt_wallet_no_error &&
+        _lxqt_wallet_write_all_at(w->fd, page, PAGED_PAGE_SIZE, (off_t)(number * PAGED_PAGE_SIZE)) != 0)
+    {
+        r = lxqt_wallet_failed_to_open_file;
+    }
+
+    return r;
+}
+
+static int _paged_list_push(struct _page_list *list, u_int64_t page)
+{
+    size_t capacity;
+    u_int64_t *e;
+
+    if (list->count == list->capacity)
+    {
+        capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+
+        e = realloc(list->pages, capacity * sizeof(u_int64_t));
+
+        if (e == NULL)
+        {
+            return 1;
+        }
+
+        list->pages    = e;
+        list->capacity = capacity;
+    }
+
+    list->pages[ list->count++ ] = page;
+
+    return 0;
+}
+
+static void _paged_lru_unlink(lxqt_wallet_paged_t w, struct _page *page)
+{
+    if (page->lru_previous != NULL)
+    {
+        page->lru_previous->lru_next = page->lru_next;
+    }
+    else
+    {
+        w->lru_head = page->lru_next;
+    }
+
+    if (page->lru_next != NULL)
+    {
+        page->lru_next->lru_previous = page->lru_previous;
+    }
+    else
+    {
+        w->lru_tail = page->lru_previous;
+    }
+
+    page->lru_previous = NULL;
+    page->lru_next     = NULL;
+}
+
+static void _paged_lru_push(lxqt_wallet_paged_t w, struct _page *page)
+{
+    page->lru_previous = NULL;
+    page->lru_next     = w->lru_head;
+
+    if (w->lru_head != NULL)
+    {
+        w->lru_head->lru_previous = page;
+    }
+    else
+    {
+        w->lru_tail = page;
+    }
+
+    w->lru_head = page;
+}
+
+static struct _page *_paged_cache_find(lxqt_wallet_paged_t w, u_int64_t number)
+{
+    struct _page *e = w->buckets[ number & (w->bucket_count - 1) ];
+
+    while (e != NULL && e->number != number)
+    {
+        e = e->hash_next;
+    }
+
+    return e;
+}
+
+/*
+ * take a page out of the cache and wipe it
+ */
+static void _paged_cache_remove(lxqt_wallet_paged_t w, struct _page *page)
+{
+    struct _page **e = w->buckets + (page->number & (w->bucket_count - 1));
+
+    while (*e != page)
+    {
+        e = &(*e)->hash_next;
+    }
+
+    *e = page->hash_next;
+
+    if (!page->dirty)
+    {
+        _paged_lru_unlink(w, page);
+        w->clean_count--;
+    }
+
+    w->cached_count--;
+
+    _lxqt_wallet_free_locked_buffer(page->data, PAGED_PAYLOAD_SIZE);
+    free(page);
+}
+
+/*
+ * evict least recently used clean pages that are not pinned until the cache is back to its size
+ */
+static void _paged_cache_trim(lxqt_wallet_paged_t w)
+{
+    struct _page *e = w->lru_tail;
+    struct _page *z;
+
+    while (e != NULL && w->clean_count > w->cache_size)
+    {
+        z = e->lru_previous;
+
+        if (e->pins == 0)
+        {
+            _paged_cache_remove(w, e);
+        }
+
+        e = z;
+    }
+}
+
+/*
+ * double the hash table once there are twice as many pages as buckets,dirty pages are not bounded by the cache size
+ */
+static void _paged_cache_grow(lxqt_wallet_paged_t w)
+{
+    struct _page **buckets;
+    struct _page *e;
+    struct _page *z;
+    size_t count = w->bucket_count * 2;
+    size_t i;
+
+    if (w->cached_count < count)
+    {
+        return;
+    }
+
+    buckets = calloc(count, sizeof(struct _page *));
+
+    if (buckets == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < w->bucket_count; i++)
+    {
+        for (e = w->buckets[ i ]; e != NULL; e = z)
+        {
+            z = e->hash_next;
+            e->hash_next = buckets[ e->number & (count - 1) ];
+            buckets[ e->number & (count - 1) ] = e;
+        }
+    }
+
+    free(w->buckets);
+
+    w->buckets      = buckets;
+    w->bucket_count = count;
+}
+
+static struct _page *_paged_cache_add(lxqt_wallet_paged_t w, u_int64_t number, int dirty)
+{
+    struct _page *e = calloc(1, sizeof(struct _page));
+
+    if (e == NULL)
+    {
+        return NULL;
+    }
+
+    e->data = _lxqt_wallet_locked_buffer(PAGED_PAYLOAD_SIZE);
+
+    if (e->data == NULL)
+    {
+        free(e);
+        return NULL;
+    }
+
+    _paged_cache_grow(w);
+
+    e->number = number;
+    e->dirty  = dirty;
+    e->pins   = 1;
+
+    e->hash_next = w->buckets[ number & (w->bucket_count - 1) ];
+    w->buckets[ number & (w->bucket_count - 1) ] = e;
+
+    if (!dirty)
+    {
+        _paged_lru_push(w, e);
+        w->clean_count++;
+    }
+
+    w->cached_count++;
+
+    return e;
+}
+
+/*
+ * get a pinned page,"tag" authenticates it if it has to be read
+ */
+static lxqt_wallet_error _paged_get(lxqt_wallet_paged_t w, u_int64_t number, const char *tag, struct _page **page)
+{
+    lxqt_wallet_error r;
+    struct _page *e = _paged_cache_find(w, number);
+
+    if (e != NULL)
+    {
+        if (!e->dirty)
+        {
+            _paged_lru_unlink(w, e);
+            _paged_lru_push(w, e);
+        }
+
+        e->pins++;
+        *page = e;
+
+        return lxqt_wallet_no_error;
+    }
+
+    e = _paged_cache_add(w, number, 0);
+
+    if (e == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    r = _paged_read_page(w, number, tag, e->data);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        _paged_cache_remove(w, e);
+        return r;
+    }
+
+    _paged_cache_trim(w);
+
+    *page = e;
+
+    return lxqt_wallet_no_error;
+}
+
+static void _paged_put(struct _page *page)
+{
+    if (page != NULL)
+    {
+        page->pins--;
+    }
+}
+
+static u_int64_t _paged_allocate(lxqt_wallet_paged_t w)
+{
+    w->modified = 1;
+
+    if (w->available.count > 0)
+    {
+        return w->available.pages[ --w->available.count ];
+    }
+    else
+    {
+        return w->sb.page_count++;
+    }
+}
+
+/*
+ * pages freed before a save may still be used by the wallet on disk and are given out only after the save
+ */
+static lxqt_wallet_error _paged_free_page(lxqt_wallet_paged_t w, u_int64_t number)
+{
+    struct _page *e = _paged_cache_find(w, number);
+
+    if (e != NULL)
+    {
+        _paged_cache_remove(w, e);
+    }
+
+    w->modified = 1;
+
+    if (_paged_list_push(&w->pending, number) != 0)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * get a new pinned and empty tree page
+ */
+static lxqt_wallet_error _paged_new_page(lxqt_wallet_paged_t w, int type, struct _page **page)
+{
+    struct _page *e = _paged_cache_add(w, _paged_allocate(w), 1);
+
+    if (e == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    e->data[ 0 ] = (char)type;
+    _paged_set_u16(e->data + 4, PAGED_PAYLOAD_SIZE);
+
+    *page = e;
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * make a pinned page changeable by moving it to a new page number if it was not changed since the last save,the
+ * caller points the parent of the page to its new number
+ */
+static lxqt_wallet_error _paged_writable(lxqt_wallet_paged_t w, struct _page **page)
+{
+    struct _page *e;
+    lxqt_wallet_error r;
+
+    if ((*page)->dirty)
+    {
+        return lxqt_wallet_no_error;
+    }
+
+    r = _paged_new_page(w, PAGED_LEAF, &e);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    memcpy(e->data, (*page)->data, PAGED_PAYLOAD_SIZE);
+
+    r = _paged_free_page(w, (*page)->number);
+
+    *page = e;
+
+    return r;
+}
+
+static int _paged_compare(const char *a, u_int32_t a_size, const char *b, u_int32_t b_size)
+{
+    int r = memcmp(a, b, a_size < b_size ? a_size : b_size);
+
+    if (r != 0)
+    {
+        return r;
+    }
+    else if (a_size < b_size)
+    {
+        return -1;
+    }
+    else
+    {
+        return a_size > b_size;
+    }
+}
+
+static int _paged_type(const char *page)
+{
+    return page[ 0 ];
+}
+
+static int _paged_count(const char *page)
+{
+    return _paged_u16(page + 2);
+}
+
+static size_t _paged_slots(const char *page)
+{
+    if (_paged_type(page) == PAGED_INTERNAL)
+    {
+        return PAGED_NODE_HEADER_SIZE + PAGED_POINTER_SIZE;
+    }
+    else
+    {
+        return PAGED_NODE_HEADER_SIZE;
+    }
+}
+
+static const char *_paged_entry(const char *page, int index)
+{
+    return page + _paged_u16(page + _paged_slots(page) + 2 * index);
+}
+
+static struct _entry _paged_entry_key(const char *page, int index)
+{
+    const char *e = _paged_entry(page, index);
+    struct _entry key;
+
+    key.size = _paged_u32(e);
+
+    if (_paged_type(page) == PAGED_INTERNAL)
+    {
+        key.data = e + sizeof(u_int32_t);
+    }
+    else
+    {
+        key.data = e + 2 * sizeof(u_int32_t);
+    }
+
+    return key;
+}
+
+static u_int32_t _paged_entry_size(const char *page, const char *e)
+{
+    u_int32_t key_size = _paged_u32(e);
+    u_int32_t value_size;
+
+    if (_paged_type(page) == PAGED_INTERNAL)
+    {
+        return sizeof(u_int32_t) + key_size + PAGED_POINTER_SIZE;
+    }
+
+    value_size = _paged_u32(e + sizeof(u_int32_t));
+
+    if (value_size & PAGED_OVERFLOW_FLAG)
+    {
+        return 2 * sizeof(u_int32_t) + key_size + PAGED_POINTER_SIZE;
+    }
+    else
+    {
+        return 2 * sizeof(u_int32_t) + key_size + value_size;
+    }
+}
+
+/*
+ * index of the first entry whose key is not smaller than "key"
+ */
+static int _paged_search(const char *page, const char *key, u_int32_t key_size, int *found)
+{
+    int low = 0;
+    int high = _paged_count(page);
+    int middle;
+    int r;
+    struct _entry e;
+
+    *found = 0;
+
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+
+        e = _paged_entry_key(page, middle);
+
+        r = _paged_compare(e.data, e.size, key, key_size);
+
+        if (r < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            if (r == 0)
+            {
+                *found = 1;
+            }
+
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/*
+ * the pointer to child "index" of an internal page,child 0 holds keys smaller than the key of entry 0 and child "n"
+ * is the child of entry "n - 1"
+ */
+static char *_paged_child(char *page, int index)
+{
+    const char *e;
+
+    if (index == 0)
+    {
+        return page + PAGED_NODE_HEADER_SIZE;
+    }
+
+    e = _paged_entry(page, index - 1);
+
+    return page + (e - page) + sizeof(u_int32_t) + _paged_u32(e);
+}
+
+static int _paged_child_index(const char *page, const char *key, u_int32_t key_size)
+{
+    int found;
+    int index = _paged_search(page, key, key_size, &found);
+
+    return found ? index + 1 : index;
+}
+
+/*
+ * list the entries of a page,entries point into "page"
+ */
+static int _paged_entries(const char *page, struct _entry *entries)
+{
+    int count = _paged_count(page);
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        entries[ i ].data = _paged_entry(page, i);
+        entries[ i ].size = _paged_entry_size(page, entries[ i ].data);
+    }
+
+    return count;
+}
+
+static size_t _paged_entries_size(const struct _entry *entries, int count, int type)
+{
+    size_t r = type == PAGED_INTERNAL ? PAGED_NODE_HEADER_SIZE + PAGED_POINTER_SIZE : PAGED_NODE_HEADER_SIZE;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        r += sizeof(u_int16_t) + entries[ i ].size;
+    }
+
+    return r;
+}
+
+/*
+ * lay out a page from entries that do not point into it,"child" is the first child of an internal page
+ */
+static void _paged_build(char *page, int type, const char *child, const struct _entry *entries, int count)
+{
+    size_t slots = type == PAGED_INTERNAL ? PAGED_NODE_HEADER_SIZE + PAGED_POINTER_SIZE : PAGED_NODE_HEADER_SIZE;
+    size_t offset = PAGED_PAYLOAD_SIZE;
+    int i;
+
+    memset(page, '\0', PAGED_PAYLOAD_SIZE);
+
+    page[ 0 ] = (char)type;
+    _paged_set_u16(page + 2, (u_int16_t)count);
+
+    if (type == PAGED_INTERNAL)
+    {
+        memcpy(page + PAGED_NODE_HEADER_SIZE, child, PAGED_POINTER_SIZE);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        offset -= entries[ i ].size;
+        memcpy(page + offset, entries[ i ].data, entries[ i ].size);
+        _paged_set_u16(page + slots + 2 * i, (u_int16_t)offset);
+    }
+
+    _paged_set_u16(page + 4, (u_int16_t)offset);
+}
+
+/*
+ * put "entry" at "index" of a pinned changeable page or replace the entry there,a page that overflows is split in two
+ * and "split" is set,"separator" then gets the first key of the new right page and "right" its number
+ */
+static lxqt_wallet_error _paged_insert(lxqt_wallet_paged_t w, struct _page *page, int index, int replace,
+                                       struct _entry entry, char *separator, u_int32_t *separator_size,
+                                       u_int64_t *right, int *split)
+{
+    struct _entry entries[ PAGED_MAX_ENTRIES + 1 ];
+    char copy[ PAGED_PAYLOAD_SIZE ];
+    char child[ PAGED_POINTER_SIZE ];
+    int type = _paged_type(page->data);
+    struct _page *e;
+    struct _entry key;
+    lxqt_wallet_error r;
+    size_t total;
+    size_t half;
+    size_t size;
+    int count;
+    int middle;
+
+    memcpy(copy, page->data, PAGED_PAYLOAD_SIZE);
+
+    count = _paged_entries(copy, entries);
+
+    if (replace)
+    {
+        entries[ index ] = entry;
+    }
+    else
+    {
+        memmove(entries + index + 1, entries + index, (count - index) * sizeof(struct _entry));
+        entries[ index ] = entry;
+        count++;
+    }
+
+    if (type == PAGED_INTERNAL)
+    {
+        memcpy(child, copy + PAGED_NODE_HEADER_SIZE, PAGED_POINTER_SIZE);
+    }
+
+    total = _paged_entries_size(entries, count, type);
+
+    *split = 0;
+
+    if (total <= PAGED_PAYLOAD_SIZE && count <= PAGED_MAX_ENTRIES)
+    {
+        _paged_build(page->data, type, child, entries, count);
+        memset(copy, '\0', sizeof(copy));
+        return lxqt_wallet_no_error;
+    }
+
+    /*
+     * split where the left page gets about half of the bytes,an internal page gives its middle entry to its parent
+     */
+    half = total / 2;
+    size = 0;
+
+    for (middle = 0; middle < count - 1; middle++)
+    {
+        size += sizeof(u_int16_t) + entries[ middle ].size;
+
+        if (size >= half)
+        {
+            break;
+        }
+    }
+
+    if (type == PAGED_INTERNAL)
+    {
+        if (middle < 1)
+        {
+            middle = 1;
+        }
+        else if (middle > count - 2)
+        {
+            middle = count - 2;
+        }
+    }
+    else if (middle < count - 1)
+    {
+        middle++;
+    }
+
+    r = _paged_new_page(w, type, &e);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        memset(copy, '\0', sizeof(copy));
+        return r;
+    }
+
+    key.size = _paged_u32(entries[ middle ].data);
+
+    if (type == PAGED_INTERNAL)
+    {
+        key.data = entries[ middle ].data + sizeof(u_int32_t);
+
+        _paged_build(page->data, type, child, entries, middle);
+        _paged_build(e->data, type, key.data + key.size, entries + middle + 1, count - middle - 1);
+    }
+    else
+    {
+        key.data = entries[ middle ].data + 2 * sizeof(u_int32_t);
+
+        _paged_build(page->data, type, NULL, entries, middle);
+        _paged_build(e->data, type, NULL, entries + middle, count - middle);
+    }
+
+    memcpy(separator, key.data, key.size);
+
+    *separator_size = key.size;
+    *right = e->number;
+    *split = 1;
+
+    _paged_put(e);
+
+    memset(copy, '\0', sizeof(copy));
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * take entry "index" out of a pinned changeable page
+ */
+static void _paged_remove(struct _page *page, int index)
+{
+    struct _entry entries[ PAGED_MAX_ENTRIES ];
+    char copy[ PAGED_PAYLOAD_SIZE ];
+    char child[ PAGED_POINTER_SIZE ];
+    int type = _paged_type(page->data);
+    int count;
+
+    memcpy(copy, page->data, PAGED_PAYLOAD_SIZE);
+
+    count = _paged_entries(copy, entries);
+
+    memmove(entries + index, entries + index + 1, (count - index - 1) * sizeof(struct _entry));
+
+    memcpy(child, copy + PAGED_NODE_HEADER_SIZE, PAGED_POINTER_SIZE);
+
+    _paged_build(page->data, type, child, entries, count - 1);
+
+    memset(copy, '\0', sizeof(copy));
+}
+
+/*
+ * take child "index" out of a pinned changeable internal page,returns 1 if the page was left without children
+ */
+static int _paged_remove_child(struct _page *page, int index)
+{
+    const char *e;
+
+    if (index > 0)
+    {
+        _paged_remove(page, index - 1);
+        return 0;
+    }
+
+    if (_paged_count(page->data) == 0)
+    {
+        return 1;
+    }
+
+    e = _paged_entry(page->data, 0);
+
+    memmove(page->data + PAGED_NODE_HEADER_SIZE, e + sizeof(u_int32_t) + _paged_u32(e), PAGED_POINTER_SIZE);
+
+    _paged_remove(page, 0);
+
+    return 0;
+}
+
+static void _paged_release(struct _path *path, int depth)
+{
+    int i;
+
+    for (i = 0; i < depth; i++)
+    {
+        _paged_put(path[ i ].page);
+    }
+}
+
+/*
+ * walk from the root to the leaf that holds "key" pinning pages on the way,pages are made changeable on the way when
+ * "writable" is set.An empty wallet gives a depth of 0
+ */
+static lxqt_wallet_error _paged_descend(lxqt_wallet_paged_t w, const char *key, u_int32_t key_size, int writable,
+                                        struct _path *path, int *depth)
+{
+    struct _page *page;
+    lxqt_wallet_error r;
+    char *child = NULL;
+    int d = 0;
+    int found;
+
+    *depth = 0;
+
+    if (w->sb.root == PAGED_NO_PAGE)
+    {
+        return lxqt_wallet_no_error;
+    }
+
+    r = _paged_get(w, w->sb.root, w->sb.root_tag, &page);
+
+    while (r == lxqt_wallet_no_error)
+    {
+        if (writable)
+        {
+            r = _paged_writable(w, &page);
+
+            if (r != lxqt_wallet_no_error)
+            {
+                _paged_put(page);
+                break;
+            }
+
+            if (child == NULL)
+            {
+                w->sb.root = page->number;
+            }
+            else
+            {
+                _paged_set_u64(child, page->number);
+            }
+        }
+
+        path[ d ].page = page;
+
+        if (_paged_type(page->data) == PAGED_LEAF)
+        {
+            path[ d ].index = _paged_search(page->data, key, key_size, &found);
+            *depth = d + 1;
+            return lxqt_wallet_no_error;
+        }
+
+        d++;
+
+        if (_paged_type(page->data) != PAGED_INTERNAL || d == PAGED_MAX_DEPTH)
+        {
+            r = lxqt_wallet_incompatible_wallet;
+            break;
+        }
+
+        path[ d - 1 ].index = _paged_child_index(page->data, key, key_size);
+
+        child = _paged_child(page->data, path[ d - 1 ].index);
+
+        r = _paged_get(w, _paged_u64(child), child + sizeof(u_int64_t), &page);
+    }
+
+    _paged_release(path, d);
+
+    return r;
+}
+
+static char *_paged_result(lxqt_wallet_paged_t w, size_t size)
+{
+    char *e;
+
+    if (size > w->result_size)
+    {
+        e = _lxqt_wallet_locked_buffer(size);
+
+        if (e == NULL)
+        {
+            return NULL;
+        }
+
+        _lxqt_wallet_free_locked_buffer(w->result, w->result_size);
+
+        w->result      = e;
+        w->result_size = size;
+    }
+
+    return w->result;
+}
+
+/*
+ * write a value to a chain of overflow pages starting from its end so that every page knows the tag of the next one
+ */
+static lxqt_wallet_error _paged_write_overflow(lxqt_wallet_paged_t w, const char *value, u_int32_t value_size,
+                                              char pointer[ PAGED_POINTER_SIZE ])
+{
+    u_int64_t count = (value_size + PAGED_CHAIN_CAPACITY - 1) / PAGED_CHAIN_CAPACITY;
+    u_int64_t *pages = malloc(count * sizeof(u_int64_t));
+    lxqt_wallet_error r = lxqt_wallet_no_error;
+    char next[ PAGED_POINTER_SIZE ];
+    u_int64_t offset;
+    u_int32_t size;
+    u_int64_t i;
+
+    if (pages == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        pages[ i ] = _paged_allocate(w);
+    }
+
+    memset(next, '\0', sizeof(next));
+
+    for (i = count; i > 0 && r == lxqt_wallet_no_error; i--)
+    {
+        offset = (i - 1) * PAGED_CHAIN_CAPACITY;
+        size   = value_size - offset < PAGED_CHAIN_CAPACITY ? value_size - offset : PAGED_CHAIN_CAPACITY;
+
+        memset(w->scratch, '\0', PAGED_PAYLOAD_SIZE);
+
+        w->scratch[ 0 ] = PAGED_OVERFLOW;
+        _paged_set_u32(w->scratch + 4, size);
+        memcpy(w->scratch + 8, next, PAGED_POINTER_SIZE);
+        memcpy(w->scratch + PAGED_CHAIN_HEADER_SIZE, value + offset, size);
+
+        _paged_set_u64(next, pages[ i - 1 ]);
+
+        r = _paged_write_page(w, pages[ i - 1 ], w->scratch, next + sizeof(u_int64_t));
+    }
+
+    if (r == lxqt_wallet_no_error)
+    {
+        memcpy(pointer, next, PAGED_POINTER_SIZE);
+    }
+    else
+    {
+        for (i = 0; i < count; i++)
+        {
+            _paged_list_push(&w->pending, pages[ i ]);
+        }
+    }
+
+    free(pages);
+
+    return r;
+}
+
+/*
+ * read a chain of overflow pages to "value" or only free its pages when "value" is NULL
+ */
+static lxqt_wallet_error _paged_read_overflow(lxqt_wallet_paged_t w, const char *pointer, u_int32_t value_size,
+                                             char *value)
+{
+    char next[ PAGED_POINTER_SIZE ];
+    lxqt_wallet_error r;
+    u_int64_t number;
+    u_int64_t offset = 0;
+    u_int32_t size;
+
+    memcpy(next, pointer, PAGED_POINTER_SIZE);
+
+    while (offset < value_size)
+    {
+        number = _paged_u64(next);
+
+        r = _paged_read_page(w, number, next + sizeof(u_int64_t), w->scratch);
+
+        if (r != lxqt_wallet_no_error)
+        {
+            return r;
+        }
+
+        size = _paged_u32(w->scratch + 4);
+
+        if (w->scratch[ 0 ] != PAGED_OVERFLOW || size == 0 || size > PAGED_CHAIN_CAPACITY ||
+            size > value_size - offset)
+        {
+            return lxqt_wallet_incompatible_wallet;
+        }
+
+        if (value != NULL)
+        {
+            memcpy(value + offset, w->scratch + PAGED_CHAIN_HEADER_SIZE, size);
+        }
+        else if (_paged_free_page(w, number) != lxqt_wallet_no_error)
+        {
+            return lxqt_wallet_failed_to_allocate_memory;
+        }
+
+        memcpy(next, w->scratch + 8, PAGED_POINTER_SIZE);
+
+        offset += size;
+    }
+
+    memset(w->scratch, '\0', PAGED_PAYLOAD_SIZE);
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * free the overflow pages of a leaf entry if it has any
+ */
+static lxqt_wallet_error _paged_free_value(lxqt_wallet_paged_t w, const char *entry)
+{
+    u_int32_t key_size = _paged_u32(entry);
+    u_int32_t value_size = _paged_u32(entry + sizeof(u_int32_t));
+
+    if (value_size & PAGED_OVERFLOW_FLAG)
+    {
+        return _paged_read_overflow(w, entry + 2 * sizeof(u_int32_t) + key_size, value_size & ~PAGED_OVERFLOW_FLAG,
+                                    NULL);
+    }
+    else
+    {
+        return lxqt_wallet_no_error;
+    }
+}
+
+/*
+ * copy a leaf entry to the result buffer
+ */
+static lxqt_wallet_error _paged_copy_entry(lxqt_wallet_paged_t w, const char *entry,
+                                           lxqt_wallet_key_values_t *key_value)
+{
+    u_int32_t key_size = _paged_u32(entry);
+    u_int32_t value_size = _paged_u32(entry + sizeof(u_int32_t));
+    const char *e = entry + 2 * sizeof(u_int32_t);
+    char pointer[ PAGED_POINTER_SIZE ];
+    int overflow = (value_size & PAGED_OVERFLOW_FLAG) != 0;
+    lxqt_wallet_error r;
+    char *buffer;
+
+    value_size &= ~PAGED_OVERFLOW_FLAG;
+
+    buffer = _paged_result(w, (size_t)key_size + value_size + 1);
+
+    if (buffer == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    memcpy(buffer, e, key_size);
+
+    if (overflow)
+    {
+        /*
+         * the entry may point into a cached page that reading the chain does not touch,it is copied nonetheless
+         */
+        memcpy(pointer, e + key_size, PAGED_POINTER_SIZE);
+
+        r = _paged_read_overflow(w, pointer, value_size, buffer + key_size);
+
+        if (r != lxqt_wallet_no_error)
+        {
+            return r;
+        }
+    }
+    else
+    {
+        memcpy(buffer + key_size, e + key_size, value_size);
+    }
+
+    key_value->key            = buffer;
+    key_value->key_size       = key_size;
+    key_value->key_value      = buffer + key_size;
+    key_value->key_value_size = value_size;
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * write changed pages under "page" and then "page" itself,"tag" gets the tag of "page"
+ */
+static lxqt_wallet_error _paged_commit(lxqt_wallet_paged_t w, struct _page *page, char *tag)
+{
+    struct _page *e;
+    lxqt_wallet_error r;
+    char *child;
+    int count;
+    int i;
+
+    if (_paged_type(page->data) == PAGED_INTERNAL)
+    {
+        count = _paged_count(page->data);
+
+        for (i = 0; i <= count; i++)
+        {
+            child = _paged_child(page->data, i);
+
+            e = _paged_cache_find(w, _paged_u64(child));
+
+            if (e != NULL && e->dirty)
+            {
+                r = _paged_commit(w, e, child + sizeof(u_int64_t));
+
+                if (r != lxqt_wallet_no_error)
+                {
+                    return r;
+                }
+            }
+        }
+    }
+
+    r = _paged_write_page(w, page->number, page->data, tag);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        page->dirty = 0;
+        _paged_lru_push(w, page);
+        w->clean_count++;
+    }
+
+    return r;
+}
+
+/*
+ * write the list of free pages to new pages at the end of the file,the pages of the previous list are in it
+ */
+static lxqt_wallet_error _paged_write_free_list(lxqt_wallet_paged_t w, struct _page_list *free_pages,
+                                               struct _page_list *list_pages)
+{
+    const u_int64_t capacity = PAGED_CHAIN_CAPACITY / sizeof(u_int64_t);
+    lxqt_wallet_error r = lxqt_wallet_no_error;
+    char next[ PAGED_POINTER_SIZE ];
+    u_int64_t count;
+    u_int64_t size;
+    u_int64_t i;
+    size_t j;
+
+    for (j = 0; j < w->available.count; j++)
+    {
+        if (_paged_list_push(free_pages, w->available.pages[ j ]) != 0)
+        {
+            return lxqt_wallet_failed_to_allocate_memory;
+        }
+    }
+
+    for (j = 0; j < w->pending.count; j++)
+    {
+        if (_paged_list_push(free_pages, w->pending.pages[ j ]) != 0)
+        {
+            return lxqt_wallet_failed_to_allocate_memory;
+        }
+    }
+
+    for (j = 0; j < w->free_list_pages.count; j++)
+    {
+        if (_paged_list_push(free_pages, w->free_list_pages.pages[ j ]) != 0)
+        {
+            return lxqt_wallet_failed_to_allocate_memory;
+        }
+    }
+
+    count = (free_pages->count + capacity - 1) / capacity;
+
+    for (i = 0; i < count; i++)
+    {
+        if (_paged_list_push(list_pages, w->sb.page_count++) != 0)
+        {
+            return lxqt_wallet_failed_to_allocate_memory;
+        }
+    }
+
+    memset(next, '\0', sizeof(next));
+
+    for (i = count; i > 0 && r == lxqt_wallet_no_error; i--)
+    {
+        size = free_pages->count - (i - 1) * capacity < capacity ? free_pages->count - (i - 1) * capacity : capacity;
+
+        memset(w->scratch, '\0', PAGED_PAYLOAD_SIZE);
+
+        w->scratch[ 0 ] = PAGED_FREE_LIST;
+        _paged_set_u32(w->scratch + 4, (u_int32_t)size);
+        memcpy(w->scratch + 8, next, PAGED_POINTER_SIZE);
+        memcpy(w->scratch + PAGED_CHAIN_HEADER_SIZE, free_pages->pages + (i - 1) * capacity,
+               size * sizeof(u_int64_t));
+
+        _paged_set_u64(next, list_pages->pages[ i - 1 ]);
+
+        r = _paged_write_page(w, list_pages->pages[ i - 1 ], w->scratch, next + sizeof(u_int64_t));
+    }
+
+    w->sb.free_list = _paged_u64(next);
+    memcpy(w->sb.free_list_tag, next + sizeof(u_int64_t), PAGED_TAG_SIZE);
+
+    return r;
+}
+
+static lxqt_wallet_error _paged_read_free_list(lxqt_wallet_paged_t w)
+{
+    char next[ PAGED_POINTER_SIZE ];
+    lxqt_wallet_error r;
+    u_int64_t number;
+    u_int32_t count;
+    u_int32_t i;
+
+    _paged_set_u64(next, w->sb.free_list);
+    memcpy(next + sizeof(u_int64_t), w->sb.free_list_tag, PAGED_TAG_SIZE);
+
+    while ((number = _paged_u64(next)) != PAGED_NO_PAGE)
+    {
+        if (w->free_list_pages.count >= w->sb.page_count)
+        {
+            return lxqt_wallet_incompatible_wallet;
+        }
+
+        r = _paged_read_page(w, number, next + sizeof(u_int64_t), w->scratch);
+
+        if (r != lxqt_wallet_no_error)
+        {
+            return r;
+        }
+
+        count = _paged_u32(w->scratch + 4);
+
+        if (w->scratch[ 0 ] != PAGED_FREE_LIST || count > PAGED_CHAIN_CAPACITY / sizeof(u_int64_t))
+        {
+            return lxqt_wallet_incompatible_wallet;
+        }
+
+        if (_paged_list_push(&w->free_list_pages, number) != 0)
+        {
+            return lxqt_wallet_failed_to_allocate_memory;
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            if (_paged_list_push(&w->available,
+                                 _paged_u64(w->scratch + PAGED_CHAIN_HEADER_SIZE + i * sizeof(u_int64_t))) != 0)
+            {
+                return lxqt_wallet_failed_to_allocate_memory;
+            }
+        }
+
+        memcpy(next, w->scratch + 8, PAGED_POINTER_SIZE);
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+static void _paged_encode_superblock(lxqt_wallet_paged_t w, char buffer[ PAGED_SUPERBLOCK_SIZE ])
+{
+    u_int32_t version = PAGED_VERSION;
+    u_int32_t page_size = PAGED_PAGE_SIZE;
+    char *e = buffer;
+
+    memcpy(e, PAGED_MAGIC_STRING, PAGED_MAGIC_STRING_SIZE);
+    e += PAGED_MAGIC_STRING_SIZE;
+    memcpy(e, &version, sizeof(u_int32_t));
+    e += sizeof(u_int32_t);
+    memcpy(e, &page_size, sizeof(u_int32_t));
+    e += sizeof(u_int32_t);
+    memcpy(e, w->salt, PAGED_SALT_SIZE);
+    e += PAGED_SALT_SIZE;
+    _paged_set_u64(e, w->sb.generation);
+    e += sizeof(u_int64_t);
+    _paged_set_u64(e, w->sb.root);
+    e += sizeof(u_int64_t);
+    memcpy(e, w->sb.root_tag, PAGED_TAG_SIZE);
+    e += PAGED_TAG_SIZE;
+    _paged_set_u64(e, w->sb.page_count);
+    e += sizeof(u_int64_t);
+    _paged_set_u64(e, w->sb.free_list);
+    e += sizeof(u_int64_t);
+    memcpy(e, w->sb.free_list_tag, PAGED_TAG_SIZE);
+    e += PAGED_TAG_SIZE;
+    _paged_set_u64(e, w->sb.entry_count);
+}
+
+static void _paged_decode_superblock(const char buffer[ PAGED_SUPERBLOCK_SIZE ], struct _superblock *sb)
+{
+    const char *e = buffer + PAGED_MAGIC_STRING_SIZE + 2 * sizeof(u_int32_t) + PAGED_SALT_SIZE;
+
+    sb->generation = _paged_u64(e);
+    e += sizeof(u_int64_t);
+    sb->root = _paged_u64(e);
+    e += sizeof(u_int64_t);
+    memcpy(sb->root_tag, e, PAGED_TAG_SIZE);
+    e += PAGED_TAG_SIZE;
+    sb->page_count = _paged_u64(e);
+    e += sizeof(u_int64_t);
+    sb->free_list = _paged_u64(e);
+    e += sizeof(u_int64_t);
+    memcpy(sb->free_list_tag, e, PAGED_TAG_SIZE);
+    e += PAGED_TAG_SIZE;
+    sb->entry_count = _paged_u64(e);
+}
+
+/*
+ * seal the superblock of the handle to "buffer",it goes to the slot of its generation
+ */
+static lxqt_wallet_error _paged_seal_superblock(lxqt_wallet_paged_t w, char buffer[ PAGED_PAGE_SIZE ])
+{
+    memset(buffer, '\0', PAGED_PAGE_SIZE);
+
+    _paged_encode_superblock(w, buffer);
+
+    gcry_create_nonce(buffer + PAGED_SUPERBLOCK_DATA_SIZE, PAGED_NONCE_SIZE);
+
+    return _paged_crypt(w, buffer + PAGED_SUPERBLOCK_DATA_SIZE, buffer, PAGED_SUPERBLOCK_DATA_SIZE,
+                        buffer + PAGED_SUPERBLOCK_SIZE - PAGED_MAGIC_STRING_SIZE, PAGED_MAGIC_STRING,
+                        PAGED_MAGIC_STRING_SIZE, buffer + PAGED_SUPERBLOCK_DATA_SIZE + PAGED_NONCE_SIZE, 1);
+}
+
+static void _paged_free(lxqt_wallet_paged_t w)
+{
+    struct _page *e;
+    struct _page *z;
+    size_t i;
+
+    if (w->buckets != NULL)
+    {
+        for (i = 0; i < w->bucket_count; i++)
+        {
+            for (e = w->buckets[ i ]; e != NULL; e = z)
+            {
+                z = e->hash_next;
+                _lxqt_wallet_free_locked_buffer(e->data, PAGED_PAYLOAD_SIZE);
+                free(e);
+            }
+        }
+    }
+
+    if (w->cipher != NULL)
+    {
+        gcry_cipher_close(w->cipher);
+    }
+
+    if (w->fd != -1)
+    {
+        close(w->fd);
+    }
+
+    _lxqt_wallet_free_locked_buffer(w->result, w->result_size);
+    _lxqt_wallet_free_locked_buffer(w->scratch, PAGED_PAYLOAD_SIZE);
+    _lxqt_wallet_free_locked_buffer(w->iter_key, PAGED_MAX_KEY_SIZE);
+
+    free(w->wallet_name);
+    free(w->application_name);
+    free(w->available.pages);
+    free(w->pending.pages);
+    free(w->free_list_pages.pages);
+    free(w->buckets);
+    free(w);
+}
+
+static lxqt_wallet_paged_t _paged_allocate_handle(void)
+{
+    lxqt_wallet_paged_t w = calloc(1, sizeof(struct lxqt_wallet_paged_struct));
+
+    if (w == NULL)
+    {
+        return NULL;
+    }
+
+    w->fd           = -1;
+    w->cache_size   = PAGED_DEFAULT_CACHE_SIZE;
+    w->bucket_count = 1024;
+    w->buckets      = calloc(w->bucket_count, sizeof(struct _page *));
+    w->scratch      = _lxqt_wallet_locked_buffer(PAGED_PAYLOAD_SIZE);
+    w->iter_key     = _lxqt_wallet_locked_buffer(PAGED_MAX_KEY_SIZE);
+
+    if (w->buckets == NULL || w->scratch == NULL || w->iter_key == NULL)
+    {
+        _paged_free(w);
+        return NULL;
+    }
+
+    return w;
+}
+
+lxqt_wallet_error lxqt_wallet_paged_create(const char *password, u_int32_t password_length, const char *wallet_name,
+                                           const char *application_name)
+{
+    char buffer[ 2 * PAGED_PAGE_SIZE ];
+    struct stat st;
+    lxqt_wallet_paged_t w;
+    lxqt_wallet_error r;
+    int dirfd;
+    int lock;
+
+    if (password == NULL || wallet_name == NULL || application_name == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    w = _paged_allocate_handle();
+
+    if (w == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    _paged_initialize_gcrypt();
+
+    gcry_create_nonce(w->salt, PAGED_SALT_SIZE);
+
+    w->sb.generation = 1;
+    w->sb.page_count = 2;
+
+    r = _paged_open_cipher(w, password, password_length);
+
+    memset(buffer, '\0', sizeof(buffer));
+
+    if (r == lxqt_wallet_no_error)
+    {
+        r = _paged_seal_superblock(w, buffer + PAGED_PAGE_SIZE);
+    }
+
+    _paged_free(w);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    dirfd = _lxqt_wallet_application_directory(application_name, 1);
+
+    lock = _lxqt_wallet_lock_application_directory(application_name);
+
+    if (dirfd == -1 || lock == -1)
+    {
+        r = lxqt_wallet_failed_to_open_file;
+    }
+    else if (lxqt_wallet_paged_exists(wallet_name, application_name) == 0 ||
+             lxqt_wallet_exists(wallet_name, application_name) == 0 ||
+             lxqt_wallet_sharded_exists(wallet_name, application_name) == 0)
+    {
+        r = lxqt_wallet_wallet_exists;
+    }
+    else
+    {
+        r = _paged_write_file(dirfd, wallet_name, buffer, sizeof(buffer));
+    }
+
+    if (r == lxqt_wallet_no_error && _paged_stat(dirfd, wallet_name, &st) == 0)
+    {
+        _lxqt_wallet_update_manifest(wallet_name, application_name, &st, 0,
+                                     PAGED_VERSION | LXQT_WALLET_PAGED_VERSION_FLAG);
+    }
+
+    _lxqt_wallet_unlock_application_directory(lock);
+
+    _lxqt_wallet_release_application_directory(dirfd);
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_paged_open(lxqt_wallet_paged_t *wallet, const char *password,
+                                         u_int32_t password_length, const char *wallet_name,
+                                         const char *application_name)
+{
+    char name[ PATH_MAX ];
+    char superblocks[ 2 ][ PAGED_SUPERBLOCK_SIZE ];
+    char magic[ PAGED_MAGIC_STRING_SIZE ];
+    struct _superblock sb;
+    lxqt_wallet_paged_t w;
+    lxqt_wallet_error r = lxqt_wallet_incompatible_wallet;
+    u_int32_t version;
+    u_int32_t page_size;
+    int valid[ 2 ];
+    int found = 0;
+    int dirfd;
+    int i;
+
+    if (wallet == NULL || password == NULL || wallet_name == NULL || application_name == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    w = _paged_allocate_handle();
+
+    if (w == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    w->wallet_name      = strdup(wallet_name);
+    w->application_name = strdup(application_name);
+
+    if (w->wallet_name == NULL || w->application_name == NULL)
+    {
+        _paged_free(w);
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    dirfd = _lxqt_wallet_application_directory(application_name, 0);
+
+    _paged_name(name, wallet_name, PAGED_EXTENSION);
+
+    w->fd = dirfd == -1 ? -1 : openat(dirfd, name, O_RDWR | O_CLOEXEC);
+
+    _lxqt_wallet_release_application_directory(dirfd);
+
+    if (w->fd == -1)
+    {
+        _paged_free(w);
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    /*
+     * saves of two handles would give out the same pages
+     */
+    if (flock(w->fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        _paged_free(w);
+        return errno == EWOULDBLOCK ? lxqt_wallet_wallet_busy : lxqt_wallet_failed_to_open_file;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        valid[ i ] = 0;
+
+        if (_lxqt_wallet_read_all(w->fd, superblocks[ i ], PAGED_SUPERBLOCK_SIZE, (off_t)i * PAGED_PAGE_SIZE) != 0)
+        {
+            continue;
+        }
+
+        memcpy(&version, superblocks[ i ] + PAGED_MAGIC_STRING_SIZE, sizeof(u_int32_t));
+        memcpy(&page_size, superblocks[ i ] + PAGED_MAGIC_STRING_SIZE + sizeof(u_int32_t), sizeof(u_int32_t));
+
+        if (memcmp(superblocks[ i ], PAGED_MAGIC_STRING, PAGED_MAGIC_STRING_SIZE) == 0 &&
+            version == PAGED_VERSION && page_size == PAGED_PAGE_SIZE)
+        {
+            valid[ i ] = 1;
+
+            if (!found)
+            {
+                memcpy(w->salt, superblocks[ i ] + PAGED_MAGIC_STRING_SIZE + 2 * sizeof(u_int32_t),
+                       PAGED_SALT_SIZE);
+                found = 1;
+            }
+        }
+    }
+
+    if (found)
+    {
+        r = _paged_open_cipher(w, password, password_length);
+        found = 0;
+    }
+
+    for (i = 0; i < 2 && r == lxqt_wallet_no_error; i++)
+    {
+        if (!valid[ i ])
+        {
+            continue;
+        }
+
+        if (_paged_crypt(w, superblocks[ i ] + PAGED_SUPERBLOCK_DATA_SIZE, superblocks[ i ],
+                         PAGED_SUPERBLOCK_DATA_SIZE, magic,
+                         superblocks[ i ] + PAGED_SUPERBLOCK_SIZE - PAGED_MAGIC_STRING_SIZE,
+                         PAGED_MAGIC_STRING_SIZE, superblocks[ i ] + PAGED_SUPERBLOCK_DATA_SIZE + PAGED_NONCE_SIZE,
+                         0) != lxqt_wallet_no_error)
+        {
+            continue;
+        }
+
+        _paged_decode_superblock(superblocks[ i ], &sb);
+
+        if (!found || sb.generation > w->sb.generation)
+        {
+            w->sb = sb;
+            found = 1;
+        }
+    }
+
+    if (r == lxqt_wallet_no_error && !found)
+    {
+        r = lxqt_wallet_wrong_password;
+    }
+
+    if (r == lxqt_wallet_no_error)
+    {
+        r = _paged_read_free_list(w);
+    }
+
+    if (r != lxqt_wallet_no_error)
+    {
+        _paged_free(w);
+        return r;
+    }
+
+    *wallet = w;
+
+    return lxqt_wallet_no_error;
+}
+
+int lxqt_wallet_paged_exists(const char *wallet_name, const char *application_name)
+{
+    struct stat st;
+    int dirfd;
+    int r;
+
+    if (wallet_name == NULL || application_name == NULL)
+    {
+        return -1;
+    }
+
+    dirfd = _lxqt_wallet_application_directory(application_name, 0);
+
+    if (dirfd == -1)
+    {
+        return -1;
+    }
+
+    r = _paged_stat(dirfd, wallet_name, &st);
+
+    _lxqt_wallet_release_application_directory(dirfd);
+
+    return r;
+}
+
+u_int64_t lxqt_wallet_paged_entry_count(lxqt_wallet_paged_t wallet)
+{
+    return wallet == NULL ? 0 : wallet->sb.entry_count;
+}
+
+lxqt_wallet_error lxqt_wallet_paged_last_error(lxqt_wallet_paged_t wallet)
+{
+    return wallet == NULL ? lxqt_wallet_invalid_argument : wallet->error;
+}
+
+void lxqt_wallet_paged_set_cache_size(lxqt_wallet_paged_t wallet, u_int32_t page_count)
+{
+    if (wallet != NULL)
+    {
+        wallet->cache_size = page_count < PAGED_MAX_DEPTH ? PAGED_MAX_DEPTH : page_count;
+        _paged_cache_trim(wallet);
+    }
+}
+
+int lxqt_wallet_paged_read_key_value(lxqt_wallet_paged_t wallet, const char *key, u_int32_t key_size,
+                                     lxqt_wallet_key_values_t *key_value)
+{
+    struct _path path[ PAGED_MAX_DEPTH ];
+    struct _page *leaf;
+    int depth;
+    int found;
+    int r = 0;
+
+    if (wallet == NULL || key == NULL || key_value == NULL)
+    {
+        return 0;
+    }
+
+    wallet->error = _paged_descend(wallet, key, key_size, 0, path, &depth);
+
+    if (wallet->error != lxqt_wallet_no_error || depth == 0)
+    {
+        return 0;
+    }
+
+    leaf = path[ depth - 1 ].page;
+
+    if (path[ depth - 1 ].index < _paged_count(leaf->data))
+    {
+        _paged_search(leaf->data, key, key_size, &found);
+
+        if (found)
+        {
+            wallet->error = _paged_copy_entry(wallet, _paged_entry(leaf->data, path[ depth - 1 ].index), key_value);
+
+            r = wallet->error == lxqt_wallet_no_error;
+        }
+    }
+
+    _paged_release(path, depth);
+
+    return r;
+}
+
+int lxqt_wallet_paged_has_key(lxqt_wallet_paged_t wallet, const char *key, u_int32_t key_size)
+{
+    struct _path path[ PAGED_MAX_DEPTH ];
+    int depth;
+    int found = 0;
+
+    if (wallet == NULL || key == NULL)
+    {
+        return 0;
+    }
+
+    wallet->error = _paged_descend(wallet, key, key_size, 0, path, &depth);
+
+    if (wallet->error != lxqt_wallet_no_error || depth == 0)
+    {
+        return 0;
+    }
+
+    _paged_search(path[ depth - 1 ].page->data, key, key_size, &found);
+
+    _paged_release(path, depth);
+
+    return found;
+}
+
+lxqt_wallet_error lxqt_wallet_paged_add_key(lxqt_wallet_paged_t wallet, const char *key, u_int32_t key_size,
+                                            const char *value, u_int32_t value_size)
+{
+    struct _path path[ PAGED_MAX_DEPTH ];
+    char body[ PAGED_MAX_INLINE_SIZE ];
+    char separator[ PAGED_MAX_KEY_SIZE ];
+    char pointer[ PAGED_POINTER_SIZE ];
+    u_int32_t separator_size;
+    u_int64_t right;
+    struct _entry entry;
+    struct _page *page;
+    lxqt_wallet_error r;
+    int depth;
+    int level;
+    int found;
+    int split;
+
+    if (wallet == NULL || key == NULL || key_size == 0 || key_size > PAGED_MAX_KEY_SIZE ||
+        (value == NULL && value_size > 0) || (value_size & PAGED_OVERFLOW_FLAG))
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    r = _paged_descend(wallet, key, key_size, 1, path, &depth);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    if (depth == 0)
+    {
+        r = _paged_new_page(wallet, PAGED_LEAF, &page);
+
+        if (r != lxqt_wallet_no_error)
+        {
+            return r;
+        }
+
+        wallet->sb.root = page->number;
+
+        path[ 0 ].page  = page;
+        path[ 0 ].index = 0;
+        depth = 1;
+    }
+
+    page = path[ depth - 1 ].page;
+
+    found = 0;
+
+    if (path[ depth - 1 ].index < _paged_count(page->data))
+    {
+        _paged_search(page->data, key, key_size, &found);
+    }
+
+    _paged_set_u32(body, key_size);
+    memcpy(body + 2 * sizeof(u_int32_t), key, key_size);
+
+    entry.data = body;
+
+    if (2 * sizeof(u_int32_t) + key_size + value_size <= PAGED_MAX_INLINE_SIZE)
+    {
+        _paged_set_u32(body + sizeof(u_int32_t), value_size);
+
+        if (value_size > 0)
+        {
+            memcpy(body + 2 * sizeof(u_int32_t) + key_size, value, value_size);
+        }
+
+        entry.size = 2 * sizeof(u_int32_t) + key_size + value_size;
+    }
+    else
+    {
+        r = _paged_write_overflow(wallet, value, value_size, pointer);
+
+        if (r != lxqt_wallet_no_error)
+        {
+            _paged_release(path, depth);
+            return r;
+        }
+
+        _paged_set_u32(body + sizeof(u_int32_t), value_size | PAGED_OVERFLOW_FLAG);
+        memcpy(body + 2 * sizeof(u_int32_t) + key_size, pointer, PAGED_POINTER_SIZE);
+
+        entry.size = 2 * sizeof(u_int32_t) + key_size + PAGED_POINTER_SIZE;
+    }
+
+    if (found)
+    {
+        r = _paged_free_value(wallet, _paged_entry(page->data, path[ depth - 1 ].index));
+    }
+    else
+    {
+        wallet->sb.entry_count++;
+    }
+
+    /*
+     * put the entry in the leaf and the separator of every split page in its parent,a split root gets a new root above it
+     */
+    for (level = depth - 1; r == lxqt_wallet_no_error; level--)
+    {
+        r = _paged_insert(wallet, path[ level ].page, path[ level ].index, found, entry, separator,
+                          &separator_size, &right, &split);
+
+        if (r != lxqt_wallet_no_error || !split)
+        {
+            break;
+        }
+
+        _paged_set_u32(body, separator_size);
+        memcpy(body + sizeof(u_int32_t), separator, separator_size);
+        _paged_set_u64(body + sizeof(u_int32_t) + separator_size, right);
+        memset(body + sizeof(u_int32_t) + separator_size + sizeof(u_int64_t), '\0', PAGED_TAG_SIZE);
+
+        entry.size = sizeof(u_int32_t) + separator_size + PAGED_POINTER_SIZE;
+        found = 0;
+
+        if (level == 0)
+        {
+            r = _paged_new_page(wallet, PAGED_INTERNAL, &page);
+
+            if (r == lxqt_wallet_no_error)
+            {
+                _paged_set_u64(pointer, path[ 0 ].page->number);
+                memset(pointer + sizeof(u_int64_t), '\0', PAGED_TAG_SIZE);
+
+                _paged_build(page->data, PAGED_INTERNAL, pointer, &entry, 1);
+
+                wallet->sb.root = page->number;
+
+                _paged_put(page);
+            }
+
+            break;
+        }
+    }
+
+    memset(body, '\0', sizeof(body));
+
+    _paged_release(path, depth);
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_paged_delete_key(lxqt_wallet_paged_t wallet, const char *key, u_int32_t key_size)
+{
+    struct _path path[ PAGED_MAX_DEPTH ];
+    struct _page *page;
+    lxqt_wallet_error r;
+    int depth;
+    int level;
+
+    if (wallet == NULL || key == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    if (!lxqt_wallet_paged_has_key(wallet, key, key_size))
+    {
+        return lxqt_wallet_no_error;
+    }
+
+    r = _paged_descend(wallet, key, key_size, 1, path, &depth);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    page = path[ depth - 1 ].page;
+
+    r = _paged_free_value(wallet, _paged_entry(page->data, path[ depth - 1 ].index));
+
+    if (r != lxqt_wallet_no_error)
+    {
+        _paged_release(path, depth);
+        return r;
+    }
+
+    _paged_remove(page, path[ depth - 1 ].index);
+
+    wallet->sb.entry_count--;
+
+    /*
+     * an empty leaf is freed and taken out of its parent,which is freed too if it is left without children
+     */
+    if (_paged_count(page->data) == 0)
+    {
+        for (level = depth - 1; r == lxqt_wallet_no_error; level--)
+        {
+            r = _paged_free_page(wallet, path[ level ].page->number);
+
+            path[ level ].page = NULL;
+
+            if (level == 0)
+            {
+                wallet->sb.root = PAGED_NO_PAGE;
+                break;
+            }
+
+            if (!_paged_remove_child(path[ level - 1 ].page, path[ level - 1 ].index))
+            {
+                break;
+            }
+        }
+    }
+
+    _paged_release(path, depth);
+
+    /*
+     * a root left with one child is replaced by the child
+     */
+    while (r == lxqt_wallet_no_error && wallet->sb.root != PAGED_NO_PAGE)
+    {
+        page = _paged_cache_find(wallet, wallet->sb.root);
+
+        if (page == NULL || _paged_type(page->data) != PAGED_INTERNAL || _paged_count(page->data) > 0)
+        {
+            break;
+        }
+
+        wallet->sb.root = _paged_u64(page->data + PAGED_NODE_HEADER_SIZE);
+        memcpy(wallet->sb.root_tag, page->data + PAGED_NODE_HEADER_SIZE + sizeof(u_int64_t), PAGED_TAG_SIZE);
+
+        r = _paged_free_page(wallet, page->number);
+    }
+
+    return r;
+}
+
+/*
+ * get the leftmost leaf under the page "pointer" points to
+ */
+static lxqt_wallet_error _paged_leftmost(lxqt_wallet_paged_t w, const char *pointer, struct _page **leaf)
+{
+    char e[ PAGED_POINTER_SIZE ];
+    struct _page *page;
+    lxqt_wallet_error r;
+    int depth;
+
+    memcpy(e, pointer, PAGED_POINTER_SIZE);
+
+    for (depth = 0; depth < PAGED_MAX_DEPTH; depth++)
+    {
+        r = _paged_get(w, _paged_u64(e), e + sizeof(u_int64_t), &page);
+
+        if (r != lxqt_wallet_no_error)
+        {
+            return r;
+        }
+
+        if (_paged_type(page->data) == PAGED_LEAF)
+        {
+            *leaf = page;
+
+            return lxqt_wallet_no_error;
+        }
+
+        if (_paged_type(page->data) != PAGED_INTERNAL)
+        {
+            _paged_put(page);
+            return lxqt_wallet_incompatible_wallet;
+        }
+
+        memcpy(e, page->data + PAGED_NODE_HEADER_SIZE, PAGED_POINTER_SIZE);
+
+        _paged_put(page);
+    }
+
+    return lxqt_wallet_incompatible_wallet;
+}
+
+/*
+ * Find the first entry whose key is larger than "key" by walking down to it from the root,the walk goes up again
+ * until there is a child to the right when the leaf has no such entry.The leaf is returned pinned,"leaf" is set to
+ * NULL after the last entry.
+ */
+static lxqt_wallet_error _paged_seek(lxqt_wallet_paged_t w, const char *key, u_int32_t key_size, struct _page **leaf,
+                                     int *slot)
+{
+    struct _path path[ PAGED_MAX_DEPTH ];
+    char pointer[ PAGED_POINTER_SIZE ];
+    struct _page *page;
+    lxqt_wallet_error r;
+    int depth;
+    int level;
+    int found;
+
+    *leaf = NULL;
+
+    r = _paged_descend(w, key, key_size, 0, path, &depth);
+
+    if (r != lxqt_wallet_no_error || depth == 0)
+    {
+        return r;
+    }
+
+    page = path[ depth - 1 ].page;
+
+    *slot = _paged_search(page->data, key, key_size, &found);
+
+    if (found)
+    {
+        *slot += 1;
+    }
+
+    if (*slot < _paged_count(page->data))
+    {
+        *leaf = page;
+        _paged_release(path, depth - 1);
+        return lxqt_wallet_no_error;
+    }
+
+    /*
+     * leaves other than the root are never empty,the leftmost leaf to the right has the entry
+     */
+    for (level = depth - 2; level >= 0; level--)
+    {
+        if (path[ level ].index < _paged_count(path[ level ].page->data))
+        {
+            memcpy(pointer, _paged_child(path[ level ].page->data, path[ level ].index + 1), PAGED_POINTER_SIZE);
+
+            r = _paged_leftmost(w, pointer, leaf);
+
+            *slot = 0;
+
+            break;
+        }
+    }
+
+    _paged_release(path, depth);
+
+    if (r == lxqt_wallet_no_error && *leaf != NULL && _paged_count((*leaf)->data) == 0)
+    {
+        _paged_put(*leaf);
+        *leaf = NULL;
+        r = lxqt_wallet_incompatible_wallet;
+    }
+
+    return r;
+}
+
+int lxqt_wallet_paged_iter_read_value(lxqt_wallet_paged_t wallet, lxqt_wallet_iterator_t *iter)
+{
+    char pointer[ PAGED_POINTER_SIZE ];
+    struct _page *leaf = NULL;
+    int slot = 0;
+
+    if (wallet == NULL || iter == NULL)
+    {
+        return 0;
+    }
+
+    wallet->error = lxqt_wallet_no_error;
+
+    if (iter->iter_pos == PAGED_ITER_END || wallet->sb.root == PAGED_NO_PAGE)
+    {
+        iter->iter_pos = PAGED_ITER_END;
+        return 0;
+    }
+
+    if (iter->iter_pos == 0)
+    {
+        _paged_set_u64(pointer, wallet->sb.root);
+        memcpy(pointer + sizeof(u_int64_t), wallet->sb.root_tag, PAGED_TAG_SIZE);
+
+        wallet->error = _paged_leftmost(wallet, pointer, &leaf);
+
+        /*
+         * only a root leaf can be empty
+         */
+        if (wallet->error == lxqt_wallet_no_error && _paged_count(leaf->data) == 0)
+        {
+            _paged_put(leaf);
+            leaf = NULL;
+        }
+    }
+    else
+    {
+        /*
+         * pages the last step was on may have been evicted,changed or given new numbers since,the walk down from the
+         * root with the last key finds the next entry whatever happened to the wallet in the meantime
+         */
+        wallet->error = _paged_seek(wallet, wallet->iter_key, wallet->iter_key_size, &leaf, &slot);
+    }
+
+    if (wallet->error != lxqt_wallet_no_error || leaf == NULL)
+    {
+        iter->iter_pos = PAGED_ITER_END;
+        return 0;
+    }
+
+    wallet->error = _paged_copy_entry(wallet, _paged_entry(leaf->data, slot), &iter->entry);
+
+    _paged_put(leaf);
+
+    if (wallet->error != lxqt_wallet_no_error)
+    {
+        iter->iter_pos = PAGED_ITER_END;
+        return 0;
+    }
+
+    memcpy(wallet->iter_key, iter->entry.key, iter->entry.key_size);
+
+    wallet->iter_key_size = iter->entry.key_size;
+
+    iter->iter_pos = PAGED_ITER_STEP;
+
+    return 1;
+}
+
+/*
+ * record the size and entry count of the wallet in the manifest of its application
+ */
+static void _paged_update_manifest(lxqt_wallet_paged_t w)
+{
+    struct stat st;
+    int lock = _lxqt_wallet_lock_application_directory(w->application_name);
+
+    if (lock != -1)
+    {
+        if (fstat(w->fd, &st) == 0)
+        {
+            _lxqt_wallet_update_manifest(w->wallet_name, w->application_name, &st, w->sb.entry_count,
+                                         PAGED_VERSION | LXQT_WALLET_PAGED_VERSION_FLAG);
+        }
+
+        _lxqt_wallet_unlock_application_directory(lock);
+    }
+}
+
+lxqt_wallet_error lxqt_wallet_paged_save(lxqt_wallet_paged_t wallet)
+{
+    char buffer[ PAGED_PAGE_SIZE ];
+    struct _page_list free_pages;
+    struct _page_list list_pages;
+    struct _page *page;
+    lxqt_wallet_error r = lxqt_wallet_no_error;
+
+    if (wallet == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    if (!wallet->modified)
+    {
+        return lxqt_wallet_no_error;
+    }
+
+    if (wallet->sb.root != PAGED_NO_PAGE)
+    {
+        page = _paged_cache_find(wallet, wallet->sb.root);
+
+        if (page != NULL && page->dirty)
+        {
+            r = _paged_commit(wallet, page, wallet->sb.root_tag);
+        }
+    }
+
+    memset(&free_pages, '\0', sizeof(free_pages));
+    memset(&list_pages, '\0', sizeof(list_pages));
+
+    if (r == lxqt_wallet_no_error)
+    {
+        r = _paged_write_free_list(wallet, &free_pages, &list_pages);
+    }
+
+    /*
+     * the superblock that makes the new pages the current ones is written only once they are on disk
+     */
+    if (r == lxqt_wallet_no_error && fsync(wallet->fd) != 0)
+    {
+        r = lxqt_wallet_failed_to_open_file;
+    }
+
+    if (r == lxqt_wallet_no_error)
+    {
+        wallet->sb.generation++;
+
+        r = _paged_seal_superblock(wallet, buffer);
+    }
+
+    if (r == lxqt_wallet_no_error)
+    {
+        if (_lxqt_wallet_write_all_at(wallet->fd, buffer, PAGED_PAGE_SIZE,
+                                      (off_t)((wallet->sb.generation & 1) * PAGED_PAGE_SIZE)) != 0 ||
+            fsync(wallet->fd) != 0)
+        {
+            r = lxqt_wallet_failed_to_open_file;
+        }
+    }
+
+    if (r != lxqt_wallet_no_error)
+    {
+        free(free_pages.pages);
+        free(list_pages.pages);
+        return r;
+    }
+
+    free(wallet->available.pages);
+    free(wallet->free_list_pages.pages);
+
+    _paged_update_manifest(wallet);
+
+    wallet->available       = free_pages;
+    wallet->free_list_pages = list_pages;
+    wallet->pending.count   = 0;
+    wallet->modified        = 0;
+
+    _paged_cache_trim(wallet);
+
+    return lxqt_wallet_no_error;
+}
+
+lxqt_wallet_error lxqt_wallet_paged_close(lxqt_wallet_paged_t *wallet)
+{
+    lxqt_wallet_error r;
+
+    if (wallet == NULL || *wallet == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    r = lxqt_wallet_paged_save(*wallet);
+
+    _paged_free(*wallet);
+
+    *wallet = NULL;
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_paged_delete_wallet(const char *wallet_name, const char *application_name)
+{
+    char name[ PATH_MAX ];
+    int dirfd;
+    int lock;
+
+    if (wallet_name == NULL || application_name == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    lock = _lxqt_wallet_lock_application_directory(application_name);
+
+    dirfd = _lxqt_wallet_application_directory(application_name, 0);
+
+    _paged_name(name, wallet_name, PAGED_EXTENSION);
+
+    if (dirfd != -1 && unlinkat(dirfd, name, 0) == 0)
+    {
+        _lxqt_wallet_update_manifest(wallet_name, application_name, NULL, 0,
+                                     PAGED_VERSION | LXQT_WALLET_PAGED_VERSION_FLAG);
+    }
+
+    _lxqt_wallet_release_application_directory(dirfd);
+
+    _lxqt_wallet_unlock_application_directory(lock);
+
+    return lxqt_wallet_no_error;
+}
@@ -0,0 +1,1693 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Sharded wallets.
+ *
+ * A sharded wallet is one logical wallet whose entries are spread over a number of shard files by a keyed hash of
+ * their keys,only shards a lookup or a change touches are read and decrypted and only shards that changed are
+ * written when the wallet is saved.A single key read or write hence costs work proportional to the size of one shard
+ * and not to the size of the whole wallet.
+ *
+ * Files of a sharded wallet "YYY" of an application are kept in the wallet folder of the application:
+ *
+ * "YYY.lws" is the index file,it is made up of:
+ * [ 16 bytes magic string ][ u_int32_t version ][ u_int32_t shard count ][ 16 bytes salt ][ 12 bytes nonce ]
+ * [ 16 bytes tag ][ 16 bytes encrypted magic string ][ encrypted shard records ]
+ * Every shard has a record made up of:
+ * [ u_int64_t generation ][ u_int64_t load size ][ u_int64_t entry count ]
+ * The magic string and the records are encrypted with AES256-GCM and the first 40 bytes are their authenticated
+ * data,a wrong password fails authentication.
+ *
+ * "YYY.shards/XXXX-GGGGGGGGGGGGGGGG" where XXXX is the index of a shard and GGGGGGGGGGGGGGGG is its generation in
+ * hex,a shard file is made up of:
+ * [ 16 bytes magic string ][ u_int32_t shard index ][ u_int32_t entry count ][ u_int64_t load size ]
+ * [ u_int64_t generation ][ 12 bytes nonce ][ 16 bytes tag ][ encrypted load ]
+ * The load is encrypted with AES256-GCM and the first 40 bytes are its authenticated data.The load has the same
+ * [ u_int32_t key size ][ u_int32_t value size ][ key ][ value ] nodes as loads of ".lwt" wallets.
+ * A shard of generation 0 was never saved and has no file.A shard file that is missing or whose header does not
+ * match the record of the shard in the index fails authentication.
+ *
+ * The password is run through PBKDF2 once when the wallet is opened,the 64 bytes it produces are the encryption key
+ * of all shards followed by the HMAC-SHA256 key entries are routed to their shards with.
+ *
+ * A save holds the lock saves of ".lwt" wallets of the application take.It writes shards that changed to files of
+ * the next generation,replaces the index through rename() and then removes files of the previous generation,a save
+ * that is cut short leaves the previous index and the files it lists in place.Shards other handles saved in the
+ * meantime are kept,if this handle changed one of them too the keys it added or deleted are replayed on top of the
+ * newer generation before it is written.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "lxqtwallet.h"
+#include "lxqtwallet_internal.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+
+#include <gcrypt.h>
+
+#define SHARDED_MAGIC_STRING        "lxqt_wallet_shw"
+#define SHARDED_SHARD_MAGIC_STRING  "lxqt_wallet_shd"
+#define SHARDED_MAGIC_STRING_SIZE   16
+#define SHARDED_VERSION             2
+#define SHARDED_EXTENSION           LXQT_WALLET_SHARDED_EXTENSION
+#define SHARDED_FOLDER_EXTENSION    ".shards"
+#define SHARDED_SALT_SIZE           16
+#define SHARDED_NONCE_SIZE          12
+#define SHARDED_TAG_SIZE            16
+#define SHARDED_KEY_SIZE            32
+#define SHARDED_PBKDF2_ITERATIONS   10000
+#define SHARDED_MAX_SHARD_COUNT     65536
+#define SHARDED_INDEX_DATA_SIZE     ( SHARDED_MAGIC_STRING_SIZE + 2 * sizeof( u_int32_t ) + SHARDED_SALT_SIZE )
+#define SHARDED_INDEX_HEADER_SIZE   ( SHARDED_INDEX_DATA_SIZE + SHARDED_NONCE_SIZE + SHARDED_TAG_SIZE )
+#define SHARDED_RECORD_SIZE         ( 3 * sizeof( u_int64_t ) )
+#define SHARDED_INDEX_SIZE( count ) ( SHARDED_INDEX_HEADER_SIZE + SHARDED_MAGIC_STRING_SIZE + ( u_int64_t )( count ) * SHARDED_RECORD_SIZE )
+#define SHARDED_SHARD_DATA_SIZE     ( SHARDED_MAGIC_STRING_SIZE + 2 * sizeof( u_int32_t ) + 2 * sizeof( u_int64_t ) )
+#define SHARDED_SHARD_HEADER_SIZE   ( SHARDED_SHARD_DATA_SIZE + SHARDED_NONCE_SIZE + SHARDED_TAG_SIZE )
+#define SHARDED_SHARD_NAME_SIZE     32
+#define SHARDED_NODE_HEADER_SIZE    ( 2 * sizeof( u_int32_t ) )
+#define SHARDED_ITER_SHARD_SHIFT    48
+
+struct _shard
+{
+    /*
+     * locked buffer of nodes,"capacity" is the size of the buffer and "size" is the size of nodes in it.
+     * "size" and "entry_count" of a shard that is not loaded come from its record in the index.
+     */
+    char *data;
+    u_int64_t size;
+    u_int64_t capacity;
+    u_int64_t generation;
+    u_int32_t entry_count;
+    int loaded;
+    int dirty;
+    /*
+     * locked buffer of [ u_int32_t key size ][ key ] items of keys added or deleted since the shard was last saved,
+     * a save replays them on top of a newer generation of the shard another handle saved
+     */
+    char *changes;
+    u_int64_t changes_size;
+    u_int64_t changes_capacity;
+};
+
+struct lxqt_wallet_sharded_struct
+{
+    char *wallet_name;
+    char *application_name;
+    /*
+     * descriptor of the folder shard files are kept in
+     */
+    int folder;
+    /*
+     * authenticated data of the index,it holds the shard count and the salt
+     */
+    char header[ SHARDED_INDEX_DATA_SIZE ];
+    u_int32_t shard_count;
+    struct _shard *shards;
+    gcry_cipher_hd_t cipher;
+    gcry_md_hd_t router;
+    /*
+     * why the last lookup or iteration step returned 0,see lxqt_wallet_sharded_last_error()
+     */
+    lxqt_wallet_error error;
+};
+
+static void _sharded_name(char name[ PATH_MAX ], const char *wallet_name, const char *extension)
+{
+    snprintf(name, PATH_MAX, "%s%s", wallet_name, extension);
+}
+
+static void _sharded_shard_name(char name[ SHARDED_SHARD_NAME_SIZE ], u_int32_t shard, u_int64_t generation)
+{
+    snprintf(name, SHARDED_SHARD_NAME_SIZE, "%04x-%016llx", shard, (unsigned long long)generation);
+}
+
+/*
+ * write "buffer" to "name" in the folder "dirfd" through a temporary file that replaces it once it is on disk
+ */
+static lxqt_wallet_error _sharded_write_file(int dirfd, const char *name, const char *header, u_int64_t header_size,
+                                             const char *buffer, u_int64_t size)
+{
+    char temp[ PATH_MAX ];
+    int fd;
+
+    snprintf(temp, PATH_MAX, "%s.tmp", name);
+
+    fd = openat(dirfd, temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+
+    if (fd == -1)
+    {
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    if (_lxqt_wallet_write_all(fd, header, header_size) || _lxqt_wallet_write_all(fd, buffer, size) || fsync(fd) != 0)
+    {
+        close(fd);
+        unlinkat(dirfd, temp, 0);
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    if (close(fd) != 0 || renameat(dirfd, temp, dirfd, name) != 0)
+    {
+        unlinkat(dirfd, temp, 0);
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+static void _sharded_initialize_gcrypt(void)
+{
+    if (gcry_control(GCRYCTL_INITIALIZATION_FINISHED_P) == 0)
+    {
+        gcry_check_version(NULL);
+        gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+    }
+}
+
+/*
+ * derive the encryption key and the routing key of a wallet,"output" has room for both
+ */
+static lxqt_wallet_error _sharded_derive_keys(const char *password, u_int32_t password_length,
+                                              const char salt[ SHARDED_SALT_SIZE ],
+                                              char output[ 2 * SHARDED_KEY_SIZE ])
+{
+    gcry_error_t r;
+
+    _sharded_initialize_gcrypt();
+
+    r = gcry_kdf_derive(password, password_length, GCRY_KDF_PBKDF2, GCRY_MD_SHA256, salt,
+                                     SHARDED_SALT_SIZE, SHARDED_PBKDF2_ITERATIONS, 2 * SHARDED_KEY_SIZE, output);
+
+    if (r != GPG_ERR_NO_ERROR)
+    {
+        return lxqt_wallet_failed_to_create_key_hash;
+    }
+    else
+    {
+        return lxqt_wallet_no_error;
+    }
+}
+
+static lxqt_wallet_error _sharded_open_handles(lxqt_wallet_sharded_t w, const char keys[ 2 * SHARDED_KEY_SIZE ])
+{
+    if (gcry_cipher_open(&w->cipher, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_GCM, GCRY_CIPHER_SECURE) != 0)
+    {
+        w->cipher = NULL;
+        return lxqt_wallet_gcry_cipher_open_failed;
+    }
+
+    if (gcry_cipher_setkey(w->cipher, keys, SHARDED_KEY_SIZE) != 0)
+    {
+        return lxqt_wallet_gcry_cipher_setkey_failed;
+    }
+
+    if (gcry_md_open(&w->router, GCRY_MD_SHA256, GCRY_MD_FLAG_HMAC | GCRY_MD_FLAG_SECURE) != 0)
+    {
+        w->router = NULL;
+        return lxqt_wallet_failed_to_create_key_hash;
+    }
+
+    if (gcry_md_setkey(w->router, keys + SHARDED_KEY_SIZE, SHARDED_KEY_SIZE) != 0)
+    {
+        return lxqt_wallet_failed_to_create_key_hash;
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * encrypt or decrypt "buffer" in place,"data" is authenticated along with it and "tag" is checked when decrypting
+ */
+static lxqt_wallet_error _sharded_crypt(gcry_cipher_hd_t cipher, const char *nonce, const char *data,
+                                        size_t data_size, char *buffer, u_int64_t size, char *tag, int encrypt)
+{
+    gcry_error_t r;
+
+    gcry_cipher_reset(cipher);
+
+    if (gcry_cipher_setiv(cipher, nonce, SHARDED_NONCE_SIZE) != 0)
+    {
+        return lxqt_wallet_gcry_cipher_setiv_failed;
+    }
+
+    if (gcry_cipher_authenticate(cipher, data, data_size) != 0)
+    {
+        return lxqt_wallet_gcry_cipher_encrypt_failed;
+    }
+
+    if (encrypt)
+    {
+        if (gcry_cipher_final(cipher) != 0 || gcry_cipher_encrypt(cipher, buffer, size, NULL, 0) != 0)
+        {
+            return lxqt_wallet_gcry_cipher_encrypt_failed;
+        }
+
+        r = gcry_cipher_gettag(cipher, tag, SHARDED_TAG_SIZE);
+
+        return r == 0 ? lxqt_wallet_no_error : lxqt_wallet_gcry_cipher_encrypt_failed;
+    }
+    else
+    {
+        if (gcry_cipher_final(cipher) != 0 || gcry_cipher_decrypt(cipher, buffer, size, NULL, 0) != 0)
+        {
+            return lxqt_wallet_gcry_cipher_decrypt_failed;
+        }
+
+        r = gcry_cipher_checktag(cipher, tag, SHARDED_TAG_SIZE);
+
+        return r == 0 ? lxqt_wallet_no_error : lxqt_wallet_authentication_failed;
+    }
+}
+
+static u_int32_t _sharded_route(lxqt_wallet_sharded_t w, const char *key, u_int32_t key_size)
+{
+    const unsigned char *e;
+    u_int32_t r;
+
+    gcry_md_reset(w->router);
+    gcry_md_write(w->router, key, key_size);
+
+    e = gcry_md_read(w->router, GCRY_MD_SHA256);
+
+    r = (u_int32_t)e[ 0 ] << 24 | (u_int32_t)e[ 1 ] << 16 | (u_int32_t)e[ 2 ] << 8 | (u_int32_t)e[ 3 ];
+
+    return r % w->shard_count;
+}
+
+static void _sharded_free(lxqt_wallet_sharded_t w)
+{
+    u_int32_t i;
+
+    if (w->shards != NULL)
+    {
+        for (i = 0; i < w->shard_count; i++)
+        {
+            _lxqt_wallet_free_locked_buffer(w->shards[ i ].data, w->shards[ i ].capacity);
+            _lxqt_wallet_free_locked_buffer(w->shards[ i ].changes, w->shards[ i ].changes_capacity);
+        }
+    }
+
+    if (w->cipher != NULL)
+    {
+        gcry_cipher_close(w->cipher);
+    }
+
+    if (w->router != NULL)
+    {
+        gcry_md_close(w->router);
+    }
+
+    if (w->folder != -1)
+    {
+        close(w->folder);
+    }
+
+    free(w->shards);
+    free(w->wallet_name);
+    free(w->application_name);
+    free(w);
+}
+
+static u_int64_t _sharded_record_generation(const char *records, u_int32_t index)
+{
+    u_int64_t generation;
+
+    memcpy(&generation, records + index * SHARDED_RECORD_SIZE, sizeof(u_int64_t));
+
+    return generation;
+}
+
+/*
+ * take the generation,load size and entry count of a shard that is not loaded from its record
+ */
+static void _sharded_set_from_record(struct _shard *s, const char *record)
+{
+    u_int64_t entry_count;
+
+    memcpy(&s->generation, record, sizeof(u_int64_t));
+    memcpy(&s->size, record + sizeof(u_int64_t), sizeof(u_int64_t));
+    memcpy(&entry_count, record + 2 * sizeof(u_int64_t), sizeof(u_int64_t));
+
+    s->entry_count = (u_int32_t)entry_count;
+}
+
+static void _sharded_make_record(char *record, const struct _shard *s)
+{
+    u_int64_t entry_count = s->entry_count;
+
+    memcpy(record, &s->generation, sizeof(u_int64_t));
+    memcpy(record + sizeof(u_int64_t), &s->size, sizeof(u_int64_t));
+    memcpy(record + 2 * sizeof(u_int64_t), &entry_count, sizeof(u_int64_t));
+}
+
+/*
+ * read the index file of a wallet,the caller has to free "index"
+ */
+static lxqt_wallet_error _sharded_read_index(int dirfd, const char *wallet_name, char **index,
+                                             u_int32_t *shard_count)
+{
+    char name[ PATH_MAX ];
+    struct stat st;
+    u_int32_t version;
+    u_int32_t count;
+    char *e;
+    int fd;
+
+    _sharded_name(name, wallet_name, SHARDED_EXTENSION);
+
+    fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1)
+    {
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    if (fstat(fd, &st) != 0 || (u_int64_t)st.st_size < SHARDED_INDEX_SIZE(1) ||
+        (u_int64_t)st.st_size > SHARDED_INDEX_SIZE(SHARDED_MAX_SHARD_COUNT))
+    {
+        close(fd);
+        return lxqt_wallet_incompatible_wallet;
+    }
+
+    e = malloc(st.st_size);
+
+    if (e == NULL)
+    {
+        close(fd);
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    if (_lxqt_wallet_read_all(fd, e, st.st_size, 0) != 0)
+    {
+        close(fd);
+        free(e);
+        return lxqt_wallet_incompatible_wallet;
+    }
+
+    close(fd);
+
+    memcpy(&version, e + SHARDED_MAGIC_STRING_SIZE, sizeof(u_int32_t));
+    memcpy(&count, e + SHARDED_MAGIC_STRING_SIZE + sizeof(u_int32_t), sizeof(u_int32_t));
+
+    if (memcmp(e, SHARDED_MAGIC_STRING, SHARDED_MAGIC_STRING_SIZE) != 0 || version != SHARDED_VERSION ||
+        count == 0 || count > SHARDED_MAX_SHARD_COUNT || (u_int64_t)st.st_size != SHARDED_INDEX_SIZE(count))
+    {
+        free(e);
+        return lxqt_wallet_incompatible_wallet;
+    }
+
+    *index = e;
+    *shard_count = count;
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * decrypt an index read by _sharded_read_index() in place,records of shards follow the magic string in it
+ */
+static lxqt_wallet_error _sharded_decrypt_index(lxqt_wallet_sharded_t w, char *index)
+{
+    lxqt_wallet_error r;
+
+    r = _sharded_crypt(w->cipher, index + SHARDED_INDEX_DATA_SIZE, index, SHARDED_INDEX_DATA_SIZE,
+                       index + SHARDED_INDEX_HEADER_SIZE, SHARDED_INDEX_SIZE(w->shard_count) - SHARDED_INDEX_HEADER_SIZE,
+                       index + SHARDED_INDEX_DATA_SIZE + SHARDED_NONCE_SIZE, 0);
+
+    if (r == lxqt_wallet_no_error &&
+        memcmp(index + SHARDED_INDEX_HEADER_SIZE, SHARDED_MAGIC_STRING, SHARDED_MAGIC_STRING_SIZE) != 0)
+    {
+        r = lxqt_wallet_authentication_failed;
+    }
+
+    return r;
+}
+
+/*
+ * write an index that lists the current generation of every shard
+ */
+static lxqt_wallet_error _sharded_write_index(lxqt_wallet_sharded_t w, int dirfd, const char *wallet_name)
+{
+    char name[ PATH_MAX ];
+    u_int64_t size = SHARDED_INDEX_SIZE(w->shard_count);
+    lxqt_wallet_error r;
+    u_int32_t i;
+    char *index;
+    char *e;
+
+    index = malloc(size);
+
+    if (index == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    memcpy(index, w->header, SHARDED_INDEX_DATA_SIZE);
+
+    gcry_create_nonce(index + SHARDED_INDEX_DATA_SIZE, SHARDED_NONCE_SIZE);
+
+    e = index + SHARDED_INDEX_HEADER_SIZE;
+
+    memcpy(e, SHARDED_MAGIC_STRING, SHARDED_MAGIC_STRING_SIZE);
+
+    e += SHARDED_MAGIC_STRING_SIZE;
+
+    for (i = 0; i < w->shard_count; i++)
+    {
+        _sharded_make_record(e + i * SHARDED_RECORD_SIZE, w->shards + i);
+    }
+
+    r = _sharded_crypt(w->cipher, index + SHARDED_INDEX_DATA_SIZE, index, SHARDED_INDEX_DATA_SIZE,
+                       index + SHARDED_INDEX_HEADER_SIZE, size - SHARDED_INDEX_HEADER_SIZE,
+                       index + SHARDED_INDEX_DATA_SIZE + SHARDED_NONCE_SIZE, 1);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        _sharded_name(name, wallet_name, SHARDED_EXTENSION);
+
+        r = _sharded_write_file(dirfd, name, index, size, NULL, 0);
+    }
+
+    free(index);
+
+    return r;
+}
+
+/*
+ * Read the index of the wallet again and take records of shards that are not loaded from it.
+ * A loaded shard that did not change is dropped too if "drop" is set and another handle saved a newer generation of
+ * it.The decrypted index is handed over through "index" if it is not NULL.
+ */
+static lxqt_wallet_error _sharded_refresh(lxqt_wallet_sharded_t w, int dirfd, int drop, char **index)
+{
+    struct _shard *s;
+    lxqt_wallet_error r;
+    const char *records;
+    u_int32_t count;
+    u_int32_t i;
+    char *e;
+
+    r = _sharded_read_index(dirfd, w->wallet_name, &e, &count);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    /*
+     * the salt and the shard count do not change unless the wallet was replaced by another one
+     */
+    if (memcmp(e, w->header, SHARDED_INDEX_DATA_SIZE) != 0)
+    {
+        free(e);
+        return lxqt_wallet_incompatible_wallet;
+    }
+
+    r = _sharded_decrypt_index(w, e);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        free(e);
+        return r;
+    }
+
+    records = e + SHARDED_INDEX_HEADER_SIZE + SHARDED_MAGIC_STRING_SIZE;
+
+    for (i = 0; i < w->shard_count; i++)
+    {
+        s = w->shards + i;
+
+        if (s->dirty || (s->loaded && !drop) || _sharded_record_generation(records, i) == s->generation)
+        {
+            continue;
+        }
+
+        if (s->loaded)
+        {
+            _lxqt_wallet_free_locked_buffer(s->data, s->capacity);
+
+            s->data     = NULL;
+            s->capacity = 0;
+            s->loaded   = 0;
+        }
+
+        _sharded_set_from_record(s, records + i * SHARDED_RECORD_SIZE);
+    }
+
+    if (index != NULL)
+    {
+        *index = e;
+    }
+    else
+    {
+        free(e);
+    }
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * read and decrypt the file "fd" of the generation of shard "index" that "s" was set to from its record,"fd" is
+ * closed
+ */
+static lxqt_wallet_error _sharded_read(lxqt_wallet_sharded_t w, u_int32_t index, struct _shard *s, int fd)
+{
+    char header[ SHARDED_SHARD_HEADER_SIZE ];
+    lxqt_wallet_error r;
+    u_int64_t generation;
+    u_int64_t size;
+    u_int32_t shard;
+    u_int32_t entry_count;
+
+    if (_lxqt_wallet_read_all(fd, header, SHARDED_SHARD_HEADER_SIZE, 0) != 0)
+    {
+        close(fd);
+        return lxqt_wallet_authentication_failed;
+    }
+
+    memcpy(&shard, header + SHARDED_MAGIC_STRING_SIZE, sizeof(u_int32_t));
+    memcpy(&entry_count, header + SHARDED_MAGIC_STRING_SIZE + sizeof(u_int32_t), sizeof(u_int32_t));
+    memcpy(&size, header + SHARDED_MAGIC_STRING_SIZE + 2 * sizeof(u_int32_t), sizeof(u_int64_t));
+    memcpy(&generation, header + SHARDED_MAGIC_STRING_SIZE + 2 * sizeof(u_int32_t) + sizeof(u_int64_t),
+           sizeof(u_int64_t));
+
+    /*
+     * the header is authenticated along with the load,checking it against the record of the shard in the index
+     * ties the file to the index
+     */
+    if (memcmp(header, SHARDED_SHARD_MAGIC_STRING, SHARDED_MAGIC_STRING_SIZE) != 0 || shard != index ||
+        generation != s->generation || size != s->size || entry_count != s->entry_count || size > (u_int64_t)SSIZE_MAX)
+    {
+        close(fd);
+        return lxqt_wallet_authentication_failed;
+    }
+
+    s->data = _lxqt_wallet_locked_buffer(size > 0 ? size : 1);
+
+    if (s->data == NULL)
+    {
+        close(fd);
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    s->capacity = size > 0 ? size : 1;
+
+    if (_lxqt_wallet_read_all(fd, s->data, size, SHARDED_SHARD_HEADER_SIZE) != 0)
+    {
+        r = lxqt_wallet_authentication_failed;
+    }
+    else
+    {
+        r = _sharded_crypt(w->cipher, header + SHARDED_SHARD_DATA_SIZE, header, SHARDED_SHARD_DATA_SIZE, s->data,
+                           size, header + SHARDED_SHARD_DATA_SIZE + SHARDED_NONCE_SIZE, 0);
+    }
+
+    close(fd);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        _lxqt_wallet_free_locked_buffer(s->data, s->capacity);
+        s->data = NULL;
+        s->capacity = 0;
+    }
+
+    return r;
+}
+
+/*
+ * read and decrypt a shard the first time it is touched
+ */
+static lxqt_wallet_error _sharded_load(lxqt_wallet_sharded_t w, u_int32_t index)
+{
+    struct _shard *s = w->shards + index;
+    char name[ SHARDED_SHARD_NAME_SIZE ];
+    lxqt_wallet_error r;
+    u_int64_t generation;
+    int dirfd;
+    int fd;
+
+    if (s->loaded)
+    {
+        return lxqt_wallet_no_error;
+    }
+
+    if (s->generation == 0)
+    {
+        s->loaded = 1;
+        return lxqt_wallet_no_error;
+    }
+
+    _sharded_shard_name(name, index, s->generation);
+
+    fd = openat(w->folder, name, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1 && errno == ENOENT)
+    {
+        /*
+         * another handle may have saved a newer generation of the shard and removed this one
+         */
+        generation = s->generation;
+
+        dirfd = _lxqt_wallet_application_directory(w->application_name, 0);
+
+        r = _sharded_refresh(w, dirfd, 0, NULL);
+
+        _lxqt_wallet_release_application_directory(dirfd);
+
+        if (r != lxqt_wallet_no_error)
+        {
+            return r;
+        }
+        else if (s->generation == generation)
+        {
+            return lxqt_wallet_authentication_failed;
+        }
+        else
+        {
+            return _sharded_load(w, index);
+        }
+    }
+    else if (fd == -1)
+    {
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    r = _sharded_read(w, index, s, fd);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        s->loaded = 1;
+    }
+
+    return r;
+}
+
+/*
+ * find the node of "key" in a loaded shard,returns its offset or -1
+ */
+static int64_t _sharded_find(const struct _shard *s, const char *key, u_int32_t key_size)
+{
+    const char *e;
+    u_int64_t i = 0;
+    u_int32_t key_len;
+    u_int32_t key_value_len;
+
+    while (i < s->size)
+    {
+        e = s->data + i;
+
+        memcpy(&key_len, e, sizeof(u_int32_t));
+        memcpy(&key_value_len, e + sizeof(u_int32_t), sizeof(u_int32_t));
+
+        if (key_len == key_size && memcmp(key, e + SHARDED_NODE_HEADER_SIZE, key_size) == 0)
+        {
+            return i;
+        }
+
+        i += SHARDED_NODE_HEADER_SIZE + (u_int64_t)key_len + key_value_len;
+    }
+
+    return -1;
+}
+
+static void _sharded_node(const struct _shard *s, u_int64_t offset, lxqt_wallet_key_values_t *key_value)
+{
+    const char *e = s->data + offset;
+    u_int32_t key_len;
+    u_int32_t key_value_len;
+
+    memcpy(&key_len, e, sizeof(u_int32_t));
+    memcpy(&key_value_len, e + sizeof(u_int32_t), sizeof(u_int32_t));
+
+    key_value->key            = e + SHARDED_NODE_HEADER_SIZE;
+    key_value->key_size       = key_len;
+    key_value->key_value      = e + SHARDED_NODE_HEADER_SIZE + key_len;
+    key_value->key_value_size = key_value_len;
+}
+
+static void _sharded_remove(struct _shard *s, u_int64_t offset)
+{
+    lxqt_wallet_key_values_t e;
+    u_int64_t block_size;
+
+    _sharded_node(s, offset, &e);
+
+    block_size = SHARDED_NODE_HEADER_SIZE + (u_int64_t)e.key_size + e.key_value_size;
+
+    memmove(s->data + offset, s->data + offset + block_size, s->size - offset - block_size);
+    memset(s->data + s->size - block_size, '\0', block_size);
+
+    s->size -= block_size;
+    s->entry_count--;
+    s->dirty = 1;
+}
+
+/*
+ * make room for "size" more bytes after the first "used" bytes of a locked buffer,the old buffer is wiped before it
+ * is freed and is hence not grown with realloc()
+ */
+static lxqt_wallet_error _sharded_reserve(char **buffer, u_int64_t *capacity, u_int64_t used, u_int64_t size)
+{
+    u_int64_t e = *capacity * 2;
+    char *data;
+
+    if (used + size <= *capacity)
+    {
+        return lxqt_wallet_no_error;
+    }
+
+    if (e < used + size)
+    {
+        e = used + size;
+    }
+
+    data = _lxqt_wallet_locked_buffer(e);
+
+    if (data == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    if (*buffer != NULL)
+    {
+        memcpy(data, *buffer, used);
+    }
+
+    _lxqt_wallet_free_locked_buffer(*buffer, *capacity);
+
+    *buffer   = data;
+    *capacity = e;
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * add a node to the end of a loaded shard that does not have "key"
+ */
+static lxqt_wallet_error _sharded_append(struct _shard *s, const char *key, u_int32_t key_size, const char *value,
+                                         u_int32_t value_size)
+{
+    u_int64_t block_size = SHARDED_NODE_HEADER_SIZE + (u_int64_t)key_size + value_size;
+    lxqt_wallet_error r;
+    char *e;
+
+    r = _sharded_reserve(&s->data, &s->capacity, s->size, block_size);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    e = s->data + s->size;
+
+    memcpy(e, &key_size, sizeof(u_int32_t));
+    memcpy(e + sizeof(u_int32_t), &value_size, sizeof(u_int32_t));
+    memcpy(e + SHARDED_NODE_HEADER_SIZE, key, key_size);
+
+    if (value_size > 0)
+    {
+        memcpy(e + SHARDED_NODE_HEADER_SIZE + key_size, value, value_size);
+    }
+
+    s->size += block_size;
+    s->entry_count++;
+    s->dirty = 1;
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * remember that "key" was added or deleted so that a save can replay the change on top of a newer generation
+ */
+static lxqt_wallet_error _sharded_note_change(struct _shard *s, const char *key, u_int32_t key_size)
+{
+    lxqt_wallet_error r;
+
+    r = _sharded_reserve(&s->changes, &s->changes_capacity, s->changes_size, sizeof(u_int32_t) + (u_int64_t)key_size);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    memcpy(s->changes + s->changes_size, &key_size, sizeof(u_int32_t));
+    memcpy(s->changes + s->changes_size + sizeof(u_int32_t), key, key_size);
+
+    s->changes_size += sizeof(u_int32_t) + key_size;
+
+    return lxqt_wallet_no_error;
+}
+
+/*
+ * Another handle saved shard "index" since this handle loaded it.The generation listed in "record" is read and keys
+ * this handle added or deleted are replayed on top of it,the result replaces the shard.
+ */
+static lxqt_wallet_error _sharded_merge(lxqt_wallet_sharded_t w, u_int32_t index, const char *record)
+{
+    struct _shard *s = w->shards + index;
+    struct _shard e;
+    char name[ SHARDED_SHARD_NAME_SIZE ];
+    lxqt_wallet_key_values_t node;
+    lxqt_wallet_error r = lxqt_wallet_no_error;
+    u_int64_t i = 0;
+    u_int32_t key_size;
+    const char *key;
+    int64_t offset;
+    int fd;
+
+    memset(&e, '\0', sizeof(e));
+
+    _sharded_set_from_record(&e, record);
+
+    if (e.generation != 0)
+    {
+        _sharded_shard_name(name, index, e.generation);
+
+        fd = openat(w->folder, name, O_RDONLY | O_CLOEXEC);
+
+        if (fd == -1)
+        {
+            return errno == ENOENT ? lxqt_wallet_authentication_failed : lxqt_wallet_failed_to_open_file;
+        }
+
+        r = _sharded_read(w, index, &e, fd);
+
+        if (r != lxqt_wallet_no_error)
+        {
+            return r;
+        }
+    }
+
+    while (i < s->changes_size)
+    {
+        memcpy(&key_size, s->changes + i, sizeof(u_int32_t));
+        key = s->changes + i + sizeof(u_int32_t);
+
+        offset = _sharded_find(&e, key, key_size);
+
+        if (offset != -1)
+        {
+            _sharded_remove(&e, offset);
+        }
+
+        offset = _sharded_find(s, key, key_size);
+
+        if (offset != -1)
+        {
+            _sharded_node(s, offset, &node);
+
+            r = _sharded_append(&e, node.key, node.key_size, node.key_value, node.key_value_size);
+
+            if (r != lxqt_wallet_no_error)
+            {
+                _lxqt_wallet_free_locked_buffer(e.data, e.capacity);
+                return r;
+            }
+        }
+
+        i += sizeof(u_int32_t) + key_size;
+    }
+
+    _lxqt_wallet_free_locked_buffer(s->data, s->capacity);
+
+    s->data        = e.data;
+    s->capacity    = e.capacity;
+    s->size        = e.size;
+    s->entry_count = e.entry_count;
+    s->generation  = e.generation;
+
+    return lxqt_wallet_no_error;
+}
+
+lxqt_wallet_error lxqt_wallet_sharded_create(const char *password, u_int32_t password_length, u_int32_t shard_count,
+                                             const char *wallet_name, const char *application_name)
+{
+    char name[ PATH_MAX ];
+    char keys[ 2 * SHARDED_KEY_SIZE ];
+    u_int32_t version = SHARDED_VERSION;
+    struct lxqt_wallet_sharded_struct w;
+    struct stat st;
+    lxqt_wallet_error r;
+    char *e;
+    int dirfd;
+    int lock;
+
+    if (password == NULL || wallet_name == NULL || application_name == NULL || shard_count == 0 ||
+        shard_count > SHARDED_MAX_SHARD_COUNT)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    _sharded_initialize_gcrypt();
+
+    memset(&w, '\0', sizeof(w));
+
+    /*
+     * every shard starts at generation 0 and has no file
+     */
+    w.shard_count = shard_count;
+    w.shards      = calloc(shard_count, sizeof(struct _shard));
+
+    if (w.shards == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    e = w.header;
+
+    memcpy(e, SHARDED_MAGIC_STRING, SHARDED_MAGIC_STRING_SIZE);
+    e += SHARDED_MAGIC_STRING_SIZE;
+    memcpy(e, &version, sizeof(u_int32_t));
+    e += sizeof(u_int32_t);
+    memcpy(e, &shard_count, sizeof(u_int32_t));
+    e += sizeof(u_int32_t);
+
+    gcry_create_nonce(e, SHARDED_SALT_SIZE);
+
+    r = _sharded_derive_keys(password, password_length, e, keys);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        r = _sharded_open_handles(&w, keys);
+    }
+
+    memset(keys, '\0', sizeof(keys));
+
+    if (r == lxqt_wallet_no_error)
+    {
+        dirfd = _lxqt_wallet_application_directory(application_name, 1);
+
+        lock = _lxqt_wallet_lock_application_directory(application_name);
+
+        _sharded_name(name, wallet_name, SHARDED_FOLDER_EXTENSION);
+
+        if (dirfd == -1 || lock == -1)
+        {
+            r = lxqt_wallet_failed_to_open_file;
+        }
+        else if (lxqt_wallet_sharded_exists(wallet_name, application_name) == 0 ||
+                 lxqt_wallet_exists(wallet_name, application_name) == 0 ||
+                 lxqt_wallet_paged_exists(wallet_name, application_name) == 0)
+        {
+            r = lxqt_wallet_wallet_exists;
+        }
+        else if (mkdirat(dirfd, name, 0700) != 0 && errno != EEXIST)
+        {
+            r = lxqt_wallet_failed_to_open_file;
+        }
+        else
+        {
+            r = _sharded_write_index(&w, dirfd, wallet_name);
+        }
+
+        _sharded_name(name, wallet_name, SHARDED_EXTENSION);
+
+        if (r == lxqt_wallet_no_error && fstatat(dirfd, name, &st, 0) == 0)
+        {
+            _lxqt_wallet_update_manifest(wallet_name, application_name, &st, 0,
+                                         SHARDED_VERSION | LXQT_WALLET_SHARDED_VERSION_FLAG);
+        }
+
+        _lxqt_wallet_unlock_application_directory(lock);
+
+        _lxqt_wallet_release_application_directory(dirfd);
+    }
+
+    if (w.cipher != NULL)
+    {
+        gcry_cipher_close(w.cipher);
+    }
+
+    if (w.router != NULL)
+    {
+        gcry_md_close(w.router);
+    }
+
+    free(w.shards);
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_sharded_open(lxqt_wallet_sharded_t *wallet, const char *password,
+                                           u_int32_t password_length, const char *wallet_name,
+                                           const char *application_name)
+{
+    char name[ PATH_MAX ];
+    char keys[ 2 * SHARDED_KEY_SIZE ];
+    const char *records;
+    char *index;
+    u_int32_t count;
+    u_int32_t i;
+    lxqt_wallet_sharded_t w;
+    lxqt_wallet_error r;
+    int dirfd;
+
+    if (wallet == NULL || password == NULL || wallet_name == NULL || application_name == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    dirfd = _lxqt_wallet_application_directory(application_name, 0);
+
+    if (dirfd == -1)
+    {
+        return lxqt_wallet_failed_to_open_file;
+    }
+
+    r = _sharded_read_index(dirfd, wallet_name, &index, &count);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        _lxqt_wallet_release_application_directory(dirfd);
+        return r;
+    }
+
+    w = calloc(1, sizeof(struct lxqt_wallet_sharded_struct));
+
+    if (w == NULL)
+    {
+        _lxqt_wallet_release_application_directory(dirfd);
+        free(index);
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    _sharded_name(name, wallet_name, SHARDED_FOLDER_EXTENSION);
+
+    w->folder           = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    w->shard_count      = count;
+    w->shards           = calloc(count, sizeof(struct _shard));
+    w->wallet_name      = strdup(wallet_name);
+    w->application_name = strdup(application_name);
+
+    _lxqt_wallet_release_application_directory(dirfd);
+
+    memcpy(w->header, index, SHARDED_INDEX_DATA_SIZE);
+
+    if (w->shards == NULL || w->wallet_name == NULL || w->application_name == NULL)
+    {
+        r = lxqt_wallet_failed_to_allocate_memory;
+    }
+    else if (w->folder == -1)
+    {
+        r = lxqt_wallet_failed_to_open_file;
+    }
+    else
+    {
+        r = _sharded_derive_keys(password, password_length, index + SHARDED_MAGIC_STRING_SIZE + 2 * sizeof(u_int32_t),
+                                 keys);
+
+        if (r == lxqt_wallet_no_error)
+        {
+            r = _sharded_open_handles(w, keys);
+        }
+
+        memset(keys, '\0', sizeof(keys));
+    }
+
+    if (r == lxqt_wallet_no_error)
+    {
+        r = _sharded_decrypt_index(w, index);
+
+        if (r == lxqt_wallet_authentication_failed)
+        {
+            r = lxqt_wallet_wrong_password;
+        }
+    }
+
+    if (r == lxqt_wallet_no_error)
+    {
+        records = index + SHARDED_INDEX_HEADER_SIZE + SHARDED_MAGIC_STRING_SIZE;
+
+        for (i = 0; i < count; i++)
+        {
+            _sharded_set_from_record(w->shards + i, records + i * SHARDED_RECORD_SIZE);
+        }
+    }
+
+    free(index);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        _sharded_free(w);
+        return r;
+    }
+
+    *wallet = w;
+
+    return lxqt_wallet_no_error;
+}
+
+int lxqt_wallet_sharded_exists(const char *wallet_name, const char *application_name)
+{
+    char name[ PATH_MAX ];
+    struct stat st;
+    int dirfd;
+    int r;
+
+    if (wallet_name == NULL || application_name == NULL)
+    {
+        return -1;
+    }
+
+    dirfd = _lxqt_wallet_application_directory(application_name, 0);
+
+    if (dirfd == -1)
+    {
+        return -1;
+    }
+
+    _sharded_name(name, wallet_name, SHARDED_EXTENSION);
+
+    r = fstatat(dirfd, name, &st, 0);
+
+    _lxqt_wallet_release_application_directory(dirfd);
+
+    return r;
+}
+
+u_int32_t lxqt_wallet_sharded_shard_count(lxqt_wallet_sharded_t wallet)
+{
+    return wallet == NULL ? 0 : wallet->shard_count;
+}
+
+lxqt_wallet_error lxqt_wallet_sharded_last_error(lxqt_wallet_sharded_t wallet)
+{
+    return wallet == NULL ? lxqt_wallet_invalid_argument : wallet->error;
+}
+
+int lxqt_wallet_sharded_read_key_value(lxqt_wallet_sharded_t wallet, const char *key, u_int32_t key_size,
+                                       lxqt_wallet_key_values_t *key_value)
+{
+    u_int32_t index;
+    int64_t offset;
+
+    if (wallet == NULL || key == NULL || key_value == NULL)
+    {
+        return 0;
+    }
+
+    index = _sharded_route(wallet, key, key_size);
+
+    wallet->error = _sharded_load(wallet, index);
+
+    if (wallet->error != lxqt_wallet_no_error)
+    {
+        return 0;
+    }
+
+    offset = _sharded_find(wallet->shards + index, key, key_size);
+
+    if (offset == -1)
+    {
+        return 0;
+    }
+
+    _sharded_node(wallet->shards + index, offset, key_value);
+
+    return 1;
+}
+
+int lxqt_wallet_sharded_has_key(lxqt_wallet_sharded_t wallet, const char *key, u_int32_t key_size)
+{
+    lxqt_wallet_key_values_t e;
+
+    return lxqt_wallet_sharded_read_key_value(wallet, key, key_size, &e);
+}
+
+lxqt_wallet_error lxqt_wallet_sharded_add_key(lxqt_wallet_sharded_t wallet, const char *key, u_int32_t key_size,
+                                              const char *value, u_int32_t value_size)
+{
+    struct _shard *s;
+    u_int32_t index;
+    int64_t offset;
+    lxqt_wallet_error r;
+
+    if (wallet == NULL || key == NULL || (value == NULL && value_size > 0))
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    index = _sharded_route(wallet, key, key_size);
+
+    r = _sharded_load(wallet, index);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    s = wallet->shards + index;
+
+    r = _sharded_note_change(s, key, key_size);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    offset = _sharded_find(s, key, key_size);
+
+    if (offset != -1)
+    {
+        _sharded_remove(s, offset);
+    }
+
+    return _sharded_append(s, key, key_size, value, value_size);
+}
+
+lxqt_wallet_error lxqt_wallet_sharded_delete_key(lxqt_wallet_sharded_t wallet, const char *key, u_int32_t key_size)
+{
+    u_int32_t index;
+    int64_t offset;
+    lxqt_wallet_error r;
+
+    if (wallet == NULL || key == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    index = _sharded_route(wallet, key, key_size);
+
+    r = _sharded_load(wallet, index);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    offset = _sharded_find(wallet->shards + index, key, key_size);
+
+    if (offset == -1)
+    {
+        return lxqt_wallet_no_error;
+    }
+
+    r = _sharded_note_change(wallet->shards + index, key, key_size);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        _sharded_remove(wallet->shards + index, offset);
+    }
+
+    return r;
+}
+
+int lxqt_wallet_sharded_iter_read_value(lxqt_wallet_sharded_t wallet, lxqt_wallet_iterator_t *iter)
+{
+    u_int64_t index;
+    u_int64_t offset;
+    struct _shard *s;
+
+    if (wallet == NULL || iter == NULL)
+    {
+        return 0;
+    }
+
+    index  = iter->iter_pos >> SHARDED_ITER_SHARD_SHIFT;
+    offset = iter->iter_pos & (((u_int64_t)1 << SHARDED_ITER_SHARD_SHIFT) - 1);
+
+    while (index < wallet->shard_count)
+    {
+        wallet->error = _sharded_load(wallet, index);
+
+        if (wallet->error != lxqt_wallet_no_error)
+        {
+            return 0;
+        }
+
+        s = wallet->shards + index;
+
+        if (offset < s->size)
+        {
+            _sharded_node(s, offset, &iter->entry);
+
+            offset += SHARDED_NODE_HEADER_SIZE + (u_int64_t)iter->entry.key_size + iter->entry.key_value_size;
+
+            iter->iter_pos = index << SHARDED_ITER_SHARD_SHIFT | offset;
+
+            return 1;
+        }
+
+        index++;
+        offset = 0;
+    }
+
+    iter->iter_pos = index << SHARDED_ITER_SHARD_SHIFT;
+
+    return 0;
+}
+
+/*
+ * write a shard to the file of "generation",the load is encrypted in a copy and the shard stays usable if the save
+ * fails
+ */
+static lxqt_wallet_error _sharded_write_shard(lxqt_wallet_sharded_t w, u_int32_t index, u_int64_t generation)
+{
+    char header[ SHARDED_SHARD_HEADER_SIZE ];
+    char name[ SHARDED_SHARD_NAME_SIZE ];
+    struct _shard *s = w->shards + index;
+    u_int64_t capacity = s->size > 0 ? s->size : 1;
+    lxqt_wallet_error r;
+    char *buffer;
+
+    memcpy(header, SHARDED_SHARD_MAGIC_STRING, SHARDED_MAGIC_STRING_SIZE);
+    memcpy(header + SHARDED_MAGIC_STRING_SIZE, &index, sizeof(u_int32_t));
+    memcpy(header + SHARDED_MAGIC_STRING_SIZE + sizeof(u_int32_t), &s->entry_count, sizeof(u_int32_t));
+    memcpy(header + SHARDED_MAGIC_STRING_SIZE + 2 * sizeof(u_int32_t), &s->size, sizeof(u_int64_t));
+    memcpy(header + SHARDED_MAGIC_STRING_SIZE + 2 * sizeof(u_int32_t) + sizeof(u_int64_t), &generation,
+           sizeof(u_int64_t));
+
+    gcry_create_nonce(header + SHARDED_SHARD_DATA_SIZE, SHARDED_NONCE_SIZE);
+
+    buffer = _lxqt_wallet_locked_buffer(capacity);
+
+    if (buffer == NULL)
+    {
+        return lxqt_wallet_failed_to_allocate_memory;
+    }
+
+    if (s->size > 0)
+    {
+        memcpy(buffer, s->data, s->size);
+    }
+
+    r = _sharded_crypt(w->cipher, header + SHARDED_SHARD_DATA_SIZE, header, SHARDED_SHARD_DATA_SIZE, buffer, s->size,
+                       header + SHARDED_SHARD_DATA_SIZE + SHARDED_NONCE_SIZE, 1);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        _sharded_shard_name(name, index, generation);
+
+        r = _sharded_write_file(w->folder, name, header, SHARDED_SHARD_HEADER_SIZE, buffer, s->size);
+    }
+
+    _lxqt_wallet_free_locked_buffer(buffer, capacity);
+
+    return r;
+}
+
+/*
+ * the caller holds the lock of the application directory,"lock" is a readable descriptor of it
+ */
+static lxqt_wallet_error _sharded_save(lxqt_wallet_sharded_t w, int dirfd, int lock)
+{
+    char name[ PATH_MAX ];
+    struct stat st;
+    struct _shard *s;
+    lxqt_wallet_error r;
+    const char *records;
+    char *index;
+    u_int64_t generation;
+    u_int64_t entry_count = 0;
+    u_int64_t size = SHARDED_INDEX_SIZE(w->shard_count);
+    u_int32_t written;
+    u_int32_t i;
+
+    r = _sharded_refresh(w, dirfd, 1, &index);
+
+    if (r != lxqt_wallet_no_error)
+    {
+        return r;
+    }
+
+    records = index + SHARDED_INDEX_HEADER_SIZE + SHARDED_MAGIC_STRING_SIZE;
+
+    for (i = 0; i < w->shard_count; i++)
+    {
+        s = w->shards + i;
+
+        if (!s->dirty)
+        {
+            continue;
+        }
+
+        if (_sharded_record_generation(records, i) != s->generation)
+        {
+            r = _sharded_merge(w, i, records + i * SHARDED_RECORD_SIZE);
+
+            if (r != lxqt_wallet_no_error)
+            {
+                break;
+            }
+        }
+
+        r = _sharded_write_shard(w, i, _sharded_record_generation(records, i) + 1);
+
+        if (r != lxqt_wallet_no_error)
+        {
+            break;
+        }
+    }
+
+    written = i;
+
+    if (r == lxqt_wallet_no_error)
+    {
+        fsync(w->folder);
+
+        for (i = 0; i < w->shard_count; i++)
+        {
+            if (w->shards[ i ].dirty)
+            {
+                w->shards[ i ].generation = _sharded_record_generation(records, i) + 1;
+            }
+        }
+
+        r = _sharded_write_index(w, dirfd, w->wallet_name);
+    }
+
+    if (r == lxqt_wallet_no_error)
+    {
+        fsync(lock);
+    }
+
+    /*
+     * files of the generation the index no longer lists are removed,new files are removed if the save failed
+     */
+    for (i = 0; i < written; i++)
+    {
+        s = w->shards + i;
+
+        if (!s->dirty)
+        {
+            continue;
+        }
+
+        generation = _sharded_record_generation(records, i);
+
+        if (r == lxqt_wallet_no_error)
+        {
+            if (generation != 0)
+            {
+                _sharded_shard_name(name, i, generation);
+                unlinkat(w->folder, name, 0);
+            }
+
+            _lxqt_wallet_free_locked_buffer(s->changes, s->changes_capacity);
+
+            s->changes          = NULL;
+            s->changes_size     = 0;
+            s->changes_capacity = 0;
+            s->dirty            = 0;
+        }
+        else
+        {
+            _sharded_shard_name(name, i, generation + 1);
+            unlinkat(w->folder, name, 0);
+
+            s->generation = generation;
+        }
+    }
+
+    free(index);
+
+    if (r == lxqt_wallet_no_error)
+    {
+        for (i = 0; i < w->shard_count; i++)
+        {
+            s = w->shards + i;
+
+            if (s->generation != 0)
+            {
+                size += SHARDED_SHARD_HEADER_SIZE + s->size;
+            }
+
+            entry_count += s->entry_count;
+        }
+
+        _sharded_name(name, w->wallet_name, SHARDED_EXTENSION);
+
+        if (fstatat(dirfd, name, &st, 0) == 0)
+        {
+            st.st_size = size;
+
+            _lxqt_wallet_update_manifest(w->wallet_name, w->application_name, &st, entry_count,
+                                         SHARDED_VERSION | LXQT_WALLET_SHARDED_VERSION_FLAG);
+        }
+    }
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_sharded_save(lxqt_wallet_sharded_t wallet)
+{
+    lxqt_wallet_error r;
+    u_int32_t i;
+    int dirfd;
+    int lock;
+
+    if (wallet == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    for (i = 0; i < wallet->shard_count; i++)
+    {
+        if (wallet->shards[ i ].dirty)
+        {
+            break;
+        }
+    }
+
+    if (i == wallet->shard_count)
+    {
+        return lxqt_wallet_no_error;
+    }
+
+    lock = _lxqt_wallet_lock_application_directory(wallet->application_name);
+
+    dirfd = _lxqt_wallet_application_directory(wallet->application_name, 0);
+
+    if (lock == -1 || dirfd == -1)
+    {
+        r = lxqt_wallet_failed_to_open_file;
+    }
+    else
+    {
+        r = _sharded_save(wallet, dirfd, lock);
+    }
+
+    _lxqt_wallet_release_application_directory(dirfd);
+
+    _lxqt_wallet_unlock_application_directory(lock);
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_sharded_close(lxqt_wallet_sharded_t *wallet)
+{
+    lxqt_wallet_error r;
+
+    if (wallet == NULL || *wallet == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    r = lxqt_wallet_sharded_save(*wallet);
+
+    _sharded_free(*wallet);
+
+    *wallet = NULL;
+
+    return r;
+}
+
+lxqt_wallet_error lxqt_wallet_sharded_delete_wallet(const char *wallet_name, const char *application_name)
+{
+    char name[ PATH_MAX ];
+    struct dirent *entry;
+    DIR *dir;
+    int dirfd;
+    int folder;
+    int lock;
+
+    if (wallet_name == NULL || application_name == NULL)
+    {
+        return lxqt_wallet_invalid_argument;
+    }
+
+    lock = _lxqt_wallet_lock_application_directory(application_name);
+
+    dirfd = _lxqt_wallet_application_directory(application_name, 0);
+
+    _sharded_name(name, wallet_name, SHARDED_EXTENSION);
+
+    if (unlinkat(dirfd, name, 0) == 0)
+    {
+        _lxqt_wallet_update_manifest(wallet_name, application_name, NULL, 0,
+                                     SHARDED_VERSION | LXQT_WALLET_SHARDED_VERSION_FLAG);
+    }
+
+    _sharded_name(name, wallet_name, SHARDED_FOLDER_EXTENSION);
+
+    folder = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (folder != -1)
+    {
+        dir = fdopendir(folder);
+
+        if (dir == NULL)
+        {
+            close(folder);
+        }
+        else
+        {
+            while ((entry = readdir(dir)) != NULL)
+            {
+                if (entry->d_name[ 0 ] != '.')
+                {
+                    unlinkat(folder, entry->d_name, 0);
+                }
+            }
+
+            closedir(dir);
+        }
+    }
+
+    unlinkat(dirfd, name, AT_REMOVEDIR);
+
+    _lxqt_wallet_release_application_directory(dirfd);
+
+    _lxqt_wallet_unlock_application_directory(lock);
+
+    return lxqt_wallet_no_error;
+}
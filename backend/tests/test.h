@@ -0,0 +1,86 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Helpers shared by the backend tests.
+ *
+ * Every test keeps its wallets in a folder of its own made by test_storage_root() and points the library at it
+ * through the "LXQT_WALLET_STORAGE_ROOT" environment variable,programs started by the test inherit it.
+ */
+
+#ifndef LXQTWALLET_TEST_H
+#define LXQTWALLET_TEST_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ftw.h>
+
+#include "../lxqtwallet.h"
+
+#define CHECK( x ) do { if (!(x)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #x); exit(1); } } while (0)
+
+static char _test_root[ 64 ];
+
+static int _test_remove(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    (void)st;
+    (void)flag;
+    (void)ftw;
+
+    return remove(path);
+}
+
+static void _test_remove_storage_root(void)
+{
+    nftw(_test_root, _test_remove, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+/*
+ * make an empty folder for wallets and return its path,the folder is removed when the test exits
+ */
+static const char *test_storage_root(void)
+{
+    snprintf(_test_root, sizeof(_test_root), "/tmp/lxqt_wallet_test.XXXXXX");
+
+    CHECK(mkdtemp(_test_root) != NULL);
+    CHECK(setenv("LXQT_WALLET_STORAGE_ROOT", _test_root, 1) == 0);
+
+    atexit(_test_remove_storage_root);
+
+    return _test_root;
+}
+
+#endif
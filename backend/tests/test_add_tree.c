@@ -0,0 +1,204 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * "add-tree" adds every file of a folder and of its sub folders keyed by its path relative to the folder,files the
+ * wallet already has are reported and are not written over and links to folders are not followed.
+ *
+ * The path to lxqt_wallet-cli is given as the first argument.
+ */
+
+#include "test.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define APPLICATION "lxqt_wallet-cli"
+#define FOLDERS 6
+#define FILES 40
+
+/*
+ * run "lxqt_wallet-cli --batch" with "add-tree <path>" given through standard input
+ */
+static int _add_tree(const char *cli, const char *path)
+{
+    char command[ 256 ];
+    int status;
+    int fds[ 2 ];
+    int pfds[ 2 ];
+    int fd;
+    int n;
+    pid_t pid;
+
+    CHECK(pipe(fds) == 0 && pipe(pfds) == 0);
+
+    pid = fork();
+    CHECK(pid >= 0);
+
+    if (pid == 0)
+    {
+        fd = open("/dev/null", O_WRONLY);
+
+        if (fd < 0 || dup2(fd, 1) < 0 || dup2(fds[ 0 ], 0) < 0 || dup2(pfds[ 0 ], 3) < 0)
+        {
+            _exit(127);
+        }
+
+        close(fds[ 1 ]);
+        close(pfds[ 1 ]);
+
+        execl(cli, cli, "--batch", "--wallet", "w", "--password-fd", "3", (char *)NULL);
+        _exit(127);
+    }
+
+    close(fds[ 0 ]);
+    close(pfds[ 0 ]);
+
+    CHECK(write(pfds[ 1 ], "pw", 2) == 2);
+    close(pfds[ 1 ]);
+
+    n = snprintf(command, sizeof(command), "add-tree %s\n", path);
+    CHECK(write(fds[ 1 ], command, n) == n);
+    close(fds[ 1 ]);
+
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) != 127);
+
+    return WEXITSTATUS(status);
+}
+
+static void _write_file(const char *path, const char *data)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    CHECK(fd >= 0 && write(fd, data, strlen(data)) == (ssize_t)strlen(data));
+
+    close(fd);
+}
+
+/*
+ * folder "i" is "d0/d1/../di" and holds files "f0" to "f<FILES-1>" whose content is their path
+ */
+static void _folder(char *buffer, size_t size, int i)
+{
+    int j;
+    int n = 0;
+
+    buffer[ 0 ] = '\0';
+
+    for (j = 0; j <= i; j++)
+    {
+        n += snprintf(buffer + n, size - n, "%sd%d", j == 0 ? "" : "/", j);
+    }
+}
+
+static void _check_value(lxqt_wallet_t w, const char *key, const char *value)
+{
+    lxqt_wallet_key_values_t e;
+
+    CHECK(lxqt_wallet_read_key_value(w, key, strlen(key) + 1, &e));
+    CHECK(e.key_value_size == strlen(value) && memcmp(e.key_value, value, e.key_value_size) == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *root = test_storage_root();
+    char folder[ 128 ];
+    char key[ 160 ];
+    char path[ 256 ];
+    lxqt_wallet_t w;
+    int i;
+    int j;
+
+    CHECK(argc == 2);
+
+    snprintf(path, sizeof(path), "%s/tree", root);
+    CHECK(mkdir(path, 0700) == 0);
+
+    for (i = 0; i < FOLDERS; i++)
+    {
+        _folder(folder, sizeof(folder), i);
+
+        snprintf(path, sizeof(path), "%s/tree/%s", root, folder);
+        CHECK(mkdir(path, 0700) == 0);
+
+        for (j = 0; j < FILES; j++)
+        {
+            snprintf(key, sizeof(key), "%s/f%d", folder, j);
+            snprintf(path, sizeof(path), "%s/tree/%s", root, key);
+            _write_file(path, key);
+        }
+    }
+
+    snprintf(path, sizeof(path), "%s/tree/empty", root);
+    _write_file(path, "");
+
+    snprintf(folder, sizeof(folder), "%s/tree/d0", root);
+    snprintf(path, sizeof(path), "%s/tree/link", root);
+    CHECK(symlink(folder, path) == 0);
+
+    snprintf(path, sizeof(path), "%s/tree", root);
+    CHECK(_add_tree(argv[ 1 ], path) == 0);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_wallet_entry_count(w) == FOLDERS * FILES + 1);
+
+    for (i = 0; i < FOLDERS; i++)
+    {
+        _folder(folder, sizeof(folder), i);
+
+        for (j = 0; j < FILES; j++)
+        {
+            snprintf(key, sizeof(key), "%s/f%d", folder, j);
+            _check_value(w, key, key);
+        }
+    }
+
+    _check_value(w, "empty", "");
+    CHECK(!lxqt_wallet_wallet_has_key(w, "link/f0", 8));
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    /*
+     * a second import does not write over files the wallet has
+     */
+    snprintf(path, sizeof(path), "%s/tree/d0/f0", root);
+    _write_file(path, "changed");
+
+    snprintf(path, sizeof(path), "%s/tree", root);
+    CHECK(_add_tree(argv[ 1 ], path) != 0);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_wallet_entry_count(w) == FOLDERS * FILES + 1);
+    _check_value(w, "d0/f0", "d0/f0");
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * lxqt_wallet-agent keeps a wallet unlocked for its clients,changes made through it are saved when the wallet is
+ * locked and attached handles see the wallet as it was when they attached.
+ *
+ * The path to lxqt_wallet-agent is given as the first argument.
+ */
+
+#include "test.h"
+
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#define APPLICATION "lxqt_wallet_test"
+
+static int _count_keys(const char *key, u_int32_t key_size, void *arg)
+{
+    (void)key;
+    (void)key_size;
+
+    (*(int *)arg)++;
+
+    return 0;
+}
+
+static pid_t _start_agent(const char *agent, lxqt_wallet_agent_t *a)
+{
+    pid_t pid = fork();
+    int fd;
+    int i;
+
+    CHECK(pid >= 0);
+
+    if (pid == 0)
+    {
+        fd = open("/dev/null", O_WRONLY);
+
+        if (fd < 0 || dup2(fd, 1) < 0)
+        {
+            _exit(127);
+        }
+
+        execl(agent, agent, "-f", (char *)NULL);
+        _exit(127);
+    }
+
+    for (i = 0; i < 100; i++)
+    {
+        if (lxqt_wallet_agent_connect(a) == lxqt_wallet_no_error)
+        {
+            return pid;
+        }
+
+        usleep(50 * 1000);
+    }
+
+    CHECK(0);
+
+    return pid;
+}
+
+int main(int argc, char *argv[])
+{
+    lxqt_wallet_key_values_t e;
+    lxqt_wallet_agent_t a;
+    lxqt_wallet_t w;
+    char socket_path[ 128 ];
+    u_int32_t value_size;
+    char *value;
+    int status;
+    int count = 0;
+    pid_t pid;
+
+    CHECK(argc == 2);
+
+    snprintf(socket_path, sizeof(socket_path), "%s/agent.socket", test_storage_root());
+    CHECK(setenv("LXQT_WALLET_AGENT_SOCKET", socket_path, 1) == 0);
+
+    CHECK(lxqt_wallet_create("pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+
+    pid = _start_agent(argv[ 1 ], &a);
+
+    CHECK(!lxqt_wallet_agent_has_wallet(a, "w", APPLICATION));
+    CHECK(lxqt_wallet_agent_get(a, "w", APPLICATION, "k", 2, &value, &value_size) == lxqt_wallet_wallet_not_unlocked);
+    CHECK(lxqt_wallet_agent_unlock(a, "wrong", 5, "w", APPLICATION) == lxqt_wallet_wrong_password);
+    CHECK(lxqt_wallet_agent_unlock(a, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_agent_has_wallet(a, "w", APPLICATION));
+
+    CHECK(lxqt_wallet_agent_add_key(a, "w", APPLICATION, "k", 2, "value", 5) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_agent_add_key(a, "w", APPLICATION, "gone", 5, "", 0) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_agent_has_key(a, "w", APPLICATION, "k", 2) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_agent_delete_key(a, "w", APPLICATION, "gone", 5) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_agent_has_key(a, "w", APPLICATION, "gone", 5) == lxqt_wallet_key_not_found);
+
+    CHECK(lxqt_wallet_agent_get(a, "w", APPLICATION, "k", 2, &value, &value_size) == lxqt_wallet_no_error);
+    CHECK(value_size == 5 && memcmp(value, "value", 5) == 0);
+    lxqt_wallet_agent_free_value(value, value_size);
+
+    CHECK(lxqt_wallet_agent_list(a, "w", APPLICATION, _count_keys, &count) == lxqt_wallet_no_error && count == 1);
+
+    /*
+     * an attached handle is a snapshot and does not see later changes
+     */
+    CHECK(lxqt_wallet_agent_attach(a, "w", APPLICATION, &w) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_agent_add_key(a, "w", APPLICATION, "later", 6, "", 0) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_read_key_value(w, "k", 2, &e) && e.key_value_size == 5);
+    CHECK(!lxqt_wallet_wallet_has_key(w, "later", 6));
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_agent_lock(a, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(!lxqt_wallet_agent_has_wallet(a, "w", APPLICATION));
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_wallet_entry_count(w) == 2);
+    CHECK(lxqt_wallet_read_key_value(w, "k", 2, &e) && memcmp(e.key_value, "value", 5) == 0);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_agent_stop(a) == lxqt_wallet_no_error);
+    lxqt_wallet_agent_disconnect(&a);
+
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * "lxqt_wallet-cli --batch" runs every command of a command file against one unlocked wallet,a failed command is
+ * reported through the exit status and does not stop the commands after it.
+ *
+ * The path to lxqt_wallet-cli is given as the first argument.
+ */
+
+#include "test.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define APPLICATION "lxqt_wallet-cli"
+
+static int _run_cli(const char *cli, const char *commands)
+{
+    int status;
+    int fds[ 2 ];
+    int fd;
+    pid_t pid;
+
+    CHECK(pipe(fds) == 0);
+
+    pid = fork();
+    CHECK(pid >= 0);
+
+    if (pid == 0)
+    {
+        fd = open("/dev/null", O_WRONLY);
+
+        if (fd < 0 || dup2(fd, 1) < 0 || dup2(fds[ 0 ], 3) < 0)
+        {
+            _exit(127);
+        }
+
+        close(fds[ 1 ]);
+
+        execl(cli, cli, "--batch", "--wallet", "w", "--password-fd", "3", commands, (char *)NULL);
+        _exit(127);
+    }
+
+    close(fds[ 0 ]);
+    CHECK(write(fds[ 1 ], "pw", 2) == 2);
+    close(fds[ 1 ]);
+
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) != 127);
+
+    return WEXITSTATUS(status);
+}
+
+static void _write_file(const char *path, const char *data)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    CHECK(fd >= 0 && write(fd, data, strlen(data)) == (ssize_t)strlen(data));
+
+    close(fd);
+}
+
+static void _check_value(lxqt_wallet_t w, const char *key, const char *value)
+{
+    lxqt_wallet_key_values_t e;
+
+    CHECK(lxqt_wallet_read_key_value(w, key, strlen(key) + 1, &e));
+    CHECK(e.key_value_size == strlen(value) && memcmp(e.key_value, value, e.key_value_size) == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *root = test_storage_root();
+    char commands[ 128 ];
+    char path[ 128 ];
+    char buffer[ 1024 ];
+    lxqt_wallet_t w;
+    int fd;
+    int n;
+
+    CHECK(argc == 2);
+
+    snprintf(path, sizeof(path), "%s/files", root);
+    CHECK(mkdir(path, 0700) == 0);
+    snprintf(path, sizeof(path), "%s/files/a", root);
+    _write_file(path, "one");
+    snprintf(path, sizeof(path), "%s/files/b", root);
+    _write_file(path, "two");
+    snprintf(path, sizeof(path), "%s/folder", root);
+    CHECK(mkdir(path, 0700) == 0);
+    snprintf(path, sizeof(path), "%s/folder/c", root);
+    _write_file(path, "three");
+
+    n = snprintf(buffer, sizeof(buffer),
+                 "# files are added to a wallet that does not exist yet\n"
+                 "\n"
+                 "add %s/files/a\n"
+                 "  --add   %s/files/b\n"
+                 "add-all %s/folder\n"
+                 "unknown command\n"
+                 "delete b\n"
+                 "get %s/a\n",
+                 root, root, root, root);
+
+    snprintf(commands, sizeof(commands), "%s/commands", root);
+    fd = open(commands, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0 && write(fd, buffer, n) == n);
+    close(fd);
+
+    CHECK(_run_cli(argv[ 1 ], commands) != 0);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_wallet_entry_count(w) == 2);
+    _check_value(w, "a", "one");
+    _check_value(w, "c", "three");
+    CHECK(!lxqt_wallet_wallet_has_key(w, "b", 2));
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    snprintf(path, sizeof(path), "%s/a", root);
+    fd = open(path, O_RDONLY);
+    CHECK(fd >= 0 && read(fd, buffer, sizeof(buffer)) == 3 && memcmp(buffer, "one", 3) == 0);
+    close(fd);
+
+    /*
+     * a wrong password unlocks nothing and runs no command
+     */
+    snprintf(path, sizeof(path), "%s/files/d", root);
+    _write_file(path, "four");
+    n = snprintf(buffer, sizeof(buffer), "add %s\n", path);
+    fd = open(commands, O_WRONLY | O_TRUNC);
+    CHECK(fd >= 0 && write(fd, buffer, n) == n);
+    close(fd);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_change_wallet_password(w, "new", 3) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(_run_cli(argv[ 1 ], commands) != 0);
+
+    CHECK(lxqt_wallet_open(&w, "new", 3, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_wallet_entry_count(w) == 2);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    return 0;
+}
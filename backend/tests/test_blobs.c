@@ -0,0 +1,197 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Files larger than 1 MiB are encrypted to files of their own in the blobs folder of the wallet,the wallet holds a
+ * small reference to them,they read back to their content and their encrypted file goes away once the entry is
+ * deleted and the wallet is saved.
+ *
+ * The path to lxqt_wallet-cli is given as the first argument.
+ */
+
+#include "test.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define APPLICATION "lxqt_wallet-cli"
+#define LARGE_SIZE ( 3 * 1024 * 1024 + 11 )
+
+static const char *_root;
+
+/*
+ * run "lxqt_wallet-cli --batch" with "commands" given through standard input
+ */
+static int _batch(const char *cli, const char *commands)
+{
+    int status;
+    int fds[ 2 ];
+    int pfds[ 2 ];
+    int fd;
+    pid_t pid;
+
+    CHECK(pipe(fds) == 0 && pipe(pfds) == 0);
+
+    pid = fork();
+    CHECK(pid >= 0);
+
+    if (pid == 0)
+    {
+        fd = open("/dev/null", O_WRONLY);
+
+        if (fd < 0 || dup2(fd, 1) < 0 || dup2(fds[ 0 ], 0) < 0 || dup2(pfds[ 0 ], 3) < 0 || chdir(_root) != 0)
+        {
+            _exit(127);
+        }
+
+        close(fds[ 1 ]);
+        close(pfds[ 1 ]);
+
+        execl(cli, cli, "--batch", "--wallet", "w", "--password-fd", "3", (char *)NULL);
+        _exit(127);
+    }
+
+    close(fds[ 0 ]);
+    close(pfds[ 0 ]);
+
+    CHECK(write(pfds[ 1 ], "pw", 2) == 2);
+    close(pfds[ 1 ]);
+
+    CHECK(write(fds[ 1 ], commands, strlen(commands)) == (ssize_t)strlen(commands));
+    close(fds[ 1 ]);
+
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) != 127);
+
+    return WEXITSTATUS(status);
+}
+
+/*
+ * number of files in the blobs folder of the wallet
+ */
+static int _blob_count(void)
+{
+    struct dirent *entry;
+    char path[ 256 ];
+    int n = 0;
+    DIR *dir;
+
+    snprintf(path, sizeof(path), "%s/%s/w.blobs", _root, APPLICATION);
+
+    dir = opendir(path);
+
+    if (dir == NULL)
+    {
+        return 0;
+    }
+
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[ 0 ] != '.')
+        {
+            n++;
+        }
+    }
+
+    closedir(dir);
+
+    return n;
+}
+
+static char _byte(u_int64_t i)
+{
+    return (char)(i * 3 + i / 8191);
+}
+
+int main(int argc, char *argv[])
+{
+    lxqt_wallet_key_values_t e;
+    lxqt_wallet_t w;
+    char path[ 256 ];
+    char *data;
+    u_int64_t i;
+    int fd;
+
+    CHECK(argc == 2);
+
+    _root = test_storage_root();
+
+    data = malloc(LARGE_SIZE);
+    CHECK(data != NULL);
+
+    for (i = 0; i < LARGE_SIZE; i++)
+    {
+        data[ i ] = _byte(i);
+    }
+
+    snprintf(path, sizeof(path), "%s/large", _root);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0 && write(fd, data, LARGE_SIZE) == LARGE_SIZE);
+    close(fd);
+
+    snprintf(path, sizeof(path), "%s/small", _root);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0 && write(fd, "small", 5) == 5);
+    close(fd);
+
+    CHECK(_batch(argv[ 1 ], "add large\nadd small\n") == 0);
+    CHECK(_blob_count() == 1);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_read_key_value(w, "large", 6, &e) && e.key_value_size < 1024);
+    CHECK(lxqt_wallet_read_key_value(w, "small", 6, &e) && e.key_value_size == 5);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(_batch(argv[ 1 ], "get-all out\n") == 0);
+
+    snprintf(path, sizeof(path), "%s/out/large", _root);
+    fd = open(path, O_RDONLY);
+    memset(data, '\0', LARGE_SIZE);
+    CHECK(fd >= 0 && read(fd, data, LARGE_SIZE) == LARGE_SIZE && read(fd, path, 1) == 0);
+    close(fd);
+
+    for (i = 0; i < LARGE_SIZE; i++)
+    {
+        CHECK(data[ i ] == _byte(i));
+    }
+
+    CHECK(_batch(argv[ 1 ], "delete large\n") == 0);
+    CHECK(_blob_count() == 0);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_wallet_entry_count(w) == 1);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    free(data);
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Compressed wallets and compressed encrypted files read back to what was stored and data that compresses well
+ * takes less room.
+ */
+
+#include "test.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define APPLICATION "lxqt_wallet_test"
+#define SIZE ( 2 * 1024 * 1024 + 3 )
+
+static int _progress(int percent, void *arg)
+{
+    (void)percent;
+    (void)arg;
+
+    return 0;
+}
+
+static u_int64_t _file_size(const char *path)
+{
+    struct stat st;
+
+    CHECK(stat(path, &st) == 0);
+
+    return st.st_size;
+}
+
+static void _write_file(const char *path, const char *data, u_int64_t size)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    CHECK(fd >= 0 && write(fd, data, size) == (ssize_t)size);
+
+    close(fd);
+}
+
+static void _check_file(const char *path, const char *data, u_int64_t size)
+{
+    char *e = malloc(size + 1);
+    int fd = open(path, O_RDONLY);
+
+    CHECK(e != NULL && fd >= 0 && read(fd, e, size + 1) == (ssize_t)size && memcmp(e, data, size) == 0);
+
+    close(fd);
+    free(e);
+}
+
+/*
+ * encrypt "data" compressed and uncompressed,return the size of the compressed file less the size of the other
+ */
+static int64_t _round_trip(const char *root, const char *data, u_int64_t size)
+{
+    char plain[ 128 ];
+    char encrypted[ 128 ];
+    char compressed[ 128 ];
+    char decrypted[ 128 ];
+    int64_t r;
+
+    snprintf(plain, sizeof(plain), "%s/plain", root);
+    snprintf(encrypted, sizeof(encrypted), "%s/encrypted", root);
+    snprintf(compressed, sizeof(compressed), "%s/compressed", root);
+    snprintf(decrypted, sizeof(decrypted), "%s/decrypted", root);
+
+    _write_file(plain, data, size);
+
+    CHECK(lxqt_wallet_create_encrypted_file("pw", 2, plain, encrypted, _progress, NULL) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_create_compressed_encrypted_file("pw", 2, plain, compressed, _progress, NULL) ==
+          lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_create_decrypted_file("pw", 2, compressed, decrypted, _progress, NULL) == lxqt_wallet_no_error);
+    _check_file(decrypted, data, size);
+
+    r = (int64_t)_file_size(compressed) - (int64_t)_file_size(encrypted);
+
+    unlink(plain);
+    unlink(encrypted);
+    unlink(compressed);
+    unlink(decrypted);
+
+    return r;
+}
+
+int main(void)
+{
+    const char *root = test_storage_root();
+    lxqt_wallet_key_values_t e;
+    lxqt_wallet_t w;
+    char *data = malloc(SIZE);
+    u_int64_t i;
+    int fd;
+
+    CHECK(data != NULL);
+
+    memset(data, 'a', SIZE);
+    CHECK(_round_trip(root, data, SIZE) < -(int64_t)SIZE / 2);
+    _round_trip(root, data, 0);
+
+    fd = open("/dev/urandom", O_RDONLY);
+    CHECK(fd >= 0);
+
+    for (i = 0; i < SIZE; i += 65536)
+    {
+        CHECK(read(fd, data + i, SIZE - i < 65536 ? SIZE - i : 65536) > 0);
+    }
+
+    close(fd);
+
+    _round_trip(root, data, SIZE);
+
+    /*
+     * a compressed wallet is kept compressed by later saves
+     */
+    memset(data, 'b', SIZE);
+
+    CHECK(lxqt_wallet_create("pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_compression(w) == 0);
+    CHECK(lxqt_wallet_add_key(w, "big", 4, data, 100000) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_set_compression(w, 1) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_volume_version("w", APPLICATION, "pw", 2) == 300);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_compression(w) == 1);
+    CHECK(lxqt_wallet_read_key_value(w, "big", 4, &e) && e.key_value_size == 100000);
+    CHECK(memcmp(e.key_value, data, 100000) == 0);
+    CHECK(lxqt_wallet_add_key(w, "small", 6, "v", 1) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_volume_version("w", APPLICATION, "pw", 2) == 300);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_wallet_entry_count(w) == 2);
+    CHECK(lxqt_wallet_read_key_value(w, "big", 4, &e) && memcmp(e.key_value, data, 100000) == 0);
+    CHECK(lxqt_wallet_set_compression(w, 0) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_volume_version("w", APPLICATION, "pw", 2) != 300);
+
+    free(data);
+
+    return 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * lxqt_wallet_decrypt_range() returns the right bytes for ranges that start,end and cross chunk and batch edges,and
+ * fails without leaving plain text in the buffer when a chunk of the range was modified.
+ * lxqt_wallet_create_decrypted_file() leaves no file behind when a chunk was modified.
+ */
+
+#include "test.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define CHUNK ( 64 * 1024 )
+#define SIZE ( 18 * 1024 * 1024 + 777 )
+
+static int _progress(int e, void *arg)
+{
+    (void)e;
+    (void)arg;
+    return 0;
+}
+
+/*
+ * number of files in "root" whose names start with "prefix"
+ */
+static int _files_named(const char *root, const char *prefix)
+{
+    struct dirent *e;
+    DIR *dir = opendir(root);
+    int n = 0;
+
+    CHECK(dir != NULL);
+
+    while ((e = readdir(dir)) != NULL)
+    {
+        if (strncmp(e->d_name, prefix, strlen(prefix)) == 0)
+        {
+            n++;
+        }
+    }
+
+    closedir(dir);
+
+    return n;
+}
+
+static void _check_file(const char *path, const char *plain)
+{
+    char *e = malloc(SIZE + 1);
+    int fd = open(path, O_RDONLY);
+
+    CHECK(e != NULL && fd >= 0);
+    CHECK(read(fd, e, SIZE + 1) == SIZE);
+    CHECK(memcmp(e, plain, SIZE) == 0);
+
+    close(fd);
+    free(e);
+}
+
+static void _check_range(const char *path, const char *plain, u_int64_t offset, u_int64_t length, char *buffer)
+{
+    u_int64_t size = 0;
+    u_int64_t expected;
+
+    if (offset >= SIZE)
+    {
+        expected = 0;
+    }
+    else if (offset + length > SIZE)
+    {
+        expected = SIZE - offset;
+    }
+    else
+    {
+        expected = length;
+    }
+
+    CHECK(lxqt_wallet_decrypt_range("pw", 2, path, offset, length, buffer, &size) == lxqt_wallet_no_error);
+    CHECK(size == expected);
+    CHECK(memcmp(buffer, plain + offset, size) == 0);
+}
+
+int main(void)
+{
+    const char *root = test_storage_root();
+    char plain_path[ 128 ];
+    char seekable_path[ 128 ];
+    char cbc_path[ 128 ];
+    char decrypted_path[ 128 ];
+    char *plain = malloc(SIZE);
+    char *buffer = malloc(SIZE);
+    struct stat st;
+    u_int64_t size;
+    u_int64_t i;
+    char c;
+    int fd;
+
+    u_int64_t offsets[] = { 0, CHUNK - 1, CHUNK, CHUNK + 1, 3 * CHUNK - 5, 0, 1, SIZE - 10, SIZE - 1, SIZE, 8 * 1024 * 1024 - 3 };
+    u_int64_t lengths[] = { 10, 2, CHUNK, 2 * CHUNK, 10, SIZE, SIZE - 2, 100, 1, 10, 20 };
+
+    CHECK(plain != NULL && buffer != NULL);
+
+    for (i = 0; i < SIZE; i++)
+    {
+        plain[ i ] = (char)(i * 7 + i / 13);
+    }
+
+    snprintf(plain_path, sizeof(plain_path), "%s/plain", root);
+    snprintf(seekable_path, sizeof(seekable_path), "%s/seekable", root);
+    snprintf(cbc_path, sizeof(cbc_path), "%s/cbc", root);
+    snprintf(decrypted_path, sizeof(decrypted_path), "%s/decrypted", root);
+
+    fd = open(plain_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+    CHECK(write(fd, plain, SIZE) == SIZE);
+    close(fd);
+
+    CHECK(lxqt_wallet_create_seekable_encrypted_file("pw", 2, plain_path, seekable_path, _progress, NULL) == 0);
+    CHECK(lxqt_wallet_create_encrypted_file("pw", 2, plain_path, cbc_path, _progress, NULL) == 0);
+
+    for (i = 0; i < sizeof(offsets) / sizeof(offsets[ 0 ]); i++)
+    {
+        _check_range(seekable_path, plain, offsets[ i ], lengths[ i ], buffer);
+        _check_range(cbc_path, plain, offsets[ i ], lengths[ i ], buffer);
+    }
+
+    CHECK(lxqt_wallet_decrypt_range("px", 2, seekable_path, 0, 10, buffer, &size) == lxqt_wallet_wrong_password);
+
+    CHECK(lxqt_wallet_create_decrypted_file("pw", 2, seekable_path, decrypted_path, _progress, NULL) == 0);
+    _check_file(decrypted_path, plain);
+    CHECK(unlink(decrypted_path) == 0);
+
+    CHECK(lxqt_wallet_create_decrypted_file("pw", 2, cbc_path, decrypted_path, _progress, NULL) == 0);
+    _check_file(decrypted_path, plain);
+    CHECK(unlink(decrypted_path) == 0);
+
+    CHECK(lxqt_wallet_create_decrypted_file("px", 2, cbc_path, decrypted_path, _progress, NULL) != 0);
+    CHECK(_files_named(root, "decrypted") == 0);
+
+    /*
+     * flip a bit in the tag of the last chunk,it is in a later batch than the start of the file
+     */
+    fd = open(seekable_path, O_RDWR);
+    CHECK(fd >= 0);
+    CHECK(fstat(fd, &st) == 0);
+    CHECK(pread(fd, &c, 1, st.st_size - 1) == 1);
+    c ^= 1;
+    CHECK(pwrite(fd, &c, 1, st.st_size - 1) == 1);
+    close(fd);
+
+    _check_range(seekable_path, plain, 0, 2 * CHUNK, buffer);
+    _check_range(seekable_path, plain, SIZE - 2000, 1000, buffer);
+
+    CHECK(lxqt_wallet_decrypt_range("pw", 2, seekable_path, SIZE - 10, 10, buffer, &size)
+          == lxqt_wallet_authentication_failed);
+
+    memset(buffer, 0, SIZE);
+
+    CHECK(lxqt_wallet_decrypt_range("pw", 2, seekable_path, 0, SIZE, buffer, &size)
+          == lxqt_wallet_authentication_failed);
+
+    for (i = 0; i < SIZE; i++)
+    {
+        CHECK(buffer[ i ] == '\0');
+    }
+
+    /*
+     * all chunks but the last one decrypt fine,none of them may be left behind
+     */
+    CHECK(lxqt_wallet_create_decrypted_file("pw", 2, seekable_path, decrypted_path, _progress, NULL)
+          == lxqt_wallet_authentication_failed);
+    CHECK(_files_named(root, "decrypted") == 0);
+
+    free(plain);
+    free(buffer);
+
+    return 0;
+}
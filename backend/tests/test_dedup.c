@@ -0,0 +1,192 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Files with the same content added to a wallet with deduplication turned on share one blob,they read back to their
+ * content and the blob goes away with the last file that refers to it.
+ *
+ * The path to lxqt_wallet-cli is given as the first argument.
+ */
+
+#include "test.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define APPLICATION "lxqt_wallet-cli"
+#define SIZE 4096
+#define REFERENCE_SIZE 48
+
+static const char *_root;
+
+/*
+ * run "lxqt_wallet-cli --batch" with "commands" given through standard input
+ */
+static int _batch(const char *cli, const char *commands)
+{
+    int status;
+    int fds[ 2 ];
+    int pfds[ 2 ];
+    int fd;
+    pid_t pid;
+
+    CHECK(pipe(fds) == 0 && pipe(pfds) == 0);
+
+    pid = fork();
+    CHECK(pid >= 0);
+
+    if (pid == 0)
+    {
+        fd = open("/dev/null", O_WRONLY);
+
+        if (fd < 0 || dup2(fd, 1) < 0 || dup2(fds[ 0 ], 0) < 0 || dup2(pfds[ 0 ], 3) < 0 || chdir(_root) != 0)
+        {
+            _exit(127);
+        }
+
+        close(fds[ 1 ]);
+        close(pfds[ 1 ]);
+
+        execl(cli, cli, "--batch", "--wallet", "w", "--password-fd", "3", (char *)NULL);
+        _exit(127);
+    }
+
+    close(fds[ 0 ]);
+    close(pfds[ 0 ]);
+
+    CHECK(write(pfds[ 1 ], "pw", 2) == 2);
+    close(pfds[ 1 ]);
+
+    CHECK(write(fds[ 1 ], commands, strlen(commands)) == (ssize_t)strlen(commands));
+    close(fds[ 1 ]);
+
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) != 127);
+
+    return WEXITSTATUS(status);
+}
+
+static void _write_file(const char *name, const char *data, size_t size)
+{
+    char path[ 256 ];
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/%s", _root, name);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    CHECK(fd >= 0 && write(fd, data, size) == (ssize_t)size);
+
+    close(fd);
+}
+
+static void _check_file(const char *name, const char *data, size_t size)
+{
+    char buffer[ SIZE + 1 ];
+    char path[ 256 ];
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/out/%s", _root, name);
+    fd = open(path, O_RDONLY);
+
+    CHECK(fd >= 0 && read(fd, buffer, sizeof(buffer)) == (ssize_t)size && memcmp(buffer, data, size) == 0);
+
+    close(fd);
+}
+
+static u_int64_t _entry_count(void)
+{
+    lxqt_wallet_t w;
+    u_int64_t n;
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    n = lxqt_wallet_wallet_entry_count(w);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    lxqt_wallet_key_values_t e;
+    lxqt_wallet_t w;
+    char same[ SIZE ];
+    char other[ SIZE ];
+    int i;
+
+    CHECK(argc == 2);
+
+    _root = test_storage_root();
+
+    for (i = 0; i < SIZE; i++)
+    {
+        same[ i ]  = (char)(i * 7);
+        other[ i ] = (char)(i * 5 + 1);
+    }
+
+    _write_file("a", same, SIZE);
+    _write_file("b", same, SIZE);
+    _write_file("c", same, SIZE);
+    _write_file("d", other, SIZE);
+    _write_file("e", "hi", 2);
+
+    CHECK(_batch(argv[ 1 ], "dedup\nadd a\nadd b\nadd c\nadd d\nadd e\n") == 0);
+
+    /*
+     * the dedup entry,5 files and a blob and a count for each of the two contents
+     */
+    CHECK(_entry_count() == 10);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_read_key_value(w, "a", 2, &e) && e.key_value_size == REFERENCE_SIZE);
+    CHECK(lxqt_wallet_read_key_value(w, "c", 2, &e) && e.key_value_size == REFERENCE_SIZE);
+    CHECK(lxqt_wallet_read_key_value(w, "e", 2, &e) && e.key_value_size == 2);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(_batch(argv[ 1 ], "get-all out\n") == 0);
+
+    _check_file("a", same, SIZE);
+    _check_file("b", same, SIZE);
+    _check_file("c", same, SIZE);
+    _check_file("d", other, SIZE);
+    _check_file("e", "hi", 2);
+
+    CHECK(_batch(argv[ 1 ], "delete a\ndelete b\n") == 0);
+    CHECK(_entry_count() == 8);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_read_key_value(w, "c", 2, &e) && e.key_value_size == REFERENCE_SIZE);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(_batch(argv[ 1 ], "delete c\n") == 0);
+    CHECK(_entry_count() == 5);
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Entries of a wallet are kept in a header array with keys and values in arenas of their own,lookups,iteration and
+ * prefix scans still find every entry after deletes renumber the headers and after the wallet is saved and read back.
+ */
+
+#include "test.h"
+
+#define APPLICATION "lxqt_wallet_test"
+#define COUNT 300
+
+static void _key(char *key, size_t size, int i)
+{
+    snprintf(key, size, "%s%d", i % 2 ? "odd" : "even", i);
+}
+
+static void _value(char *value, size_t size, int i)
+{
+    snprintf(value, size, "value of entry %d", i);
+}
+
+/*
+ * every entry that is not deleted can be found and iteration returns them in the order they were added
+ */
+static void _check(lxqt_wallet_t w, int deleted)
+{
+    lxqt_wallet_key_values_t e;
+    lxqt_wallet_iterator_t iter;
+    char key[ 32 ];
+    char value[ 32 ];
+    u_int64_t n = 0;
+    int i;
+
+    for (i = 0; i < COUNT; i++)
+    {
+        _key(key, sizeof(key), i);
+        _value(value, sizeof(value), i);
+
+        if (deleted && i % 3 == 0)
+        {
+            CHECK(!lxqt_wallet_wallet_has_key(w, key, strlen(key) + 1));
+        }
+        else
+        {
+            CHECK(lxqt_wallet_read_key_value(w, key, strlen(key) + 1, &e));
+            CHECK(e.key_value_size == strlen(value) && memcmp(e.key_value, value, e.key_value_size) == 0);
+            n++;
+        }
+    }
+
+    CHECK(lxqt_wallet_wallet_entry_count(w) == n);
+
+    iter.iter_pos = 0;
+    i = 0;
+
+    while (lxqt_wallet_iter_read_key(w, &iter))
+    {
+        while (deleted && i % 3 == 0)
+        {
+            i++;
+        }
+
+        _key(key, sizeof(key), i);
+        CHECK(iter.entry.key_size == strlen(key) + 1 && memcmp(iter.entry.key, key, iter.entry.key_size) == 0);
+        i++;
+    }
+
+    iter.iter_pos = 0;
+    n = 0;
+
+    while (lxqt_wallet_iter_read_prefix(w, "odd", 3, &iter))
+    {
+        CHECK(memcmp(iter.entry.key, "odd", 3) == 0);
+        n++;
+    }
+
+    CHECK(n == (deleted ? COUNT / 3 : COUNT / 2));
+
+    _value(value, sizeof(value), 1);
+    CHECK(lxqt_wallet_wallet_has_value(w, value, strlen(value), &e) && memcmp(e.key, "odd1", 5) == 0);
+}
+
+int main(void)
+{
+    lxqt_wallet_t w;
+    char key[ 32 ];
+    char value[ 32 ];
+    int i;
+
+    test_storage_root();
+
+    CHECK(lxqt_wallet_create("pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+
+    for (i = 0; i < COUNT; i++)
+    {
+        _key(key, sizeof(key), i);
+        _value(value, sizeof(value), i);
+        CHECK(lxqt_wallet_add_key(w, key, strlen(key) + 1, value, strlen(value)) == lxqt_wallet_no_error);
+    }
+
+    _check(w, 0);
+
+    for (i = 0; i < COUNT; i += 3)
+    {
+        _key(key, sizeof(key), i);
+        CHECK(lxqt_wallet_delete_key(w, key, strlen(key) + 1) == lxqt_wallet_no_error);
+    }
+
+    _check(w, 1);
+
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+
+    _check(w, 1);
+
+    /*
+     * deleted keys added back go to the end
+     */
+    for (i = 0; i < COUNT; i += 3)
+    {
+        _key(key, sizeof(key), i);
+        _value(value, sizeof(value), i);
+        CHECK(lxqt_wallet_add_key(w, key, strlen(key) + 1, value, strlen(value)) == lxqt_wallet_no_error);
+    }
+
+    CHECK(lxqt_wallet_wallet_entry_count(w) == COUNT);
+    CHECK(lxqt_wallet_set_compression(w, 1) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+
+    for (i = 0; i < COUNT; i += 3)
+    {
+        _key(key, sizeof(key), i);
+        CHECK(lxqt_wallet_delete_key(w, key, strlen(key) + 1) == lxqt_wallet_no_error);
+    }
+
+    _check(w, 1);
+
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    return 0;
+}
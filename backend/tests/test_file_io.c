@@ -0,0 +1,117 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * A file many times larger than the ring of buffers comes back unchanged,with reads and writes of several buffers in
+ * flight at once and at offsets past the header of the encrypted file.
+ */
+
+#include "test.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define MIB ( 1024 * 1024 )
+#define SIZE ( 23 * MIB + 517 )
+
+static int _progress(int percent, void *arg)
+{
+    (void)percent;
+    (void)arg;
+
+    return 0;
+}
+
+static char _byte(u_int64_t i)
+{
+    return (char)(i * 13 + i / 1021);
+}
+
+int main(void)
+{
+    const char *root = test_storage_root();
+    char plain[ 128 ];
+    char encrypted[ 128 ];
+    char decrypted[ 128 ];
+    char buffer[ 65536 ];
+    struct stat st;
+    u_int64_t i;
+    ssize_t n;
+    ssize_t j;
+    int fd;
+
+    snprintf(plain, sizeof(plain), "%s/plain", root);
+    snprintf(encrypted, sizeof(encrypted), "%s/encrypted", root);
+    snprintf(decrypted, sizeof(decrypted), "%s/decrypted", root);
+
+    fd = open(plain, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+
+    for (i = 0; i < SIZE; i += n)
+    {
+        n = SIZE - i < sizeof(buffer) ? (ssize_t)(SIZE - i) : (ssize_t)sizeof(buffer);
+
+        for (j = 0; j < n; j++)
+        {
+            buffer[ j ] = _byte(i + j);
+        }
+
+        CHECK(write(fd, buffer, n) == n);
+    }
+
+    close(fd);
+
+    lxqt_wallet_set_file_buffer_size(MIB);
+
+    CHECK(lxqt_wallet_create_encrypted_file("pw", 2, plain, encrypted, _progress, NULL) == lxqt_wallet_no_error);
+
+    /*
+     * a 64 byte header and the file padded to a multiple of 1024 bytes
+     */
+    CHECK(stat(encrypted, &st) == 0 && st.st_size == 64 + (SIZE + 1023) / 1024 * 1024);
+
+    CHECK(lxqt_wallet_create_decrypted_file("pw", 2, encrypted, decrypted, _progress, NULL) == lxqt_wallet_no_error);
+
+    fd = open(decrypted, O_RDONLY);
+    CHECK(fd >= 0 && fstat(fd, &st) == 0 && st.st_size == SIZE);
+
+    for (i = 0; (n = read(fd, buffer, sizeof(buffer))) > 0; i += n)
+    {
+        for (j = 0; j < n; j++)
+        {
+            CHECK(buffer[ j ] == _byte(i + j));
+        }
+    }
+
+    CHECK(n == 0 && i == SIZE);
+    close(fd);
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Files encrypted and decrypted through the ring of buffers come back unchanged whatever the buffer size and
+ * whether or not they end on a buffer boundary,progress goes up and ends at 100.
+ */
+
+#include "test.h"
+
+#include <fcntl.h>
+
+#define MIB ( 1024 * 1024 )
+
+static char _path[ 3 ][ 128 ];
+
+static int _progress(int percent, void *arg)
+{
+    int *last = arg;
+
+    CHECK(percent >= *last && percent <= 100);
+
+    *last = percent;
+
+    return 0;
+}
+
+static void _write_file(const char *path, u_int64_t size)
+{
+    char buffer[ 4096 ];
+    u_int64_t i = 0;
+    size_t n;
+    size_t j;
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    CHECK(fd >= 0);
+
+    while (i < size)
+    {
+        n = size - i < sizeof(buffer) ? size - i : sizeof(buffer);
+
+        for (j = 0; j < n; j++)
+        {
+            buffer[ j ] = (char)((i + j) * 7 + (i + j) / 4093);
+        }
+
+        CHECK(write(fd, buffer, n) == (ssize_t)n);
+
+        i += n;
+    }
+
+    close(fd);
+}
+
+static void _compare_files(const char *a, const char *b)
+{
+    char x[ 4096 ];
+    char y[ 4096 ];
+    ssize_t n;
+    int fa = open(a, O_RDONLY);
+    int fb = open(b, O_RDONLY);
+
+    CHECK(fa >= 0 && fb >= 0);
+
+    do
+    {
+        n = read(fa, x, sizeof(x));
+        CHECK(n >= 0 && read(fb, y, sizeof(y)) == n && memcmp(x, y, n) == 0);
+    }
+    while (n > 0);
+
+    close(fa);
+    close(fb);
+}
+
+static void _round_trip(u_int64_t size)
+{
+    int last = 0;
+
+    _write_file(_path[ 0 ], size);
+
+    CHECK(lxqt_wallet_create_encrypted_file("pw", 2, _path[ 0 ], _path[ 1 ], _progress, &last) == lxqt_wallet_no_error);
+    CHECK(last == 100);
+
+    last = 0;
+    CHECK(lxqt_wallet_create_decrypted_file("pw", 2, _path[ 1 ], _path[ 2 ], _progress, &last) == lxqt_wallet_no_error);
+    CHECK(last == 100);
+
+    _compare_files(_path[ 0 ], _path[ 2 ]);
+
+    unlink(_path[ 1 ]);
+    unlink(_path[ 2 ]);
+}
+
+int main(void)
+{
+    const char *root = test_storage_root();
+    static const u_int64_t sizes[] = { 0, 1, 31, 32, MIB - 1, MIB, MIB + 1, 5 * MIB + 17 };
+    static const u_int32_t buffer_sizes[] = { MIB, 2 * MIB + 1000, 8 * MIB, 64 * MIB };
+    size_t i;
+    size_t j;
+    int last = 0;
+
+    snprintf(_path[ 0 ], sizeof(_path[ 0 ]), "%s/plain", root);
+    snprintf(_path[ 1 ], sizeof(_path[ 1 ]), "%s/encrypted", root);
+    snprintf(_path[ 2 ], sizeof(_path[ 2 ]), "%s/decrypted", root);
+
+    for (i = 0; i < sizeof(buffer_sizes) / sizeof(buffer_sizes[ 0 ]); i++)
+    {
+        lxqt_wallet_set_file_buffer_size(buffer_sizes[ i ]);
+
+        for (j = 0; j < sizeof(sizes) / sizeof(sizes[ 0 ]); j++)
+        {
+            _round_trip(sizes[ j ]);
+        }
+    }
+
+    /*
+     * an existing destination is not written over
+     */
+    _write_file(_path[ 0 ], 100);
+    _write_file(_path[ 1 ], 1);
+    CHECK(lxqt_wallet_create_encrypted_file("pw", 2, _path[ 0 ], _path[ 1 ], _progress, &last) != lxqt_wallet_no_error);
+
+    return 0;
+}
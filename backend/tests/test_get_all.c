@@ -0,0 +1,169 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * "get-all" writes every file of the wallet to a folder,keys with '/' go to sub folders,keys that would land outside
+ * of the folder are refused and files that are already there are not replaced.
+ *
+ * The path to lxqt_wallet-cli is given as the first argument.
+ */
+
+#include "test.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define APPLICATION "lxqt_wallet-cli"
+#define FILES 500
+
+/*
+ * run "lxqt_wallet-cli --batch" with "get-all <path>" given through standard input
+ */
+static int _get_all(const char *cli, const char *path)
+{
+    char command[ 256 ];
+    int status;
+    int fds[ 2 ];
+    int pfds[ 2 ];
+    int fd;
+    int n;
+    pid_t pid;
+
+    CHECK(pipe(fds) == 0 && pipe(pfds) == 0);
+
+    pid = fork();
+    CHECK(pid >= 0);
+
+    if (pid == 0)
+    {
+        fd = open("/dev/null", O_WRONLY);
+
+        if (fd < 0 || dup2(fd, 1) < 0 || dup2(fds[ 0 ], 0) < 0 || dup2(pfds[ 0 ], 3) < 0)
+        {
+            _exit(127);
+        }
+
+        close(fds[ 1 ]);
+        close(pfds[ 1 ]);
+
+        execl(cli, cli, "--batch", "--wallet", "w", "--password-fd", "3", (char *)NULL);
+        _exit(127);
+    }
+
+    close(fds[ 0 ]);
+    close(pfds[ 0 ]);
+
+    CHECK(write(pfds[ 1 ], "pw", 2) == 2);
+    close(pfds[ 1 ]);
+
+    n = snprintf(command, sizeof(command), "get-all %s\n", path);
+    CHECK(write(fds[ 1 ], command, n) == n);
+    close(fds[ 1 ]);
+
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) != 127);
+
+    return WEXITSTATUS(status);
+}
+
+static void _add(lxqt_wallet_t w, const char *key, const char *value)
+{
+    CHECK(lxqt_wallet_add_key(w, key, strlen(key) + 1, value, strlen(value)) == lxqt_wallet_no_error);
+}
+
+static void _check_file(const char *path, const char *data)
+{
+    char buffer[ 256 ];
+    ssize_t n;
+    int fd = open(path, O_RDONLY);
+
+    CHECK(fd >= 0);
+
+    n = read(fd, buffer, sizeof(buffer));
+    CHECK(n == (ssize_t)strlen(data) && memcmp(buffer, data, n) == 0);
+
+    close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *root = test_storage_root();
+    struct stat st;
+    char key[ 64 ];
+    char path[ 256 ];
+    lxqt_wallet_t w;
+    int i;
+
+    CHECK(argc == 2);
+
+    CHECK(lxqt_wallet_create("pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+
+    for (i = 0; i < FILES; i++)
+    {
+        snprintf(key, sizeof(key), "file%d", i);
+        _add(w, key, key);
+    }
+
+    _add(w, "sub/folder/file", "deep");
+    _add(w, "empty", "");
+    _add(w, "kept", "new");
+    _add(w, "../escaped", "outside");
+
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    snprintf(path, sizeof(path), "%s/out", root);
+    CHECK(mkdir(path, 0700) == 0);
+    snprintf(path, sizeof(path), "%s/out/kept", root);
+    CHECK(close(open(path, O_WRONLY | O_CREAT, 0600)) == 0);
+    _check_file(path, "");
+
+    snprintf(path, sizeof(path), "%s/out", root);
+    CHECK(_get_all(argv[ 1 ], path) != 0);
+
+    for (i = 0; i < FILES; i++)
+    {
+        snprintf(key, sizeof(key), "file%d", i);
+        snprintf(path, sizeof(path), "%s/out/%s", root, key);
+        _check_file(path, key);
+    }
+
+    snprintf(path, sizeof(path), "%s/out/sub/folder/file", root);
+    _check_file(path, "deep");
+    snprintf(path, sizeof(path), "%s/out/empty", root);
+    _check_file(path, "");
+    snprintf(path, sizeof(path), "%s/out/kept", root);
+    _check_file(path, "");
+    snprintf(path, sizeof(path), "%s/escaped", root);
+    CHECK(stat(path, &st) != 0);
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Opening a wallet that is already opened shares its handle,a wallet opened after the storage root changed
+ * comes from the new root and gets a handle of its own.
+ */
+
+#include "test.h"
+
+#include <sys/stat.h>
+
+#define APPLICATION "lxqt_wallet_test"
+
+static int _value_is(lxqt_wallet_t w, const char *key, const char *value)
+{
+    lxqt_wallet_key_values_t e;
+
+    return lxqt_wallet_read_key_value(w, key, strlen(key) + 1, &e) && e.key_value_size == strlen(value)
+           && memcmp(e.key_value, value, e.key_value_size) == 0;
+}
+
+static void _create(const char *value)
+{
+    lxqt_wallet_t w;
+
+    CHECK(lxqt_wallet_create("pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_add_key(w, "k", 2, value, strlen(value)) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+}
+
+int main(void)
+{
+    lxqt_wallet_t a;
+    lxqt_wallet_t b;
+    lxqt_wallet_t c;
+    char root[ 128 ];
+    char other[ 256 ];
+
+    /*
+     * lxqt_wallet_set_storage_root() is not used while the environment variable is set
+     */
+    snprintf(root, sizeof(root), "%s", test_storage_root());
+    snprintf(other, sizeof(other), "%s/other", root);
+
+    CHECK(unsetenv("LXQT_WALLET_STORAGE_ROOT") == 0);
+    CHECK(mkdir(other, 0700) == 0);
+
+    CHECK(lxqt_wallet_set_storage_root(root) == lxqt_wallet_no_error);
+    _create("first");
+
+    CHECK(lxqt_wallet_set_storage_root(other) == lxqt_wallet_no_error);
+    _create("second");
+
+    lxqt_wallet_set_handle_cache(1);
+
+    CHECK(lxqt_wallet_set_storage_root(root) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_open(&a, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_open(&b, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(a == b);
+    CHECK(lxqt_wallet_open(&c, "wrong", 5, "w", APPLICATION) == lxqt_wallet_wrong_password);
+    CHECK(_value_is(a, "k", "first"));
+
+    CHECK(lxqt_wallet_set_storage_root(other) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_open(&c, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(c != a);
+    CHECK(_value_is(c, "k", "second"));
+
+    CHECK(lxqt_wallet_close(&c) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&b) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&a) == lxqt_wallet_no_error);
+
+    return 0;
+}
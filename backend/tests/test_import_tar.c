@@ -0,0 +1,352 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * "lxqt_wallet-cli --import-tar" adds an archive in batches,large files are streamed to the blobs folder,the last
+ * copy of a file the archive holds more than once wins across batches and a failed import adds nothing of the
+ * batch that failed.
+ *
+ * The path to lxqt_wallet-cli is given as the first argument.
+ */
+
+#include "test.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#define APPLICATION "lxqt_wallet-cli"
+#define BLOCK 512
+#define BATCH ( 64 * 1024 )
+#define EMPTY_FILES ( BATCH + 10 )
+#define BIG_SIZE ( 3 * 1024 * 1024 + 5 )
+#define DUP_SIZE ( 2 * 1024 * 1024 )
+
+static char _zeros[ BLOCK ];
+
+static char _byte(const char *name, u_int64_t i)
+{
+    return (char)(i * 31 + name[ 0 ] + i / 4099);
+}
+
+static void _write(int fd, const char *buffer, size_t size)
+{
+    CHECK(write(fd, buffer, size) == (ssize_t)size);
+}
+
+/*
+ * write a ustar header,"base256" stores the size as a big endian base-256 number like archivers do for sizes
+ * that do not fit in 11 octal digits
+ */
+static void _header(int fd, const char *name, u_int64_t size, char type, int base256)
+{
+    unsigned char h[ BLOCK ] = { 0 };
+    unsigned int sum = 0;
+    int i;
+
+    snprintf((char *)h, 100, "%s", name);
+    snprintf((char *)h + 100, 8, "%07o", 0600);
+
+    if (base256)
+    {
+        for (i = 11; i > 0; i--)
+        {
+            h[ 124 + i ] = (unsigned char)(size & 0xff);
+            size >>= 8;
+        }
+
+        h[ 124 ] = 0x80;
+    }
+    else
+    {
+        snprintf((char *)h + 124, 12, "%011llo", (unsigned long long)size);
+    }
+
+    h[ 156 ] = type;
+    memcpy(h + 257, "ustar", 6);
+    memcpy(h + 263, "00", 2);
+    memset(h + 148, ' ', 8);
+
+    for (i = 0; i < BLOCK; i++)
+    {
+        sum += h[ i ];
+    }
+
+    snprintf((char *)h + 148, 8, "%06o", sum);
+
+    _write(fd, (const char *)h, BLOCK);
+}
+
+/*
+ * write a file whose content is made by _byte(),only "written" bytes of it are written
+ */
+static void _file(int fd, const char *name, u_int64_t size, u_int64_t written, int base256)
+{
+    char buffer[ 4096 ];
+    u_int64_t i = 0;
+    size_t n;
+    size_t j;
+
+    _header(fd, name, size, '0', base256);
+
+    while (i < written)
+    {
+        n = written - i < sizeof(buffer) ? written - i : sizeof(buffer);
+
+        for (j = 0; j < n; j++)
+        {
+            buffer[ j ] = _byte(name, i + j);
+        }
+
+        _write(fd, buffer, n);
+
+        i += n;
+    }
+
+    if (written == size)
+    {
+        _write(fd, _zeros, (BLOCK - size % BLOCK) % BLOCK);
+    }
+}
+
+static int _run_cli(const char *cli, const char *action, const char *archive)
+{
+    int status;
+    int fds[ 2 ];
+    int fd;
+    pid_t pid;
+
+    CHECK(pipe(fds) == 0);
+
+    pid = fork();
+    CHECK(pid >= 0);
+
+    if (pid == 0)
+    {
+        fd = open("/dev/null", O_WRONLY);
+
+        if (fd < 0 || dup2(fd, 1) < 0 || dup2(fds[ 0 ], 3) < 0)
+        {
+            _exit(127);
+        }
+
+        close(fds[ 1 ]);
+
+        execl(cli, cli, action, "--wallet", "w", "--password-fd", "3", archive, (char *)NULL);
+        _exit(127);
+    }
+
+    close(fds[ 0 ]);
+    CHECK(write(fds[ 1 ], "pw", 2) == 2);
+    close(fds[ 1 ]);
+
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) != 127);
+
+    return WEXITSTATUS(status);
+}
+
+/*
+ * find "name" in an archive written by "--export-tar" and check its content
+ */
+static void _check_exported(const char *archive, const char *name, u_int64_t size)
+{
+    unsigned char h[ BLOCK ];
+    char buffer[ 4096 ];
+    u_int64_t file_size;
+    u_int64_t i;
+    ssize_t n;
+    ssize_t j;
+    int fd = open(archive, O_RDONLY);
+
+    CHECK(fd >= 0);
+
+    for (;;)
+    {
+        CHECK(read(fd, h, BLOCK) == BLOCK);
+        CHECK(memcmp(h, _zeros, BLOCK) != 0);
+
+        file_size = strtoull((const char *)h + 124, NULL, 8);
+
+        if (strcmp((const char *)h, name) == 0)
+        {
+            break;
+        }
+
+        CHECK(lseek(fd, (file_size + BLOCK - 1) / BLOCK * BLOCK, SEEK_CUR) != -1);
+    }
+
+    CHECK(file_size == size);
+
+    for (i = 0; i < size; i += n)
+    {
+        n = read(fd, buffer, size - i < sizeof(buffer) ? size - i : sizeof(buffer));
+        CHECK(n > 0);
+
+        for (j = 0; j < n; j++)
+        {
+            CHECK(buffer[ j ] == _byte(name, i + j));
+        }
+    }
+
+    close(fd);
+}
+
+static int _blob_files(const char *root)
+{
+    char path[ 256 ];
+    struct dirent *e;
+    DIR *dir;
+    int n = 0;
+
+    snprintf(path, sizeof(path), "%s/%s/w.blobs", root, APPLICATION);
+
+    dir = opendir(path);
+
+    if (dir == NULL)
+    {
+        return 0;
+    }
+
+    while ((e = readdir(dir)) != NULL)
+    {
+        n += e->d_name[ 0 ] != '.';
+    }
+
+    closedir(dir);
+
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *root = test_storage_root();
+    lxqt_wallet_key_values_t e;
+    lxqt_wallet_t w;
+    char archive[ 256 ];
+    char exported[ 256 ];
+    char name[ 32 ];
+    int fd;
+    int i;
+
+    CHECK(argc == 2);
+
+    snprintf(archive, sizeof(archive), "%s/archive.tar", root);
+    snprintf(exported, sizeof(exported), "%s/exported.tar", root);
+
+    /*
+     * "dup" is first small and then large in a later batch,the empty files fill the first batch
+     */
+    fd = open(archive, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+
+    _file(fd, "dup", 100, 100, 0);
+    _file(fd, "small", 1000, 1000, 0);
+    _header(fd, "folder/", 0, '5', 0);
+    _file(fd, "big", BIG_SIZE, BIG_SIZE, 1);
+
+    for (i = 0; i < EMPTY_FILES; i++)
+    {
+        snprintf(name, sizeof(name), "empty/%d", i);
+        _header(fd, name, 0, '0', 0);
+    }
+
+    _file(fd, "dup", DUP_SIZE, DUP_SIZE, 0);
+    _write(fd, _zeros, BLOCK);
+    _write(fd, _zeros, BLOCK);
+    close(fd);
+
+    CHECK(_run_cli(argv[ 1 ], "--import-tar", archive) == 0);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_wallet_entry_count(w) == EMPTY_FILES + 3);
+    CHECK(lxqt_wallet_read_key_value(w, "small", 6, &e) && e.key_value_size == 1000);
+    CHECK(lxqt_wallet_read_key_value(w, "empty/65545", 12, &e) && e.key_value_size == 0);
+    CHECK(!lxqt_wallet_read_key_value(w, "folder/", 8, &e));
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(_blob_files(root) == 2);
+
+    CHECK(_run_cli(argv[ 1 ], "--export-tar", exported) == 0);
+
+    _check_exported(exported, "small", 1000);
+    _check_exported(exported, "big", BIG_SIZE);
+    _check_exported(exported, "dup", DUP_SIZE);
+
+    /*
+     * an archive cut inside a large file fails,the first batch of it was added before and stays
+     */
+    fd = open(archive, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+
+    _file(fd, "other", 10, 10, 0);
+    _file(fd, "big2", BIG_SIZE, BIG_SIZE, 0);
+
+    for (i = 0; i < EMPTY_FILES; i++)
+    {
+        snprintf(name, sizeof(name), "more/%d", i);
+        _header(fd, name, 0, '0', 0);
+    }
+
+    _file(fd, "cut", BIG_SIZE, BIG_SIZE / 2, 0);
+    close(fd);
+
+    CHECK(_run_cli(argv[ 1 ], "--import-tar", archive) != 0);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_wallet_entry_count(w) == EMPTY_FILES + 3 + BATCH);
+    CHECK(lxqt_wallet_read_key_value(w, "other", 6, &e) && e.key_value_size == 10);
+    CHECK(lxqt_wallet_read_key_value(w, "more/0", 7, &e));
+    CHECK(!lxqt_wallet_read_key_value(w, "more/65545", 11, &e));
+    CHECK(!lxqt_wallet_read_key_value(w, "cut", 4, &e));
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(_blob_files(root) == 3);
+
+    /*
+     * files the wallet already has are refused
+     */
+    fd = open(archive, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+
+    _file(fd, "new", 10, 10, 0);
+    _file(fd, "small", 10, 10, 0);
+    _write(fd, _zeros, BLOCK);
+    close(fd);
+
+    CHECK(_run_cli(argv[ 1 ], "--import-tar", archive) != 0);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(!lxqt_wallet_read_key_value(w, "new", 4, &e));
+    CHECK(lxqt_wallet_read_key_value(w, "small", 6, &e) && e.key_value_size == 1000);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    return 0;
+}
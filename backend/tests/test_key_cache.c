@@ -0,0 +1,110 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Wallets opened with a cached key behave like wallets opened with a derived one,a wrong password still fails and
+ * a key cached before a password change or a purge is not used.
+ */
+
+#include "test.h"
+
+#define APPLICATION "lxqt_wallet_test"
+
+static void _open(const char *password, const char *wallet_name, lxqt_wallet_error expected)
+{
+    lxqt_wallet_key_values_t e;
+    lxqt_wallet_t w;
+
+    CHECK(lxqt_wallet_open(&w, password, strlen(password), wallet_name, APPLICATION) == expected);
+
+    if (expected == lxqt_wallet_no_error)
+    {
+        CHECK(lxqt_wallet_read_key_value(w, "k", 2, &e) && e.key_value_size == 1 && e.key_value[ 0 ] == 'v');
+        CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+    }
+}
+
+static void _create(const char *wallet_name)
+{
+    lxqt_wallet_t w;
+
+    CHECK(lxqt_wallet_create("pw", 2, wallet_name, APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_open(&w, "pw", 2, wallet_name, APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_add_key(w, "k", 2, "v", 1) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+}
+
+int main(void)
+{
+    lxqt_wallet_t w;
+
+    test_storage_root();
+
+    CHECK(lxqt_wallet_set_key_cache_timeout(60) == lxqt_wallet_no_error);
+
+    _create("a");
+    _create("b");
+
+    _open("pw", "a", lxqt_wallet_no_error);
+    _open("pw", "a", lxqt_wallet_no_error);
+    _open("pw", "b", lxqt_wallet_no_error);
+    _open("wrong", "a", lxqt_wallet_wrong_password);
+
+    /*
+     * a new password gives the wallet a new salt and the old key is not found
+     */
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "a", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_change_wallet_password(w, "new", 3) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    _open("pw", "a", lxqt_wallet_wrong_password);
+    _open("new", "a", lxqt_wallet_no_error);
+
+    lxqt_wallet_purge_wallet_key_cache("a", APPLICATION);
+    _open("new", "a", lxqt_wallet_no_error);
+    _open("pw", "b", lxqt_wallet_no_error);
+
+    lxqt_wallet_purge_key_cache();
+    _open("pw", "b", lxqt_wallet_no_error);
+
+    /*
+     * keys expire and a disabled cache is not used
+     */
+    CHECK(lxqt_wallet_set_key_cache_timeout(1) == lxqt_wallet_no_error);
+    _open("pw", "b", lxqt_wallet_no_error);
+    sleep(2);
+    _open("pw", "b", lxqt_wallet_no_error);
+    _open("wrong", "b", lxqt_wallet_wrong_password);
+
+    CHECK(lxqt_wallet_set_key_cache_timeout(0) == lxqt_wallet_no_error);
+    _open("pw", "b", lxqt_wallet_no_error);
+
+    return 0;
+}
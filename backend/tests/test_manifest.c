@@ -0,0 +1,138 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Wallets are listed from the manifest of their folder,it follows creates,saves and deletes and it is rebuilt from the
+ * folder when it is damaged.
+ */
+
+#include "test.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define APPLICATION "lxqt_wallet_test"
+
+/*
+ * the listed entry of "wallet_name" or NULL
+ */
+static const lxqt_wallet_info_t *_find(const lxqt_wallet_info_t *list, const char *wallet_name)
+{
+    for (; list->wallet_name != NULL; list++)
+    {
+        if (strcmp(list->wallet_name, wallet_name) == 0)
+        {
+            return list;
+        }
+    }
+
+    return NULL;
+}
+
+static u_int64_t _file_size(const char *wallet_name)
+{
+    char path[ 256 ];
+    struct stat st;
+
+    snprintf(path, sizeof(path), "%s/%s/%s.lwt", getenv("LXQT_WALLET_STORAGE_ROOT"), APPLICATION, wallet_name);
+    CHECK(stat(path, &st) == 0);
+
+    return st.st_size;
+}
+
+int main(void)
+{
+    const lxqt_wallet_info_t *e;
+    lxqt_wallet_info_t *list;
+    lxqt_wallet_t w;
+    char path[ 256 ];
+    char **names;
+    int size;
+    int fd;
+    int i;
+
+    test_storage_root();
+
+    list = lxqt_wallet_wallet_info_list(APPLICATION, &size);
+    CHECK(size == 0);
+    lxqt_wallet_free_wallet_info_list(list, size);
+
+    CHECK(lxqt_wallet_create("pw", 2, "a", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_create("pw", 2, "b", APPLICATION) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "a", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_add_key(w, "k1", 3, "v", 1) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_add_key(w, "k2", 3, "v", 1) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    list = lxqt_wallet_wallet_info_list(APPLICATION, &size);
+    CHECK(size == 2);
+    CHECK((e = _find(list, "a")) != NULL && e->entry_count == 2 && e->file_size == _file_size("a"));
+    CHECK((e = _find(list, "b")) != NULL && e->entry_count == 0 && e->file_size == _file_size("b"));
+    lxqt_wallet_free_wallet_info_list(list, size);
+
+    names = lxqt_wallet_wallet_list(APPLICATION, &size);
+    CHECK(size == 2 && names[ 2 ] == NULL);
+
+    for (i = 0; i < size; i++)
+    {
+        free(names[ i ]);
+    }
+
+    free(names);
+
+    CHECK(lxqt_wallet_delete_wallet("b", APPLICATION) == lxqt_wallet_no_error);
+
+    list = lxqt_wallet_wallet_info_list(APPLICATION, &size);
+    CHECK(size == 1 && _find(list, "b") == NULL);
+    lxqt_wallet_free_wallet_info_list(list, size);
+
+    /*
+     * a damaged manifest is rebuilt from the files in the folder,counts of entries are not known until a save
+     */
+    snprintf(path, sizeof(path), "%s/%s/wallets.manifest", getenv("LXQT_WALLET_STORAGE_ROOT"), APPLICATION);
+    fd = open(path, O_WRONLY | O_TRUNC);
+    CHECK(fd >= 0 && write(fd, "damaged", 7) == 7);
+    close(fd);
+
+    list = lxqt_wallet_wallet_info_list(APPLICATION, &size);
+    CHECK(size == 1 && (e = _find(list, "a")) != NULL && e->entry_count == -1 && e->file_size == _file_size("a"));
+    lxqt_wallet_free_wallet_info_list(list, size);
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "a", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_add_key(w, "k3", 3, "v", 1) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    list = lxqt_wallet_wallet_info_list(APPLICATION, &size);
+    CHECK(size == 1 && (e = _find(list, "a")) != NULL && e->entry_count == 3 && e->file_size == _file_size("a"));
+    lxqt_wallet_free_wallet_info_list(list, size);
+
+    return 0;
+}
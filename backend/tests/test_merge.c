@@ -0,0 +1,234 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Two handles of one wallet and two processes change the wallet at the same time,saves merge what the other
+ * saved and a save only replays changes the handle made.A save that can not be written leaves the old file.
+ */
+
+#include "test.h"
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define APPLICATION "lxqt_wallet_test"
+#define KEYS 50
+
+static void _add_keys(const char *prefix)
+{
+    lxqt_wallet_t w;
+    char key[ 32 ];
+    int i;
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+
+    for (i = 0; i < KEYS; i++)
+    {
+        snprintf(key, sizeof(key), "%s%d", prefix, i);
+
+        CHECK(lxqt_wallet_add_key(w, key, strlen(key) + 1, prefix, strlen(prefix)) == lxqt_wallet_no_error);
+
+        if (i % 5 == 0)
+        {
+            CHECK(lxqt_wallet_save(w) == lxqt_wallet_no_error);
+        }
+    }
+
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+}
+
+static int _value_is(lxqt_wallet_t w, const char *key, const char *value)
+{
+    lxqt_wallet_key_values_t e;
+
+    return lxqt_wallet_read_key_value(w, key, strlen(key) + 1, &e) && e.key_value_size == strlen(value)
+           && memcmp(e.key_value, value, e.key_value_size) == 0;
+}
+
+int main(void)
+{
+    lxqt_wallet_t a;
+    lxqt_wallet_t b;
+    char key[ 32 ];
+    pid_t pid;
+    int status;
+    int i;
+
+    test_storage_root();
+
+    CHECK(lxqt_wallet_create("pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+
+    /*
+     * two processes add different keys and save as they go
+     */
+    pid = fork();
+    CHECK(pid >= 0);
+
+    if (pid == 0)
+    {
+        _add_keys("child");
+        _exit(0);
+    }
+
+    _add_keys("parent");
+
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    CHECK(lxqt_wallet_open(&a, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_wallet_entry_count(a) == 2 * KEYS);
+
+    for (i = 0; i < KEYS; i++)
+    {
+        snprintf(key, sizeof(key), "child%d", i);
+        CHECK(_value_is(a, key, "child"));
+
+        snprintf(key, sizeof(key), "parent%d", i);
+        CHECK(_value_is(a, key, "parent"));
+    }
+
+    /*
+     * deleting a key "a" does not have must not delete the key "b" saved
+     */
+    CHECK(lxqt_wallet_open(&b, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_add_key(b, "x", 2, "1", 1) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_save(b) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_delete_key(a, "x", 2) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_add_key(a, "y", 2, "2", 1) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_save(a) == lxqt_wallet_no_error);
+
+    CHECK(_value_is(a, "x", "1"));
+    CHECK(_value_is(a, "y", "2"));
+
+    /*
+     * both handles replace a different key and close,each close merges what the other saved
+     */
+    CHECK(lxqt_wallet_reload(b) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_delete_key(a, "x", 2) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_add_key(a, "x", 2, "A", 1) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_delete_key(b, "y", 2) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_add_key(b, "y", 2, "B", 1) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_close(&a) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&b) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_open(&a, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(_value_is(a, "x", "A"));
+    CHECK(_value_is(a, "y", "B"));
+    CHECK(lxqt_wallet_wallet_entry_count(a) == 2 * KEYS + 2);
+
+    /*
+     * many keys changed through one handle,some of them more than once and through lxqt_wallet_add_keys(),
+     * are all replayed on top of what another handle saved
+     */
+    CHECK(lxqt_wallet_open(&b, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_add_key(b, "z", 2, "3", 1) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_save(b) == lxqt_wallet_no_error);
+
+    for (i = 0; i < 100 * KEYS; i++)
+    {
+        snprintf(key, sizeof(key), "many%d", i);
+
+        CHECK(lxqt_wallet_add_key(a, key, strlen(key) + 1, "m", 1) == lxqt_wallet_no_error);
+
+        if (i % 7 == 0)
+        {
+            CHECK(lxqt_wallet_delete_key(a, key, strlen(key) + 1) == lxqt_wallet_no_error);
+            CHECK(lxqt_wallet_add_key(a, key, strlen(key) + 1, "n", 1) == lxqt_wallet_no_error);
+        }
+    }
+
+    {
+        lxqt_wallet_key_values_t entries[ 3 ] = {
+            { "batch", 6, "1", 1 },
+            { "batch2", 7, "2", 1 },
+            { "many0", 6, "o", 1 }
+        };
+
+        CHECK(lxqt_wallet_delete_key(a, "many0", 6) == lxqt_wallet_no_error);
+        CHECK(lxqt_wallet_add_keys(a, entries, 3) == lxqt_wallet_no_error);
+    }
+
+    CHECK(lxqt_wallet_save(a) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&a) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&b) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_open(&a, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_wallet_entry_count(a) == 2 * KEYS + 3 + 100 * KEYS + 2);
+    CHECK(_value_is(a, "z", "3"));
+    CHECK(_value_is(a, "batch2", "2"));
+    CHECK(_value_is(a, "many0", "o"));
+    CHECK(_value_is(a, "many7", "n"));
+    CHECK(_value_is(a, "many8", "m"));
+
+    /*
+     * a save that runs out of file size fails,leaves the wallet file as it was and no temporary file behind
+     */
+    {
+        struct rlimit limit = { 4096, RLIM_INFINITY };
+        struct stat st;
+        struct stat st_1;
+        char path[ 256 ];
+
+        snprintf(path, sizeof(path), "%s/%s/w.lwt", getenv("LXQT_WALLET_STORAGE_ROOT"), APPLICATION);
+
+        CHECK(stat(path, &st) == 0);
+
+        pid = fork();
+        CHECK(pid >= 0);
+
+        if (pid == 0)
+        {
+            signal(SIGXFSZ, SIG_IGN);
+            CHECK(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+            CHECK(lxqt_wallet_add_key(a, "big", 4, "b", 1) == lxqt_wallet_no_error);
+            CHECK(lxqt_wallet_save(a) == lxqt_wallet_failed_to_open_file);
+            _exit(0);
+        }
+
+        CHECK(waitpid(pid, &status, 0) == pid);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        CHECK(stat(path, &st_1) == 0);
+        CHECK(st.st_ino == st_1.st_ino && st.st_size == st_1.st_size);
+
+        strcat(path, ".tmp");
+        CHECK(access(path, F_OK) != 0);
+    }
+
+    CHECK(lxqt_wallet_close(&a) == lxqt_wallet_no_error);
+
+    return 0;
+}
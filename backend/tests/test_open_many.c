@@ -0,0 +1,101 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * lxqt_wallet_open_many() opens every wallet it can and reports the ones it can not in their own slots.
+ */
+
+#include "test.h"
+
+#define APPLICATION "lxqt_wallet_test"
+#define COUNT 8
+
+int main(void)
+{
+    lxqt_wallet_key_values_t e;
+    lxqt_wallet_t wallets[ COUNT + 1 ];
+    lxqt_wallet_error errors[ COUNT + 1 ];
+    const char *names[ COUNT + 1 ];
+    char buffer[ COUNT ][ 16 ];
+    int i;
+
+    test_storage_root();
+
+    for (i = 0; i < COUNT; i++)
+    {
+        snprintf(buffer[ i ], sizeof(buffer[ i ]), "w%d", i);
+        names[ i ] = buffer[ i ];
+
+        CHECK(lxqt_wallet_create("pw", 2, names[ i ], APPLICATION) == lxqt_wallet_no_error);
+        CHECK(lxqt_wallet_open(&wallets[ i ], "pw", 2, names[ i ], APPLICATION) == lxqt_wallet_no_error);
+        CHECK(lxqt_wallet_add_key(wallets[ i ], "name", 5, names[ i ], strlen(names[ i ])) == lxqt_wallet_no_error);
+        CHECK(lxqt_wallet_close(&wallets[ i ]) == lxqt_wallet_no_error);
+    }
+
+    CHECK(lxqt_wallet_open_many(wallets, errors, names, COUNT, "pw", 2, APPLICATION) == lxqt_wallet_no_error);
+
+    for (i = 0; i < COUNT; i++)
+    {
+        CHECK(errors[ i ] == lxqt_wallet_no_error && wallets[ i ] != NULL);
+        CHECK(lxqt_wallet_read_key_value(wallets[ i ], "name", 5, &e));
+        CHECK(e.key_value_size == strlen(names[ i ]) && memcmp(e.key_value, names[ i ], e.key_value_size) == 0);
+        CHECK(lxqt_wallet_close(&wallets[ i ]) == lxqt_wallet_no_error);
+    }
+
+    /*
+     * a wallet that does not exist in the middle of the list does not stop the others from opening
+     */
+    names[ COUNT ] = names[ 2 ];
+    names[ 2 ] = "missing";
+
+    CHECK(lxqt_wallet_open_many(wallets, errors, names, COUNT + 1, "pw", 2, APPLICATION) != lxqt_wallet_no_error);
+
+    for (i = 0; i < COUNT + 1; i++)
+    {
+        if (i == 2)
+        {
+            CHECK(errors[ i ] != lxqt_wallet_no_error && wallets[ i ] == NULL);
+        }
+        else
+        {
+            CHECK(errors[ i ] == lxqt_wallet_no_error && wallets[ i ] != NULL);
+            CHECK(lxqt_wallet_close(&wallets[ i ]) == lxqt_wallet_no_error);
+        }
+    }
+
+    CHECK(lxqt_wallet_open_many(wallets, errors, names, COUNT, "wrong", 5, APPLICATION) == lxqt_wallet_wrong_password);
+
+    for (i = 0; i < COUNT; i++)
+    {
+        CHECK(wallets[ i ] == NULL);
+    }
+
+    return 0;
+}
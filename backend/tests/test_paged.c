@@ -0,0 +1,213 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * A paged wallet is iterated while entries are added,deleted and saved,with a cache of one page so pages are
+ * dropped and read again during the iteration,and the result survives closing and opening the wallet.
+ * A second handle is refused while the wallet is open and the wallet shows up in the manifest of its application.
+ */
+
+#include "test.h"
+
+#define APPLICATION "lxqt_wallet_test"
+#define KEYS 3000
+
+/*
+ * entry count of wallet "name" in the wallet info list,-2 if the wallet is not listed
+ */
+static int64_t _listed_entry_count(const char *name, int *version)
+{
+    lxqt_wallet_info_t *list;
+    int64_t r = -2;
+    int size;
+    int i;
+
+    list = lxqt_wallet_wallet_info_list(APPLICATION, &size);
+
+    CHECK(list != NULL);
+
+    for (i = 0; i < size; i++)
+    {
+        if (strcmp(list[ i ].wallet_name, name) == 0)
+        {
+            r = list[ i ].entry_count;
+            *version = list[ i ].version;
+        }
+    }
+
+    lxqt_wallet_free_wallet_info_list(list, size);
+
+    return r;
+}
+
+int main(void)
+{
+    lxqt_wallet_paged_t w;
+    lxqt_wallet_paged_t z;
+    char **names;
+    int version = 0;
+    lxqt_wallet_iterator_t iter;
+    char key[ 32 ];
+    char path[ 256 ];
+    char previous[ 32 ] = "";
+    char value[ 2000 ];
+    u_int32_t size;
+    int steps;
+    int i;
+
+    test_storage_root();
+
+    CHECK(lxqt_wallet_paged_create("pw", 2, "p", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_paged_create("pw", 2, "p", APPLICATION) == lxqt_wallet_wallet_exists);
+    CHECK(lxqt_wallet_create("pw", 2, "p", APPLICATION) == lxqt_wallet_wallet_exists);
+
+    CHECK(_listed_entry_count("p", &version) == 0);
+    CHECK(version & LXQT_WALLET_PAGED_VERSION_FLAG);
+
+    CHECK(lxqt_wallet_paged_open(&w, "pw", 2, "p", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_paged_open(&z, "pw", 2, "p", APPLICATION) == lxqt_wallet_wallet_busy);
+
+    memset(&iter, 0, sizeof(iter));
+    CHECK(!lxqt_wallet_paged_iter_read_value(w, &iter));
+    CHECK(lxqt_wallet_paged_last_error(w) == lxqt_wallet_no_error);
+
+    /*
+     * even keys,some with values that do not fit in a page
+     */
+    for (i = 0; i < KEYS; i += 2)
+    {
+        snprintf(key, sizeof(key), "k%05d", i);
+        size = i % 7 == 0 ? sizeof(value) : 20;
+        memset(value, 'a' + i % 26, size);
+
+        CHECK(lxqt_wallet_paged_add_key(w, key, strlen(key), value, size) == lxqt_wallet_no_error);
+    }
+
+    CHECK(lxqt_wallet_paged_save(w) == lxqt_wallet_no_error);
+
+    lxqt_wallet_paged_set_cache_size(w, 1);
+
+    /*
+     * every visited key is deleted,an even key adds the odd key after it,which is visited later,and a "j" key
+     * before all "k" keys,which is not
+     */
+    memset(&iter, 0, sizeof(iter));
+    steps = 0;
+
+    while (lxqt_wallet_paged_iter_read_value(w, &iter))
+    {
+        CHECK(iter.entry.key_size < sizeof(key));
+        memcpy(key, iter.entry.key, iter.entry.key_size);
+        key[ iter.entry.key_size ] = '\0';
+
+        CHECK(key[ 0 ] == 'k');
+        CHECK(strcmp(previous, key) < 0);
+        strcpy(previous, key);
+
+        i = atoi(key + 1);
+
+        if (i % 2 == 0)
+        {
+            CHECK(iter.entry.key_value_size == (i % 7 == 0 ? sizeof(value) : 20));
+            CHECK(iter.entry.key_value[ 0 ] == 'a' + i % 26);
+        }
+
+        CHECK(lxqt_wallet_paged_delete_key(w, key, strlen(key)) == lxqt_wallet_no_error);
+
+        if (i % 2 == 0)
+        {
+            snprintf(key, sizeof(key), "k%05d", i + 1);
+            CHECK(lxqt_wallet_paged_add_key(w, key, strlen(key), "odd", 3) == lxqt_wallet_no_error);
+
+            snprintf(key, sizeof(key), "j%05d", i);
+            CHECK(lxqt_wallet_paged_add_key(w, key, strlen(key), "before", 6) == lxqt_wallet_no_error);
+        }
+
+        if (steps % 100 == 0)
+        {
+            CHECK(lxqt_wallet_paged_save(w) == lxqt_wallet_no_error);
+        }
+
+        steps++;
+    }
+
+    CHECK(lxqt_wallet_paged_last_error(w) == lxqt_wallet_no_error);
+    CHECK(steps == KEYS);
+    CHECK(lxqt_wallet_paged_entry_count(w) == KEYS / 2);
+    CHECK(lxqt_wallet_paged_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_paged_open(&w, "pw", 2, "p", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_paged_entry_count(w) == KEYS / 2);
+
+    memset(&iter, 0, sizeof(iter));
+    steps = 0;
+
+    while (lxqt_wallet_paged_iter_read_value(w, &iter))
+    {
+        snprintf(key, sizeof(key), "j%05d", 2 * steps);
+
+        CHECK(iter.entry.key_size == strlen(key) && memcmp(iter.entry.key, key, iter.entry.key_size) == 0);
+        CHECK(iter.entry.key_value_size == 6 && memcmp(iter.entry.key_value, "before", 6) == 0);
+
+        steps++;
+    }
+
+    CHECK(lxqt_wallet_paged_last_error(w) == lxqt_wallet_no_error);
+    CHECK(steps == KEYS / 2);
+
+    memset(value, 'x', 600);
+    CHECK(lxqt_wallet_paged_add_key(w, value, 600, "v", 1) == lxqt_wallet_invalid_argument);
+
+    CHECK(lxqt_wallet_paged_close(&w) == lxqt_wallet_no_error);
+
+    CHECK(_listed_entry_count("p", &version) == KEYS / 2);
+
+    /*
+     * paged wallets can not be opened with lxqt_wallet_open() and are left out of the plain wallet list
+     */
+    names = lxqt_wallet_wallet_list(APPLICATION, &i);
+    CHECK(names != NULL && i == 0 && names[ 0 ] == NULL);
+    free(names);
+
+    CHECK(lxqt_wallet_paged_delete_wallet("p", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_paged_exists("p", APPLICATION) != 0);
+    CHECK(_listed_entry_count("p", &version) == -2);
+
+    /*
+     * a manifest rebuilt from the files in the folder lists paged wallets too
+     */
+    CHECK(lxqt_wallet_paged_create("pw", 2, "q", APPLICATION) == lxqt_wallet_no_error);
+    snprintf(path, sizeof(path), "%s/%s/wallets.manifest", getenv("LXQT_WALLET_STORAGE_ROOT"), APPLICATION);
+    CHECK(unlink(path) == 0);
+    CHECK(_listed_entry_count("q", &version) == -1);
+    CHECK(version & LXQT_WALLET_PAGED_VERSION_FLAG);
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Sharded wallets keep changes saved by two handles,and a deleted shard file is reported as
+ * lxqt_wallet_authentication_failed instead of being read as an empty shard.
+ */
+
+#include "test.h"
+
+#include <dirent.h>
+
+#define APPLICATION "lxqt_wallet_test"
+#define KEYS 200
+#define SHARDS 8
+
+static int _value_is(lxqt_wallet_sharded_t w, const char *key, const char *value)
+{
+    lxqt_wallet_key_values_t e;
+
+    return lxqt_wallet_sharded_read_key_value(w, key, strlen(key) + 1, &e) && e.key_value_size == strlen(value)
+           && memcmp(e.key_value, value, e.key_value_size) == 0;
+}
+
+static int _count(lxqt_wallet_sharded_t w)
+{
+    lxqt_wallet_iterator_t iter;
+    int count = 0;
+
+    memset(&iter, 0, sizeof(iter));
+
+    while (lxqt_wallet_sharded_iter_read_value(w, &iter))
+    {
+        count++;
+    }
+
+    return count;
+}
+
+int main(void)
+{
+    lxqt_wallet_sharded_t a;
+    lxqt_wallet_sharded_t b;
+    lxqt_wallet_info_t *info;
+    struct dirent *e;
+    DIR *dir;
+    char path[ 4096 ];
+    char shard[ 8192 ];
+    char key[ 32 ];
+    char value[ 32 ];
+    int missing;
+    int count;
+    int i;
+
+    test_storage_root();
+
+    CHECK(lxqt_wallet_sharded_create("pw", 2, SHARDS, "s", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_sharded_create("pw", 2, SHARDS, "s", APPLICATION) == lxqt_wallet_wallet_exists);
+    CHECK(lxqt_wallet_create("pw", 2, "s", APPLICATION) == lxqt_wallet_wallet_exists);
+    CHECK(lxqt_wallet_sharded_open(&a, "px", 2, "s", APPLICATION) == lxqt_wallet_wrong_password);
+
+    CHECK(lxqt_wallet_sharded_open(&a, "pw", 2, "s", APPLICATION) == lxqt_wallet_no_error);
+
+    for (i = 0; i < KEYS; i++)
+    {
+        snprintf(key, sizeof(key), "k%d", i);
+        snprintf(value, sizeof(value), "v%d", i);
+
+        CHECK(lxqt_wallet_sharded_add_key(a, key, strlen(key) + 1, value, strlen(value)) == lxqt_wallet_no_error);
+    }
+
+    CHECK(lxqt_wallet_sharded_save(a) == lxqt_wallet_no_error);
+
+    /*
+     * "b" reads a shard "a" saved after "b" was opened,then both save changes to different keys
+     */
+    CHECK(lxqt_wallet_sharded_open(&b, "pw", 2, "s", APPLICATION) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_sharded_add_key(a, "k1", 3, "A1", 2) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_sharded_save(a) == lxqt_wallet_no_error);
+    CHECK(_value_is(b, "k1", "A1"));
+
+    CHECK(lxqt_wallet_sharded_add_key(b, "k2", 3, "B2", 2) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_sharded_add_key(a, "k3", 3, "A3", 2) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_sharded_save(a) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_sharded_save(b) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_sharded_close(&b) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_sharded_close(&a) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_sharded_open(&a, "pw", 2, "s", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(_value_is(a, "k1", "A1"));
+    CHECK(_value_is(a, "k2", "B2"));
+    CHECK(_value_is(a, "k3", "A3"));
+    CHECK(_value_is(a, "k4", "v4"));
+    CHECK(_count(a) == KEYS);
+    CHECK(lxqt_wallet_sharded_last_error(a) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_sharded_close(&a) == lxqt_wallet_no_error);
+
+    info = lxqt_wallet_wallet_info_list(APPLICATION, &count);
+    CHECK(count == 1);
+    CHECK(info[ 0 ].version & LXQT_WALLET_SHARDED_VERSION_FLAG);
+    CHECK(info[ 0 ].entry_count == KEYS);
+    lxqt_wallet_free_wallet_info_list(info, count);
+
+    /*
+     * delete one shard file
+     */
+    lxqt_wallet_application_wallet_path(path, sizeof(path), APPLICATION);
+    strcat(path, "s.shards");
+
+    dir = opendir(path);
+    CHECK(dir != NULL);
+
+    count = 0;
+
+    while ((e = readdir(dir)) != NULL)
+    {
+        if (e->d_name[ 0 ] != '.')
+        {
+            snprintf(shard, sizeof(shard), "%s/%s", path, e->d_name);
+            count++;
+        }
+    }
+
+    closedir(dir);
+
+    CHECK(count == SHARDS);
+    CHECK(unlink(shard) == 0);
+
+    CHECK(lxqt_wallet_sharded_open(&a, "pw", 2, "s", APPLICATION) == lxqt_wallet_no_error);
+
+    CHECK(_count(a) < KEYS);
+    CHECK(lxqt_wallet_sharded_last_error(a) == lxqt_wallet_authentication_failed);
+
+    for (i = 0, missing = 0; i < KEYS; i++)
+    {
+        snprintf(key, sizeof(key), "k%d", i);
+
+        if (!lxqt_wallet_sharded_has_key(a, key, strlen(key) + 1))
+        {
+            CHECK(lxqt_wallet_sharded_last_error(a) == lxqt_wallet_authentication_failed);
+            missing++;
+        }
+    }
+
+    CHECK(missing > 0);
+    CHECK(lxqt_wallet_sharded_close(&a) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_sharded_delete_wallet("s", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_sharded_exists("s", APPLICATION) != 0);
+
+    info = lxqt_wallet_wallet_info_list(APPLICATION, &count);
+    CHECK(count == 0);
+    lxqt_wallet_free_wallet_info_list(info, count);
+
+    return 0;
+}
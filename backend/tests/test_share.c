@@ -0,0 +1,208 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * A shared wallet can be attached and read,a memory file with entry headers or a hash table that point outside of
+ * it is refused.
+ */
+
+#include "test.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#define APPLICATION "lxqt_wallet_test"
+#define SEALS ( F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL )
+
+/*
+ * entry header of a shared wallet,[ key offset ][ value offset ][ key hash ][ key size ][ value size ]
+ */
+struct header
+{
+    u_int64_t key;
+    u_int64_t value;
+    u_int64_t hash;
+    u_int32_t key_size;
+    u_int32_t value_size;
+};
+
+/*
+ * a shared wallet with one entry whose key is "a" and whose value is "value"
+ */
+struct shared
+{
+    struct header header;
+    u_int64_t slots[ 4 ];
+    char keys[ 2 ];
+    char values[ 5 ];
+};
+
+static u_int64_t _hash(const char *key, u_int32_t key_size)
+{
+    u_int64_t h = 14695981039346656037ULL;
+    u_int32_t i;
+
+    for (i = 0; i < key_size; i++)
+    {
+        h ^= (unsigned char)key[ i ];
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+static void _shared(struct shared *s)
+{
+    memset(s, '\0', sizeof(*s));
+
+    s->header.key        = 0;
+    s->header.value      = 0;
+    s->header.hash       = _hash("a", 2);
+    s->header.key_size   = 2;
+    s->header.value_size = 5;
+
+    s->slots[ s->header.hash & 3 ] = 1;
+
+    memcpy(s->keys, "a", 2);
+    memcpy(s->values, "value", 5);
+}
+
+/*
+ * a sealed memory file with the header of a shared wallet followed by "s"
+ */
+static int _memory_file(const struct shared *s)
+{
+    char header[ 48 ] = { '\0' };
+    u_int64_t sizes[ 4 ] = { 1, 4, sizeof(s->keys), sizeof(s->values) };
+    int fd = memfd_create("test", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+    CHECK(fd != -1);
+
+    memcpy(header, "lxqt_wallet_sh2", 16);
+    memcpy(header + 16, sizes, sizeof(sizes));
+
+    CHECK(write(fd, header, sizeof(header)) == sizeof(header));
+    CHECK(write(fd, &s->header, sizeof(s->header)) == sizeof(s->header));
+    CHECK(write(fd, s->slots, sizeof(s->slots)) == sizeof(s->slots));
+    CHECK(write(fd, s->keys, sizeof(s->keys)) == sizeof(s->keys));
+    CHECK(write(fd, s->values, sizeof(s->values)) == sizeof(s->values));
+    CHECK(fcntl(fd, F_ADD_SEALS, SEALS) == 0);
+
+    return fd;
+}
+
+static void _refused(const struct shared *s)
+{
+    lxqt_wallet_t a;
+    int fd = _memory_file(s);
+
+    CHECK(lxqt_wallet_attach(&a, fd) == lxqt_wallet_incompatible_wallet && a == NULL);
+    close(fd);
+}
+
+int main(void)
+{
+    lxqt_wallet_key_values_t e;
+    lxqt_wallet_iterator_t iter;
+    struct shared s;
+    lxqt_wallet_t w;
+    lxqt_wallet_t a;
+    int fd;
+
+    test_storage_root();
+
+    CHECK(lxqt_wallet_create("pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_add_key(w, "a", 2, "value", 5) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_add_key(w, "bb", 3, "", 0) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_share(w, &fd) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_attach(&a, fd) == lxqt_wallet_no_error);
+    close(fd);
+
+    CHECK(lxqt_wallet_wallet_entry_count(a) == 2);
+    CHECK(lxqt_wallet_read_key_value(a, "a", 2, &e) && e.key_value_size == 5 && memcmp(e.key_value, "value", 5) == 0);
+    CHECK(lxqt_wallet_read_key_value(a, "bb", 3, &e) && e.key_value_size == 0);
+    CHECK(!lxqt_wallet_read_key_value(a, "c", 2, &e));
+    CHECK(lxqt_wallet_add_key(a, "c", 2, "", 0) == lxqt_wallet_invalid_argument);
+
+    iter.iter_pos = 0;
+    CHECK(lxqt_wallet_iter_read_prefix(a, "b", 1, &iter) && memcmp(iter.entry.key, "bb", 3) == 0);
+    CHECK(!lxqt_wallet_iter_read_prefix(a, "b", 1, &iter));
+
+    CHECK(lxqt_wallet_close(&a) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    _shared(&s);
+    fd = _memory_file(&s);
+    CHECK(lxqt_wallet_attach(&a, fd) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_read_key_value(a, "a", 2, &e) && e.key_value_size == 5 && memcmp(e.key_value, "value", 5) == 0);
+    CHECK(lxqt_wallet_close(&a) == lxqt_wallet_no_error);
+    close(fd);
+
+    /*
+     * a key offset that wraps around when the key size is added to it
+     */
+    _shared(&s);
+    s.header.key = (u_int64_t)-1;
+    _refused(&s);
+
+    /*
+     * a value that runs past the end of the value arena
+     */
+    _shared(&s);
+    s.header.value = 1;
+    _refused(&s);
+
+    _shared(&s);
+    s.header.value_size = 100;
+    _refused(&s);
+
+    /*
+     * a slot that names an entry that is not there and a full hash table a lookup would never leave
+     */
+    _shared(&s);
+    s.slots[ 0 ] = 2;
+    _refused(&s);
+
+    _shared(&s);
+    s.slots[ 0 ] = s.slots[ 1 ] = s.slots[ 2 ] = s.slots[ 3 ] = 1;
+    _refused(&s);
+
+    /*
+     * a memory file that is not sealed could change after it was checked
+     */
+    fd = memfd_create("test", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    CHECK(fd != -1);
+    CHECK(lxqt_wallet_attach(&a, fd) == lxqt_wallet_invalid_argument);
+    close(fd);
+
+    return 0;
+}
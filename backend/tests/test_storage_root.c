@@ -0,0 +1,107 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Wallets are kept under the storage root,"LXQT_WALLET_STORAGE_ROOT" wins over a root set by the application and a
+ * wallet folder removed behind the back of the library is not used any more.
+ */
+
+#include "test.h"
+
+#include <sys/stat.h>
+
+#define APPLICATION "lxqt_wallet_test"
+
+static int _file_exists(const char *root, const char *wallet_name)
+{
+    char path[ 256 ];
+    struct stat st;
+
+    snprintf(path, sizeof(path), "%s/%s/%s.lwt", root, APPLICATION, wallet_name);
+
+    return stat(path, &st) == 0;
+}
+
+int main(void)
+{
+    const char *root = test_storage_root();
+    char one[ 128 ];
+    char two[ 128 ];
+    char path[ 256 ];
+    char expected[ 256 ];
+
+    snprintf(one, sizeof(one), "%s/one", root);
+    snprintf(two, sizeof(two), "%s/two", root);
+
+    CHECK(lxqt_wallet_set_storage_root("relative/path") == lxqt_wallet_invalid_argument);
+
+    /*
+     * the environment variable is used while it is set
+     */
+    CHECK(lxqt_wallet_set_storage_root(one) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_create("pw", 2, "env", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(_file_exists(root, "env"));
+
+    CHECK(unsetenv("LXQT_WALLET_STORAGE_ROOT") == 0);
+    CHECK(lxqt_wallet_set_storage_root(one) == lxqt_wallet_no_error);
+
+    CHECK(lxqt_wallet_exists("env", APPLICATION) != 0);
+    CHECK(lxqt_wallet_create("pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(_file_exists(one, "w"));
+    CHECK(lxqt_wallet_exists("w", APPLICATION) == 0);
+
+    lxqt_wallet_application_wallet_path(path, sizeof(path), APPLICATION);
+    snprintf(expected, sizeof(expected), "%s/%s/", one, APPLICATION);
+    CHECK(strcmp(path, expected) == 0);
+
+    CHECK(lxqt_wallet_set_storage_root(two) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_exists("w", APPLICATION) != 0);
+    CHECK(lxqt_wallet_create("pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(_file_exists(two, "w"));
+
+    /*
+     * a removed folder is not looked into through the descriptor kept of it
+     */
+    snprintf(path, sizeof(path), "%s/%s/w.lwt", two, APPLICATION);
+    CHECK(unlink(path) == 0);
+    snprintf(path, sizeof(path), "%s/%s/wallets.manifest", two, APPLICATION);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/%s", two, APPLICATION);
+    CHECK(rmdir(path) == 0);
+    CHECK(mkdir(path, 0700) == 0);
+
+    CHECK(lxqt_wallet_exists("w", APPLICATION) != 0);
+    CHECK(lxqt_wallet_create("pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(_file_exists(two, "w"));
+
+    CHECK(lxqt_wallet_set_storage_root(NULL) == lxqt_wallet_no_error);
+
+    return 0;
+}
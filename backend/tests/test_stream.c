@@ -0,0 +1,212 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Data encrypted from a pipe decrypts from a pipe and from a file to what went in,a stream that was cut short or
+ * modified is refused.
+ */
+
+#include "test.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define SIZE ( 3 * 1024 * 1024 + 77 )
+
+static char *_plain;
+static char _path[ 2 ][ 128 ];
+
+/*
+ * a pipe a child process writes "size" bytes of "data" into,the read end is returned
+ */
+static int _pipe(const char *data, u_int64_t size)
+{
+    int fds[ 2 ];
+    pid_t pid;
+
+    CHECK(pipe(fds) == 0);
+
+    pid = fork();
+    CHECK(pid >= 0);
+
+    if (pid == 0)
+    {
+        close(fds[ 0 ]);
+        _exit(write(fds[ 1 ], data, size) == (ssize_t)size ? 0 : 1);
+    }
+
+    close(fds[ 1 ]);
+
+    return fds[ 0 ];
+}
+
+static int _progress(int percent, void *arg)
+{
+    (void)percent;
+    (void)arg;
+
+    return 0;
+}
+
+static void _wait(void)
+{
+    int status;
+
+    CHECK(wait(&status) > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+/*
+ * read all of file "path" into a buffer of "*size" bytes
+ */
+static char *_read_file(const char *path, u_int64_t *size)
+{
+    struct stat st;
+    char *e;
+    int fd = open(path, O_RDONLY);
+
+    CHECK(fd >= 0 && fstat(fd, &st) == 0);
+
+    e = malloc(st.st_size + 1);
+    CHECK(e != NULL && read(fd, e, st.st_size) == st.st_size);
+
+    close(fd);
+
+    *size = st.st_size;
+
+    return e;
+}
+
+static int _open(const char *path)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    CHECK(fd >= 0);
+
+    return fd;
+}
+
+static lxqt_wallet_error _decrypt(const char *data, u_int64_t size)
+{
+    lxqt_wallet_error r;
+    int fd = _pipe(data, size);
+    int fd_dest = _open(_path[ 1 ]);
+
+    r = lxqt_wallet_decrypt_stream("pw", 2, fd, fd_dest, NULL, NULL);
+
+    close(fd);
+    close(fd_dest);
+
+    /*
+     * a refused stream may not have been read to its end and the writer may have been cut off
+     */
+    CHECK(wait(NULL) > 0);
+
+    return r;
+}
+
+static void _check_decrypted(void)
+{
+    u_int64_t size;
+    char *e = _read_file(_path[ 1 ], &size);
+
+    CHECK(size == SIZE && memcmp(e, _plain, SIZE) == 0);
+
+    free(e);
+}
+
+int main(void)
+{
+    const char *root = test_storage_root();
+    char buffer[ 100 ];
+    u_int64_t size;
+    u_int64_t n;
+    char *encrypted;
+    int fd;
+    int fd_dest;
+
+    snprintf(_path[ 0 ], sizeof(_path[ 0 ]), "%s/encrypted", root);
+    snprintf(_path[ 1 ], sizeof(_path[ 1 ]), "%s/decrypted", root);
+
+    _plain = malloc(SIZE);
+    CHECK(_plain != NULL);
+
+    for (n = 0; n < SIZE; n++)
+    {
+        _plain[ n ] = (char)(n * 11 + n / 65521);
+    }
+
+    fd = _pipe(_plain, SIZE);
+    fd_dest = _open(_path[ 0 ]);
+    CHECK(lxqt_wallet_encrypt_stream("pw", 2, fd, fd_dest, NULL, NULL) == lxqt_wallet_no_error);
+    close(fd);
+    close(fd_dest);
+    _wait();
+
+    encrypted = _read_file(_path[ 0 ], &size);
+
+    CHECK(_decrypt(encrypted, size) == lxqt_wallet_no_error);
+    _check_decrypted();
+
+    /*
+     * a saved stream is a seekable encrypted file
+     */
+    unlink(_path[ 1 ]);
+    CHECK(lxqt_wallet_create_decrypted_file("pw", 2, _path[ 0 ], _path[ 1 ], _progress, NULL) == lxqt_wallet_no_error);
+    _check_decrypted();
+
+    CHECK(lxqt_wallet_decrypt_range("pw", 2, _path[ 0 ], SIZE - 50, 100, buffer, &n) == lxqt_wallet_no_error);
+    CHECK(n == 50 && memcmp(buffer, _plain + SIZE - 50, 50) == 0);
+
+    CHECK(_decrypt(encrypted, size - 1) == lxqt_wallet_authentication_failed);
+    CHECK(_decrypt(encrypted, size - 100000) == lxqt_wallet_authentication_failed);
+
+    encrypted[ size / 2 ] ^= 1;
+    CHECK(_decrypt(encrypted, size) == lxqt_wallet_authentication_failed);
+    encrypted[ size / 2 ] ^= 1;
+
+    free(encrypted);
+
+    /*
+     * a buffer encrypts to a stream with its size in the header
+     */
+    fd_dest = _open(_path[ 0 ]);
+    CHECK(lxqt_wallet_encrypt_buffer("pw", 2, _plain, SIZE, fd_dest) == lxqt_wallet_no_error);
+    close(fd_dest);
+
+    encrypted = _read_file(_path[ 0 ], &size);
+    CHECK(_decrypt(encrypted, size) == lxqt_wallet_no_error);
+    _check_decrypted();
+    free(encrypted);
+
+    free(_plain);
+
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * "lxqt_wallet-cli --sync" reads a manifest cut at every length or with a damaged record without reading past it,
+ * syncs again the files the damaged manifest no longer lists and writes a whole manifest back.
+ *
+ * The path to lxqt_wallet-cli is given as the first argument.
+ */
+
+#include "test.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define APPLICATION "lxqt_wallet-cli"
+#define MANIFEST_KEY "\0sync"
+#define MANIFEST_KEY_SIZE 6
+
+static const char *_files[] = { "a", "b", "c" };
+static const char *_contents[] = { "one\n", "two\n", "three\n" };
+
+/*
+ * run "lxqt_wallet-cli --batch" with commands in "commands",the password is given through a pipe
+ */
+static void _run_cli(const char *cli, const char *commands)
+{
+    int status;
+    int fds[ 2 ];
+    int fd;
+    pid_t pid;
+
+    CHECK(pipe(fds) == 0);
+
+    pid = fork();
+    CHECK(pid >= 0);
+
+    if (pid == 0)
+    {
+        fd = open("/dev/null", O_WRONLY);
+
+        if (fd < 0 || dup2(fd, 1) < 0 || dup2(fds[ 0 ], 3) < 0)
+        {
+            _exit(127);
+        }
+
+        close(fds[ 1 ]);
+
+        execl(cli, cli, "--batch", "--wallet", "w", "--password-fd", "3", commands, (char *)NULL);
+        _exit(127);
+    }
+
+    close(fds[ 0 ]);
+    CHECK(write(fds[ 1 ], "pw", 2) == 2);
+    close(fds[ 1 ]);
+
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+/*
+ * check that the synced files are in the wallet and return a copy of the manifest,its size is put in "size"
+ */
+static char *_read_manifest(u_int32_t *size)
+{
+    lxqt_wallet_t w;
+    lxqt_wallet_key_values_t e;
+    char *buffer;
+    size_t i;
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+
+    for (i = 0; i < sizeof(_files) / sizeof(_files[ 0 ]); i++)
+    {
+        CHECK(lxqt_wallet_read_key_value(w, _files[ i ], strlen(_files[ i ]) + 1, &e));
+        CHECK(e.key_value_size == strlen(_contents[ i ]));
+        CHECK(memcmp(e.key_value, _contents[ i ], e.key_value_size) == 0);
+    }
+
+    CHECK(lxqt_wallet_wallet_entry_count(w) == sizeof(_files) / sizeof(_files[ 0 ]) + 1);
+    CHECK(lxqt_wallet_read_key_value(w, MANIFEST_KEY, MANIFEST_KEY_SIZE, &e));
+
+    buffer = malloc(e.key_value_size + 1);
+    CHECK(buffer != NULL);
+    memcpy(buffer, e.key_value, e.key_value_size);
+    *size = e.key_value_size;
+
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+
+    return buffer;
+}
+
+static void _write_manifest(const char *buffer, u_int32_t size)
+{
+    lxqt_wallet_t w;
+
+    CHECK(lxqt_wallet_open(&w, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_delete_key(w, MANIFEST_KEY, MANIFEST_KEY_SIZE) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_add_key(w, MANIFEST_KEY, MANIFEST_KEY_SIZE, buffer, size) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_close(&w) == lxqt_wallet_no_error);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *root = test_storage_root();
+    char commands[ 128 ];
+    char path[ 128 ];
+    char *manifest;
+    char *buffer;
+    u_int32_t size;
+    u_int32_t record;
+    u_int32_t n;
+    u_int32_t i;
+    FILE *f;
+
+    CHECK(argc == 2);
+
+    snprintf(path, sizeof(path), "%s/files", root);
+    CHECK(mkdir(path, 0700) == 0);
+
+    for (i = 0; i < sizeof(_files) / sizeof(_files[ 0 ]); i++)
+    {
+        snprintf(path, sizeof(path), "%s/files/%s", root, _files[ i ]);
+
+        f = fopen(path, "w");
+        CHECK(f != NULL);
+        CHECK(fputs(_contents[ i ], f) >= 0);
+        CHECK(fclose(f) == 0);
+    }
+
+    snprintf(commands, sizeof(commands), "%s/commands", root);
+
+    f = fopen(commands, "w");
+    CHECK(f != NULL);
+    fprintf(f, "sync %s/files\n", root);
+    CHECK(fclose(f) == 0);
+
+    _run_cli(argv[ 1 ], commands);
+
+    manifest = _read_manifest(&size);
+    CHECK(size > 0);
+
+    /*
+     * all paths have the same length and so do all records.A manifest cut between records is a whole manifest of
+     * fewer synced files,files it does not list were not added by a sync and are left alone
+     */
+    record = size / (sizeof(_files) / sizeof(_files[ 0 ]));
+
+    for (i = 0; i < size; i++)
+    {
+        _write_manifest(manifest, i);
+        _run_cli(argv[ 1 ], commands);
+
+        buffer = _read_manifest(&n);
+
+        if (i % record == 0)
+        {
+            CHECK(n == i && memcmp(buffer, manifest, n) == 0);
+        }
+        else
+        {
+            CHECK(n == size && memcmp(buffer, manifest, n) == 0);
+        }
+
+        free(buffer);
+    }
+
+    /*
+     * a path size that runs past the end of the manifest
+     */
+    buffer = malloc(size);
+    CHECK(buffer != NULL);
+    memcpy(buffer, manifest, size);
+    memset(buffer, 0xff, 4);
+
+    _write_manifest(buffer, size);
+    free(buffer);
+
+    _run_cli(argv[ 1 ], commands);
+
+    buffer = _read_manifest(&n);
+    CHECK(n == size && memcmp(buffer, manifest, n) == 0);
+
+    free(buffer);
+    free(manifest);
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * copyright: 2013-2015
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * A thread safe handle can be read by many threads while another thread adds and deletes entries,readers holding
+ * the read lock see every entry that is never deleted with its value intact.
+ */
+
+#include "test.h"
+
+#include <pthread.h>
+
+#define APPLICATION "lxqt_wallet_test"
+#define KEYS 64
+#define READERS 4
+#define ROUNDS 2000
+
+static lxqt_wallet_t _wallet;
+static int _done;
+
+static void *_reader(void *arg)
+{
+    lxqt_wallet_key_values_t e;
+    char key[ 16 ];
+    int i = 0;
+
+    (void)arg;
+
+    while (!__atomic_load_n(&_done, __ATOMIC_ACQUIRE))
+    {
+        snprintf(key, sizeof(key), "key%d", i % KEYS);
+
+        lxqt_wallet_read_lock(_wallet);
+
+        CHECK(lxqt_wallet_read_key_value(_wallet, key, strlen(key) + 1, &e));
+        CHECK(e.key_value_size == strlen(key) + 1 && memcmp(e.key_value, key, e.key_value_size) == 0);
+
+        lxqt_wallet_read_unlock(_wallet);
+
+        i++;
+    }
+
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t readers[ READERS ];
+    char key[ 16 ];
+    int i;
+
+    test_storage_root();
+
+    CHECK(lxqt_wallet_create("pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_open(&_wallet, "pw", 2, "w", APPLICATION) == lxqt_wallet_no_error);
+    CHECK(lxqt_wallet_set_thread_safe(_wallet) == lxqt_wallet_no_error);
+
+    for (i = 0; i < KEYS; i++)
+    {
+        snprintf(key, sizeof(key), "key%d", i);
+        CHECK(lxqt_wallet_add_key(_wallet, key, strlen(key) + 1, key, strlen(key) + 1) == lxqt_wallet_no_error);
+    }
+
+    for (i = 0; i < READERS; i++)
+    {
+        CHECK(pthread_create(&readers[ i ], NULL, _reader, NULL) == 0);
+    }
+
+    /*
+     * entries added and deleted by the writer move the entries the readers look at
+     */
+    for (i = 0; i < ROUNDS; i++)
+    {
+        snprintf(key, sizeof(key), "temp%d", i);
+        CHECK(lxqt_wallet_add_key(_wallet, key, strlen(key) + 1, "x", 1) == lxqt_wallet_no_error);
+
+        if (i % 2)
+        {
+            snprintf(key, sizeof(key), "temp%d", i - 1);
+            CHECK(lxqt_wallet_delete_key(_wallet, key, strlen(key) + 1) == lxqt_wallet_no_error);
+        }
+    }
+
+    __atomic_store_n(&_done, 1, __ATOMIC_RELEASE);
+
+    for (i = 0; i < READERS; i++)
+    {
+        CHECK(pthread_join(readers[ i ], NULL) == 0);
+    }
+
+    CHECK(lxqt_wallet_wallet_entry_count(_wallet) == KEYS + ROUNDS / 2);
+    CHECK(lxqt_wallet_close(&_wallet) == lxqt_wallet_no_error);
+
+    return 0;
+}
@@ -30,15 +30,138 @@
 
 #include "lxqt_internal_wallet.h"
 
+#include <QCoreApplication>
+
+#include <mutex>
+#include <condition_variable>
+#include <cstdlib>
+#include <map>
+#include <utility>
+
 namespace Task = LXQt::Wallet::Task;
 
+namespace
+{
+
+/*
+ * Keeps count of wallets that are being encrypted and saved in background threads.
+ *
+ * Counts are kept per wallet name and application name so that opening,deleting or checking
+ * the existence of a wallet only waits for pending closes of that wallet.All pending closes
+ * are waited for when the application exits so that changes are never lost.
+ */
+class backgroundCloses
+{
+public:
+    static backgroundCloses &instance()
+    {
+        static backgroundCloses e;
+        return e;
+    }
+    using key = std::pair< QString,QString >;
+
+    void add(const key &k)
+    {
+        std::lock_guard< std::mutex > lock(m_mutex);
+
+        m_count++;
+        m_pending[ k ]++;
+
+        if (!m_postRoutineAdded && QCoreApplication::instance())
+        {
+            m_postRoutineAdded = true;
+
+            qAddPostRoutine([]() { backgroundCloses::instance().wait(); });
+        }
+    }
+    void remove(const key &k)
+    {
+        std::lock_guard< std::mutex > lock(m_mutex);
+
+        m_count--;
+
+        auto it = m_pending.find(k);
+
+        if (it != m_pending.end() && --it->second == 0)
+        {
+            m_pending.erase(it);
+        }
+
+        m_done.notify_all();
+    }
+    void wait()
+    {
+        std::unique_lock< std::mutex > lock(m_mutex);
+
+        m_done.wait(lock, [this]() { return m_count == 0; });
+    }
+    void wait(const key &k)
+    {
+        std::unique_lock< std::mutex > lock(m_mutex);
+
+        m_done.wait(lock, [this,&k]() { return m_pending.find(k) == m_pending.end(); });
+    }
+    ~backgroundCloses()
+    {
+        this->wait();
+    }
+private:
+    backgroundCloses() = default;
+    std::mutex m_mutex;
+    std::condition_variable m_done;
+    std::map< key,int > m_pending;
+    int m_count = 0;
+    bool m_postRoutineAdded = false;
+};
+
+void _closeWalletInBackground(lxqt_wallet_t wallet,
+			      const backgroundCloses::key &k,
+			      std::function< void(bool) > function)
+{
+    if (QCoreApplication::closingDown() || QCoreApplication::instance() == nullptr)
+    {
+        /*
+         * There is no event loop to deliver the result to,close the wallet here.
+         */
+        function(lxqt_wallet_close(&wallet) == lxqt_wallet_no_error);
+
+        return;
+    }
+
+    backgroundCloses::instance().add(k);
+
+    Task::run< lxqt_wallet_error >([wallet,k]()mutable
+    {
+        auto r = lxqt_wallet_close(&wallet);
+
+        backgroundCloses::instance().remove(k);
+
+        return r;
+
+    }).then([function = std::move(function)](lxqt_wallet_error r)
+    {
+        function(r == lxqt_wallet_no_error);
+    });
+}
+
+}
+
 LXQt::Wallet::internalWallet::internalWallet() : m_wallet(nullptr)
 {
 }
 
 LXQt::Wallet::internalWallet::~internalWallet()
 {
-    lxqt_wallet_close(&m_wallet);
+    if (m_wallet)
+    {
+        _closeWalletInBackground(m_wallet, {m_walletName,m_applicationName}, [](bool e) { Q_UNUSED(e) });
+    }
+}
+
+void LXQt::Wallet::internalWallet::waitForBackgroundCloses(const QString &walletName,
+							   const QString &applicationName)
+{
+    backgroundCloses::instance().wait({walletName,applicationName});
 }
 
 void LXQt::Wallet::internalWallet::setImage(const QIcon &image)
@@ -52,6 +175,8 @@ void LXQt::Wallet::internalWallet::openWallet(QString password)
 
     Task::run< lxqt_wallet_error >([this]()
     {
+        backgroundCloses::instance().wait({m_walletName,m_applicationName});
+
         return lxqt_wallet_open(&m_wallet,
                                 m_password.toLatin1().constData(),
                                 m_password.size(), m_walletName.toLatin1().constData(),
@@ -151,6 +276,8 @@ void LXQt::Wallet::internalWallet::openWallet()
 
 	Task::run< lxqt_wallet_error >([this]()
         {
+            backgroundCloses::instance().wait({m_walletName,m_applicationName});
+
             return lxqt_wallet_open(&m_wallet,
                                     m_password.toLatin1().constData(),
                                     m_password.size(),
@@ -262,6 +389,8 @@ void LXQt::Wallet::internalWallet::changeWalletPassWord(const QString &walletNam
 
 	auto result = Task::await<args>([&]()->args{
 
+            backgroundCloses::instance().wait({m_walletName,m_applicationName});
+
             if (!this->opened())
             {
 		auto s = _open(old);
@@ -343,7 +472,7 @@ QStringList LXQt::Wallet::internalWallet::readAllKeys()
 
     iter.iter_pos = 0;
 
-    while (lxqt_wallet_iter_read_value(m_wallet, &iter))
+    while (lxqt_wallet_iter_read_key(m_wallet, &iter))
     {
 	l.append(QByteArray(iter.entry.key, iter.entry.key_size - 1));
     }
@@ -377,9 +506,26 @@ int LXQt::Wallet::internalWallet::walletSize(void)
 }
 
 void LXQt::Wallet::internalWallet::closeWallet(bool b)
+{
+    this->closeWalletAsync([](bool e) { Q_UNUSED(e) }, b);
+}
+
+void LXQt::Wallet::internalWallet::closeWalletAsync(std::function< void(bool) > function, bool b)
 {
     Q_UNUSED(b)
-    lxqt_wallet_close(&m_wallet);
+
+    if (m_wallet == nullptr)
+    {
+        function(false);
+    }
+    else
+    {
+        auto wallet = m_wallet;
+
+        m_wallet = nullptr;
+
+        _closeWalletInBackground(wallet, {m_walletName,m_applicationName}, std::move(function));
+    }
 }
 
 LXQt::Wallet::BackEnd LXQt::Wallet::internalWallet::backEnd()
@@ -410,20 +556,20 @@ QString LXQt::Wallet::internalWallet::storagePath()
 
 QStringList LXQt::Wallet::internalWallet::managedWalletList()
 {
-    char path[ 4096 ];
-    lxqt_wallet_application_wallet_path(path, 4096, m_applicationName.toLatin1().constData());
-    QDir d(path);
-    QStringList l = d.entryList();
-    l.removeOne(".");
-    l.removeOne("..");
-
-    if (l.size() > 0)
+    QStringList l;
+    int size = 0;
+
+    auto e = lxqt_wallet_wallet_list(m_applicationName.toLatin1().constData(), &size);
+
+    if (e != nullptr)
     {
-        /*
-         * remove the extension part of a file name
-         */
-	const QString &q = l.at(0);
-	l.replaceInStrings(q.mid(q.indexOf(".")), "");
+        for (int i = 0; i < size; i++)
+        {
+            l.append(QString::fromLatin1(e[ i ]));
+            free(e[ i ]);
+        }
+
+        free(e);
     }
 
     return l;
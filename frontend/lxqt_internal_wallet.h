@@ -94,6 +94,15 @@ public:
 
     void deleteKey(const QString &key) ;
     void closeWallet(bool) ;
+
+    /*
+     * Close the wallet without blocking the calling thread.
+     *
+     * The wallet is encrypted and saved in a background thread and the passed in lambda will be
+     * called on the calling thread with "true" if the wallet was successfully closed and with
+     * "false" otherwise.Wallets that are still being saved when the application exits are waited for.
+     */
+    void closeWalletAsync(std::function< void(bool) >, bool option = false) ;
     void changeWalletPassWord(const QString &walletName,
                               const QString &applicationName = QString(),
     std::function< void(bool) > = [](bool e) { Q_UNUSED(e) }) ;
@@ -103,6 +112,11 @@ public:
 
     LXQt::Wallet::BackEnd backEnd(void) ;
     QObject *qObject(void) ;
+
+    /*
+     * Block until the named wallet is saved if it is being closed in a background thread.
+     */
+    static void waitForBackgroundCloses(const QString &walletName,const QString &applicationName) ;
 private:
     void walletIsOpen(bool) ;
 
@@ -176,6 +176,11 @@ bool LXQt::Wallet::deleteWallet(LXQt::Wallet::BackEnd bk,
 
     if (bk == LXQt::Wallet::BackEnd::internal)
     {
+        /*
+         * A wallet that is still being saved in the background would be recreated after deletion.
+         */
+        LXQt::Wallet::internalWallet::waitForBackgroundCloses(walletName,appName);
+
         auto e = lxqt_wallet_delete_wallet(walletName.toLatin1().constData(),
                                            appName.toLatin1().constData());
 
@@ -216,6 +221,11 @@ bool LXQt::Wallet::walletExists(LXQt::Wallet::BackEnd bk,
 
     if (bk == LXQt::Wallet::BackEnd::internal)
     {
+        /*
+         * A wallet that is still being saved in the background may not have its file yet.
+         */
+        LXQt::Wallet::internalWallet::waitForBackgroundCloses(walletName,appName);
+
         return lxqt_wallet_exists(walletName.toLatin1().constData(),
                                   appName.toLatin1().constData()) == 0;
     }
@@ -245,14 +255,10 @@ QStringList LXQt::Wallet::walletList(LXQt::Wallet::BackEnd bk)
 
         lxqt_wallet_application_wallet_path(path, 4096, "");
 
-        QDir d(path);
-
-        auto l = d.entryList();
-
-        l.removeOne(".");
-        l.removeOne("..");
-
-        return l;
+        /*
+         * the internal backend keeps wallets of each application in a directory named after the application
+         */
+        return QDir(path).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
     }
     else if (bk == LXQt::Wallet::BackEnd::kwallet)
     {
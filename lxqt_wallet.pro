@@ -12,7 +12,7 @@ TEMPLATE = app
 
 INCLUDEPATH += /home/local/KDE4/include /usr/include /home/ink/src/lxqt_wallet-build /home/ink/src/wallet_manager /usr/include/ /usr/include/libsecret-1 /usr/include/libsecret-1/libsecret /usr/include/glib-2.0 /usr/lib/glib-2.0/include
 
-LIBS += -lgcrypt -lkwalletbackend -L/home/local/KDE4/lib -lsecret-1
+LIBS += -lgcrypt -lz -lkwalletbackend -L/home/local/KDE4/lib -lsecret-1
 
 OTHER_FILES += \
     frontend/README \